@@ -162,15 +162,23 @@
 ./build/build-resample.sh 0 0 0
 ./build/build-stretchpitch.sh 0 0 0
 ./build/build-scale.sh 0 0 0
+./build/build-bsf.sh 0 0 0
+./build/build-yuv2rgba.sh 0 0 0
 
 ./build/build-resample.sh 0 1 0
 ./build/build-stretchpitch.sh 0 1 0
 ./build/build-scale.sh 0 1 0
+./build/build-bsf.sh 0 1 0
+./build/build-yuv2rgba.sh 0 1 0
 
 ./build/build-resample.sh 1 1 0
 ./build/build-stretchpitch.sh 1 1 0
 ./build/build-scale.sh 1 1 0
+./build/build-bsf.sh 1 1 0
+./build/build-yuv2rgba.sh 1 1 0
 
 ./build/build-resample.sh 1 1 1
 ./build/build-stretchpitch.sh 1 1 1
-./build/build-scale.sh 1 1 1
\ No newline at end of file
+./build/build-scale.sh 1 1 1
+./build/build-bsf.sh 1 1 1
+./build/build-yuv2rgba.sh 1 1 1
\ No newline at end of file
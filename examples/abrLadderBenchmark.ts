@@ -0,0 +1,106 @@
+import AVTranscoder, { type TaskOptions } from '@libmedia/avtranscoder'
+
+const ladder = [
+  { width: 1920, height: 1080, bitrate: 5000000 },
+  { width: 1280, height: 720, bitrate: 2800000 },
+  { width: 854, height: 480, bitrate: 1400000 }
+]
+
+function createMemoryWriter() {
+  let size = 0
+  return {
+    write: (buffer: Uint8Array<ArrayBuffer>) => {
+      size += buffer.length
+    },
+    appendBufferByPosition: (buffer: Uint8Array<ArrayBuffer>, pos: number) => {},
+    seek: (pos: number) => {},
+    close: () => {},
+    size: () => size
+  }
+}
+
+function waitTask(transcoder: AVTranscoder, taskId: string) {
+  return new Promise<void>((resolve) => {
+    const onEnded = (id: string) => {
+      if (id === taskId) {
+        transcoder.off(AVTranscoder.Events.TASK_ENDED, onEnded)
+        resolve()
+      }
+    }
+    transcoder.on(AVTranscoder.Events.TASK_ENDED, onEnded)
+  })
+}
+
+async function run(transcoder: AVTranscoder, options: TaskOptions) {
+  const taskId = await transcoder.addTask(options)
+  const ended = waitTask(transcoder, taskId)
+  await transcoder.startTask(taskId)
+  await ended
+}
+
+/**
+ * compare one decode fanned out to the whole ladder against one full transcode per rendition
+ */
+export async function benchmarkAbrLadder(file: File) {
+
+  const transcoder = new AVTranscoder({})
+  await transcoder.ready()
+
+  let start = performance.now()
+
+  for (let i = 0; i < ladder.length; i++) {
+    await run(transcoder, {
+      input: {
+        file
+      },
+      output: {
+        file: createMemoryWriter(),
+        format: 'mp4',
+        audio: {
+          disable: true
+        },
+        video: {
+          codec: 'h264',
+          ...ladder[i]
+        }
+      }
+    })
+  }
+
+  const separateCost = performance.now() - start
+
+  start = performance.now()
+
+  await run(transcoder, {
+    input: {
+      file
+    },
+    output: {
+      file: createMemoryWriter(),
+      format: 'mp4',
+      audio: {
+        disable: true
+      },
+      video: {
+        codec: 'h264',
+        ...ladder[0]
+      }
+    },
+    renditions: ladder.slice(1).map((rendition) => {
+      return {
+        file: createMemoryWriter(),
+        format: 'mp4',
+        video: {
+          codec: 'h264',
+          ...rendition
+        }
+      }
+    })
+  })
+
+  const ladderCost = performance.now() - start
+
+  console.log(`${ladder.length} renditions: separate runs ${separateCost.toFixed(2)}ms, single decode ${ladderCost.toFixed(2)}ms, speedup ${(separateCost / ladderCost).toFixed(2)}x`)
+
+  await transcoder.destroy()
+}
@@ -0,0 +1,125 @@
+import { IOReader, IOWriterSync, IOError } from '@libmedia/common/io'
+import { createAVPacket, destroyAVPacket, unrefAVPacket, copyCodecParameters, compileResource } from '@libmedia/avutil'
+import { createAVIFormatContext, createAVOFormatContext, demux, mux, bsfKernel } from '@libmedia/avformat'
+import IMpegtsFormat from '@libmedia/avformat/IMpegtsFormat'
+import OIsobmffFormat from '@libmedia/avformat/OIsobmffFormat'
+
+/**
+ * remux a local AAC/H.264 mpegts file to mp4 in the current thread and measure throughput
+ */
+async function remux(readFile: File) {
+  const iformatContext = createAVIFormatContext()
+  const ioReader = new IOReader()
+
+  iformatContext.ioReader = ioReader
+  iformatContext.iformat = new IMpegtsFormat()
+
+  let readPos = 0
+  const readFileLength = readFile.size
+
+  ioReader.onFlush = async (buffer) => {
+    if (readPos >= readFileLength) {
+      return IOError.END
+    }
+    const len = Math.min(buffer.length, readFileLength - readPos)
+    buffer.set(new Uint8Array(await (readFile.slice(readPos, readPos + len).arrayBuffer())), 0)
+    readPos += len
+    return len
+  }
+  ioReader.onSeek = (pos) => {
+    readPos = Number(pos)
+    return 0
+  }
+  ioReader.onSize = () => {
+    return BigInt(readFile.size)
+  }
+
+  await demux.open(iformatContext)
+  await demux.analyzeStreams(iformatContext)
+
+  const oformatContext = createAVOFormatContext()
+  const ioWriter = new IOWriterSync()
+  let outputBytes = 0
+  // 只统计输出大小，不写文件
+  ioWriter.onFlush = (buffer) => {
+    outputBytes += buffer.length
+    return 0
+  }
+  ioWriter.onSeek = () => {
+    return 0
+  }
+  oformatContext.ioWriter = ioWriter
+  oformatContext.oformat = new OIsobmffFormat()
+
+  iformatContext.streams.forEach((stream) => {
+    const ostream = oformatContext.createStream()
+    copyCodecParameters(addressof(ostream.codecpar), addressof(stream.codecpar))
+    ostream.timeBase.num = stream.timeBase.num
+    ostream.timeBase.den = stream.timeBase.den
+  })
+
+  mux.open(oformatContext)
+  mux.writeHeader(oformatContext)
+
+  const avpacket = createAVPacket()
+  let count = 0
+  let bytes = 0
+
+  const start = performance.now()
+
+  while (1) {
+    let ret = await demux.readAVPacket(iformatContext, avpacket)
+    if (ret !== 0) {
+      break
+    }
+    count++
+    bytes += avpacket.size
+    mux.writeAVPacket(oformatContext, avpacket)
+    unrefAVPacket(avpacket)
+  }
+
+  mux.writeTrailer(oformatContext)
+  mux.flush(oformatContext)
+
+  const cost = performance.now() - start
+
+  iformatContext.destroy()
+  oformatContext.destroy()
+  destroyAVPacket(avpacket)
+
+  return {
+    count,
+    bytes,
+    outputBytes,
+    cost
+  }
+}
+
+/**
+ * compare ts and wasm bitstream filters (adts -> raw, annexb -> avcc) on AAC/H.264 mpegts -> mp4 remux
+ *
+ * @param readFile mpegts file
+ * @param bsfWasmUrl url of bsf.wasm
+ */
+export async function benchmarkBSF(readFile: File, bsfWasmUrl: string) {
+
+  if (readFile.name.split('.').pop().toLowerCase() !== 'ts') {
+    console.log(`not support file ${readFile.name}, use mpegts`)
+    return
+  }
+
+  function print(tag: string, result: Awaited<ReturnType<typeof remux>>) {
+    console.log(`${tag}: ${result.count} packets in ${result.cost.toFixed(2)}ms, ${
+      (result.count / result.cost * 1000).toFixed(0)} packets/sec, ${(result.bytes / result.cost / 1000).toFixed(2)} MB/s, output ${result.outputBytes} bytes`)
+  }
+
+  bsfKernel.unload()
+  print('ts bsf', await remux(readFile))
+
+  if (await bsfKernel.load(await compileResource(bsfWasmUrl)) < 0) {
+    console.log('load wasm bsf failed')
+    return
+  }
+  print('wasm bsf', await remux(readFile))
+  bsfKernel.unload()
+}
@@ -0,0 +1,81 @@
+import { IOReader, IOError } from '@libmedia/common/io'
+import { destroyAVPacket, createAVPacket, unrefAVPacket } from '@libmedia/avutil'
+import { createAVIFormatContext, demux, type IFormat } from '@libmedia/avformat'
+import IFlvFormat from '@libmedia/avformat/IFlvFormat'
+import IMatroskaFormat from '@libmedia/avformat/IMatroskaFormat'
+import IIsobmffFormat from '@libmedia/avformat/IIsobmffFormat'
+
+const formats: Record<string, () => IFormat> = {
+  flv: () => new IFlvFormat(),
+  mkv: () => new IMatroskaFormat(),
+  webm: () => new IMatroskaFormat(),
+  mp4: () => new IIsobmffFormat(),
+  mov: () => new IIsobmffFormat()
+}
+
+/**
+ * measure demux throughput (packets/sec) of a local file
+ */
+export async function benchmarkDemux(readFile: File) {
+
+  const ext = readFile.name.split('.').pop().toLowerCase()
+
+  if (!formats[ext]) {
+    console.log(`not support file ${readFile.name}, use flv/mkv/webm/mp4/mov`)
+    return
+  }
+
+  const iformatContext = createAVIFormatContext()
+  const ioReader = new IOReader()
+
+  iformatContext.ioReader = ioReader
+  iformatContext.iformat = formats[ext]()
+
+  const avpacket = createAVPacket()
+
+  let readPos = 0
+  const readFileLength = readFile.size
+
+  ioReader.onFlush = async (buffer) => {
+    if (readPos >= readFileLength) {
+      return IOError.END
+    }
+    const len = Math.min(buffer.length, readFileLength - readPos)
+    buffer.set(new Uint8Array(await (readFile.slice(readPos, readPos + len).arrayBuffer())), 0)
+    readPos += len
+    return len
+  }
+  ioReader.onSeek = (pos) => {
+    readPos = Number(pos)
+    return 0
+  }
+  ioReader.onSize = () => {
+    return BigInt(readFile.size)
+  }
+
+  const openStart = performance.now()
+  await demux.open(iformatContext)
+  const openCost = performance.now() - openStart
+
+  let count = 0
+  let bytes = 0
+
+  const start = performance.now()
+
+  while (1) {
+    let ret = await demux.readAVPacket(iformatContext, avpacket)
+    if (ret !== 0) {
+      break
+    }
+    count++
+    bytes += avpacket.size
+    unrefAVPacket(avpacket)
+  }
+
+  const cost = performance.now() - start
+
+  console.log(`${ext}: open ${openCost.toFixed(2)}ms, ${count} packets in ${cost.toFixed(2)}ms, ${(count / cost * 1000).toFixed(0)} packets/sec, ${(bytes / cost / 1000).toFixed(2)} MB/s`)
+
+  iformatContext.destroy()
+  destroyAVPacket(avpacket)
+}
@@ -0,0 +1,92 @@
+import { mapUint8Array } from '@libmedia/cheap'
+import {
+  createAVFrame,
+  destroyAVFrame,
+  getVideoBuffer,
+  compileResource,
+  AVPixelFormat,
+  AVColorSpace,
+  AVColorRange,
+  type AVFrame
+} from '@libmedia/avutil'
+import { yuv2rgbaKernel } from '@libmedia/avrender'
+
+const formats = [
+  { name: 'yuv420p', format: AVPixelFormat.AV_PIX_FMT_YUV420P },
+  { name: 'nv12', format: AVPixelFormat.AV_PIX_FMT_NV12 },
+  { name: 'yuv420p10le', format: AVPixelFormat.AV_PIX_FMT_YUV420P10LE },
+  { name: 'p010le', format: AVPixelFormat.AV_PIX_FMT_P010LE }
+]
+
+const sizes = [
+  { name: '1:1', width: 1920, height: 1080 },
+  { name: 'downscale', width: 1280, height: 720 },
+  { name: 'upscale', width: 2560, height: 1440 }
+]
+
+function createFrame(format: AVPixelFormat, width: int32, height: int32) {
+  const frame = createAVFrame()
+  frame.format = format
+  frame.width = width
+  frame.height = height
+  frame.colorSpace = AVColorSpace.AVCOL_SPC_BT709
+  frame.colorRange = AVColorRange.AVCOL_RANGE_MPEG
+  getVideoBuffer(frame)
+
+  // 填充随机数据，避免全零输入
+  for (let i = 0; i < 3; i++) {
+    if (frame.data[i]) {
+      const lines = i ? height >>> 1 : height
+      const data = mapUint8Array(frame.data[i], frame.linesize[i] * lines)
+      for (let j = 0; j < data.length; j++) {
+        data[j] = (Math.random() * 256) >>> 0
+      }
+    }
+  }
+  return frame
+}
+
+function run(converter: yuv2rgbaKernel.Yuv2RgbaConverter, frame: pointer<AVFrame>, width: int32, height: int32, filter: yuv2rgbaKernel.Yuv2RgbaFilter, count: number) {
+  // 预热，分配输出缓冲区
+  converter.convert(frame, width, height, filter)
+  const start = performance.now()
+  for (let i = 0; i < count; i++) {
+    converter.convert(frame, width, height, filter)
+  }
+  return performance.now() - start
+}
+
+/**
+ * 测试 1080p 输入各像素格式转换到 rgba 的速度
+ *
+ * @param wasmUrl url or buffer of yuv2rgba.wasm（simd 或非 simd 版本）
+ * @param count 每种组合转换次数
+ */
+export async function benchmarkYuv2Rgba(wasmUrl: string | ArrayBuffer, count: number = 200) {
+
+  if (await yuv2rgbaKernel.load(await compileResource(wasmUrl)) < 0) {
+    console.log('load wasm yuv2rgba failed')
+    return
+  }
+
+  const converter = new yuv2rgbaKernel.Yuv2RgbaConverter()
+
+  formats.forEach(({ name, format }) => {
+    const frame = createFrame(format, 1920, 1080)
+    sizes.forEach((size) => {
+      const filters = size.name === '1:1'
+        ? [yuv2rgbaKernel.Yuv2RgbaFilter.BILINEAR]
+        : [yuv2rgbaKernel.Yuv2RgbaFilter.NEAREST, yuv2rgbaKernel.Yuv2RgbaFilter.BILINEAR]
+      filters.forEach((filter) => {
+        const cost = run(converter, frame, size.width, size.height, filter, count)
+        console.log(`${name} 1920x1080 -> ${size.width}x${size.height} (${size.name}, ${
+          filter === yuv2rgbaKernel.Yuv2RgbaFilter.NEAREST ? 'nearest' : 'bilinear'}): ${
+          (count / cost * 1000).toFixed(1)} fps, ${(cost / count).toFixed(3)}ms/frame`)
+      })
+    })
+    destroyAVFrame(frame)
+  })
+
+  converter.destroy()
+  yuv2rgbaKernel.unload()
+}
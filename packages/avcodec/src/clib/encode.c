@@ -10,10 +10,20 @@
 #include <libavutil/channel_layout.h>
 #endif
 
+#if MEDIA_TYPE_VIDEO
+#include <libavutil/pixdesc.h>
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+#endif
+
 static AVCodecContext* enc_ctx;
 int enc_ctx_max_b_frames = -1;
 int enc_ctx_flags = 0;
 int enc_ctx_flags2 = 0;
+char* enc_ctx_stats_in = NULL;
+char* enc_ctx_stats_out = NULL;
+size_t enc_ctx_stats_out_size = 0;
 
 struct AVBuffer {
   uint8_t *data; /**< data described by this buffer */
@@ -45,6 +55,92 @@ struct AVBuffer {
   int flags_internal;
 };
 
+#if MEDIA_TYPE_VIDEO
+// 场景检测在 1/4 缩小的亮度平面上进行
+#define SCENE_SCALE 4
+#define SCENE_HIST_BINS 64
+
+static uint8_t* scene_prev = NULL;
+static uint8_t* scene_cur = NULL;
+static int scene_width = 0;
+static int scene_height = 0;
+static int scene_has_prev = 0;
+static double scene_prev_mafd = 0;
+static uint32_t scene_prev_hist[SCENE_HIST_BINS];
+
+static void scene_free() {
+  if (scene_prev) {
+    av_freep(&scene_prev);
+  }
+  if (scene_cur) {
+    av_freep(&scene_cur);
+  }
+  scene_width = 0;
+  scene_height = 0;
+  scene_has_prev = 0;
+}
+
+/**
+ * 4x4 块平均缩小亮度平面
+ */
+static void scene_downscale(const uint8_t* src, int linesize, uint8_t* dst, int width, int height) {
+  for (int y = 0; y < height; y++) {
+    const uint8_t* r0 = src + (y * SCENE_SCALE) * linesize;
+    const uint8_t* r1 = r0 + linesize;
+    const uint8_t* r2 = r1 + linesize;
+    const uint8_t* r3 = r2 + linesize;
+    uint8_t* out = dst + y * width;
+    int x = 0;
+    #ifdef __wasm_simd128__
+    // 每次处理 64 个输入像素，输出 16 个
+    for (; x + 16 <= width; x += 16) {
+      v128_t sum[4];
+      for (int i = 0; i < 4; i++) {
+        int offset = (x + i * 4) * SCENE_SCALE;
+        v128_t a = wasm_u8x16_avgr(wasm_v128_load(r0 + offset), wasm_v128_load(r1 + offset));
+        v128_t b = wasm_u8x16_avgr(wasm_v128_load(r2 + offset), wasm_v128_load(r3 + offset));
+        v128_t v = wasm_u8x16_avgr(a, b);
+        sum[i] = wasm_u32x4_shr(wasm_u32x4_extadd_pairwise_u16x8(wasm_u16x8_extadd_pairwise_u8x16(v)), 2);
+      }
+      v128_t lo = wasm_u16x8_narrow_i32x4(sum[0], sum[1]);
+      v128_t hi = wasm_u16x8_narrow_i32x4(sum[2], sum[3]);
+      wasm_v128_store(out + x, wasm_u8x16_narrow_i16x8(lo, hi));
+    }
+    #endif
+    for (; x < width; x++) {
+      int offset = x * SCENE_SCALE;
+      uint32_t sum = 0;
+      for (int i = 0; i < SCENE_SCALE; i++) {
+        sum += r0[offset + i] + r1[offset + i] + r2[offset + i] + r3[offset + i];
+      }
+      out[x] = sum >> 4;
+    }
+  }
+}
+
+static uint64_t scene_sad(const uint8_t* cur, const uint8_t* prev, int size) {
+  uint64_t sad = 0;
+  int i = 0;
+  #ifdef __wasm_simd128__
+  v128_t acc = wasm_i32x4_splat(0);
+  for (; i + 16 <= size; i += 16) {
+    v128_t c = wasm_v128_load(cur + i);
+    v128_t p = wasm_v128_load(prev + i);
+    v128_t d = wasm_v128_or(wasm_u8x16_sub_sat(c, p), wasm_u8x16_sub_sat(p, c));
+    acc = wasm_i32x4_add(acc, wasm_u32x4_extadd_pairwise_u16x8(wasm_u16x8_extadd_pairwise_u8x16(d)));
+  }
+  sad = (uint64_t)wasm_u32x4_extract_lane(acc, 0)
+    + wasm_u32x4_extract_lane(acc, 1)
+    + wasm_u32x4_extract_lane(acc, 2)
+    + wasm_u32x4_extract_lane(acc, 3);
+  #endif
+  for (; i < size; i++) {
+    sad += cur[i] > prev[i] ? cur[i] - prev[i] : prev[i] - cur[i];
+  }
+  return sad;
+}
+#endif
+
 int open_codec_context(AVCodecContext** enc_ctx, enum AVCodecID codec_id, AVCodecParameters* codecpar, AVRational* time_base, int thread_count, AVDictionary** opts) {
 
   int ret;
@@ -76,6 +172,11 @@ int open_codec_context(AVCodecContext** enc_ctx, enum AVCodecID codec_id, AVCode
   (*enc_ctx)->flags2 = enc_ctx_flags2;
   (*enc_ctx)->strict_std_compliance = -2;
 
+  // 两遍编码第二遍的统计数据，由外部在打开编码器之前设置
+  if (enc_ctx_stats_in) {
+    (*enc_ctx)->stats_in = enc_ctx_stats_in;
+  }
+
   if (enc_ctx_max_b_frames > -1) {
     (*enc_ctx)->max_b_frames = enc_ctx_max_b_frames;
   }
@@ -109,6 +210,32 @@ int open_codec_context(AVCodecContext** enc_ctx, enum AVCodecID codec_id, AVCode
   return 0;
 }
 
+/**
+ * mpeg4 第一遍编码的 stats_out 只有当前帧的统计数据，每输出一个 packet 都要追加保存
+ * libvpx/libaom 在 flush 之后一次性给出全部统计数据，不需要追加
+ */
+static void append_stats_out() {
+  size_t len;
+  char* buf;
+
+  if (!(enc_ctx->flags & AV_CODEC_FLAG_PASS1)
+    || enc_ctx->codec_id != AV_CODEC_ID_MPEG4
+    || !enc_ctx->stats_out
+  ) {
+    return;
+  }
+
+  len = strlen(enc_ctx->stats_out);
+  buf = av_realloc(enc_ctx_stats_out, enc_ctx_stats_out_size + len + 1);
+  if (!buf) {
+    format_log(ERROR, "Error appending stats out, no memory\n");
+    return;
+  }
+  memcpy(buf + enc_ctx_stats_out_size, enc_ctx->stats_out, len + 1);
+  enc_ctx_stats_out = buf;
+  enc_ctx_stats_out_size += len;
+}
+
 int receive_packet(const AVPacket* packet) {
   int ret;
 
@@ -123,6 +250,8 @@ int receive_packet(const AVPacket* packet) {
     return ret;
   }
 
+  append_stats_out();
+
   return 1;
 }
 
@@ -169,6 +298,25 @@ EM_PORT_API(void) encoder_set_flags2(int flags) {
   enc_ctx_flags2 = flags;
 }
 
+EM_PORT_API(void) encoder_set_stats_in(const char* stats) {
+  if (enc_ctx_stats_in) {
+    av_freep(&enc_ctx_stats_in);
+  }
+  if (stats) {
+    enc_ctx_stats_in = av_strdup(stats);
+  }
+}
+
+EM_PORT_API(char*) encoder_get_stats_out() {
+  if (enc_ctx_stats_out) {
+    return enc_ctx_stats_out;
+  }
+  if (enc_ctx) {
+    return enc_ctx->stats_out;
+  }
+  return NULL;
+}
+
 EM_PORT_API(void) encoder_set_gop_size(int gop) {
   if (enc_ctx) {
     enc_ctx->gop_size = gop;
@@ -181,6 +329,85 @@ EM_PORT_API(void) encoder_set_max_b_frame(int max) {
 }
 #endif
 
+#if MEDIA_TYPE_VIDEO
+/**
+ * 计算当前帧相对上一帧的场景切换分数（0 - 100）
+ *
+ * 同 ffmpeg scdet 的思路，取帧平均绝对差（MAFD）和 MAFD 变化量的较小值，
+ * 再和亮度直方图差异取较小值，过滤掉运动剧烈但画面内容没有切换的帧
+ *
+ * 不支持的像素格式返回 -1
+ */
+EM_PORT_API(double) encoder_scene_score(AVFrame* frame) {
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(frame->format);
+
+  if (!desc
+    || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL))
+    || desc->comp[0].depth != 8
+    || desc->comp[0].step != 1
+  ) {
+    return -1;
+  }
+
+  int width = frame->width / SCENE_SCALE;
+  int height = frame->height / SCENE_SCALE;
+
+  if (width <= 0 || height <= 0) {
+    return -1;
+  }
+
+  if (width != scene_width || height != scene_height) {
+    scene_free();
+    scene_prev = av_malloc(width * height);
+    scene_cur = av_malloc(width * height);
+    if (!scene_prev || !scene_cur) {
+      scene_free();
+      return -1;
+    }
+    scene_width = width;
+    scene_height = height;
+  }
+
+  int size = width * height;
+
+  scene_downscale(frame->data[0], frame->linesize[0], scene_cur, width, height);
+
+  uint32_t hist[SCENE_HIST_BINS] = {0};
+  for (int i = 0; i < size; i++) {
+    hist[scene_cur[i] >> 2]++;
+  }
+
+  double score = 0;
+
+  if (scene_has_prev) {
+    double mafd = (double)scene_sad(scene_cur, scene_prev, size) * 100.0 / (size * 255.0);
+    double diff = fabs(mafd - scene_prev_mafd);
+
+    uint64_t hist_diff = 0;
+    for (int i = 0; i < SCENE_HIST_BINS; i++) {
+      hist_diff += hist[i] > scene_prev_hist[i] ? hist[i] - scene_prev_hist[i] : scene_prev_hist[i] - hist[i];
+    }
+    double hist_score = (double)hist_diff * 100.0 / (2.0 * size);
+
+    score = FFMIN(FFMIN(mafd, diff), hist_score);
+    scene_prev_mafd = mafd;
+  }
+
+  uint8_t* tmp = scene_prev;
+  scene_prev = scene_cur;
+  scene_cur = tmp;
+  memcpy(scene_prev_hist, hist, sizeof(hist));
+  scene_has_prev = 1;
+
+  return av_clipd(score, 0, 100);
+}
+
+EM_PORT_API(void) encoder_scene_reset() {
+  scene_has_prev = 0;
+  scene_prev_mafd = 0;
+}
+#endif
+
 EM_PORT_API(int) encoder_encode(AVFrame* frame) {
   return encode_frame(frame);
 }
@@ -245,4 +472,14 @@ EM_PORT_API(void) encoder_close() {
     avcodec_free_context(&enc_ctx);
     enc_ctx = NULL;
   }
+  #if MEDIA_TYPE_VIDEO
+  scene_free();
+  #endif
+  if (enc_ctx_stats_in) {
+    av_freep(&enc_ctx_stats_in);
+  }
+  if (enc_ctx_stats_out) {
+    av_freep(&enc_ctx_stats_out);
+    enc_ctx_stats_out_size = 0;
+  }
 }
\ No newline at end of file
@@ -61,6 +61,8 @@ import {
   type WebAssemblyResource,
   WebAssemblyRunner,
   mapUint8Array,
+  readCString,
+  writeCString,
   stack
 } from '@libmedia/cheap'
 
@@ -74,6 +76,11 @@ export type WasmVideoEncoderOptions = {
   copyTs?: boolean
 }
 
+const enum PassFlags {
+  AV_CODEC_FLAG_PASS1 = 1 << 9,
+  AV_CODEC_FLAG_PASS2 = 1 << 10
+}
+
 export default class WasmVideoEncoder {
 
   private options: WasmVideoEncoderOptions
@@ -96,6 +103,9 @@ export default class WasmVideoEncoder {
 
   private encoderOptions: pointer<AVDictionary> = nullptr
 
+  private pass: int32 = 0
+  private passStats: string = ''
+
   constructor(options: WasmVideoEncoderOptions) {
     this.options = options
     this.encoder = new WebAssemblyRunner(this.options.resource)
@@ -165,6 +175,19 @@ export default class WasmVideoEncoder {
     return this.encoder.invokeAsync<int32>('encoder_receive', this.getAVPacket())
   }
 
+  /**
+   * 设置两遍编码的遍数，需要在 open 之前调用
+   * 
+   * 第一遍编码结束后通过 getPassStats 获取统计数据，第二遍编码时传入
+   * 
+   * @param pass 0 单遍编码，1 第一遍，2 第二遍
+   * @param stats 第二遍编码使用的统计数据
+   */
+  public setPass(pass: int32, stats: string = '') {
+    this.pass = pass
+    this.passStats = stats
+  }
+
   /**
    * 打开编码器
    * 
@@ -184,8 +207,22 @@ export default class WasmVideoEncoder {
     timeBaseP.den = timeBase.den
     accessof(optsP) <- nullptr
 
+    let flags = 0
     if (parameters.codecId === AVCodecID.AV_CODEC_ID_MPEG4 && !(parameters.flags & AVCodecParameterFlags.AV_CODECPAR_FLAG_H26X_ANNEXB)) {
-      this.encoder.invoke('encoder_set_flags', 1 << 22)
+      flags |= 1 << 22
+    }
+    if (this.pass === 1) {
+      flags |= PassFlags.AV_CODEC_FLAG_PASS1
+    }
+    else if (this.pass === 2 && this.passStats) {
+      flags |= PassFlags.AV_CODEC_FLAG_PASS2
+      const stats = reinterpret_cast<pointer<char>>(malloc(this.passStats.length + 1))
+      writeCString(stats, this.passStats, this.passStats.length)
+      this.encoder.invoke('encoder_set_stats_in', stats)
+      free(stats)
+    }
+    if (flags) {
+      this.encoder.invoke('encoder_set_flags', flags)
     }
     this.encoder.invoke('encoder_set_max_b_frame', parameters.videoDelay)
 
@@ -380,6 +417,38 @@ export default class WasmVideoEncoder {
     return null
   }
 
+  /**
+   * 计算帧相对上一次调用的场景切换分数（0 - 100），像素格式不支持返回 -1
+   * 
+   * 在编码器 wasm 中对缩小的亮度平面做 SAD 和直方图比较，simd 版本使用 simd 指令
+   * 
+   * @param frame 
+   * @returns 
+   */
+  public getSceneScore(frame: pointer<AVFrame>): double {
+    return this.encoder.invoke<double>('encoder_scene_score', frame)
+  }
+
+  /**
+   * 重置场景检测状态，下一帧不和之前的帧比较
+   */
+  public resetSceneDetect() {
+    this.encoder.invoke('encoder_scene_reset')
+  }
+
+  /**
+   * 获取第一遍编码的统计数据，需要在 flush 之后调用
+   * 
+   * @returns 
+   */
+  public getPassStats() {
+    if (this.pass !== 1) {
+      return ''
+    }
+    const stats = this.encoder.invoke<pointer<char>>('encoder_get_stats_out')
+    return stats ? readCString(stats) : ''
+  }
+
   public getColorSpace() {
     return {
       colorSpace: this.encoder.invoke<int32>('encoder_get_color_space'),
@@ -43,6 +43,8 @@ import { isPointer } from '@libmedia/cheap'
 
 import type AVOutputNode from './AVOutputNode'
 
+const MAX_OUTPUT_QUEUE_LENGTH = 2
+
 export interface AVFilterNodeOptions {
   avframePool?: AVFramePool
 }
@@ -116,9 +118,18 @@ export default abstract class AVFilterNode {
   protected inputInnerNodePort: IPCPort[]
   protected outputInnerNodePort: IPCPort[]
 
-  private currentOutput: (pointer<AVFrame> | VideoFrame)[]
-  private consumedCount: number
-  private pending: { resolve: (data?: any) => void, reject: () => void }[]
+  /**
+   * 每个输出还未被拉走的帧
+   * 
+   * 多输出时各输出按节拍同步，任一输出积压到 MAX_OUTPUT_QUEUE_LENGTH 时其他输出需等待它消费
+   */
+  private outputQueues: (pointer<AVFrame> | VideoFrame | int32)[][]
+  /**
+   * 已经不再被拉取的输出（已结束或下游已分离），它的帧直接释放，不参与节拍同步
+   */
+  private detachedOutputs: boolean[]
+  private processing: Promise<void> | null
+  private pending: (() => void)[]
 
   protected inputCount: number
   protected outputCount: number
@@ -126,6 +137,11 @@ export default abstract class AVFilterNode {
   private inputConnectedMap: Map<any, number>
   private outputConnectedMap: Map<any, number>
 
+  /**
+   * 同线程内直接相连的上游节点，下标为输入序号
+   */
+  private directInputs: { node: AVFilterNode, index: number }[]
+
   constructor(options: AVFilterNodeOptions, inputCount: number, outputCount: number) {
     this.options = options
     this.inputCount = inputCount
@@ -148,106 +164,176 @@ export default abstract class AVFilterNode {
       this.outputInnerNodePort.push(new IPCPort(port.getInnerPort()!))
     }
 
-    this.consumedCount = 0
+    this.outputQueues = []
+    this.detachedOutputs = []
+    this.processing = null
     this.pending = []
-    this.currentOutput = []
 
     for (let i = 0; i < this.outputCount; i++) {
+      this.outputQueues.push([])
+      this.detachedOutputs.push(false)
       this.handlePull(this.outputInnerNodePort[i], i)
     }
 
     this.inputConnectedMap = new Map()
     this.outputConnectedMap = new Map()
+    this.directInputs = []
   }
 
   private handlePull(port: IPCPort, index: number) {
     port.on(REQUEST, async (request: RpcMessage) => {
       switch (request.method) {
         case 'pull': {
-          if (this.consumedCount === 0) {
-            const input: (pointer<AVFrame> | VideoFrame)[] = []
-            this.currentOutput.length = 0
-            for (let i = 0; i < this.inputCount; i++) {
-              input.push(await this.inputInnerNodePort[i].request('pull', request.params))
-            }
-
-            await this.process(input, this.currentOutput, request.params)
-
-            input.forEach((frame) => {
-              if (is.number(frame) && frame < 0) {
-                return
-              }
-              if (isPointer(frame)) {
-                if (frame > 0) {
-                  this.options.avframePool ? this.options.avframePool.release(reinterpret_cast<pointer<AVFrameRef>>(frame)) : destroyAVFrame(frame)
-                }
-              }
-              else {
-                frame.close()
-              }
-            })
-
-            port.reply(
-              request,
-              this.currentOutput[index],
-              undefined,
-              (isPointer(this.currentOutput[index])
-                || is.number(this.currentOutput[index])
-              )
-                ? undefined
-                : [this.currentOutput[index]]
-            )
-            this.consumedCount++
-
-            if (this.pending.length) {
-              this.pending.forEach((item) => {
-                item.resolve()
-              })
-              this.pending.length = 0
-            }
-            if (this.consumedCount === this.outputCount) {
-              this.consumedCount = 0
-              this.currentOutput.length = 0
-            }
-          }
-          else if (this.consumedCount === this.outputCount - 1) {
-            port.reply(
-              request,
-              this.currentOutput[index],
-              undefined,
-              (isPointer(this.currentOutput[index])
-                || is.number(this.currentOutput[index])
-              )
-                ? undefined
-                : [this.currentOutput[index]]
-            )
-            this.consumedCount = 0
-            this.currentOutput.length = 0
-          }
-          else {
-            await new Promise((resolve, reject) => {
-              this.pending.push({
-                resolve,
-                reject
-              })
-            })
-            port.reply(
-              request,
-              this.currentOutput[index],
-              undefined,
-              (isPointer(this.currentOutput[index])
-                || is.number(this.currentOutput[index])
-              )
-                ? undefined
-                : [this.currentOutput[index]]
-            )
-            this.consumedCount++
-          }
+          const frame = await this.pull(index, request.params)
+          port.reply(
+            request,
+            frame,
+            undefined,
+            (isPointer(frame) || is.number(frame)) ? undefined : [frame]
+          )
         }
       }
     })
   }
 
+  /**
+   * 从指定输入拉取一帧
+   * 
+   * 同一个线程内相连的节点直接调用上游的 pull，只有跨线程的输入才走 IPC
+   */
+  protected pullInput(index: number, params?: Data) {
+    const peer = this.directInputs[index]
+    if (peer) {
+      return peer.node.pull(peer.index, params)
+    }
+    return this.inputInnerNodePort[index].request<pointer<AVFrame> | VideoFrame | int32>('pull', params)
+  }
+
+  private releaseFrame(frame: pointer<AVFrame> | VideoFrame | int32) {
+    if (is.number(frame) && frame < 0) {
+      return
+    }
+    if (isPointer(frame)) {
+      if (frame > 0) {
+        this.options.avframePool ? this.options.avframePool.release(reinterpret_cast<pointer<AVFrameRef>>(frame)) : destroyAVFrame(frame)
+      }
+    }
+    else {
+      (frame as VideoFrame).close()
+    }
+  }
+
+  private async runProcess(params?: Data) {
+    const input: (pointer<AVFrame> | VideoFrame)[] = []
+    const output: (pointer<AVFrame> | VideoFrame | int32)[] = []
+    for (let i = 0; i < this.inputCount; i++) {
+      input.push(await this.pullInput(i, params) as pointer<AVFrame> | VideoFrame)
+    }
+
+    await this.process(input, output, params)
+
+    input.forEach((frame) => {
+      this.releaseFrame(frame)
+    })
+
+    for (let i = 0; i < this.outputCount; i++) {
+      if (this.detachedOutputs[i]) {
+        this.releaseFrame(output[i])
+      }
+      else {
+        this.outputQueues[i].push(output[i])
+      }
+    }
+  }
+
+  private wakeupPending() {
+    if (this.pending.length) {
+      const pending = this.pending
+      this.pending = []
+      pending.forEach((resolve) => {
+        resolve()
+      })
+    }
+  }
+
+  /**
+   * 分离指定输出，之后它的帧直接释放，其他输出不再等待它消费
+   * 
+   * 所有输出都分离后继续向上游分离
+   */
+  public detachOutput(index: number) {
+    if (this.detachedOutputs[index]) {
+      return
+    }
+    this.detachedOutputs[index] = true
+    this.outputQueues[index].forEach((frame) => {
+      this.releaseFrame(frame)
+    })
+    this.outputQueues[index].length = 0
+    this.wakeupPending()
+
+    if (this.detachedOutputs.every((detached) => detached)) {
+      this.detach()
+    }
+  }
+
+  /**
+   * 分离连接到 node 的输出
+   */
+  public detachOutputNode(node: any) {
+    const index = this.outputConnectedMap.get(node)
+    if (index != null) {
+      this.detachOutput(index)
+    }
+  }
+
+  /**
+   * 本节点的下游不再拉取，分离上游对应的输出
+   */
+  public detach() {
+    for (let i = 0; i < this.directInputs.length; i++) {
+      const peer = this.directInputs[i]
+      if (peer) {
+        peer.node.detachOutput(peer.index)
+      }
+    }
+  }
+
+  /**
+   * 拉取指定输出的一帧，帧的所有权转移给调用方
+   */
+  public async pull(index: number, params?: Data): Promise<pointer<AVFrame> | VideoFrame | int32> {
+    const queue = this.outputQueues[index]
+
+    while (!queue.length) {
+      if (this.processing) {
+        await this.processing
+      }
+      else if (this.outputQueues.some((q, i) => !this.detachedOutputs[i] && q.length >= MAX_OUTPUT_QUEUE_LENGTH)) {
+        await new Promise<void>((resolve) => {
+          this.pending.push(resolve)
+        })
+      }
+      else {
+        this.processing = this.runProcess(params).finally(() => {
+          this.processing = null
+        })
+        await this.processing
+      }
+    }
+
+    const frame = queue.shift()!
+
+    // 已经结束的输出不会再被拉取
+    if (is.number(frame) && frame < 0 && this.outputCount > 1) {
+      this.detachOutput(index)
+    }
+
+    this.wakeupPending()
+
+    return frame
+  }
+
   public getInputNodePort(index: number) {
     return this.inputAVFilterNodePort[index]
   }
@@ -328,9 +414,19 @@ export default abstract class AVFilterNode {
       throw new Error('next node all input has connected')
     }
 
-    output.port.connect(nextInput.port)
+    if (node instanceof AVFilterNode) {
+      // 同一线程内的节点直接调用，不经过 port
+      node.directInputs[nextInput.index] = {
+        node: this,
+        index: output.index
+      }
+    }
+    else {
+      output.port.connect(nextInput.port)
+    }
 
     this.outputConnectedMap.set(node, output.index)
+    this.detachedOutputs[output.index] = false
     node.addInputPeer(this, nextInput.index)
   }
 
@@ -338,10 +434,17 @@ export default abstract class AVFilterNode {
     if (!this.outputConnectedMap.has(node)) {
       return
     }
-    this.outputAVFilterNodePort[this.outputConnectedMap.get(node)!].disconnect()
+    const index = this.outputConnectedMap.get(node)!
+    this.outputAVFilterNodePort[index].disconnect()
     this.outputConnectedMap.delete(node)
+    this.detachOutput(index)
 
     if (node instanceof AVFilterNode) {
+      for (let i = 0; i < node.directInputs.length; i++) {
+        if (node.directInputs[i]?.node === this) {
+          node.directInputs[i] = undefined
+        }
+      }
       node.removeInputPeer(this)
     }
   }
@@ -353,6 +456,12 @@ export default abstract class AVFilterNode {
     this.outputConnectedMap.forEach((index, node) => {
       this.disconnectNode(node)
     })
+    this.outputQueues.forEach((queue) => {
+      queue.forEach((frame) => {
+        this.releaseFrame(frame)
+      })
+      queue.length = 0
+    })
   }
 
   public abstract ready(): void | Promise<void>
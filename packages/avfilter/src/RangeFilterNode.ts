@@ -63,7 +63,7 @@ export default class RangeFilterNode extends AVFilterNode {
 
     if (pts < this.options.start) {
       while (true) {
-        const next = await this.inputInnerNodePort[0].request<pointer<AVFrame> | VideoFrame>('pull')
+        const next = await this.pullInput(0)
         if (is.number(next) && next < 0) {
           outputs[0] = next
           return
@@ -24,6 +24,11 @@ export {
   default as RangeFilterNode
 } from './RangeFilterNode'
 
+export {
+  type SplitFilterNodeOptions,
+  default as SplitFilterNode
+} from './SplitFilterNode'
+
 export {
   type ResampleFilterNodeOptions,
   default as ResampleFilterNode
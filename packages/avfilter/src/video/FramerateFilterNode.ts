@@ -75,7 +75,7 @@ export default class FramerateFilterNode extends AVFilterNode {
 
     if (diff < this.step && this.lastPts > -1n) {
       while (true) {
-        const next = await this.inputInnerNodePort[0].request<pointer<AVFrame> | VideoFrame>('pull')
+        const next = await this.pullInput(0)
         if (is.number(next) && next < 0) {
           outputs[0] = next
           return
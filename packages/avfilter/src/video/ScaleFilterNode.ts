@@ -124,7 +124,11 @@ export default class ScaleFilterNode extends AVFilterNode {
       }
 
       if (!isPointer(avframe)) {
-        avframe = await videoFrame2AVFrame(inputs[0] as VideoFrame, this.options.avframePool ? this.options.avframePool.alloc() : createAVFrame())
+        avframe = await videoFrame2AVFrame(
+          inputs[0] as VideoFrame,
+          this.options.avframePool ? this.options.avframePool.alloc() : createAVFrame(),
+          this.options.avframePool
+        )
       }
 
       this.scaler.scale(avframe, out)
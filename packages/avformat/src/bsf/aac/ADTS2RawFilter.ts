@@ -50,7 +50,10 @@ import {
   AVPacketSideDataType,
   addAVPacketData,
   addAVPacketSideData,
-  unrefAVPacket
+  unrefAVPacket,
+  createAVPacket,
+  destroyAVPacket,
+  copyAVPacketData
 } from '@libmedia/avutil'
 
 import {
@@ -59,12 +62,18 @@ import {
   aac
 } from '@libmedia/avutil/internal'
 
+import * as wasmKernel from '../wasmKernel'
+
 interface CacheItem {
   duration: number
   dts: bigint
   buffer: Uint8Array
   extradata: Uint8Array
   pos: int64
+  /**
+   * wasm 解析时直接引用输入 avpacket 的缓冲区，不拷贝
+   */
+  avpacket?: pointer<AVPacket>
 }
 
 interface PendingItem extends CacheItem {
@@ -95,7 +104,129 @@ export default class ADTS2RawFilter extends AVBSFilter {
     return 0
   }
 
+  public destroy(): void {
+    this.reset()
+    super.destroy()
+  }
+
+  /**
+   * 更新 profile、采样率和声道数，变化时返回新的 extradata
+   */
+  private updateStreamMuxConfig(profile: number, sampleRate: number, channels: number) {
+    this.streamMuxConfig.profile = profile
+    this.streamMuxConfig.sampleRate = sampleRate
+    this.streamMuxConfig.channels = channels
+
+    const hasNewExtraData = this.inCodecpar.profile !== this.streamMuxConfig.profile
+      || this.inCodecpar.sampleRate !== this.streamMuxConfig.sampleRate
+      || this.inCodecpar.chLayout.nbChannels !== this.streamMuxConfig.channels
+
+    if (hasNewExtraData) {
+      this.inCodecpar.profile = this.streamMuxConfig.profile
+      this.inCodecpar.sampleRate = this.streamMuxConfig.sampleRate
+      this.inCodecpar.chLayout.nbChannels = this.streamMuxConfig.channels
+
+      const extradata = aac.avCodecParameters2Extradata(accessof(this.inCodecpar))
+
+      if (this.inCodecpar.extradata) {
+        avFree(this.inCodecpar.extradata)
+      }
+      this.inCodecpar.extradata = avMalloc(extradata.length)
+      memcpyFromUint8Array(this.inCodecpar.extradata, extradata.length, extradata)
+      this.inCodecpar.extradataSize = extradata.length
+      return extradata
+    }
+    return null
+  }
+
+  /**
+   * wasm 一次解析出整个 avpacket 中的 adts 头，完整的帧直接引用输入缓冲区
+   */
+  private sendAVPacketByKernel(avpacket: pointer<AVPacket>): number {
+    let lastDts = avpacket.dts !== NOPTS_VALUE_BIGINT ? avpacket.dts : avpacket.pts
+    const size = avpacket.size
+
+    let offset = 0
+
+    while (offset < size) {
+      const count = wasmKernel.parseADTS(avpacket.data + offset, size - offset)
+
+      if (count < 0) {
+        logger.error('AACADTSParser parse failed')
+        return errorType.DATA_INVALID
+      }
+
+      let end = offset
+
+      for (let i = 0; i < count; i++) {
+        const frameOffset = offset + wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.OFFSET)
+        const headerLength = wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.HEADER_LENGTH)
+        const payloadLength = wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.PAYLOAD_LENGTH)
+        const profile = wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.PROFILE)
+
+        const sampleRate = aac.MPEG4SamplingFrequencies[wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.SAMPLING_FREQUENCY_INDEX)]
+
+        const extradata = this.updateStreamMuxConfig(
+          profile & 0xff,
+          sampleRate,
+          aac.MPEG4Channels[wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.CHANNEL_CONFIGURATION)]
+        )
+
+        const duration = avRescaleQ(
+          static_cast<int64>(((profile >>> 8) + 1) * 1024 / sampleRate * AV_TIME_BASE),
+          AV_TIME_BASE_Q,
+          this.inTimeBase
+        )
+
+        const item: CacheItem = {
+          dts: lastDts,
+          buffer: null,
+          extradata,
+          duration: Number(duration),
+          pos: avpacket.pos
+        }
+
+        const payloadOffset = Math.min(frameOffset + headerLength, size)
+
+        if (payloadOffset + payloadLength > size) {
+          // 帧跨越了 avpacket，剩余部分在下一个 avpacket 中
+          item.buffer = mapUint8Array(avpacket.data + payloadOffset, reinterpret_cast<size>(size - payloadOffset)).slice()
+          this.pendingItem = {
+            ...item,
+            miss: payloadLength - item.buffer.length
+          }
+        }
+        else {
+          item.avpacket = createAVPacket()
+          copyAVPacketData(item.avpacket, avpacket)
+          item.avpacket.data = avpacket.data + payloadOffset
+          item.avpacket.size = payloadLength
+          this.caches.push(item)
+        }
+
+        end = frameOffset + wasmKernel.getADTSFrameField(i, wasmKernel.ADTSFrameField.FRAME_LENGTH)
+        lastDts += duration
+      }
+
+      if (count < wasmKernel.MAX_ADTS_FRAMES) {
+        if (end < size) {
+          // 尾部有无法解析的数据（比如不完整的 adts 头），和 ts 解析保持一致
+          logger.error('AACADTSParser parse failed')
+          return errorType.DATA_INVALID
+        }
+        break
+      }
+      offset = end
+    }
+    return 0
+  }
+
   public sendAVPacket(avpacket: pointer<AVPacket>): number {
+
+    if (wasmKernel.isLoaded() && !this.pendingItem && avpacket.buf) {
+      return this.sendAVPacketByKernel(avpacket)
+    }
+
     let i = 0
 
     let lastDts = avpacket.dts !== NOPTS_VALUE_BIGINT ? avpacket.dts : avpacket.pts
@@ -137,15 +268,7 @@ export default class ADTS2RawFilter extends AVBSFilter {
       }
 
       item.buffer = buffer.subarray(i + info.headerLength, i + info.headerLength + info.framePayloadLength)
-
-      this.streamMuxConfig.profile = info.profile
-      this.streamMuxConfig.sampleRate = info.sampleRate
-      this.streamMuxConfig.channels = info.channels
-
-      const hasNewExtraData = this.inCodecpar.profile !== this.streamMuxConfig.profile
-        || this.inCodecpar.sampleRate !== this.streamMuxConfig.sampleRate
-        || this.inCodecpar.chLayout.nbChannels !== this.streamMuxConfig.channels
-
+      item.extradata = this.updateStreamMuxConfig(info.profile, info.sampleRate, info.channels)
 
       const duration = avRescaleQ(
         static_cast<int64>((info.numberOfRawDataBlocksInFrame + 1) * 1024 / this.streamMuxConfig.sampleRate * AV_TIME_BASE),
@@ -155,22 +278,6 @@ export default class ADTS2RawFilter extends AVBSFilter {
 
       item.duration = Number(duration)
 
-      if (hasNewExtraData) {
-        this.inCodecpar.profile = this.streamMuxConfig.profile
-        this.inCodecpar.sampleRate = this.streamMuxConfig.sampleRate
-        this.inCodecpar.chLayout.nbChannels = this.streamMuxConfig.channels
-
-        const extradata = aac.avCodecParameters2Extradata(accessof(this.inCodecpar))
-
-        if (this.inCodecpar.extradata) {
-          avFree(this.inCodecpar.extradata)
-        }
-        this.inCodecpar.extradata = avMalloc(extradata.length)
-        memcpyFromUint8Array(this.inCodecpar.extradata, extradata.length, extradata)
-        this.inCodecpar.extradataSize = extradata.length
-        item.extradata = extradata
-      }
-
       if (item.buffer.length < info.framePayloadLength) {
         this.pendingItem = {
           ...item,
@@ -194,9 +301,15 @@ export default class ADTS2RawFilter extends AVBSFilter {
 
       const item = this.caches.shift()!
 
-      const data: pointer<uint8> = avMalloc(item.buffer.length)
-      memcpyFromUint8Array(data, item.buffer.length, item.buffer)
-      addAVPacketData(avpacket, data, item.buffer.length)
+      if (item.avpacket) {
+        copyAVPacketData(avpacket, item.avpacket)
+        destroyAVPacket(item.avpacket)
+      }
+      else {
+        const data: pointer<uint8> = avMalloc(item.buffer.length)
+        memcpyFromUint8Array(data, item.buffer.length, item.buffer)
+        addAVPacketData(avpacket, data, item.buffer.length)
+      }
 
       avpacket.dts = avpacket.pts = item.dts
       avpacket.pos = item.pos
@@ -216,6 +329,11 @@ export default class ADTS2RawFilter extends AVBSFilter {
 
   public reset(): number {
     this.pendingItem = null
+    this.caches.forEach((item) => {
+      if (item.avpacket) {
+        destroyAVPacket(item.avpacket)
+      }
+    })
     this.caches.length = 0
     return 0
   }
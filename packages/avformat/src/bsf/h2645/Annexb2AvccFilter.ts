@@ -49,7 +49,8 @@ import {
   copyAVPacketProps,
   createAVPacket,
   destroyAVPacket,
-  refAVPacket
+  refAVPacket,
+  avFree
 } from '@libmedia/avutil'
 
 import {
@@ -58,6 +59,8 @@ import {
   vvc
 } from '@libmedia/avutil/internal'
 
+import * as wasmKernel from '../wasmKernel'
+
 export default class Annexb2AvccFilter extends AVBSFilter {
 
   private cache: pointer<AVPacket>
@@ -88,6 +91,9 @@ export default class Annexb2AvccFilter extends AVBSFilter {
     if (!(avpacket.flags & AVPacketFlags.AV_PKT_FLAG_H26X_ANNEXB)) {
       refAVPacket(this.cache, avpacket)
     }
+    else if (wasmKernel.isLoaded() && this.sendAVPacketByKernel(avpacket)) {
+      // wasm 已经处理
+    }
     else {
 
       copyAVPacketProps(this.cache, avpacket)
@@ -132,6 +138,38 @@ export default class Annexb2AvccFilter extends AVBSFilter {
     return 0
   }
 
+  /**
+   * 使用 wasm 转换，包含参数集的包需要生成 extradata 返回 false 交给 ts 处理
+   * 
+   * 先统计输出大小再按实际大小分配，转换结果写入 cache 的新缓冲区，输入 avpacket 保持不变
+   */
+  private sendAVPacketByKernel(avpacket: pointer<AVPacket>) {
+    const size = avpacket.size
+
+    if (wasmKernel.annexb2Avcc(this.inCodecpar.codecId, avpacket.data, size) !== wasmKernel.KernelRet.NEED_BUFFER) {
+      return false
+    }
+
+    const dstSize = wasmKernel.getAnnexb2AvccInfo(wasmKernel.Annexb2AvccInfo.SIZE)
+    const dst: pointer<uint8> = avMalloc(dstSize)
+
+    const ret = wasmKernel.annexb2Avcc(this.inCodecpar.codecId, avpacket.data, size, dst, dstSize)
+
+    if (ret !== wasmKernel.KernelRet.OK) {
+      avFree(dst)
+      return false
+    }
+
+    copyAVPacketProps(this.cache, avpacket)
+    this.cache.flags &= ~AVPacketFlags.AV_PKT_FLAG_H26X_ANNEXB
+    addAVPacketData(this.cache, dst, dstSize)
+
+    if (wasmKernel.getAnnexb2AvccInfo(wasmKernel.Annexb2AvccInfo.KEY)) {
+      this.cache.flags |= AVPacketFlags.AV_PKT_FLAG_KEY
+    }
+    return true
+  }
+
   public receiveAVPacket(avpacket: pointer<AVPacket>): number {
     if (this.cached) {
       unrefAVPacket(avpacket)
@@ -0,0 +1,158 @@
+/*
+ * libmedia wasm bitstream filter kernel
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  WebAssemblyRunner,
+  type WebAssemblyResource
+} from '@libmedia/cheap'
+
+import {
+  logger
+} from '@libmedia/common'
+
+import {
+  AVCodecID,
+  avMalloc,
+  avFree
+} from '@libmedia/avutil'
+
+/**
+ * 一个 avpacket 中最多解析的 adts 帧数
+ */
+export const MAX_ADTS_FRAMES = 64
+
+/**
+ * 每个 adts 帧的解析结果字段
+ */
+export const enum ADTSFrameField {
+  OFFSET,
+  HEADER_LENGTH,
+  PAYLOAD_LENGTH,
+  FRAME_LENGTH,
+  // 低 8 位 profile，高 8 位 number_of_raw_data_blocks_in_frame
+  PROFILE,
+  SAMPLING_FREQUENCY_INDEX,
+  CHANNEL_CONFIGURATION,
+  MAX
+}
+
+export const enum KernelRet {
+  OK = 0,
+  // 包含参数集需要生成 extradata，走 ts 实现
+  FALLBACK = 1,
+  // 没有传入输出缓冲区或者大小不够，需要的大小通过 Annexb2AvccInfo.SIZE 获取
+  NEED_BUFFER = 2
+}
+
+export const enum Annexb2AvccInfo {
+  KEY,
+  SIZE
+}
+
+let runner: WebAssemblyRunner = null
+let info: pointer<int32> = nullptr
+let frames: pointer<int32> = nullptr
+
+/**
+ * 加载 wasm 的 bsf 实现，加载之后 Annexb2AvccFilter 和 ADTS2RawFilter 使用 wasm 处理热路径
+ * 
+ * 每个线程加载一次，没有加载或者加载失败继续使用 ts 实现
+ * 
+ * @param resource 
+ */
+export async function load(resource: WebAssemblyResource) {
+  if (runner) {
+    return 0
+  }
+  try {
+    const instance = new WebAssemblyRunner(resource)
+    await instance.run()
+    info = reinterpret_cast<pointer<int32>>(avMalloc(sizeof(int32) * 4))
+    frames = reinterpret_cast<pointer<int32>>(avMalloc(sizeof(int32) * ADTSFrameField.MAX * MAX_ADTS_FRAMES))
+    runner = instance
+    logger.debug('wasm bsf kernel loaded')
+    return 0
+  }
+  catch (error) {
+    logger.warn(`load wasm bsf kernel failed, use ts implementation, ${error}`)
+    return -1
+  }
+}
+
+export function unload() {
+  if (runner) {
+    runner.destroy()
+    runner = null
+    avFree(info)
+    avFree(frames)
+    info = nullptr
+    frames = nullptr
+  }
+}
+
+export function isLoaded() {
+  return !!runner
+}
+
+function getCodec(codecId: AVCodecID) {
+  switch (codecId) {
+    case AVCodecID.AV_CODEC_ID_H264:
+      return 0
+    case AVCodecID.AV_CODEC_ID_HEVC:
+      return 1
+    case AVCodecID.AV_CODEC_ID_VVC:
+      return 2
+    default:
+      return -1
+  }
+}
+
+/**
+ * annexb 转 avcc，dst 为 nullptr 时只统计输出大小，返回 NEED_BUFFER
+ * 
+ * 结果通过 getAnnexb2AvccInfo 获取
+ */
+export function annexb2Avcc(codecId: AVCodecID, src: pointer<uint8>, size: int32, dst: pointer<uint8> = nullptr, dstSize: int32 = 0): int32 {
+  const codec = getCodec(codecId)
+  if (codec < 0) {
+    return KernelRet.FALLBACK
+  }
+  return runner.invoke<int32>('bsf_annexb2avcc', src, size, dst, dstSize, codec, info)
+}
+
+export function getAnnexb2AvccInfo(field: Annexb2AvccInfo) {
+  return info[field]
+}
+
+/**
+ * 解析 avpacket 中的 adts 帧，返回帧数量
+ */
+export function parseADTS(src: pointer<uint8>, size: int32): int32 {
+  return runner.invoke<int32>('bsf_adts_parse', src, size, frames, MAX_ADTS_FRAMES)
+}
+
+export function getADTSFrameField(index: int32, field: ADTSFrameField) {
+  return frames[index * ADTSFrameField.MAX + field]
+}
@@ -0,0 +1,268 @@
+/*
+ * libmedia bitstream filter kernels
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "wasmenv.h"
+
+#define CODEC_H264 0
+#define CODEC_HEVC 1
+#define CODEC_VVC 2
+
+/**
+ * 返回值
+ * 0 转换完成
+ * 1 包含完整的参数集，需要生成 extradata，交给 ts 处理
+ * 2 不能原地转换并且没有传入输出缓冲区，需要的大小在 info[1]
+ * -1 数据错误
+ */
+#define RET_OK 0
+#define RET_FALLBACK 1
+#define RET_NEED_BUFFER 2
+#define RET_INVALID -1
+
+#define MAX_ADTS_FIELD 7
+
+/**
+ * 查找下一个起始码，返回起始码的位置，*start_code 为起始码长度
+ * 多于 3 个的 0 字节属于上一个 nalu 的 trailing_zero
+ */
+static int next_start_code(const uint8_t *data, int size, int offset, int *start_code) {
+  int t = 0;
+  for (int i = offset; i < size; i++) {
+    uint8_t v = data[i];
+    if (v == 0) {
+      t++;
+    }
+    else if (v == 1 && t >= 2) {
+      int zero = t < 3 ? t : 3;
+      *start_code = zero + 1;
+      return i - zero;
+    }
+    else {
+      t = 0;
+    }
+  }
+  *start_code = 0;
+  return -1;
+}
+
+static inline int get_nalu_type(const uint8_t *nalu, int size, int codec) {
+  if (codec == CODEC_H264) {
+    return size > 0 ? (nalu[0] & 0x1f) : -1;
+  }
+  else if (codec == CODEC_HEVC) {
+    return size > 0 ? ((nalu[0] >> 1) & 0x3f) : -1;
+  }
+  return size > 1 ? ((nalu[1] >> 3) & 0x1f) : -1;
+}
+
+static inline int is_aud(int type, int codec) {
+  if (codec == CODEC_H264) {
+    return type == 9;
+  }
+  else if (codec == CODEC_HEVC) {
+    return type == 35;
+  }
+  return type == 20;
+}
+
+static inline int is_sps(int type, int codec) {
+  if (codec == CODEC_H264) {
+    return type == 7;
+  }
+  else if (codec == CODEC_HEVC) {
+    return type == 33;
+  }
+  return type == 15;
+}
+
+static inline int is_pps(int type, int codec) {
+  if (codec == CODEC_H264) {
+    return type == 8;
+  }
+  else if (codec == CODEC_HEVC) {
+    return type == 34;
+  }
+  return type == 16;
+}
+
+static inline int is_key(int type, int codec) {
+  if (codec == CODEC_H264) {
+    return type == 5;
+  }
+  else if (codec == CODEC_HEVC) {
+    return type == 19 || type == 20 || type == 21;
+  }
+  return type >= 7 && type <= 10;
+}
+
+/**
+ * annexb 转 avcc（4 字节长度），去掉 AUD
+ *
+ * dst 为 0 或者 dst_size 不够时只统计，返回 RET_NEED_BUFFER，调用方按 info[1] 分配输出缓冲区再调用
+ *
+ * info[0] 是否是关键帧
+ * info[1] 输出大小
+ */
+EM_PORT_API(int) bsf_annexb2avcc(uint8_t *src, int size, uint8_t *dst, int dst_size, int codec, int32_t *info) {
+
+  int start_code = 0;
+  int offset = next_start_code(src, size, 0, &start_code);
+
+  if (offset < 0) {
+    return RET_INVALID;
+  }
+
+  int has_sps = 0;
+  int has_pps = 0;
+  int key = 0;
+  int out_size = 0;
+
+  // 第一遍统计输出大小
+  while (offset >= 0) {
+    int begin = offset + start_code;
+    int next_code = 0;
+    int next = next_start_code(src, size, begin, &next_code);
+    int end = next < 0 ? size : next;
+    int type = get_nalu_type(src + begin, end - begin, codec);
+
+    if (is_sps(type, codec)) {
+      has_sps = 1;
+    }
+    else if (is_pps(type, codec)) {
+      has_pps = 1;
+    }
+    if (is_key(type, codec)) {
+      key = 1;
+    }
+    if (!is_aud(type, codec)) {
+      out_size += 4 + end - begin;
+    }
+
+    offset = next;
+    start_code = next_code;
+  }
+
+  info[0] = key;
+  info[1] = out_size;
+
+  if (has_sps && has_pps) {
+    return RET_FALLBACK;
+  }
+
+  if (!dst || dst_size < out_size) {
+    return RET_NEED_BUFFER;
+  }
+
+  // 第二遍写入
+  offset = next_start_code(src, size, 0, &start_code);
+  int pos = 0;
+  while (offset >= 0) {
+    int begin = offset + start_code;
+    int next_code = 0;
+    int next = next_start_code(src, size, begin, &next_code);
+    int end = next < 0 ? size : next;
+    int length = end - begin;
+    int type = get_nalu_type(src + begin, length, codec);
+
+    if (!is_aud(type, codec)) {
+      uint8_t *p = dst + pos;
+      p[0] = (length >> 24) & 0xff;
+      p[1] = (length >> 16) & 0xff;
+      p[2] = (length >> 8) & 0xff;
+      p[3] = length & 0xff;
+      memcpy(p + 4, src + begin, length);
+      pos += 4 + length;
+    }
+
+    offset = next;
+    start_code = next_code;
+  }
+
+  return RET_OK;
+}
+
+/**
+ * 解析一个 avpacket 中所有完整或不完整的 adts 帧
+ *
+ * 每帧输出 MAX_ADTS_FIELD 个 int32：
+ * 帧起始偏移、头长度、payload 长度、帧长度、profile、采样率索引、声道配置（number_of_raw_data_blocks 在 profile 高 8 位）
+ *
+ * 最后一帧可能不完整，由调用方根据帧长度判断
+ * 遇到无法解析的数据（包括尾部不足 7 字节的 adts 头）时停止，调用方根据最后一帧的结束位置判断是否有剩余数据
+ * 返回解析出的帧数量，-1 数据错误
+ */
+EM_PORT_API(int) bsf_adts_parse(const uint8_t *src, int size, int32_t *frames, int max_frames) {
+  int i = 0;
+  int count = 0;
+
+  while (i < size && count < max_frames) {
+
+    if (size - i < 7 || src[i] != 0xff || (src[i + 1] & 0xf0) != 0xf0) {
+      // 重新同步
+      int j = i + 1;
+      for (; j < size - 1; j++) {
+        if (src[j] == 0xff && (src[j + 1] & 0xf0) == 0xf0) {
+          break;
+        }
+      }
+      if (j < size - 1 && size - j >= 7) {
+        i = j;
+        continue;
+      }
+      return count ? count : RET_INVALID;
+    }
+
+    const uint8_t *p = src + i;
+
+    int protection_absent = p[1] & 0x01;
+    int profile = (p[2] & 0xc0) >> 6;
+    int sampling_frequency_index = (p[2] & 0x3c) >> 2;
+    int channel_configuration = ((p[2] & 0x01) << 2) | ((p[3] & 0xc0) >> 6);
+    int frame_length = ((p[3] & 0x03) << 11) | (p[4] << 3) | ((p[5] & 0xe0) >> 5);
+    int blocks = p[6] & 0x03;
+    int header_length = protection_absent ? 7 : 9;
+
+    if (frame_length < header_length) {
+      return count ? count : RET_INVALID;
+    }
+
+    int32_t *frame = frames + count * MAX_ADTS_FIELD;
+    frame[0] = i;
+    frame[1] = header_length;
+    frame[2] = frame_length - header_length;
+    frame[3] = frame_length;
+    frame[4] = (profile + 1) | (blocks << 8);
+    frame[5] = sampling_frequency_index;
+    frame[6] = channel_configuration;
+
+    count++;
+    i += frame_length;
+  }
+
+  return count;
+}
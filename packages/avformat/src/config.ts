@@ -26,3 +26,5 @@
 export const DURATION_MAX_READ_SIZE = 250 * 1024
 
 export const SAMPLE_INDEX_STEP = 5000n
+
+export const REFINE_MAX_SAMPLES = 300
@@ -24,11 +24,12 @@
  */
 
 import type { AVIFormatContext } from './AVFormatContext'
-import { checkStreamParameters } from './function/checkStreamParameters'
-import { DURATION_MAX_READ_SIZE, SAMPLE_INDEX_STEP } from './config'
+import { checkStreamParameters, checkDecoderParameters } from './function/checkStreamParameters'
+import { DURATION_MAX_READ_SIZE, SAMPLE_INDEX_STEP, REFINE_MAX_SAMPLES } from './config'
 import roundStandardFramerate from './function/roundStandardFramerate'
 import guessDelayFromPts from './function/guessDelayFromPts'
 import guessDtsFromPts from './function/guessDtsFromPts'
+import hasAnnexbParamSet from './function/hasAnnexbParamSet'
 
 import { mapUint8Array } from '@libmedia/cheap'
 
@@ -47,6 +48,7 @@ import {
   NOPTS_VALUE_BIGINT,
   AVPacketSideDataType,
   avD2Q,
+  avQ2D,
   avRescaleQ,
   avRescaleQ2,
   copyAVPacketData,
@@ -92,16 +94,31 @@ export interface DemuxOptions {
    * 最大流分析时长（毫秒）
    */
   maxAnalyzeDuration?: number
+  /**
+   * 分级分析流参数
+   *
+   * 优先使用容器声明的参数（moov/stsd、FLV onMetaData、MKV Tracks、PMT 描述符等），
+   * 解码器必须的参数都拿到之后立即结束分析，帧率和码率在之后读包的过程中继续统计
+   */
+  tieredAnalyze?: boolean
 }
 
 interface StreamDemuxPrivateData {
   delay?: int32
   dtsQueue?: int64[]
+  /**
+   * 分级分析提前结束之后继续统计帧率码率使用的数据
+   */
+  refine?: {
+    dtsList: int64[]
+    bytes: number
+  }
 }
 
 const DefaultDemuxOptions = {
   fastOpen: false,
-  maxAnalyzeDuration: 15000
+  maxAnalyzeDuration: 15000,
+  tieredAnalyze: false
 }
 
 /**
@@ -236,6 +253,38 @@ export async function analyzeStreams(formatContext: AVIFormatContext): Promise<i
   let avpacket: pointer<AVPacket> = nullptr
   const caches: pointer<AVPacket>[] = []
   let ret = 0
+  let tiered = false
+
+  /**
+   * 解码器需要的参数都已知，音视频流都需要拿到第一个包来确定 startTime 和 firstDTS，
+   * 没有 dts 的流需要 MIN_ANALYZE_SAMPLES 个 pts 来推算 dts
+   */
+  function checkTieredReady() {
+    if (!(formatContext.options as DemuxOptions).tieredAnalyze
+      || formatContext.streams.length < needStreams
+      || !checkDecoderParameters(formatContext)
+    ) {
+      return false
+    }
+    for (let i = 0; i < formatContext.streams.length; i++) {
+      const stream = formatContext.streams[i]
+      if ((stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_AUDIO
+          && stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO)
+        || (stream.disposition & AVDisposition.ATTACHED_PIC)
+      ) {
+        continue
+      }
+      if (!streamFirstGotMap[stream.index]) {
+        return false
+      }
+      if (!streamDtsMap[stream.index]
+        && streamPtsMap[stream.index].length < MIN_ANALYZE_SAMPLES
+      ) {
+        return false
+      }
+    }
+    return true
+  }
 
   function checkPictureGot() {
     if (!formatContext.getDecoderResource) {
@@ -294,7 +343,8 @@ export async function analyzeStreams(formatContext: AVIFormatContext): Promise<i
       }
     }
 
-    if (dtsList && dtsList.length > 1) {
+    // 分级分析提前结束时样本太少，帧率码率留给 refineStream 统计
+    if (dtsList && dtsList.length > 1 && !(tiered && dtsList.length < MIN_ANALYZE_SAMPLES)) {
       let count = 0n
       for (let i = 1; i < dtsList.length; i++) {
         count += dtsList[i] - dtsList[i - 1]
@@ -383,6 +433,13 @@ export async function analyzeStreams(formatContext: AVIFormatContext): Promise<i
       break
     }
 
+    if (checkTieredReady()) {
+      logger.debug('decoder parameters are ready, finish analyze streams early')
+      tiered = true
+      await finalizeAnalyze()
+      break
+    }
+
     if (!avpacket) {
       avpacket = createAVPacket()
     }
@@ -439,6 +496,7 @@ export async function analyzeStreams(formatContext: AVIFormatContext): Promise<i
       if (!pictureGot[stream.index]
         && formatContext.getDecoderResource
         && !(formatContext.options as DemuxOptions).fastOpen
+        && !(formatContext.options as DemuxOptions).tieredAnalyze
         && !stream.metadata[AVStreamMetadataKey.ENCRYPTION]
       ) {
         let decoder = decoderMap[stream.index]
@@ -557,6 +615,30 @@ export async function analyzeStreams(formatContext: AVIFormatContext): Promise<i
     }
   })
 
+  if (tiered) {
+    // 缓存的包之后会再经过 readAVPacket，从空数据开始统计
+    formatContext.streams.forEach((stream) => {
+      if (stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_AUDIO
+        && stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO
+        || (stream.disposition & AVDisposition.ATTACHED_PIC)
+      ) {
+        return
+      }
+      const refine = {
+        dtsList: [],
+        bytes: 0
+      }
+      if (stream.privateData2) {
+        (stream.privateData2 as StreamDemuxPrivateData).refine = refine
+      }
+      else {
+        stream.privateData2 = {
+          refine
+        }
+      }
+    })
+  }
+
   if (ret === IOError.END || ret === IOError.ABORT) {
     return 0
   }
@@ -604,6 +686,66 @@ function addSample(stream: AVStream, avpacket: pointer<AVPacket>) {
   }
 }
 
+/**
+ * 分级分析提前结束之后，在正常读包的过程中继续统计帧率和码率
+ *
+ * 统计够 maxAnalyzeDuration 时长或 REFINE_MAX_SAMPLES 个包之后更新到 codecpar，容器已经声明的参数不覆盖
+ */
+function refineStream(formatContext: AVIFormatContext, stream: AVStream, avpacket: pointer<AVPacket>) {
+  const context = stream.privateData2 as StreamDemuxPrivateData
+  if (!context?.refine || !avpacket.size || avpacket.dts === NOPTS_VALUE_BIGINT) {
+    return
+  }
+  const refine = context.refine
+  refine.dtsList.push(avpacket.dts)
+  refine.bytes += avpacket.size
+
+  const dtsList = refine.dtsList
+  if (dtsList.length < MIN_ANALYZE_SAMPLES) {
+    return
+  }
+
+  const count = dtsList[dtsList.length - 1] - dtsList[0]
+
+  if (count <= 0n) {
+    return
+  }
+
+  if (dtsList.length < REFINE_MAX_SAMPLES
+    && avRescaleQ(count, stream.timeBase, AV_MILLI_TIME_BASE_Q)
+      < static_cast<int64>((formatContext.options as DemuxOptions).maxAnalyzeDuration)
+  ) {
+    return
+  }
+
+  if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO
+    && stream.codecpar.sampleRate > 0
+    && stream.codecpar.frameSize <= 0
+  ) {
+    let value = static_cast<double>(count) / (dtsList.length - 1)
+    stream.codecpar.frameSize = Math.round(value / stream.timeBase.den * stream.timeBase.num * stream.codecpar.sampleRate)
+  }
+  else if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO
+    && avQ2D(stream.codecpar.framerate) === 0
+  ) {
+    const q = avD2Q((stream.timeBase.den * (dtsList.length - 1))
+      / (reinterpret_cast<int32>(static_cast<double>(count)) * stream.timeBase.num), INT32_MAX)
+    stream.codecpar.framerate.num = q.num
+    stream.codecpar.framerate.den = q.den
+    roundStandardFramerate(stream.codecpar.framerate)
+  }
+
+  if (!stream.codecpar.bitrate) {
+    // 最后一个包的数据不在统计的时长内
+    const duration = static_cast<double>(count) * stream.timeBase.num / stream.timeBase.den
+    stream.codecpar.bitrate = static_cast<int64>((refine.bytes - avpacket.size) * 8 / duration)
+  }
+
+  logger.debug(`refine stream ${stream.index} parameters, framerate: ${avQ2D(stream.codecpar.framerate)}, bitrate: ${stream.codecpar.bitrate}`)
+
+  delete context.refine
+}
+
 async function packetNeedRead(formatContext: AVIFormatContext, avpacket: pointer<AVPacket>): Promise<int32> {
   const stream = formatContext.getStreamByIndex(avpacket.streamIndex)
   if (avpacket.dts === NOPTS_VALUE_BIGINT) {
@@ -700,6 +842,17 @@ async function packetNeedRead(formatContext: AVIFormatContext, avpacket: pointer
       return readAVPacket(formatContext, avpacket)
     }
   }
+  // 关键帧带有参数集时打上标记，之后使用方不需要再解析码流
+  if ((avpacket.flags & AVPacketFlags.AV_PKT_FLAG_KEY)
+    && (avpacket.flags & AVPacketFlags.AV_PKT_FLAG_H26X_ANNEXB)
+    && (stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264
+      || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC
+      || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC
+    )
+    && hasAnnexbParamSet(stream.codecpar.codecId, mapUint8Array(avpacket.data, reinterpret_cast<size>(avpacket.size)))
+  ) {
+    avpacket.flags |= AVPacketFlags.AV_PKT_FLAG_H26X_PARAM_SET
+  }
   if (formatContext.ioReader.flags & IOFlags.SEEKABLE) {
     if (!stream.sampleIndexesPosMap.has(avpacket.pos)) {
       if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
@@ -746,6 +899,7 @@ async function packetNeedRead(formatContext: AVIFormatContext, avpacket: pointer
       }
     }
   }
+  refineStream(formatContext, stream, avpacket)
   return 0
 }
 
@@ -830,6 +984,10 @@ export async function seek(formatContext: AVIFormatContext, streamIndex: number,
     const oldDelay: Record<int32, int32> = {}
     formatContext.streams.forEach((stream) => {
       const context = stream.privateData2 as StreamDemuxPrivateData
+      if (context?.refine) {
+        context.refine.dtsList.length = 0
+        context.refine.bytes = 0
+      }
       if (context?.dtsQueue) {
         context.dtsQueue.length = 0
         if (context.delay) {
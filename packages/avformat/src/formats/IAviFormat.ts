@@ -27,8 +27,10 @@ import type { AVIFormatContext } from '../AVFormatContext'
 import IFormat from './IFormat'
 import { readInfo, readBmpHeader, readWavHeader } from './riff/iriff'
 import mktagle from '../function/mktagle'
+import checkAVPacketDiscard from '../function/checkAVPacketDiscard'
 import type { AVIMainHeader, AVISample, AVIStreamContext } from './avi/type'
 import { AVFIndexFlags, AVIFlags } from './avi/type'
+import AVISampleIndex, { AVISampleIndexChunk } from './avi/AVISampleIndex'
 import { codecBmpTags } from './riff/riff'
 
 import {
@@ -59,6 +61,7 @@ import {
   avReduce,
   intread,
   AVCodecParameterFlags,
+  AVDiscard,
   nalu as naluUtil
 } from '@libmedia/avutil'
 
@@ -79,7 +82,6 @@ import {
 } from '@libmedia/avutil/internal'
 
 import {
-  array,
   object,
   bigint,
   concatTypeArray,
@@ -91,6 +93,9 @@ import {
   IOError
 } from '@libmedia/common/io'
 
+// 索引按块批量读取，16 和 8 的整数倍
+const INDEX_READ_BLOCK_SIZE = 64 * 1024
+
 const AVI_HEADER = [
   ['R', 'I', 'F', 'F', 'A', 'V', 'I', ' '],
   ['R', 'I', 'F', 'F', 'A', 'V', 'I', 'X'],
@@ -176,6 +181,16 @@ export default class IAviFormat extends IFormat {
     return 100
   }
 
+  private getStreamIndexByCode(c0: number, c1: number) {
+    // '0' - '9'
+    if (c0 >= 0x30 && c0 <= 0x39
+      && c1 >= 0x30 && c1 <= 0x39
+    ) {
+      return (c0 - 0x30) * 10 + (c1 - 0x30)
+    }
+    return 100
+  }
+
   private getDuration(context: AVIStreamContext, len: int32) {
     if (context.dwSampleSize) {
       return static_cast<int64>(len)
@@ -296,6 +311,7 @@ export default class IAviFormat extends IFormat {
           case 'strh': {
             const streamContext: AVIStreamContext = {
               sampleEnd: false,
+              currentChunk: 0,
               currentSample: 0
             } as AVIStreamContext
             streamContext.fccType = await formatContext.ioReader.readString(4)
@@ -647,8 +663,15 @@ export default class IAviFormat extends IFormat {
 
       formatContext.streams.forEach((stream) => {
         const streamContext = stream.privData as AVIStreamContext
-        if (streamContext.samples?.length) {
-          stream.nbFrames = static_cast<int64>(streamContext.samples.length as uint32)
+        if (streamContext.samples) {
+          if (streamContext.samples.loaded) {
+            if (streamContext.samples.length) {
+              stream.nbFrames = static_cast<int64>(streamContext.samples.length as uint32)
+            }
+          }
+          else if (streamContext.dwLength && !streamContext.dwSampleSize) {
+            stream.nbFrames = static_cast<int64>(streamContext.dwLength as uint32)
+          }
         }
       })
 
@@ -660,40 +683,58 @@ export default class IAviFormat extends IFormat {
     return 0
   }
 
-  private async readOdmlIndex(formatContext: AVIFormatContext): Promise<int32> {
-    const longsPerEntry = await formatContext.ioReader.readUint16()
-    const indexSubType = await formatContext.ioReader.readUint8()
-    const indexType = await formatContext.ioReader.readUint8()
-    const entriesInUse = await formatContext.ioReader.readInt32()
-    const chunkId = await formatContext.ioReader.readString(4)
-    let base = await formatContext.ioReader.readUint64()
-
-    const index = this.getStreamIndex(chunkId)
+  /**
+   * 读取 OpenDML 索引
+   * 
+   * 超级索引只记录各个标准索引块的位置和时长，除第一块外都在 seek 或播放到对应区域时才加载
+   * 
+   * @param formatContext 
+   * @param target 加载指定的标准索引块
+   */
+  private async readOdmlIndex(formatContext: AVIFormatContext, target?: AVISampleIndexChunk): Promise<int32> {
+    const header = await formatContext.ioReader.readBuffer(24)
+    const view = new DataView(header.buffer, header.byteOffset, header.byteLength)
+
+    const longsPerEntry = view.getUint16(0, true)
+    const indexSubType = header[2]
+    const indexType = header[3]
+    const entriesInUse = view.getInt32(4, true)
+    let base = view.getBigUint64(12, true)
+
+    const index = this.getStreamIndexByCode(header[8], header[9])
 
     if (index >= formatContext.streams.length) {
       return errorType.DATA_INVALID
     }
 
-    let lastPos = -1n
     let fileSize = this.context.fileSize
 
     const stream = formatContext.streams[index]
     const streamContext = stream.privData as AVIStreamContext
 
     if (!streamContext.samples) {
-      streamContext.samples = []
+      streamContext.samples = new AVISampleIndex()
     }
 
     if (indexSubType || entriesInUse < 0) {
       return errorType.DATA_INVALID
     }
-    await formatContext.ioReader.skip(4)
+    // 索引条目不能超出文件剩余大小
+    if (fileSize > 0
+      && static_cast<int64>(entriesInUse) * (indexType ? 8n : 16n) > fileSize - formatContext.ioReader.getPos()
+    ) {
+      return errorType.DATA_INVALID
+    }
     if (indexType && longsPerEntry !== 2) {
       return errorType.DATA_INVALID
     }
     if (indexType > 1) {
       return errorType.DATA_INVALID
     }
+    if (target && !indexType) {
+      // 标准索引块不能再指向超级索引
+      return errorType.DATA_INVALID
+    }
     if (fileSize > 0 && base >= fileSize) {
       if (base >> 32n == (base & 0xFFFFFFFFn)
         && (base & 0xFFFFFFFFn) < fileSize
@@ -705,50 +746,131 @@ export default class IAviFormat extends IFormat {
         return errorType.DATA_INVALID
       }
     }
-    for (let i = 0; i < entriesInUse; i++) {
-      this.context.odmlMaxPos = bigint.max(this.context.odmlMaxPos, formatContext.ioReader.getPos())
-      // If we read more than there are bytes then we must have been reading something twice
-      if (this.context.odmlRead > this.context.odmlMaxPos) {
-        return errorType.DATA_INVALID
+
+    if (indexType) {
+      const chunk = target || streamContext.samples.addChunk(new AVISampleIndexChunk(streamContext.currentDts))
+      let currentDts = chunk.startDts
+      let lastPos = -1n
+      let remaining = entriesInUse
+
+      // 文件大小未知时条目数没有校验，只预留一块，之后按需增长
+      chunk.reserve(fileSize > 0 ? entriesInUse : Math.min(entriesInUse, INDEX_READ_BLOCK_SIZE >>> 3))
+
+      while (remaining > 0) {
+        const count = Math.min(remaining, INDEX_READ_BLOCK_SIZE >>> 3)
+        const buffer = await this.readIndexBlock(formatContext, count << 3)
+        if (!buffer) {
+          return errorType.DATA_INVALID
+        }
+        const view = new DataView(buffer.buffer, buffer.byteOffset, buffer.byteLength)
+        for (let i = 0; i < count; i++) {
+          const pos = static_cast<int64>(view.getUint32(i << 3, true) as uint32) + base - 8n
+          let len = view.getInt32((i << 3) + 4, true)
+          const key = len >= 0
+          len &= 0x7FFFFFFF
+
+          if (lastPos == pos || pos == base - 8n) {
+            this.context.nonInterleaved = true
+          }
+          if (lastPos != pos && len) {
+            chunk.push(pos, len, key, currentDts)
+          }
+          currentDts += this.getDuration(streamContext, len)
+          lastPos = pos
+        }
+        remaining -= count
       }
-      if (indexType) {
-        const pos = static_cast<int64>((await formatContext.ioReader.readUint32()) as uint32) + base - 8n
-        let len = await formatContext.ioReader.readInt32()
-        const key = len >= 0
-        len &= 0x7FFFFFFF
-        this.context.odmlRead += 8n
-
-        if (lastPos == pos || pos == base - 8n) {
-          this.context.nonInterleaved = true
+      chunk.duration = currentDts - chunk.startDts
+      chunk.loaded = true
+      if (!target) {
+        streamContext.currentDts = currentDts
+      }
+    }
+    else {
+      const scale = static_cast<int64>((streamContext.dwSampleSize || 1) as uint32)
+      const chunks: AVISampleIndexChunk[] = []
+      let startDts = streamContext.currentDts
+      // 超级索引没有记录时长时无法定位，只能全部加载
+      let eager = false
+      let remaining = entriesInUse
+
+      while (remaining > 0) {
+        const count = Math.min(remaining, INDEX_READ_BLOCK_SIZE >>> 4)
+        const buffer = await this.readIndexBlock(formatContext, count << 4)
+        if (!buffer) {
+          return errorType.DATA_INVALID
         }
-        if (lastPos != pos && len) {
-          streamContext.samples.push({
-            pos,
-            size: len,
-            key,
-            dts: streamContext.currentDts
-          })
+        const view = new DataView(buffer.buffer, buffer.byteOffset, buffer.byteLength)
+        for (let i = 0; i < count; i++) {
+          const offset = view.getBigUint64(i << 4, true)
+          const duration = static_cast<int64>(view.getUint32((i << 4) + 12, true) as uint32) * scale
+          if (!duration) {
+            eager = true
+          }
+          const chunk = new AVISampleIndexChunk(startDts, duration, offset + 8n)
+          startDts += duration
+          chunks.push(streamContext.samples.addChunk(chunk))
         }
-        streamContext.currentDts += this.getDuration(streamContext, len)
-        lastPos = pos
+        remaining -= count
       }
-      else {
-        this.context.odmlRead += 16n
-        let offset = await formatContext.ioReader.readUint64()
-        await formatContext.ioReader.skip(8)
-        let pos = formatContext.ioReader.getPos()
-        await formatContext.ioReader.seek(offset + 8n)
-        let ret = await this.readOdmlIndex(formatContext)
+
+      let currentDts = streamContext.currentDts
+      for (let i = 0; i < chunks.length; i++) {
+        if (i && !eager) {
+          break
+        }
+        chunks[i].startDts = currentDts
+        const ret = await this.loadSampleIndexChunk(formatContext, chunks[i])
         if (ret < 0) {
           return ret
         }
-        await formatContext.ioReader.seek(pos)
+        currentDts = chunks[i].startDts + chunks[i].duration
       }
     }
     this.context.indexLoaded = true
     return 0
   }
 
+  /**
+   * 读取一块索引数据
+   * 
+   * 读过的索引总字节数超过读到过的最大位置说明有索引被重复读取（索引块相互引用或重复），返回 null
+   * 
+   * @param formatContext 
+   * @param size 
+   */
+  private async readIndexBlock(formatContext: AVIFormatContext, size: int32) {
+    const buffer = await formatContext.ioReader.readBuffer(size)
+    this.context.odmlRead += static_cast<int64>(size)
+    this.context.odmlMaxPos = bigint.max(this.context.odmlMaxPos, formatContext.ioReader.getPos())
+    if (this.context.odmlRead > this.context.odmlMaxPos) {
+      return null
+    }
+    return buffer
+  }
+
+  /**
+   * 加载一个 OpenDML 标准索引块，不改变当前读取位置
+   * 
+   * @param formatContext 
+   * @param chunk 
+   */
+  private async loadSampleIndexChunk(formatContext: AVIFormatContext, chunk: AVISampleIndexChunk) {
+    if (chunk.loaded) {
+      return 0
+    }
+    const pos = formatContext.ioReader.getPos()
+    await formatContext.ioReader.seek(chunk.offset)
+    const ret = await this.readOdmlIndex(formatContext, chunk)
+    await formatContext.ioReader.seek(pos)
+    if (ret < 0) {
+      // 损坏的索引块当作空块处理
+      chunk.loaded = true
+      logger.warn(`load avi index chunk at ${chunk.offset} failed, ret: ${ret}`)
+    }
+    return ret
+  }
+
   private async readIdx1(formatContext: AVIFormatContext, size: int32): Promise<int32> {
 
     let firstPacket = true
@@ -758,7 +880,7 @@ export default class IAviFormat extends IFormat {
     let dataOffset = 0n
     let anyKey = false
 
-    let nbIndexEntries = size / 16
+    let nbIndexEntries = size >>> 4
 
     if (nbIndexEntries <= 0) {
       return errorType.DATA_INVALID
@@ -781,55 +903,62 @@ export default class IAviFormat extends IFormat {
       dataOffset = this.context.moviList
     }
 
-    for (let i = 0; i < nbIndexEntries; i++) {
-      const tag = await formatContext.ioReader.readString(4)
-      const flags = await formatContext.ioReader.readUint32()
-      let pos = static_cast<int64>(await formatContext.ioReader.readUint32())
-      const len = await formatContext.ioReader.readUint32()
+    const chunks: AVISampleIndexChunk[] = []
 
-      const index = this.getStreamIndex(tag)
-      if (index >= formatContext.streams.length) {
-        continue
-      }
-      const stream = formatContext.streams[index]
-      const streamContext = stream.privData as AVIStreamContext
-      if (!streamContext.samples) {
-        streamContext.samples = []
-      }
+    while (nbIndexEntries > 0) {
+      const count = Math.min(nbIndexEntries, INDEX_READ_BLOCK_SIZE >>> 4)
+      const buffer = await formatContext.ioReader.readBuffer(count << 4)
+      const view = new DataView(buffer.buffer, buffer.byteOffset, buffer.byteLength)
+      nbIndexEntries -= count
 
-      if (tag[2] === 'p' && tag[3] === 'c') {
-        continue
-      }
-      if (firstPacket && firstPacketPos) {
-        if (this.context.moviList + 4n !== pos || pos + 500n > firstPacketPos) {
-          dataOffset = firstPacketPos - pos
+      for (let i = 0; i < count; i++) {
+        const offset = i << 4
+        const flags = view.getUint32(offset + 4, true)
+        let pos = static_cast<int64>(view.getUint32(offset + 8, true) as uint32)
+        const len = view.getUint32(offset + 12, true)
+
+        const index = this.getStreamIndexByCode(buffer[offset], buffer[offset + 1])
+        if (index >= formatContext.streams.length) {
+          continue
+        }
+        const stream = formatContext.streams[index]
+        const streamContext = stream.privData as AVIStreamContext
+        if (!chunks[index]) {
+          if (!streamContext.samples) {
+            streamContext.samples = new AVISampleIndex()
+          }
+          chunks[index] = streamContext.samples.addChunk(new AVISampleIndexChunk(streamContext.currentDts))
+        }
+
+        // ##pc 调色板变化
+        if (buffer[offset + 2] === 0x70 && buffer[offset + 3] === 0x63) {
+          continue
+        }
+        if (firstPacket && firstPacketPos) {
+          if (this.context.moviList + 4n !== pos || pos + 500n > firstPacketPos) {
+            dataOffset = firstPacketPos - pos
+          }
+          firstPacket = false
+        }
+        pos += dataOffset
+        if (lastPos === pos) {
+          this.context.nonInterleaved = true
+        }
+        if (lastIdx !== pos && len) {
+          chunks[index].push(pos, len, (flags & AVFIndexFlags.AVIIF_INDEX) > 0, streamContext.currentDts)
+          lastIdx = pos
+        }
+        streamContext.currentDts += this.getDuration(streamContext, len)
+        lastPos = pos
+        if (flags & AVFIndexFlags.AVIIF_INDEX) {
+          anyKey = true
         }
-        firstPacket = false
-      }
-      pos += dataOffset
-      if (lastPos === pos) {
-        this.context.nonInterleaved = true
-      }
-      if (lastIdx !== pos && len) {
-        streamContext.samples.push({
-          pos,
-          size: len,
-          key: (flags & AVFIndexFlags.AVIIF_INDEX) > 0,
-          dts: streamContext.currentDts
-        })
-        lastIdx = pos
-      }
-      streamContext.currentDts += this.getDuration(streamContext, len)
-      lastPos = pos
-      if (flags & AVFIndexFlags.AVIIF_INDEX) {
-        anyKey = true
       }
     }
     if (!anyKey) {
-      formatContext.streams.forEach((stream) => {
-        const streamContext = stream.privData as AVIStreamContext
-        if (streamContext.samples?.length) {
-          streamContext.samples[0].key = true
+      chunks.forEach((chunk) => {
+        if (chunk.count) {
+          chunk.key[0] = 1
         }
       })
     }
@@ -875,7 +1004,42 @@ export default class IAviFormat extends IFormat {
     })
   }
 
-  private getNextSample(formatContext: AVIFormatContext) {
+  /**
+   * 获取流当前采样所在的索引块，需要时加载
+   */
+  private async getCurrentSampleChunk(formatContext: AVIFormatContext, context: AVIStreamContext) {
+    const chunks = context.samples.chunks
+    while (context.currentChunk < chunks.length) {
+      const chunk = chunks[context.currentChunk]
+      if (!chunk.loaded) {
+        await this.loadSampleIndexChunk(formatContext, chunk)
+      }
+      if (context.currentSample < chunk.count) {
+        return chunk
+      }
+      context.currentChunk++
+      context.currentSample = 0
+    }
+    context.sampleEnd = true
+    return null
+  }
+
+  /**
+   * 获取 timestamp 所在的索引块，需要时加载
+   */
+  private async getSampleChunkByDts(formatContext: AVIFormatContext, context: AVIStreamContext, timestamp: int64) {
+    const index = context.samples.findChunk(timestamp)
+    if (index < 0) {
+      return null
+    }
+    const chunk = context.samples.chunks[index]
+    if (!chunk.loaded) {
+      await this.loadSampleIndexChunk(formatContext, chunk)
+    }
+    return chunk
+  }
+
+  private async getNextSample(formatContext: AVIFormatContext) {
     let sample: AVISample
     let stream: AVStream
 
@@ -887,34 +1051,55 @@ export default class IAviFormat extends IFormat {
     let dtsSample: AVISample
     let dtsStream: AVStream
 
-    formatContext.streams.forEach((s) => {
+    for (let i = 0; i < formatContext.streams.length; i++) {
+      const s = formatContext.streams[i]
       const context = s.privData as AVIStreamContext
 
-      if (!context.samples || !context.samples.length) {
+      if (!context.samples || !context.samples.chunks.length) {
         context.sampleEnd = true
-        return true
+        continue
+      }
+      if (context.sampleEnd) {
+        continue
+      }
+      if (s.discard >= AVDiscard.AVDISCARD_ALL) {
+        context.sampleEnd = true
+        continue
       }
 
-      if (!context.sampleEnd
-        && (!posSample
-          || (context.samples[context.currentSample].pos < posSample.pos)
-        )
-      ) {
-        posSample = context.samples[context.currentSample]
+      let chunk = await this.getCurrentSampleChunk(formatContext, context)
+
+      // 只读关键帧时直接跳到下一个关键帧采样
+      if (s.discard >= AVDiscard.AVDISCARD_NONKEY && s.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+        while (chunk && !chunk.key[context.currentSample]) {
+          context.currentSample++
+          chunk = await this.getCurrentSampleChunk(formatContext, context)
+        }
+      }
+      if (!chunk) {
+        continue
+      }
+
+      const current: AVISample = {
+        pos: chunk.pos[context.currentSample],
+        dts: chunk.dts[context.currentSample],
+        size: chunk.size[context.currentSample],
+        key: !!chunk.key[context.currentSample]
+      }
+
+      if (!posSample || current.pos < posSample.pos) {
+        posSample = current
         posStream = s
       }
 
-      if (!context.sampleEnd
-        && (!dtsSample
-          || avRescaleQ(context.samples[context.currentSample].dts, s.timeBase, AV_TIME_BASE_Q)
-            < bestDts
-        )
+      if (!dtsSample
+        || avRescaleQ(current.dts, s.timeBase, AV_TIME_BASE_Q) < bestDts
       ) {
-        dtsSample = context.samples[context.currentSample]
+        dtsSample = current
         bestDts = avRescaleQ(dtsSample.dts, s.timeBase, AV_TIME_BASE_Q)
         dtsStream = s
       }
-    })
+    }
 
     if (posSample && dtsSample) {
       const posDts = avRescaleQ(posSample.dts, posStream.timeBase, AV_TIME_BASE_Q)
@@ -957,10 +1142,12 @@ export default class IAviFormat extends IFormat {
     if (stream) {
       const streamContext = (stream.privData as AVIStreamContext)
       streamContext.currentSample++
-      if (streamContext.currentSample
-        >= streamContext.samples.length
-      ) {
-        streamContext.sampleEnd = true
+      if (streamContext.currentSample >= streamContext.samples.chunks[streamContext.currentChunk].count) {
+        streamContext.currentChunk++
+        streamContext.currentSample = 0
+        if (streamContext.currentChunk >= streamContext.samples.chunks.length) {
+          streamContext.sampleEnd = true
+        }
       }
     }
     return {
@@ -973,7 +1160,7 @@ export default class IAviFormat extends IFormat {
 
     if (this.context.currentIndex < 0) {
       if (this.context.nonInterleaved && formatContext.streams.length > 1) {
-        const { sample, stream } = this.getNextSample(formatContext)
+        const { sample, stream } = await this.getNextSample(formatContext)
         if (sample) {
           await formatContext.ioReader.seek(sample.pos)
           const streamContext = stream.privData as AVIStreamContext
@@ -1018,20 +1205,19 @@ export default class IAviFormat extends IFormat {
       avpacket.flags |= AVPacketFlags.AV_PKT_FLAG_H26X_ANNEXB
     }
 
+    // 没有索引时无法判断关键帧，不做关键帧过滤
+    let key = true
+
     if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
-      if (streamContext.samples?.length) {
-        let index = array.binarySearch(streamContext.samples, (sample) => {
-          if (sample.dts > streamContext.currentDts) {
-            return -1
-          }
-          else if (sample.dts === streamContext.currentDts) {
-            return 0
-          }
-          return 1
-        })
-        if (index > -1) {
-          if (streamContext.samples[index].key) {
+      if (streamContext.samples?.chunks.length) {
+        const currentDts = streamContext.currentDts
+        const chunk = await this.getSampleChunkByDts(formatContext, streamContext, currentDts)
+        key = false
+        if (chunk) {
+          const index = chunk.search(currentDts)
+          if (index > -1 && chunk.dts[index] === currentDts && chunk.key[index]) {
             avpacket.flags |= AVPacketFlags.AV_PKT_FLAG_KEY
+            key = true
           }
         }
       }
@@ -1046,6 +1232,31 @@ export default class IAviFormat extends IFormat {
       avpacket.flags |= AVPacketFlags.AV_PKT_FLAG_KEY
     }
 
+    if (checkAVPacketDiscard(stream, key)) {
+      avpacket.flags = 0
+      if (this.canJumpToNextKey(formatContext, stream)) {
+        const located = await this.locateNextKeySample(formatContext, stream, streamContext.currentDts)
+        if (!located) {
+          return IOError.END
+        }
+        const pos = streamContext.samples.chunks[located.chunk].pos[located.index]
+        // 中间的 chunk 不再读取，直接跳到下一个关键帧
+        if (pos > formatContext.ioReader.getPos() + static_cast<int64>(this.context.remaining)) {
+          this.context.remaining = 0
+          this.context.packetSize = 0
+          await this.seekToSample(formatContext, stream, located)
+          return this.readAVPacket_(formatContext, avpacket)
+        }
+      }
+      // 跳过整个 chunk 的数据
+      await formatContext.ioReader.skip(this.context.remaining)
+      streamContext.currentDts += this.getDuration(streamContext, this.context.remaining)
+      this.context.remaining = 0
+      this.context.currentIndex = -1
+      this.context.packetSize = 0
+      return this.readAVPacket_(formatContext, avpacket)
+    }
+
     this.context.lastPktPos = formatContext.ioReader.getPos()
 
     let size: number
@@ -1212,86 +1423,129 @@ export default class IAviFormat extends IFormat {
       return now
     }
 
-    if (!this.context.indexLoaded) {
-      static_cast<int64>(errorType.OPERATE_NOT_SUPPORT)
+    const streamContext = stream.privData as AVIStreamContext
+
+    if (!this.context.indexLoaded || !streamContext.samples) {
+      return static_cast<int64>(errorType.OPERATE_NOT_SUPPORT)
     }
 
-    const streamContext = stream.privData as AVIStreamContext
+    const located = await this.locateSample(formatContext, stream, timestamp)
 
-    let pos = NOPTS_VALUE_BIGINT
+    if (located) {
+      await this.seekToSample(formatContext, stream, located)
+      return now
+    }
+    return static_cast<int64>(errorType.OPERATE_NOT_SUPPORT)
+  }
 
-    let index = array.binarySearch(streamContext.samples, (item) => {
-      if (item.dts > timestamp) {
-        return -1
+  /**
+   * 将 stream 定位到 located 处的采样，其他流定位到相同时间，跳到所有流中最小的位置
+   */
+  private async seekToSample(formatContext: AVIFormatContext, stream: AVStream, located: { chunk: number, index: number }) {
+    const streamContext = stream.privData as AVIStreamContext
+    const chunk = streamContext.samples.chunks[located.chunk]
+    streamContext.currentDts = chunk.dts[located.index]
+    streamContext.sampleEnd = false
+    streamContext.currentChunk = located.chunk
+    streamContext.currentSample = located.index
+    let pos = chunk.pos[located.index]
+
+    for (let i = 0; i < formatContext.streams.length; i++) {
+      const st = formatContext.streams[i]
+      const stContext = st.privData as AVIStreamContext
+      if (st === stream || !stContext.samples) {
+        continue
       }
-      else if (item.dts === timestamp) {
-        return 0
+      const located = await this.locateSample(
+        formatContext,
+        st,
+        avRescaleQ(streamContext.currentDts, stream.timeBase, st.timeBase)
+      )
+      if (located) {
+        const chunk = stContext.samples.chunks[located.chunk]
+        pos = bigint.min(pos, chunk.pos[located.index])
+        stContext.currentDts = chunk.dts[located.index]
+        stContext.currentChunk = located.chunk
+        stContext.currentSample = located.index
+        stContext.sampleEnd = false
       }
-      return 1
-    })
+    }
 
-    if (index > -1 && stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
-      let i = index
-      for (; i >= 0; i--) {
-        if (streamContext.samples[i].key) {
-          index = i
-          break
-        }
+    await formatContext.ioReader.seek(pos)
+    this.context.currentIndex = -1
+  }
+
+  /**
+   * 查找 timestamp 之后的下一个关键帧采样
+   */
+  private async locateNextKeySample(formatContext: AVIFormatContext, stream: AVStream, timestamp: int64) {
+    const streamContext = stream.privData as AVIStreamContext
+    let chunkIndex = Math.max(streamContext.samples.findChunk(timestamp), 0)
+
+    while (chunkIndex < streamContext.samples.chunks.length) {
+      const chunk = streamContext.samples.chunks[chunkIndex]
+      if (!chunk.loaded) {
+        await this.loadSampleIndexChunk(formatContext, chunk)
       }
-      if (i < 0) {
-        index = -1
+      for (let index = chunk.search(timestamp) + 1; index < chunk.count; index++) {
+        if (chunk.key[index]) {
+          return {
+            chunk: chunkIndex,
+            index
+          }
+        }
       }
+      chunkIndex++
     }
+    return null
+  }
 
-    if (index > -1) {
-      streamContext.currentDts = streamContext.samples[index].dts
-      streamContext.sampleEnd = false
-      streamContext.currentSample = index
-      pos = streamContext.samples[index].pos
-      array.each(formatContext.streams, (st) => {
-        if (st !== stream) {
-          const stContext = st.privData as AVIStreamContext
-          let timestamp = avRescaleQ(streamContext.currentDts, stream.timeBase, st.timeBase)
+  /**
+   * 交错存储时只读视频关键帧并且其他流都已丢弃，可以直接跳到下一个关键帧
+   */
+  private canJumpToNextKey(formatContext: AVIFormatContext, stream: AVStream) {
+    if (this.context.nonInterleaved
+      || !this.context.indexLoaded
+      || !(formatContext.ioReader.flags & IOFlags.SEEKABLE)
+      || stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO
+      || stream.discard < AVDiscard.AVDISCARD_NONKEY
+      || !(stream.privData as AVIStreamContext).samples?.chunks.length
+    ) {
+      return false
+    }
+    return formatContext.streams.every((st) => {
+      return st === stream || st.discard >= AVDiscard.AVDISCARD_ALL
+    })
+  }
 
-          let index = array.binarySearch(stContext.samples, (sample) => {
-            if (sample.dts > timestamp) {
-              return -1
-            }
-            else if (sample.dts === timestamp) {
-              return 0
-            }
-            return 1
-          })
-
-          if (index > -1 && st.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
-            let i = index
-            for (; i >= 0; i--) {
-              if (stContext.samples[i].key) {
-                index = i
-                break
-              }
-            }
-            if (i < 0) {
-              index = -1
-            }
-          }
+  /**
+   * 查找 timestamp 处的采样，视频查找之前最近的关键帧
+   * 
+   * 只加载查找路径上的索引块
+   */
+  private async locateSample(formatContext: AVIFormatContext, stream: AVStream, timestamp: int64) {
+    const streamContext = stream.privData as AVIStreamContext
+    let chunkIndex = streamContext.samples.findChunk(timestamp)
 
-          if (index >= 0) {
-            pos = bigint.min(pos, stContext.samples[index].pos)
-            stContext.currentDts = stContext.samples[index].dts
-            stContext.currentSample = index
-            stContext.sampleEnd = false
-          }
+    while (chunkIndex >= 0) {
+      const chunk = streamContext.samples.chunks[chunkIndex]
+      if (!chunk.loaded) {
+        await this.loadSampleIndexChunk(formatContext, chunk)
+      }
+      let index = chunk.search(timestamp)
+      if (index > -1 && stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+        index = chunk.findKeyBefore(index)
+      }
+      if (index > -1) {
+        return {
+          chunk: chunkIndex,
+          index
         }
-      })
-
-      if (pos !== NOPTS_VALUE_BIGINT) {
-        await formatContext.ioReader.seek(pos)
-        this.context.currentIndex = -1
       }
-      return now
+      // 当前块内没有找到，去前一个块里找
+      chunkIndex--
     }
-    return static_cast<int64>(errorType.OPERATE_NOT_SUPPORT)
+    return null
   }
 
   public getAnalyzeStreamsCount(): number {
@@ -42,6 +42,7 @@ import { FlvAudioCodecType2AVCodecID,
 import IFormat from './IFormat'
 import mktag from '../function/mktag'
 import seekInBytes from '../function/seekInBytes'
+import checkAVPacketDiscard from '../function/checkAVPacketDiscard'
 import type { FlvColorInfo, FlvStreamContext } from './flv/type'
 
 import { mapSafeUint8Array, mapUint8Array } from '@libmedia/cheap'
@@ -133,6 +134,8 @@ export default class IFlvFormat extends IFormat {
 
   private firstTagPos: int64
 
+  private tagHeader: Uint8Array
+
   constructor(options: IFlvFormatOptions = {}) {
     super()
 
@@ -442,26 +445,102 @@ export default class IFlvFormat extends IFormat {
     return stream
   }
 
-  private async readAVPacket_(formatContext: AVIFormatContext, avpacket: pointer<AVPacket>): Promise<number> {
+  /**
+   * 根据 tag 头判断是否被 discard，是则跳过整个 tag 不读取数据
+   * 
+   * 只处理单轨的编码帧，序列头等配置 tag 总是正常读取
+   */
+  private async skipDiscardTag(formatContext: AVIFormatContext, type: int32, size: int32) {
+    if (size < 2 || (type !== FlvTag.AUDIO && type !== FlvTag.VIDEO)) {
+      return false
+    }
 
-    const now = formatContext.ioReader.getPos()
+    const header = await formatContext.ioReader.peekUint16()
+    const tagHeader = header >>> 8
+    const packetType = header & 0xff
 
-    avpacket.pos = now
+    let stream: AVStream
+    let key = true
+
+    if (type === FlvTag.AUDIO) {
+      if ((tagHeader & 0xf0) >>> 4 === 9) {
+        if ((tagHeader & 0x0f) !== AudioPacketType.CodedFrames) {
+          return false
+        }
+      }
+      else if (((tagHeader & 0xf0) >>> 4) === 10 && packetType !== AACPacketType.AAC_RAW) {
+        return false
+      }
+      stream = this.findStream(formatContext, AVMediaType.AVMEDIA_TYPE_AUDIO, 0)
+    }
+    else {
+      const videoFrameType = (tagHeader & 0x70) >> 4
+      if (videoFrameType === VideoFrameType.Command) {
+        return false
+      }
+      if (tagHeader & 0x80) {
+        if ((tagHeader & 0x0f) !== VideoPacketType.CodedFrames
+          && (tagHeader & 0x0f) !== VideoPacketType.CodedFramesX
+        ) {
+          return false
+        }
+      }
+      else if (videoFrameType === VideoFrameType.KeyFrame && packetType !== AVCPacketType.AVC_NALU) {
+        // 旧格式的序列头和结束标记都是关键帧类型
+        return false
+      }
+      key = videoFrameType === VideoFrameType.KeyFrame || videoFrameType === VideoFrameType.GeneratedKeyFrame
+      stream = this.findStream(formatContext, AVMediaType.AVMEDIA_TYPE_VIDEO, 0)
+    }
+
+    if (!checkAVPacketDiscard(stream, key)) {
+      return false
+    }
+
+    // tag data + previousTagSize
+    await formatContext.ioReader.skip(size + 4)
+    return true
+  }
+
+  private async readAVPacket_(formatContext: AVIFormatContext, avpacket: pointer<AVPacket>): Promise<number> {
 
     let needRedo = false
-    const type = (await formatContext.ioReader.readUint8()) & 0x1f
-    let size = await formatContext.ioReader.readUint24()
-    let timestamp = await formatContext.ioReader.readUint24()
-    const timestampExt = await formatContext.ioReader.readUint8()
-    if (timestampExt) {
-      timestamp = (timestampExt << 24) | timestamp
+
+    // tag header 固定 11 字节，一次读取后同步解析
+    if (!this.tagHeader) {
+      this.tagHeader = new Uint8Array(11)
+    }
+    const tagHeader = this.tagHeader
+
+    let now: int64
+    let type: int32
+    let size: int32
+    let timestamp: int32
+
+    // 被 discard 的 tag 在这里循环跳过，不递归
+    while (true) {
+      now = formatContext.ioReader.getPos()
+      await formatContext.ioReader.readBuffer(11, tagHeader)
+
+      type = tagHeader[0] & 0x1f
+      size = (tagHeader[1] << 16) | (tagHeader[2] << 8) | tagHeader[3]
+      timestamp = (tagHeader[4] << 16) | (tagHeader[5] << 8) | tagHeader[6]
+      const timestampExt = tagHeader[7]
+      if (timestampExt) {
+        timestamp = (timestampExt << 24) | timestamp
+      }
+      // streamId 总是 0，已在 tag header 中读取
+
+      if (!await this.skipDiscardTag(formatContext, type, size)) {
+        break
+      }
     }
+
+    avpacket.pos = now
     avpacket.dts = this.options.useNanoTimestamp
       ? avRescaleQ(static_cast<int64>(timestamp), AV_MILLI_TIME_BASE_Q, AV_NANO_TIME_BASE_Q)
       : static_cast<int64>(timestamp)
     avpacket.pts = avpacket.dts
-    // streamId 总是 0
-    await formatContext.ioReader.skip(3)
 
     if (type === FlvTag.AUDIO) {
 
@@ -903,8 +982,10 @@ export default class IFlvFormat extends IFormat {
             || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC
             || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_MPEG4
           ) {
-            const packetType = await formatContext.ioReader.readUint8()
-            const ct: int32 = await formatContext.ioReader.readInt24()
+            await formatContext.ioReader.readBuffer(4, this.tagHeader.subarray(0, 4))
+            const packetType = this.tagHeader[0]
+            // SI24
+            const ct: int32 = ((this.tagHeader[1] << 24) | (this.tagHeader[2] << 16) | (this.tagHeader[3] << 8)) >> 8
             size -= 4
 
             avpacket.pts = avpacket.dts + (
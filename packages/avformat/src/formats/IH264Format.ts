@@ -26,12 +26,14 @@
 import type { AVIFormatContext } from '../AVFormatContext'
 import IFormat from './IFormat'
 import NaluReader from './nalu/NaluReader'
+import seekInNaluIndexes from '../function/seekInNaluIndexes'
 
 import { memcpyFromUint8Array } from '@libmedia/cheap'
 
 import {
   AVFormat,
   AVSeekFlags,
+  IOFlags,
   AVMediaType,
   AVCodecID,
   type AVPacket,
@@ -89,6 +91,7 @@ export default class IH264Format extends IFormat {
 
   private slices: Uint8Array[]
   private naluPos: int64
+  private firstPacketPos: int64
 
   private queue: { avpacket: pointer<AVPacket>, poc: int64 }[]
   private bitReader: BitReader
@@ -192,6 +195,32 @@ export default class IH264Format extends IFormat {
     }
   }
 
+  private isKeyFrame(nalus: Uint8Array[]) {
+    return nalus.some((n) => {
+      return (n[(n[2] === 1 ? 3 : 4)] & 0x1f) === h264.H264NaluType.kSliceIDR
+    })
+  }
+
+  /**
+   * 重置读取状态，seek 之后从 pos 处的访问单元开始读取
+   */
+  private resetStream(pos: int64, dts: int64) {
+    for (let i = 0; i < this.queue.length; i++) {
+      destroyAVPacket(this.queue[i].avpacket)
+    }
+    this.queue.length = 0
+    this.slices = []
+    this.naluReader.reset()
+    this.naluPos = pos
+    this.currentDts = dts
+    this.currentPts = dts
+    this.poc = 0n
+    this.picOrderCntMsb = 0n
+    this.lastPicOrderCntLsb = 0
+    this.frameNumberOffset = 0n
+    this.prevFrameNumber = 0
+  }
+
   public async readHeader(formatContext: AVIFormatContext): Promise<number> {
     const stream = formatContext.createStream()
     stream.codecpar.codecType = AVMediaType.AVMEDIA_TYPE_VIDEO
@@ -241,6 +270,7 @@ export default class IH264Format extends IFormat {
         addAVPacketData(avpacket, dataP, data.length)
 
         avpacket.pos = this.naluPos
+        this.firstPacketPos = this.naluPos
         this.naluPos += static_cast<int64>(data.length)
 
         avpacket.dts = this.currentDts
@@ -360,14 +390,22 @@ export default class IH264Format extends IFormat {
       }
     })
 
-    const data = concatTypeArray(Uint8Array, nalus)
+    let size = 0
+    for (let i = 0; i < nalus.length; i++) {
+      size += nalus[i].length
+    }
 
-    const dataP: pointer<uint8> = avMalloc(data.length)
-    memcpyFromUint8Array(dataP, data.length, data)
-    addAVPacketData(avpacket, dataP, data.length)
+    // nalus 是 NaluReader 数据块上的视图，直接逐个拷贝到 packet 中
+    const dataP: pointer<uint8> = avMalloc(size)
+    let offset = 0
+    for (let i = 0; i < nalus.length; i++) {
+      memcpyFromUint8Array(dataP + offset, nalus[i].length, nalus[i])
+      offset += nalus[i].length
+    }
+    addAVPacketData(avpacket, dataP, size)
 
     avpacket.pos = this.naluPos
-    this.naluPos += static_cast<int64>(data.length)
+    this.naluPos += static_cast<int64>(size)
     avpacket.dts = this.currentDts
     this.currentDts += this.step
     avpacket.streamIndex = stream.index
@@ -467,9 +505,24 @@ export default class IH264Format extends IFormat {
 
     if (flags & AVSeekFlags.BYTE) {
       await formatContext.ioReader.seek(timestamp)
+      this.resetStream(timestamp, this.currentDts)
       return now
     }
-    return static_cast<int64>(errorType.FORMAT_NOT_SUPPORT)
+
+    if (!(formatContext.ioReader.flags & IOFlags.SEEKABLE)) {
+      return static_cast<int64>(errorType.FORMAT_NOT_SUPPORT)
+    }
+
+    return seekInNaluIndexes(
+      formatContext,
+      stream,
+      timestamp,
+      this.firstPacketPos,
+      this.step,
+      this.readNaluFrame.bind(this),
+      this.isKeyFrame.bind(this),
+      this.resetStream.bind(this)
+    )
   }
 
   public getAnalyzeStreamsCount(): number {
@@ -34,6 +34,7 @@ import { EbmlSyntaxAttachments, EbmlSyntaxBlockGroup, EbmlSyntaxChapters, EbmlSy
 
 import findStreamByTrackUid from './matroska/function/findStreamByTrackUid'
 import findStreamByTrackNumber from './matroska/function/findStreamByTrackNumber'
+import checkAVPacketDiscard from '../function/checkAVPacketDiscard'
 import * as riff from './riff/riff'
 import * as isomTags from './isom/tags'
 
@@ -832,6 +833,11 @@ export default class IMatroskaFormat extends IFormat {
       isKey = (flags & 0x80) ? 1 : 0
     }
 
+    if (checkAVPacketDiscard(stream, stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO || !!isKey)) {
+      this.resetCurrentBlock()
+      return errorType.EAGAIN
+    }
+
     const lacing = (flags >>> 1) & 0x03
 
     let frameCount = 0
@@ -990,6 +996,12 @@ export default class IMatroskaFormat extends IFormat {
       }
     }
 
+    this.resetCurrentBlock()
+
+    return 0
+  }
+
+  private resetCurrentBlock() {
     this.context.currentCluster.block = {
       pos: -1n,
       size: -1n
@@ -997,8 +1009,45 @@ export default class IMatroskaFormat extends IFormat {
     this.context.currentCluster.blockGroup = {
       block: null
     }
+  }
 
-    return 0
+  /**
+   * 从 SimpleBlock 头判断是否被 discard，是则不读取 block 数据
+   * 
+   * @param length SimpleBlock 的长度
+   */
+  private async checkSimpleBlockDiscard(formatContext: AVIFormatContext, length: int64) {
+    if (length < 4n) {
+      return false
+    }
+
+    const header = await formatContext.ioReader.peekBuffer(Math.min(static_cast<int32>(length), 11))
+
+    // track number vint
+    let width = 1
+    let mask = 0x80
+    while (width <= 8 && !(header[0] & mask)) {
+      width++
+      mask >>>= 1
+    }
+    if (width > 8 || width + 3 > header.length) {
+      return false
+    }
+    let trackNumber = header[0] & (mask - 1)
+    for (let i = 1; i < width; i++) {
+      trackNumber = trackNumber * 256 + header[i]
+    }
+
+    const stream = findStreamByTrackNumber(formatContext.streams, trackNumber)
+    if (!stream) {
+      return false
+    }
+    const flags = header[width + 2]
+
+    return checkAVPacketDiscard(
+      stream,
+      stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO || !!(flags & 0x80)
+    )
   }
 
   private addClusterIndex(clusterIndex: ClusterIndex) {
@@ -1067,6 +1116,10 @@ export default class IMatroskaFormat extends IFormat {
       }
     }
     else if (id === EBMLId.SIMPLE_BLOCK) {
+      if (await this.checkSimpleBlockDiscard(formatContext, length)) {
+        await formatContext.ioReader.skip(static_cast<int32>(length))
+        return this.readAVPacket_(formatContext, avpacket)
+      }
       this.context.currentCluster.block = {
         pos: formatContext.ioReader.getPos(),
         size: length,
@@ -33,11 +33,12 @@ import handleSectionSlice from './mpegts/function/handleSectionSlice'
 import parsePES from './mpegts/function/parsePES'
 import parsePESSlice from './mpegts/function/parsePESSlice'
 import clearTSSliceQueue from './mpegts/function/clearTSSliceQueue'
-import type { PES } from './mpegts/struct'
+import type { PES, TSPacket } from './mpegts/struct'
 import { TSSliceQueue } from './mpegts/struct'
 import IFormat from './IFormat'
 import initStream from './mpegts/function/initStream'
 import seekInBytes from '../function/seekInBytes'
+import checkAVPacketDiscard from '../function/checkAVPacketDiscard'
 
 import { memcpyFromUint8Array, mapSafeUint8Array, memcpy } from '@libmedia/cheap'
 
@@ -61,6 +62,7 @@ import {
   deleteAVPacketSideData,
   avRescaleQ,
   errorType,
+  AVDiscard,
   nalu as nalusUtil
 } from '@libmedia/avutil'
 
@@ -194,6 +196,27 @@ export default class IMpegtsFormat extends IFormat {
     }
   }
 
+  /**
+   * 在 pes 的第一个 ts packet 处判断是否丢弃整个 pes
+   * 
+   * 视频依赖 random_access_indicator 判断关键帧，码流中从未出现过该标志时不做关键帧过滤
+   */
+  private checkPESDiscard(stream: AVStream, tsPacket: TSPacket) {
+    if (stream.discard < AVDiscard.AVDISCARD_NONKEY) {
+      return false
+    }
+    const streamContext = stream.privData as MpegtsStreamContext
+    const randomAccessIndicator = tsPacket.adaptationFieldInfo?.randomAccessIndicator ?? 0
+    if (randomAccessIndicator) {
+      streamContext.hasRandomAccessIndicator = true
+    }
+    let key = true
+    if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO && streamContext.hasRandomAccessIndicator) {
+      key = !!randomAccessIndicator
+    }
+    return checkAVPacketDiscard(stream, key)
+  }
+
   private handlePES(formatContext: AVIFormatContext, avpacket: pointer<AVPacket>, pes: PES, stream: AVStream) {
 
     if (pes.randomAccessIndicator || stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
@@ -570,12 +593,23 @@ export default class IMpegtsFormat extends IFormat {
           }
 
           if (tsPacket.payloadUnitStartIndicator) {
+            pesSliceQueue.discard = this.checkPESDiscard(stream, tsPacket)
+            if (pesSliceQueue.discard) {
+              if (packetGot) {
+                return 0
+              }
+              continue
+            }
             pesSliceQueue.randomAccessIndicator = tsPacket.adaptationFieldInfo?.randomAccessIndicator ?? 0
             pesSliceQueue.pos = tsPacket.pos
             pesSliceQueue.pid = tsPacket.pid
             pesSliceQueue.streamType = streamType
             pesSliceQueue.expectedLength = pesPacketLength === 0 ? 0 : pesPacketLength + 6
           }
+          else if (pesSliceQueue.discard) {
+            // 被丢弃的 pes 的后续 ts packet 不再拼接
+            continue
+          }
 
           pesSliceQueue.slices.push(tsPacket.payload)
           pesSliceQueue.totalLength += tsPacket.payload.length
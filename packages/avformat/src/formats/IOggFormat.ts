@@ -46,7 +46,8 @@ import {
   AVPacketFlags,
   NOPTS_VALUE_BIGINT,
   avRescaleQ,
-  errorType
+  errorType,
+  IOFlags
 } from '@libmedia/avutil'
 
 import {
@@ -69,6 +70,28 @@ interface IOggFormatPrivateData {
   serialNumber: number
 }
 
+interface OggPageHeaderInfo {
+  pos: int64
+  /**
+   * 下一页的位置
+   */
+  end: int64
+  granulePosition: int64
+  serialNumber: number
+  headerTypeFlag: number
+}
+
+// 二分查找区间小于此值后顺序扫描页头
+const BISECT_MIN_INTERVAL = 64n * 1024n
+// 查找页头时每次读取的字节数
+const SYNC_READ_SIZE = 4096
+// 一页最大 65307 字节，超过还没找到页头认为区间内没有页
+const MAX_PAGE_SIZE = 65307n
+// RFC 7845 建议 seek 时至少预解码 80ms
+const OPUS_PREROLL = 3840n
+// 每个逻辑流最多缓存的页头数，超过之后隔一个丢一个
+const MAX_GRANULE_CACHE = 1024
+
 export default class IOggFormat extends IFormat {
 
   public type: AVFormat = AVFormat.OGG
@@ -89,10 +112,16 @@ export default class IOggFormat extends IFormat {
   private firstGranulePosition: int64
   private paddingPayload: Uint8Array
 
+  /**
+   * 每个逻辑流 seek 时读到的页头，按位置排序，用于缩小之后 seek 的查找区间
+   */
+  private granuleCache: Map<number, OggPageHeaderInfo[]>
+
   constructor() {
     super()
     this.page = new OggPage()
     this.headerPagesPayload = []
+    this.granuleCache = new Map()
   }
 
   public init(formatContext: AVIFormatContext): void {
@@ -590,6 +619,15 @@ export default class IOggFormat extends IFormat {
         return now
       }
 
+      const fileSize = await formatContext.ioReader.fileSize()
+      if (fileSize > 0n && stream.privData) {
+        const ret = await this.seekByGranule(formatContext, stream, timestamp, fileSize)
+        if (ret >= 0) {
+          return now
+        }
+        await formatContext.ioReader.seek(now)
+      }
+
       return seekInBytes(
         formatContext,
         stream,
@@ -601,6 +639,245 @@ export default class IOggFormat extends IFormat {
     }
   }
 
+  /**
+   * 读取页头，不读取页数据
+   */
+  private async readPageHeaderInfo(formatContext: AVIFormatContext): Promise<OggPageHeaderInfo> {
+    const pos = formatContext.ioReader.getPos()
+    const header = await formatContext.ioReader.readBuffer(27)
+    // OggS + version 0
+    if (header[0] !== 0x4f || header[1] !== 0x67 || header[2] !== 0x67 || header[3] !== 0x53 || header[4] !== 0) {
+      return null
+    }
+    const view = new DataView(header.buffer, header.byteOffset, header.byteLength)
+    const segmentCount = header[26]
+    let size = 0
+    if (segmentCount) {
+      const segments = await formatContext.ioReader.readBuffer(segmentCount)
+      for (let i = 0; i < segmentCount; i++) {
+        size += segments[i]
+      }
+    }
+    return {
+      pos,
+      end: pos + static_cast<int64>((27 + segmentCount + size) as uint32),
+      granulePosition: view.getBigInt64(6, true),
+      serialNumber: view.getUint32(14, true),
+      headerTypeFlag: header[5]
+    }
+  }
+
+  /**
+   * 从 start 开始查找第一个属于 serialNumber 且有 granule position 的页
+   * 
+   * 只读取页头，找不到或超出 limit 返回 null
+   */
+  private async findPageHeader(formatContext: AVIFormatContext, serialNumber: number, start: int64, limit: int64) {
+    let pos = start
+    while (pos < limit) {
+      await formatContext.ioReader.seek(pos)
+      const buffer = await formatContext.ioReader.readBuffer(Number(bigint.min(static_cast<int64>(SYNC_READ_SIZE), limit - pos)))
+
+      let index = -1
+      for (let i = 0; i + 3 < buffer.length; i++) {
+        if (buffer[i] === 0x4f && buffer[i + 1] === 0x67 && buffer[i + 2] === 0x67 && buffer[i + 3] === 0x53) {
+          index = i
+          break
+        }
+      }
+      if (index < 0) {
+        if (pos - start > MAX_PAGE_SIZE) {
+          return null
+        }
+        // 保留 3 字节以防 OggS 跨越读取边界
+        pos += static_cast<int64>(Math.max(buffer.length - 3, 1))
+        continue
+      }
+
+      pos += static_cast<int64>(index)
+      await formatContext.ioReader.seek(pos)
+      const info = await this.readPageHeaderInfo(formatContext)
+      if (!info) {
+        pos++
+        continue
+      }
+      if (info.serialNumber === serialNumber && info.granulePosition >= 0n) {
+        this.addGranuleCache(info)
+        return info
+      }
+      pos = info.end
+    }
+    return null
+  }
+
+  private addGranuleCache(info: OggPageHeaderInfo) {
+    let list = this.granuleCache.get(info.serialNumber)
+    if (!list) {
+      list = []
+      this.granuleCache.set(info.serialNumber, list)
+    }
+    // 二分查找第一个 pos >= info.pos 的位置
+    let low = 0
+    let high = list.length
+    while (low < high) {
+      const mid = (low + high) >>> 1
+      if (list[mid].pos < info.pos) {
+        low = mid + 1
+      }
+      else {
+        high = mid
+      }
+    }
+    if (low < list.length && list[low].pos === info.pos) {
+      return
+    }
+    list.splice(low, 0, info)
+
+    if (list.length > MAX_GRANULE_CACHE) {
+      // 缓存只用来缩小查找区间，均匀抽掉一半不影响正确性
+      let j = 0
+      for (let i = 0; i < list.length; i += 2) {
+        list[j++] = list[i]
+      }
+      list.length = j
+    }
+  }
+
+  /**
+   * 通过页头的 granule position 二分查找 seek 位置
+   * 
+   * 本 demuxer 输出的 pts 即 granule position（已包含 opus 的 pre-skip），
+   * 所以目标 granule 就是 timestamp，opus 再往前预留 80ms 预解码
+   */
+  private async seekByGranule(formatContext: AVIFormatContext, stream: AVStream, timestamp: int64, fileSize: int64) {
+    const serialNumber = (stream.privData as IOggFormatPrivateData).serialNumber
+
+    let target = timestamp
+    if (stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_OPUS) {
+      target -= OPUS_PREROLL
+    }
+    if (target < 0n) {
+      target = 0n
+    }
+
+    // 最后一个 granule <= target 的页，从它的下一页开始读
+    let best: OggPageHeaderInfo = null
+    let low = this.firstPos
+    let high = fileSize
+
+    // 先用缓存缩小区间
+    const cache = this.granuleCache.get(serialNumber)
+    if (cache && cache.length) {
+      // 同一逻辑流的 granule 随位置递增，二分查找第一个 granule > target 的页
+      let left = 0
+      let right = cache.length
+      while (left < right) {
+        const mid = (left + right) >>> 1
+        if (cache[mid].granulePosition <= target) {
+          left = mid + 1
+        }
+        else {
+          right = mid
+        }
+      }
+      if (left > 0) {
+        best = cache[left - 1]
+        low = best.end
+      }
+      if (left < cache.length) {
+        high = bigint.min(high, cache[left].pos)
+      }
+    }
+
+    try {
+      while (high - low > BISECT_MIN_INTERVAL) {
+        if (formatContext.ioReader.flags & IOFlags.ABORT) {
+          return errorType.EOF
+        }
+        const mid = (low + high) >> 1n
+        const info = await this.findPageHeader(formatContext, serialNumber, mid, high)
+        if (!info) {
+          high = mid
+        }
+        else if (info.granulePosition <= target) {
+          best = info
+          low = info.end
+        }
+        else {
+          high = mid
+        }
+      }
+
+      // 剩余区间顺序扫描页头
+      let pos = low
+      while (pos < high) {
+        const info = await this.findPageHeader(formatContext, serialNumber, pos, fileSize)
+        if (!info || info.granulePosition > target) {
+          break
+        }
+        best = info
+        pos = info.end
+      }
+    }
+    catch (error) {
+      if (formatContext.ioReader.error === IOError.ABORT) {
+        return errorType.EOF
+      }
+      if (!best) {
+        return errorType.DATA_INVALID
+      }
+    }
+
+    if (!best) {
+      await formatContext.ioReader.seek(this.firstPos)
+      this.page.reset()
+      this.currentPts = 0n
+      this.curSegIndex = -1
+      return 0
+    }
+
+    logger.debug(`seek by granule ${target}, got page pos: ${best.pos}, granule: ${best.granulePosition}`)
+
+    let granulePosition = best.granulePosition
+    let start = best.end
+    await formatContext.ioReader.seek(start)
+
+    // 跳过目标流以上一个 packet 的剩余部分开始的页，其他逻辑流的页不影响判断
+    while (true) {
+      let info: OggPageHeaderInfo
+      try {
+        info = await this.readPageHeaderInfo(formatContext)
+      }
+      catch (error) {
+        break
+      }
+      if (!info) {
+        break
+      }
+      if (info.serialNumber !== serialNumber) {
+        await formatContext.ioReader.seek(info.end)
+        continue
+      }
+      if (!(info.headerTypeFlag & 0x01)) {
+        break
+      }
+      // 目标流的延续页，从它之后开始读，中间其他流的页一起跳过
+      if (info.granulePosition >= 0n) {
+        granulePosition = info.granulePosition
+      }
+      start = info.end
+      await formatContext.ioReader.seek(start)
+    }
+    await formatContext.ioReader.seek(start)
+
+    this.page.reset()
+    this.page.granulePosition = granulePosition
+    this.currentPts = granulePosition
+    this.curSegIndex = -1
+
+    return 0
+  }
+
   public getAnalyzeStreamsCount(): number {
     return 1
   }
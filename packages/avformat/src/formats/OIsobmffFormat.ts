@@ -93,6 +93,25 @@ export {
   Mp4Mode
 }
 
+export interface OIsobmffFragmentInfo {
+  /**
+   * moof 的 sequence number
+   */
+  sequence: number
+  /**
+   * fragment 是否从关键帧开始
+   */
+  independent: boolean
+  /**
+   * fragment 开始时间（毫秒）
+   */
+  startTime: number
+  /**
+   * fragment 时长（毫秒）
+   */
+  duration: number
+}
+
 export interface OIsobmffFormatOptions {
   /**
    * fragment 按 gop 分段还是按帧分段
@@ -138,6 +157,10 @@ export interface OIsobmffFormatOptions {
    * fragment index 最短时长（只有音频时使用，默认 5 秒）
    */
   minFragmentIndexLength?: number
+  /**
+   * fragment 最长时长（毫秒），大于 0 时 GOP 内也会按此时长切分 fragment（CMAF chunk）
+   */
+  chunkDuration?: number
   /**
    * fragment 结束时是否追加 tfra 用于 seek
    */
@@ -152,6 +175,10 @@ export interface OIsobmffFormatOptions {
    * @returns 
    */
   onFragmentStart?: () => void
+  /**
+   * fragment 的 moof 和 mdat 已经全部写出
+   */
+  onFragmentEnd?: (info: OIsobmffFragmentInfo) => void
 }
 
 const defaultOptions: OIsobmffFormatOptions = {
@@ -164,6 +191,7 @@ const defaultOptions: OIsobmffFormatOptions = {
   ignoreEncryption: false,
   minFragmentLength: 5000,
   minFragmentIndexLength: 5000,
+  chunkDuration: 0,
   hasTfra: true,
   useMetadataTags: false
 }
@@ -457,6 +485,9 @@ export default class OIsobmffFormat extends OFormat {
 
   private updateCurrentFragment(formatContext: AVOFormatContext, currentDts?: int64) {
     if (this.context.currentFragment.firstWrote) {
+      let fragmentInfo: OIsobmffFragmentInfo
+      const hasVideo = formatContext.streams.some((stream) => stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO)
+
       array.each(this.context.currentFragment.tracks, (track) => {
 
         const stream = formatContext.streams.find((stream) => {
@@ -525,6 +556,26 @@ export default class OIsobmffFormat extends OFormat {
           track.sampleDurations.push(static_cast<double>(currentDts - streamContext.lastDts))
         }
 
+        // 有视频时以有采样的视频轨为准，视频轨没有采样时使用其他有采样的轨
+        if (this.options.onFragmentEnd
+          && track.sampleSizes.length
+          && (!fragmentInfo || stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO)
+        ) {
+          let duration = 0
+          for (let i = 0; i < track.sampleSizes.length; i++) {
+            duration += track.sampleDurations[i] ?? track.sampleDurations[track.sampleDurations.length - 1]
+          }
+          fragmentInfo = {
+            sequence: this.context.currentFragment.sequence,
+            // 有视频流但这个 fragment 没有视频采样时不能作为分片的开始
+            independent: stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO
+              ? !(track.sampleFlags[0] & SampleFlags.IS_NON_SYN)
+              : !hasVideo,
+            startTime: static_cast<double>(track.baseMediaDecodeTime) * avQ2D(stream.timeBase) * 1000,
+            duration: duration * avQ2D(stream.timeBase) * 1000
+          }
+        }
+
         streamContext.lastDuration = track.sampleDurations[track.sampleSizes.length - 1]
 
         if (track.sampleFlags.length === 1 || arrayItemSame(track.sampleFlags, 1)) {
@@ -625,6 +676,10 @@ export default class OIsobmffFormat extends OFormat {
 
       this.context.currentFragment.firstWrote = false
       this.context.currentFragment.sequence++
+
+      if (this.options.onFragmentEnd && fragmentInfo) {
+        this.options.onFragmentEnd(fragmentInfo)
+      }
     }
   }
 
@@ -840,6 +895,9 @@ export default class OIsobmffFormat extends OFormat {
               && avRescaleQ(dts - track.baseMediaDecodeTime, stream.timeBase, AV_MILLI_TIME_BASE_Q) >= this.options.minFragmentLength
           )
           || this.options.fragmentMode === Mp4FragmentMode.FRAME
+          || this.options.chunkDuration > 0
+            && track.sampleSizes.length > 0
+            && avRescaleQ(dts - track.baseMediaDecodeTime, stream.timeBase, AV_MILLI_TIME_BASE_Q) >= this.options.chunkDuration
         ) {
           if (this.context.currentFragment.tracks.length === 1) {
             this.updateCurrentFragment(formatContext, dts)
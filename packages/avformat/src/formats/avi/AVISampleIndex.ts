@@ -0,0 +1,204 @@
+/*
+ * libmedia avi sample index
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import { NOPTS_VALUE_BIGINT } from '@libmedia/avutil'
+
+const CHUNK_INIT_CAPACITY = 256
+
+/**
+ * 一段连续的采样索引（对应一个 idx1 或一个 OpenDML 标准索引块）
+ * 
+ * 使用类型化数组存储，避免大文件为每个采样创建一个 js 对象
+ */
+export class AVISampleIndexChunk {
+  /**
+   * 第一个采样的 dts
+   */
+  startDts: int64
+  /**
+   * 覆盖的时长，未知为 NOPTS_VALUE_BIGINT
+   */
+  duration: int64
+  /**
+   * 标准索引在文件中的位置，-1n 表示已经内联（idx1）
+   */
+  offset: int64
+  loaded: boolean
+  count: number
+
+  pos: BigInt64Array
+  dts: BigInt64Array
+  size: Uint32Array
+  key: Uint8Array
+
+  constructor(startDts: int64, duration: int64 = NOPTS_VALUE_BIGINT, offset: int64 = -1n) {
+    this.startDts = startDts
+    this.duration = duration
+    this.offset = offset
+    this.loaded = offset < 0n
+    this.count = 0
+    this.allocate(CHUNK_INIT_CAPACITY)
+  }
+
+  private allocate(capacity: number) {
+    const pos = new BigInt64Array(capacity)
+    const dts = new BigInt64Array(capacity)
+    const size = new Uint32Array(capacity)
+    const key = new Uint8Array(capacity)
+    if (this.count) {
+      pos.set(this.pos.subarray(0, this.count))
+      dts.set(this.dts.subarray(0, this.count))
+      size.set(this.size.subarray(0, this.count))
+      key.set(this.key.subarray(0, this.count))
+    }
+    this.pos = pos
+    this.dts = dts
+    this.size = size
+    this.key = key
+  }
+
+  /**
+   * 预留空间，已知条目数时一次分配到位
+   * 
+   * @param count 
+   */
+  public reserve(count: number) {
+    if (this.count + count > this.pos.length) {
+      this.allocate(this.count + count)
+    }
+  }
+
+  public push(pos: int64, size: int32, key: boolean, dts: int64) {
+    if (this.count === this.pos.length) {
+      this.allocate(this.count << 1)
+    }
+    this.pos[this.count] = pos
+    this.dts[this.count] = dts
+    this.size[this.count] = size
+    this.key[this.count] = key ? 1 : 0
+    this.count++
+  }
+
+  /**
+   * 查找最后一个 dts <= timestamp 的采样
+   * 
+   * @param timestamp 
+   * @returns 没有返回 -1
+   */
+  public search(timestamp: int64) {
+    let low = 0
+    let high = this.count - 1
+    let index = -1
+    while (low <= high) {
+      const mid = (low + high) >>> 1
+      if (this.dts[mid] <= timestamp) {
+        index = mid
+        low = mid + 1
+      }
+      else {
+        high = mid - 1
+      }
+    }
+    return index
+  }
+
+  /**
+   * 从 index 开始向前查找关键帧
+   * 
+   * @param index 
+   * @returns 没有返回 -1
+   */
+  public findKeyBefore(index: number) {
+    for (let i = index; i >= 0; i--) {
+      if (this.key[i]) {
+        return i
+      }
+    }
+    return -1
+  }
+}
+
+/**
+ * 一个流的采样索引，由若干 AVISampleIndexChunk 按时间顺序组成
+ */
+export default class AVISampleIndex {
+
+  chunks: AVISampleIndexChunk[]
+
+  constructor() {
+    this.chunks = []
+  }
+
+  public addChunk(chunk: AVISampleIndexChunk) {
+    this.chunks.push(chunk)
+    return chunk
+  }
+
+  /**
+   * 已加载的采样数
+   */
+  get length() {
+    let count = 0
+    for (let i = 0; i < this.chunks.length; i++) {
+      count += this.chunks[i].count
+    }
+    return count
+  }
+
+  /**
+   * 是否所有索引块都已经加载
+   */
+  get loaded() {
+    for (let i = 0; i < this.chunks.length; i++) {
+      if (!this.chunks[i].loaded) {
+        return false
+      }
+    }
+    return true
+  }
+
+  /**
+   * 查找 timestamp 所在的索引块
+   * 
+   * @param timestamp 
+   * @returns 没有返回 -1
+   */
+  public findChunk(timestamp: int64) {
+    let low = 0
+    let high = this.chunks.length - 1
+    let index = -1
+    while (low <= high) {
+      const mid = (low + high) >>> 1
+      if (this.chunks[mid].startDts <= timestamp) {
+        index = mid
+        low = mid + 1
+      }
+      else {
+        high = mid - 1
+      }
+    }
+    return index
+  }
+}
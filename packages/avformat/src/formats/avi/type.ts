@@ -23,6 +23,8 @@
  *
  */
 
+import type AVISampleIndex from './AVISampleIndex'
+
 export const enum AVIFlags {
   AVIF_HASINDEX = 16,
   AVIF_MUSTUSEINDEX = 32,
@@ -87,7 +89,8 @@ export interface AVIStreamContext {
   hasPal: boolean
   dshowBlockAlign: number
 
-  samples: AVISample[]
+  samples: AVISampleIndex
   sampleEnd: boolean
+  currentChunk: number
   currentSample: number
 }
@@ -28,6 +28,7 @@ import type { Atom, IsobmffContext, IsobmffStreamContext } from '../type'
 import { logger } from '@libmedia/common'
 import { type IOReader } from '@libmedia/common/io'
 import { type AVStream } from '@libmedia/avutil'
+import readEntries from '../../../function/readEntries'
 
 export default async function read(ioReader: IOReader, stream: AVStream, atom: Atom, isobmffContext: IsobmffContext) {
   const now = ioReader.getPos()
@@ -40,9 +41,9 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
   const entryCount = await ioReader.readUint32()
 
   if (version === 0) {
-    for (let i = 0; i < entryCount; i++) {
-      chunkOffsets.push(await ioReader.readUint64())
-    }
+    await readEntries(ioReader, Math.min(entryCount, Math.floor((atom.size - Number(ioReader.getPos() - now)) / 8)), 8, (view, offset) => {
+      chunkOffsets.push(view.getBigUint64(offset))
+    })
   }
 
   (stream.privData as IsobmffStreamContext).chunkOffsets = chunkOffsets
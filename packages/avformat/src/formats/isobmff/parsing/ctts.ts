@@ -27,6 +27,7 @@ import type { Atom, IsobmffContext, IsobmffStreamContext } from '../type'
 import { logger } from '@libmedia/common'
 import { type IOReader } from '@libmedia/common/io'
 import { type AVStream } from '@libmedia/avutil'
+import readEntries from '../../../function/readEntries'
 
 export default async function read(ioReader: IOReader, stream: AVStream, atom: Atom, isobmffContext: IsobmffContext) {
   const now = ioReader.getPos()
@@ -41,10 +42,10 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
 
   const entryCount = await ioReader.readUint32()
 
-  for (let i = 0; i < entryCount; i++) {
-    sampleCounts.push(await ioReader.readUint32())
-    sampleOffsets.push(await ioReader.readInt32())
-  }
+  await readEntries(ioReader, Math.min(entryCount, Math.floor((atom.size - Number(ioReader.getPos() - now)) / 8)), 8, (view, offset) => {
+    sampleCounts.push(view.getUint32(offset))
+    sampleOffsets.push(view.getInt32(offset + 4))
+  })
 
   streamContext.cttsSampleCounts = sampleCounts
   streamContext.cttsSampleOffsets = sampleOffsets
@@ -27,6 +27,7 @@ import type { Atom, IsobmffContext, IsobmffStreamContext } from '../type'
 import { logger } from '@libmedia/common'
 import { type IOReader } from '@libmedia/common/io'
 import { type AVStream } from '@libmedia/avutil'
+import readEntries from '../../../function/readEntries'
 
 export default async function read(ioReader: IOReader, stream: AVStream, atom: Atom, isobmffContext: IsobmffContext) {
   const now = ioReader.getPos()
@@ -39,9 +40,9 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
   const chunkCount = await ioReader.readUint32()
 
   if (version === 0) {
-    for (let i = 0; i < chunkCount; i++) {
-      chunkOffsets.push(static_cast<int64>(await ioReader.readUint32()))
-    }
+    await readEntries(ioReader, Math.min(chunkCount, Math.floor((atom.size - Number(ioReader.getPos() - now)) / 4)), 4, (view, offset) => {
+      chunkOffsets.push(static_cast<int64>(view.getUint32(offset)))
+    })
   }
 
   (stream.privData as IsobmffStreamContext).chunkOffsets = chunkOffsets
@@ -27,6 +27,7 @@ import type { Atom, IsobmffContext, IsobmffStreamContext } from '../type'
 import { logger } from '@libmedia/common'
 import { type IOReader } from '@libmedia/common/io'
 import { type AVStream } from '@libmedia/avutil'
+import readEntries from '../../../function/readEntries'
 
 export default async function read(ioReader: IOReader, stream: AVStream, atom: Atom, isobmffContext: IsobmffContext) {
   const now = ioReader.getPos()
@@ -43,11 +44,13 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
     sampleSize = await ioReader.readUint32()
     sampleCount = await ioReader.readUint32()
 
-    for (let i = 0; i < sampleCount; i++) {
-      if (sampleSize === 0) {
-        sampleSizes.push(await ioReader.readUint32())
-      }
-      else {
+    if (sampleSize === 0) {
+      await readEntries(ioReader, Math.min(sampleCount, Math.floor((atom.size - Number(ioReader.getPos() - now)) / 4)), 4, (view, offset) => {
+        sampleSizes.push(view.getUint32(offset))
+      })
+    }
+    else {
+      for (let i = 0; i < sampleCount; i++) {
         sampleSizes[i] = sampleSize
       }
     }
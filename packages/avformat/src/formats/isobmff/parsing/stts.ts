@@ -27,6 +27,7 @@ import type { Atom, IsobmffContext, IsobmffStreamContext } from '../type'
 import { logger } from '@libmedia/common'
 import { type IOReader } from '@libmedia/common/io'
 import { type AVStream } from '@libmedia/avutil'
+import readEntries from '../../../function/readEntries'
 
 export default async function read(ioReader: IOReader, stream: AVStream, atom: Atom, isobmffContext: IsobmffContext) {
   const now = ioReader.getPos()
@@ -44,15 +45,15 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
   let delta = 1
 
   if (version === 0) {
-    for (let i = 0; i < entryCount; i++) {
-      sampleCounts.push(await ioReader.readUint32())
-      delta = await ioReader.readInt32()
+    await readEntries(ioReader, Math.min(entryCount, Math.floor((atom.size - Number(ioReader.getPos() - now)) / 8)), 8, (view, offset) => {
+      sampleCounts.push(view.getUint32(offset))
+      delta = view.getInt32(offset + 4)
       if (delta < 0) {
         logger.warn('File uses negative stts sample delta, using value 1 instead, sync may be lost!')
         delta = 1
       }
       sampleDeltas.push(delta)
-    }
+    })
   }
 
   streamContext.sttsSampleCounts = sampleCounts
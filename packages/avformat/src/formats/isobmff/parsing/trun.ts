@@ -28,6 +28,12 @@ import { TRUNFlags } from '../boxType'
 import { logger } from '@libmedia/common'
 import { type IOReader } from '@libmedia/common/io'
 import { type AVStream } from '@libmedia/avutil'
+import readEntries from '../../../function/readEntries'
+
+/**
+ * 所有采样都使用默认值时 box 中没有采样数据，限制一个 fragment 的最大采样数
+ */
+const MAX_DEFAULT_SAMPLE_COUNT = 1 << 16
 
 export default async function read(ioReader: IOReader, stream: AVStream, atom: Atom, isobmffContext: IsobmffContext) {
 
@@ -43,7 +49,7 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
   })
 
   if (track) {
-    const sampleCount = await ioReader.readUint32()
+    let sampleCount = await ioReader.readUint32()
     if (flags & TRUNFlags.DATA_OFFSET) {
       if (track.sampleCount) {
         track.remainDataOffsets.push(await ioReader.readInt32())
@@ -57,31 +63,57 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
     if (flags & TRUNFlags.FIRST_FLAG) {
       firstSampleFlags = await ioReader.readUint32()
     }
-    for (let i = 0; i < sampleCount; i++) {
+    let entrySize = 0
+    if (flags & TRUNFlags.DURATION) {
+      entrySize += 4
+    }
+    if (flags & TRUNFlags.SIZE) {
+      entrySize += 4
+    }
+    if (flags & TRUNFlags.FLAGS) {
+      entrySize += 4
+    }
+    if (flags & TRUNFlags.CTS_OFFSET) {
+      entrySize += 4
+    }
+
+    // sampleCount 不能超过 box 剩余数据能容纳的数量，避免损坏的文件导致巨大的分配
+    const maxSampleCount = entrySize
+      ? Math.floor(Math.max(atom.size - Number(ioReader.getPos() - now), 0) / entrySize)
+      : MAX_DEFAULT_SAMPLE_COUNT
+    if (sampleCount > maxSampleCount) {
+      logger.warn(`trun sample count ${sampleCount} exceeds box size, clamp to ${maxSampleCount}`)
+      sampleCount = maxSampleCount
+    }
+
+    const parseEntry = (view: DataView, offset: number, i: number) => {
       if (flags & TRUNFlags.DURATION) {
-        track.sampleDurations.push(await ioReader.readUint32())
+        track.sampleDurations.push(view.getUint32(offset))
+        offset += 4
       }
       else {
         track.sampleDurations.push(track.defaultSampleDuration || trex?.duration)
       }
       if (flags & TRUNFlags.SIZE) {
-        track.sampleSizes.push(await ioReader.readUint32())
+        track.sampleSizes.push(view.getUint32(offset))
+        offset += 4
       }
       else {
         track.sampleSizes.push(track.defaultSampleSize || trex?.size)
       }
       if (flags & TRUNFlags.FLAGS) {
-        track.sampleFlags.push(await ioReader.readUint32())
+        track.sampleFlags.push(view.getUint32(offset))
+        offset += 4
       }
       else {
         track.sampleFlags.push(track.defaultSampleFlags || trex?.flags)
       }
       if (flags & TRUNFlags.CTS_OFFSET) {
         if (version === 0) {
-          track.sampleCompositionTimeOffset.push(await ioReader.readUint32())
+          track.sampleCompositionTimeOffset.push(view.getUint32(offset))
         }
         else {
-          track.sampleCompositionTimeOffset.push(await ioReader.readInt32())
+          track.sampleCompositionTimeOffset.push(view.getInt32(offset))
         }
       }
       else {
@@ -92,6 +124,16 @@ export default async function read(ioReader: IOReader, stream: AVStream, atom: A
         track.sampleFlags.push(firstSampleFlags)
       }
     }
+
+    if (entrySize) {
+      await readEntries(ioReader, sampleCount, entrySize, parseEntry)
+    }
+    else {
+      // 全部使用默认值，没有需要读取的数据
+      for (let i = 0; i < sampleCount; i++) {
+        parseEntry(null, 0, i)
+      }
+    }
     track.sampleCount += sampleCount
   }
 
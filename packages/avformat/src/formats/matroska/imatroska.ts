@@ -781,10 +781,15 @@ export async function readVInt(reader: BytesReader | BytesReaderSync, maxLen: nu
 
   let value = mask >>> (len - 1)
 
-  while (--len) {
-    value <<= 8
-    const next = await reader.readUint8()
-    value |= next
+  // 剩余字节一次读取
+  if (len === 2) {
+    value = (value << 8) | await reader.readUint8()
+  }
+  else if (len === 3) {
+    value = (value << 16) | await reader.readUint16()
+  }
+  else if (len === 4) {
+    value = (value << 24) | await reader.readUint24()
   }
 
   return value
@@ -826,10 +831,20 @@ export async function readVInt64(reader: BytesReader | BytesReaderSync, maxLen:
 
   let value = static_cast<int64>(mask >>> (len - 1))
 
-  while (--len) {
-    value <<= 8n
-    const next = await reader.readUint8()
-    value |= static_cast<int64>(next)
+  // 剩余字节按 32/24/16/8 位分段读取
+  let remaining = len - 1
+  if (remaining >= 4) {
+    value = (value << 32n) | static_cast<int64>(await reader.readUint32())
+    remaining -= 4
+  }
+  if (remaining === 3) {
+    value = (value << 24n) | static_cast<int64>(await reader.readUint24())
+  }
+  else if (remaining === 2) {
+    value = (value << 16n) | static_cast<int64>(await reader.readUint16())
+  }
+  else if (remaining === 1) {
+    value = (value << 8n) | static_cast<int64>(await reader.readUint8())
   }
 
   return value
@@ -921,14 +936,16 @@ export async function readEbmlId(formatContext: AVIFormatContext, maxLen: number
     return errorType.DATA_INVALID
   }
 
-  let value = 0
-
-  while (len--) {
-    value <<= 8
-    const next = await formatContext.ioReader.readUint8()
-    value |= next
+  switch (len) {
+    case 1:
+      return formatContext.ioReader.readUint8()
+    case 2:
+      return formatContext.ioReader.readUint16()
+    case 3:
+      return formatContext.ioReader.readUint24()
+    default:
+      return formatContext.ioReader.readUint32()
   }
-  return value
 }
 
 export async function parseEbml(formatContext: AVIFormatContext, size: int64, callback: (id: EBMLId, length: int64) => Promise<void | boolean>) {
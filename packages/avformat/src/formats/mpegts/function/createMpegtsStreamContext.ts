@@ -38,6 +38,7 @@ export default function createMpegtsStreamContext(): MpegtsStreamContext {
       total: 0,
       buffers: []
     },
-    latm: false
+    latm: false,
+    hasRandomAccessIndicator: false
   }
 }
@@ -63,6 +63,7 @@ export class TSSliceQueue {
   pid: PID = NOPTS_VALUE
   streamType: TSStreamType = TSStreamType.NONE
   pos: bigint = NOPTS_VALUE_BIGINT
+  discard: boolean = false
 }
 
 export class PAT {
@@ -56,6 +56,7 @@ export interface MpegtsStreamContext {
     buffers: Uint8Array[]
   },
   latm: boolean
+  hasRandomAccessIndicator: boolean
 }
 
 export interface MpegpsSlice {
@@ -24,83 +24,100 @@
  */
 
 import { type IOReader } from '@libmedia/common/io'
-import { nalu } from '@libmedia/avutil'
-import { concatTypeArray } from '@libmedia/common'
 
+const BLOCK_SIZE = 1024 * 1024
+
+/**
+ * Annex B 码流 NALU 读取器
+ *
+ * 按块读取数据，使用原生 indexOf 查找起始码中的 0x01，返回的 NALU 是数据块上的视图，不做拷贝
+ * 数据块剩余空间不足时分配新的数据块并只拷贝还没有返回的尾部数据，之前返回的视图仍然有效
+ */
 export default class NaluReader {
 
   private buffer: Uint8Array
+  private data: Uint8Array
   private pos: int32
   private end: int32
   private ended: boolean
 
   constructor() {
-    this.buffer = new Uint8Array(100 * 1024)
+    this.buffer = new Uint8Array(BLOCK_SIZE)
+    this.data = this.buffer.subarray(0, 0)
     this.pos = 0
     this.end = 0
     this.ended = false
   }
 
+  /**
+   * 从 from 开始查找下一个起始码的位置，没有找到返回 -1
+   *
+   * @param from 起始码允许开始的最小位置
+   */
+  private findStartCode(from: int32) {
+    let i = from + 2
+    while (i < this.end) {
+      i = this.data.indexOf(1, i)
+      if (i < 0) {
+        return -1
+      }
+      if (this.data[i - 1] === 0 && this.data[i - 2] === 0) {
+        return (i - 3 >= from && this.data[i - 3] === 0) ? i - 3 : i - 2
+      }
+      i++
+    }
+    return -1
+  }
+
+  private async fill(ioReader: IOReader) {
+    if (this.end === this.buffer.length) {
+      const remain = this.end - this.pos
+      // 已经返回出去的视图还在引用当前块，不能原地移动数据，换一个新块
+      const buffer = new Uint8Array(Math.max(BLOCK_SIZE, remain * 2))
+      buffer.set(this.buffer.subarray(this.pos, this.end), 0)
+      this.buffer = buffer
+      this.pos = 0
+      this.end = remain
+    }
+    try {
+      const len = await ioReader.readToBuffer(this.buffer.length - this.end, this.buffer.subarray(this.end))
+      this.end += len
+    }
+    catch (error) {
+      this.ended = true
+    }
+    this.data = this.buffer.subarray(0, this.end)
+  }
+
   public async read(ioReader: IOReader) {
     if (this.ended && this.pos >= this.end) {
       return
     }
 
-    const slices: Uint8Array[] = []
-
-    if (this.pos < this.end - 4) {
-      let next = nalu.getNextNaluStart(this.buffer.subarray(this.pos, this.end - 4), 3)
-      if (next.offset > -1) {
-        const nalu = this.buffer.slice(this.pos, this.pos + next.offset)
-        this.pos += next.offset
-        return nalu
-      }
-      else {
-        slices.push(this.buffer.slice(this.pos, this.end - 4))
-        this.buffer.copyWithin(0, this.end - 4, this.end)
-        this.pos = 0
-        this.end = 4
-      }
-    }
+    // 跳过当前 NALU 自身的起始码
+    let from = this.pos + 3
 
     while (true) {
-      if (!this.ended && this.end < this.buffer.length) {
-        try {
-          const len = await ioReader.readToBuffer(this.buffer.length - this.end, this.buffer.subarray(this.end))
-          this.end += len
-        }
-        catch (error) {
-          this.ended = true
-          if (this.pos >= this.end) {
-            return slices.length ? concatTypeArray(Uint8Array, slices) : null
-          }
-        }
-      }
-
-      let next = nalu.getNextNaluStart(this.buffer.subarray(this.pos, this.end - 4), slices.length ? 0 : 3)
-
-      if (next.offset > -1) {
-        slices.push(this.buffer.slice(this.pos, this.pos + next.offset))
-        this.pos += next.offset
-        return concatTypeArray(Uint8Array, slices)
+      const next = this.findStartCode(from)
+      if (next > -1) {
+        const nalu = this.data.subarray(this.pos, next)
+        this.pos = next
+        return nalu
       }
-      else {
-        if (this.ended) {
-          slices.push(this.buffer.slice(this.pos, this.end))
-          this.pos = this.end = 0
-          return concatTypeArray(Uint8Array, slices)
-        }
-        else {
-          slices.push(this.buffer.slice(this.pos, this.end - 4))
-          this.buffer.copyWithin(0, this.end - 4, this.end)
-          this.pos = 0
-          this.end = 4
-        }
+      if (this.ended) {
+        const nalu = this.data.subarray(this.pos, this.end)
+        this.pos = this.end
+        return nalu.length ? nalu : null
       }
+      // 起始码可能跨越块的末尾，下一次从末尾往前 3 个字节处继续查找
+      from = Math.max(from, this.end - 3) - this.pos
+      await this.fill(ioReader)
+      from += this.pos
     }
   }
 
   public reset() {
+    this.data = this.buffer.subarray(0, 0)
     this.pos = 0
     this.end = 0
     this.ended = false
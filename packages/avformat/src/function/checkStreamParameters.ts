@@ -67,3 +67,47 @@ export function checkStreamParameters(context: AVIFormatContext | AVOFormatConte
 
   return result
 }
+
+/**
+ * 检查解码器必须的参数是否都已经知道（不包括帧率和码率）
+ *
+ * @param context
+ */
+export function checkDecoderParameters(context: AVIFormatContext | AVOFormatContext) {
+  let result = true
+  array.each(context.streams, (stream) => {
+    switch (stream.codecpar.codecType) {
+      case AVMediaType.AVMEDIA_TYPE_AUDIO:
+        if (stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_NONE
+          || stream.codecpar.chLayout.nbChannels === NOPTS_VALUE
+          || stream.codecpar.sampleRate === NOPTS_VALUE
+        ) {
+          result = false
+        }
+        break
+      case AVMediaType.AVMEDIA_TYPE_VIDEO:
+        if (stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_NONE
+          || stream.codecpar.width === NOPTS_VALUE
+          || stream.codecpar.height === NOPTS_VALUE
+        ) {
+          result = false
+        }
+
+        if ((stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264
+          || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC
+          || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC
+          || stream.codecpar.codecId === AVCodecID.AV_CODEC_ID_MPEG4
+        )
+          && (
+            stream.codecpar.profile === NOPTS_VALUE
+              || stream.codecpar.level === NOPTS_VALUE
+          )
+        ) {
+          result = false
+        }
+        break
+    }
+  })
+
+  return result
+}
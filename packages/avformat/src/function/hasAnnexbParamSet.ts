@@ -0,0 +1,90 @@
+/*
+ * libmedia has annexb param set
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  AVCodecID,
+  nalu
+} from '@libmedia/avutil'
+
+import {
+  h264,
+  hevc,
+  vvc
+} from '@libmedia/avutil/internal'
+
+import type { Uint8ArrayInterface } from '@libmedia/common/io'
+
+/**
+ * annexb 码流中是否带有 sps
+ * 
+ * 只检查 nalu 头不解析参数集，参数集在 vcl nalu 之前，遇到 vcl nalu 就结束
+ * 
+ * @param codecId 
+ * @param data 
+ */
+export default function hasAnnexbParamSet(codecId: AVCodecID, data: Uint8ArrayInterface) {
+  let offset = 0
+  while (true) {
+    const next = nalu.getNextNaluStart(data, offset)
+    if (next.offset < 0) {
+      return false
+    }
+    const header = next.offset + next.startCode
+    if (header + 1 >= data.length) {
+      return false
+    }
+    if (codecId === AVCodecID.AV_CODEC_ID_H264) {
+      const type = data[header] & 0x1f
+      if (type === h264.H264NaluType.kSliceSPS) {
+        return true
+      }
+      if (type >= h264.H264NaluType.kSliceNonIDR && type <= h264.H264NaluType.kSliceIDR) {
+        return false
+      }
+    }
+    else if (codecId === AVCodecID.AV_CODEC_ID_HEVC) {
+      const type = (data[header] >>> 1) & 0x3f
+      if (type === hevc.HEVCNaluType.kSliceSPS) {
+        return true
+      }
+      if (type < hevc.HEVCNaluType.kSliceVPS) {
+        return false
+      }
+    }
+    else if (codecId === AVCodecID.AV_CODEC_ID_VVC) {
+      const type = (data[header + 1] >>> 3) & 0x1f
+      if (type === vvc.VVCNaluType.kSPS_NUT) {
+        return true
+      }
+      if (type < vvc.VVCNaluType.kOPI_NUT) {
+        return false
+      }
+    }
+    else {
+      return false
+    }
+    offset = header + 1
+  }
+}
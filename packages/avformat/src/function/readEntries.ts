@@ -0,0 +1,64 @@
+/*
+ * libmedia read fixed size entries
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type { IOReader } from '@libmedia/common/io'
+
+const BLOCK_SIZE = 64 * 1024
+
+/**
+ * 批量读取定长表项
+ * 
+ * 每次读取一整块数据后同步解析块内的表项，避免每个字段都 await 一次
+ * 
+ * @param ioReader 
+ * @param count 表项数量
+ * @param entrySize 每个表项的字节数
+ * @param callback 解析一个表项，offset 为表项在 view 中的偏移，view 的字节序需自行指定
+ */
+export default async function readEntries(
+  ioReader: IOReader,
+  count: number,
+  entrySize: number,
+  callback: (view: DataView, offset: number, index: number) => void
+) {
+  if (count <= 0 || entrySize <= 0) {
+    return
+  }
+
+  const blockCount = Math.max(1, Math.floor(BLOCK_SIZE / entrySize))
+  const buffer = new Uint8Array(Math.min(count, blockCount) * entrySize)
+  const view = new DataView(buffer.buffer)
+
+  let index = 0
+
+  while (index < count) {
+    const n = Math.min(count - index, blockCount)
+    await ioReader.readBuffer(n * entrySize, n === blockCount ? buffer : buffer.subarray(0, n * entrySize))
+    for (let i = 0; i < n; i++) {
+      callback(view, i * entrySize, index + i)
+    }
+    index += n
+  }
+}
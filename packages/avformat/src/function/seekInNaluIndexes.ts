@@ -0,0 +1,127 @@
+/*
+ * libmedia seek in h26x nalu stream with keyframe indexes
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type { AVIFormatContext } from '../AVFormatContext'
+
+import {
+  type AVStream,
+  IOFlags,
+  AVPacketFlags
+} from '@libmedia/avutil'
+
+import {
+  array,
+  logger
+} from '@libmedia/common'
+
+/**
+ * 裸 H.264/HEVC/VVC 码流按时间戳 seek
+ *
+ * 关键帧位置来自 stream.sampleIndexes（demux 过程中建立），目标时间超出索引范围时
+ * 从最后一个索引处向后快速扫描访问单元，只判断是否是 IRAP 帧而不解析 slice header，
+ * 扫描到的关键帧追加到索引中，之后的 seek 可以直接使用
+ *
+ * @param context
+ * @param stream
+ * @param timestamp 目标时间戳（stream.timeBase）
+ * @param firstPacketPos 第一个 packet 的位置
+ * @param step 每帧时长
+ * @param readNaluFrame 读取一个访问单元的所有 NALU
+ * @param isKeyFrame 访问单元是否是关键帧
+ * @param reset 重置 format 的读取状态到 pos 处，并以 dts 作为下一帧的时间戳
+ */
+export default async function seekInNaluIndexes(
+  context: AVIFormatContext,
+  stream: AVStream,
+  timestamp: int64,
+  firstPacketPos: int64,
+  step: int64,
+  readNaluFrame: (context: AVIFormatContext) => Promise<Uint8Array[]>,
+  isKeyFrame: (nalus: Uint8Array[]) => boolean,
+  reset: (pos: int64, dts: int64) => void
+) {
+  const now = context.ioReader.getPos()
+
+  const indexes = stream.sampleIndexes
+  const last = indexes[indexes.length - 1]
+
+  if (!last || last.pts < timestamp) {
+    let pos = last ? last.pos : firstPacketPos
+    let dts = last ? last.dts : 0n
+
+    logger.debug(`scan keyframe from pos: ${pos}, dts: ${dts}`)
+
+    await context.ioReader.seek(pos)
+    reset(pos, dts)
+
+    while (dts <= timestamp) {
+      const nalus = await readNaluFrame(context)
+      if (!nalus.length || (context.ioReader.flags & IOFlags.ABORT)) {
+        break
+      }
+      let size = 0
+      for (let i = 0; i < nalus.length; i++) {
+        size += nalus[i].length
+      }
+      if (isKeyFrame(nalus) && !stream.sampleIndexesPosMap.has(pos)) {
+        stream.sampleIndexesPosMap.set(pos, indexes.length)
+        indexes.push({
+          dts,
+          pts: dts,
+          pos,
+          size,
+          duration: step,
+          flags: AVPacketFlags.AV_PKT_FLAG_KEY
+        })
+      }
+      pos += static_cast<int64>(size)
+      dts += step
+    }
+  }
+
+  let pos = firstPacketPos
+  let dts = 0n
+
+  if (indexes.length) {
+    const index = array.binarySearch(indexes, (item) => {
+      if (item.pts > timestamp) {
+        return -1
+      }
+      return 1
+    })
+    const sample = index === -1 ? indexes[indexes.length - 1] : indexes[index - 1]
+    if (sample) {
+      pos = sample.pos
+      dts = sample.dts
+    }
+  }
+
+  logger.debug(`seek in sampleIndexes, pos: ${pos}, dts: ${dts}`)
+
+  await context.ioReader.seek(pos)
+  reset(pos, dts)
+
+  return now
+}
@@ -1,6 +1,7 @@
 
 export * as demux from './demux'
 export * as mux from './mux'
+export * as bsfKernel from './bsf/wasmKernel'
 export * as dumpUtils from './dump'
 export { default as dump } from './dump'
 
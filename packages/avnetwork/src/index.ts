@@ -1,6 +1,6 @@
 export { default as CustomIOLoader } from './ioLoader/CustomIOLoader'
 export { default as FetchIOLoader, type FetchIOLoaderOptions, type FetchInfo } from './ioLoader/FetchIOLoader'
-export { default as FileIOLoader, type FileInfo } from './ioLoader/FileIOLoader'
+export { default as FileIOLoader, type FileIOLoaderOptions, type FileInfo } from './ioLoader/FileIOLoader'
 export { default as IOLoader, type IOLoaderOptions, type IOLoaderAudioStreamInfo, type IOLoaderStatus, type IOLoaderSubtitleStreamInfo, type IOLoaderVideoStreamInfo } from './ioLoader/IOLoader'
 export { default as SocketIOLoader } from './ioLoader/SocketIOLoader'
 export { default as WebSocketIOLoader, type WebSocketOptions } from './ioLoader/WebSocketIOLoader'
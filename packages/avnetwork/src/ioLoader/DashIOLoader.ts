@@ -51,7 +51,7 @@ interface Resource {
   segmentIndex: number
   currentUri: string
   selectedIndex: number
-  segments: { url: string, pending?: boolean, duration?: number}[]
+  segments: { url: string, pending?: boolean, segmentDuration?: number }[]
   initSegmentPadding: string
   initedSegment: string
   sleep: Sleep
@@ -150,7 +150,8 @@ export default class DashIOLoader extends IOLoader {
       })
       this.signal = null
       const text = await res.text()
-      this.mediaPlayList = dashParser(text, this.info.url)
+      // 直播刷新时把上一次的列表传给解析器，只追加新的分片
+      this.mediaPlayList = dashParser(text, this.info.url, this.options.isLive ? this.mediaPlayList : null)
       this.minBuffer = this.mediaPlayList.minBufferTime
 
       if (this.mediaPlayList.type === 'vod') {
@@ -218,13 +219,7 @@ export default class DashIOLoader extends IOLoader {
         }
         else {
           if (this.options.isLive && this.audioResource.initedSegment === media.initSegment) {
-            this.audioResource.segments = media.mediaSegments.map((s) => {
-              return {
-                url: s.url,
-                pending: s.pending,
-                duration: s.segmentDuration
-              }
-            })
+            this.audioResource.segments = media.mediaSegments
             this.audioResource.lastPendingSegmentFetchTs = this.mediaPlayList.timestamp
             this.audioResource.lastPendingSegmentDuration = this.mediaPlayList.maxSegmentDuration
           }
@@ -232,13 +227,7 @@ export default class DashIOLoader extends IOLoader {
             if (this.options.isLive) {
               addIgnoreSegment(this.audioResource, media.mediaSegments, this.minBuffer)
             }
-            this.audioResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments.map((s) => {
-              return {
-                url: s.url,
-                pending: s.pending,
-                duration: s.segmentDuration
-              }
-            }))
+            this.audioResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments)
             this.audioResource.initedSegment = media.initSegment
           }
         }
@@ -288,13 +277,7 @@ export default class DashIOLoader extends IOLoader {
         }
         else {
           if (this.options.isLive && this.videoResource.initedSegment === media.initSegment) {
-            this.videoResource.segments = media.mediaSegments.map((s) => {
-              return {
-                url: s.url,
-                pending: s.pending,
-                duration: s.segmentDuration
-              }
-            })
+            this.videoResource.segments = media.mediaSegments
             this.videoResource.lastPendingSegmentFetchTs = this.mediaPlayList.maxSegmentDuration
             this.videoResource.lastPendingSegmentDuration = this.mediaPlayList.maxSegmentDuration
           }
@@ -302,13 +285,7 @@ export default class DashIOLoader extends IOLoader {
             if (this.options.isLive) {
               addIgnoreSegment(this.videoResource, media.mediaSegments, this.minBuffer)
             }
-            this.videoResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments.map((s) => {
-              return {
-                url: s.url,
-                pending: s.pending,
-                duration: s.segmentDuration
-              }
-            }))
+            this.videoResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments)
             this.videoResource.initedSegment = media.initSegment
           }
         }
@@ -352,13 +329,7 @@ export default class DashIOLoader extends IOLoader {
         }
         else {
           if (this.options.isLive && this.subtitleResource.initedSegment === media.initSegment) {
-            this.subtitleResource.segments = media.mediaSegments.map((s) => {
-              return {
-                url: s.url,
-                pending: s.pending,
-                duration: s.segmentDuration
-              }
-            })
+            this.subtitleResource.segments = media.mediaSegments
             this.subtitleResource.lastPendingSegmentFetchTs = this.mediaPlayList.maxSegmentDuration
             this.subtitleResource.lastPendingSegmentDuration = this.mediaPlayList.maxSegmentDuration
           }
@@ -366,13 +337,7 @@ export default class DashIOLoader extends IOLoader {
             if (this.options.isLive) {
               addIgnoreSegment(this.subtitleResource, media.mediaSegments, this.minBuffer)
             }
-            this.subtitleResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments.map((s) => {
-              return {
-                url: s.url,
-                pending: s.pending,
-                duration: s.segmentDuration
-              }
-            }))
+            this.subtitleResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments)
             this.subtitleResource.initedSegment = media.initSegment
           }
         }
@@ -459,9 +424,15 @@ export default class DashIOLoader extends IOLoader {
     }
 
     if (this.options.isLive) {
-      const segments = resource.segments.filter((s) => {
-        return !resource.fetchedMap.get(s.url)
-      })
+      // 已拉取的分片都在列表前面，从后往前找第一个未拉取的分片，只需要生成末尾这些分片的 url
+      let next = -1
+      for (let i = resource.segments.length - 1; i >= 0; i--) {
+        if (resource.fetchedMap.get(resource.segments[i].url)) {
+          break
+        }
+        next = i
+      }
+      const segments = next >= 0 ? resource.segments.slice(next, next + 1) : []
 
       if (!segments.length) {
         if (this.mediaPlayList.isEnd) {
@@ -508,7 +479,7 @@ export default class DashIOLoader extends IOLoader {
           }
         }
         resource.lastPendingSegmentFetchTs = getTimestamp()
-        resource.lastPendingSegmentDuration = segments[0].duration || this.mediaPlayList.maxSegmentDuration
+        resource.lastPendingSegmentDuration = segments[0].segmentDuration || this.mediaPlayList.maxSegmentDuration
       }
 
       resource.loader = new FetchIOLoader(object.extend({}, this.options, {
@@ -799,13 +770,7 @@ export default class DashIOLoader extends IOLoader {
           })
           this.addHistory(this.videoResource, media.mediaSegments, segmentIndex + 1)
         }
-        this.videoResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments.map((s) => {
-          return {
-            url: s.url,
-            pending: s.pending,
-            duration: s.segmentDuration
-          }
-        }))
+        this.videoResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments)
         this.videoResource.initSegmentPadding = media.initSegment
       }
       if (media.mediaSegments
@@ -841,13 +806,7 @@ export default class DashIOLoader extends IOLoader {
           })
           this.addHistory(this.audioResource, media.mediaSegments, segmentIndex + 1)
         }
-        this.audioResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments.map((s) => {
-          return {
-            url: s.url,
-            pending: s.pending,
-            duration: s.segmentDuration
-          }
-        }))
+        this.audioResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments)
         this.audioResource.initSegmentPadding = media.initSegment
       }
       if (media.mediaSegments
@@ -883,13 +842,7 @@ export default class DashIOLoader extends IOLoader {
           })
           this.addHistory(this.subtitleResource, media.mediaSegments, segmentIndex + 1)
         }
-        this.subtitleResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments.map((s) => {
-          return {
-            url: s.url,
-            pending: s.pending,
-            duration: s.segmentDuration
-          }
-        }))
+        this.subtitleResource.segments = [{ url: media.initSegment }].concat(media.mediaSegments)
         this.subtitleResource.initSegmentPadding = media.initSegment
       }
       if (media.mediaSegments
@@ -64,6 +64,8 @@ export default class FetchIOLoader extends IOLoader {
 
   private reader: ReadableStreamDefaultReader<Uint8Array>
 
+  private connecting: Promise<void>
+
   private buffers: Uint8Array[]
 
   private supportRange: boolean
@@ -266,6 +268,10 @@ export default class FetchIOLoader extends IOLoader {
     if (!this.options.isLive && !this.options.disableSegment) {
       params.headers['range'] = `bytes=${this.startBytes}-${this.endBytes > 0 ? this.endBytes : ''}`
     }
+    else if (this.options.disableSegment && (this.range.from > 0 || this.range.to > 0)) {
+      // 不分段请求时按 open 传入的范围一次请求（hls 的 byterange）
+      params.headers['range'] = `bytes=${this.range.from}-${this.range.to > 0 ? this.range.to : ''}`
+    }
 
     if (this.info.httpOptions?.credentials) {
       params.credentials = this.info.httpOptions.credentials
@@ -342,7 +348,12 @@ export default class FetchIOLoader extends IOLoader {
     }
 
     if (!this.reader) {
-      await this.openReader()
+      if (this.connecting) {
+        await this.connecting
+      }
+      else {
+        await this.openReader()
+      }
       if (this.aborted) {
         return IOError.END
       }
@@ -398,6 +409,24 @@ export default class FetchIOLoader extends IOLoader {
     return this.readInterval(buffer)
   }
 
+  /**
+   * 提前发出请求，不读取数据，之后的 read 直接使用这个请求的响应
+   * 
+   * 用于 ll-hls 的预加载提示，服务端会挂起请求直到数据可用
+   */
+  public async connect() {
+    if (this.reader || this.connecting) {
+      return this.connecting
+    }
+    this.connecting = this.openReader()
+    try {
+      await this.connecting
+    }
+    finally {
+      this.connecting = null
+    }
+  }
+
   public async seek(pos: int64) {
 
     if (!this.supportRange) {
@@ -23,21 +23,61 @@
  *
  */
 
-import { is, type Range } from '@libmedia/common'
+import { is, object, type Range } from '@libmedia/common'
 import { IOError, type Uint8ArrayInterface } from '@libmedia/common/io'
 
+import type { IOLoaderOptions } from './IOLoader'
 import IOLoader, { IOLoaderStatus } from './IOLoader'
 
 export interface FileInfo {
   file: Blob
+  /**
+   * Node 环境下的文件描述符，设置之后使用 fs.read 按位置读取，不再使用 file
+   */
+  fd?: number
+}
+
+export interface FileIOLoaderOptions extends IOLoaderOptions {
+  /**
+   * 缓存块大小，默认 1MB
+   */
+  blockSize?: number
+  /**
+   * 最多缓存的块数，seek 回已读区域时可以直接命中，默认 4（包括预读的块）
+   */
+  blockCount?: number
+  /**
+   * 顺序读取时并发预读的块数
+   */
+  concurrency?: number
+}
+
+interface NodeFs {
+  read(
+    fd: number,
+    buffer: Uint8Array,
+    offset: number,
+    length: number,
+    position: number,
+    callback: (error: Error, bytesRead: number) => void
+  ): void
+  fstat(fd: number, callback: (error: Error, stats: { size: number }) => void): void
 }
 
 // chrome 目前使用 arrayBuffer 读文件数据会造成内存泄漏，先关闭
 const hasArrayBuffer = is.func(Blob.prototype.arrayBuffer)
 const hasFileReaderSync = typeof FileReaderSync === 'function'
 
+const optionsDefault = {
+  blockSize: 1024 * 1024,
+  blockCount: 4,
+  concurrency: 4
+}
+
 export default class FileIOLoader extends IOLoader {
 
+  declare public options: FileIOLoaderOptions
+
   private info: FileInfo
 
   private range: Range
@@ -46,16 +86,52 @@ export default class FileIOLoader extends IOLoader {
 
   private endPos: number
 
-  private reader: FileReader | FileReaderSync
-  private readerResolve: (buffer: ArrayBuffer) => void
+  private fileSize: number
+
+  private fs: NodeFs
+
+  private readerSync: FileReaderSync
+
+  /**
+   * 块缓存，Map 的插入顺序即 LRU 顺序
+   */
+  private blocks: Map<number, Promise<Uint8Array>>
+
+  private lastBlockIndex: number
+
+  constructor(options: FileIOLoaderOptions = {}) {
+    super(options)
+    this.options = object.extend(object.extend({}, optionsDefault), this.options)
+    this.blocks = new Map()
+    this.lastBlockIndex = -1
+  }
 
   public async open(info: FileInfo, range: Range = { from: 0, to: -1 }) {
 
     this.info = info
     this.range = range
 
+    if (is.number(info.fd)) {
+      if (!this.fs) {
+        this.fs = await import(/* webpackIgnore: true */ 'fs' as string)
+      }
+      this.fileSize = await new Promise<number>((resolve, reject) => {
+        this.fs.fstat(info.fd, (error, stats) => {
+          if (error) {
+            reject(error)
+          }
+          else {
+            resolve(stats.size)
+          }
+        })
+      })
+    }
+    else {
+      this.fileSize = this.info.file.size
+    }
+
     this.readPos = 0
-    this.endPos = this.info.file.size
+    this.endPos = this.fileSize
 
     if (range.from > 0) {
       this.readPos = range.from
@@ -64,31 +140,106 @@ export default class FileIOLoader extends IOLoader {
       this.endPos = range.to
     }
 
+    this.blocks.clear()
+    this.lastBlockIndex = -1
+
     this.status = IOLoaderStatus.BUFFERING
 
     return 0
   }
 
-  private readBufferByReaderSync(len: number) {
-    if (!this.reader) {
-      this.reader = new FileReaderSync()
-    }
-    return this.reader.readAsArrayBuffer(this.info.file.slice(this.readPos, this.readPos + len)) as ArrayBuffer
+  private readRangeByFs(pos: number, len: number) {
+    return new Promise<Uint8Array>((resolve, reject) => {
+      const buffer = new Uint8Array(len)
+      this.fs.read(this.info.fd, buffer, 0, len, pos, (error, bytesRead) => {
+        if (error) {
+          reject(error)
+        }
+        else {
+          resolve(bytesRead < len ? buffer.subarray(0, bytesRead) : buffer)
+        }
+      })
+    })
   }
 
-  private async readBufferByReader(len: number) {
-    if (!this.reader) {
-      this.reader = new FileReader()
-      this.reader.onloadend = (event) => {
-        if (this.readerResolve) {
-          this.readerResolve(event.target.result as ArrayBuffer)
+  private readRangeByReader(pos: number, len: number) {
+    // 每次读取使用独立的 FileReader，允许多个区间并发读取
+    return new Promise<Uint8Array>((resolve, reject) => {
+      const reader = new FileReader()
+      reader.onloadend = (event) => {
+        if (event.target.error) {
+          reject(event.target.error)
         }
+        else {
+          resolve(new Uint8Array(event.target.result as ArrayBuffer))
+        }
+      }
+      reader.readAsArrayBuffer(this.info.file.slice(pos, pos + len))
+    })
+  }
+
+  /**
+   * @param async 预读时为 true，使用异步 FileReader，避免阻塞线程并且可以和其他块并发读取
+   */
+  private async readRange(pos: number, len: number, async: boolean) {
+    if (this.fs) {
+      return this.readRangeByFs(pos, len)
+    }
+    else if (async) {
+      // 预读不走 arrayBuffer，避免 chrome 的内存泄漏
+      return this.readRangeByReader(pos, len)
+    }
+    else if (hasFileReaderSync) {
+      if (!this.readerSync) {
+        this.readerSync = new FileReaderSync()
       }
+      return new Uint8Array(this.readerSync.readAsArrayBuffer(this.info.file.slice(pos, pos + len)))
+    }
+    else if (hasArrayBuffer) {
+      return new Uint8Array(await this.info.file.slice(pos, pos + len).arrayBuffer())
+    }
+    return this.readRangeByReader(pos, len)
+  }
+
+  private getBlock(index: number, async: boolean = false) {
+    let block = this.blocks.get(index)
+    if (block) {
+      // 移到 LRU 尾部
+      this.blocks.delete(index)
+      this.blocks.set(index, block)
+      return block
     }
-    return new Promise<ArrayBuffer>((resolve) => {
-      this.readerResolve = resolve
-      this.reader.readAsArrayBuffer(this.info.file.slice(this.readPos, this.readPos + len))
+
+    const pos = index * this.options.blockSize
+    block = this.readRange(pos, Math.min(this.options.blockSize, this.fileSize - pos), async)
+    // 读取失败不缓存，下次重新读取
+    block.catch(() => {
+      if (this.blocks.get(index) === block) {
+        this.blocks.delete(index)
+      }
     })
+    this.blocks.set(index, block)
+
+    while (this.blocks.size > this.options.blockCount) {
+      this.blocks.delete(this.blocks.keys().next().value)
+    }
+    return block
+  }
+
+  /**
+   * 顺序读取时并发预读后面的块
+   */
+  private prefetch(index: number) {
+    if (index !== this.lastBlockIndex + 1 && index !== this.lastBlockIndex) {
+      return
+    }
+    const lastIndex = Math.floor((this.endPos - 1) / this.options.blockSize)
+    const count = Math.min(this.options.concurrency, this.options.blockCount) - 1
+    for (let i = 1; i <= count && index + i <= lastIndex; i++) {
+      if (!this.blocks.has(index + i)) {
+        this.getBlock(index + i, true)
+      }
+    }
   }
 
   public async read(buffer: Uint8ArrayInterface) {
@@ -98,23 +249,35 @@ export default class FileIOLoader extends IOLoader {
     }
     const len = Math.min(buffer.length, this.endPos - this.readPos)
 
-    if (hasFileReaderSync) {
-      buffer.set(new Uint8Array(this.readBufferByReaderSync(len)), 0)
-    }
-    else if (hasArrayBuffer) {
-      buffer.set(new Uint8Array(await (this.info.file.slice(this.readPos, this.readPos + len).arrayBuffer())), 0)
-    }
-    else {
-      buffer.set(new Uint8Array(await this.readBufferByReader(len)), 0)
-    }
+    let offset = 0
 
-    this.readPos += len
+    while (offset < len) {
+      const index = Math.floor(this.readPos / this.options.blockSize)
+      const block = this.getBlock(index)
+      this.prefetch(index)
+      this.lastBlockIndex = index
+
+      const data = await block
+      const start = this.readPos - index * this.options.blockSize
+      const size = Math.min(data.length - start, len - offset)
+      if (size <= 0) {
+        break
+      }
+      buffer.set(data.subarray(start, start + size), offset)
+      offset += size
+      this.readPos += size
+    }
 
     if (this.readPos >= this.endPos) {
       this.status = IOLoaderStatus.COMPLETE
     }
 
-    return len
+    if (!offset) {
+      this.status = IOLoaderStatus.COMPLETE
+      return IOError.END
+    }
+
+    return offset
   }
 
   public async seek(pos: int64) {
@@ -126,10 +289,12 @@ export default class FileIOLoader extends IOLoader {
   }
 
   public async size() {
-    return static_cast<int64>(this.info.file.size)
+    return static_cast<int64>(this.fileSize)
   }
 
   public async stop() {
+    this.blocks.clear()
+    this.lastBlockIndex = -1
     this.status = IOLoaderStatus.IDLE
   }
 }
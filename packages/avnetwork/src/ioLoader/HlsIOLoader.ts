@@ -25,7 +25,7 @@
 
 import { Sleep } from '@libmedia/common/timer'
 import { AVMediaType, errorType, AVFormat } from '@libmedia/avutil'
-import { object, logger, getTimestamp, url as urlUtil, is, AESWebDecryptor, AesMode, type Data } from '@libmedia/common'
+import { object, logger, getTimestamp, url as urlUtil, is, AESWebDecryptor, AesMode, type Data, type Range } from '@libmedia/common'
 import { IOError, type Uint8ArrayInterface } from '@libmedia/common/io'
 import { Ext2Format } from '@libmedia/avutil/internal'
 
@@ -33,7 +33,7 @@ import type { IOLoaderAudioStreamInfo, IOLoaderOptions, IOLoaderSubtitleStreamIn
 import IOLoader, { IOLoaderStatus } from './IOLoader'
 
 import hlsParser from '@libmedia/avprotocol/m3u8/parser'
-import type { MasterPlaylist, MediaPlaylist, Playlist, Segment } from '@libmedia/avprotocol/m3u8/types'
+import type { MasterPlaylist, MediaPlaylist, PartialSegment, Playlist, Segment } from '@libmedia/avprotocol/m3u8/types'
 import type { FetchInfo } from './FetchIOLoader'
 import FetchIOLoader from './FetchIOLoader'
 import AESDecryptPipe from '../bsp/aes/AESDecryptPipe'
@@ -145,10 +145,33 @@ class MediaLoader {
 
   private signal: AbortController
 
+  /**
+   * ll-hls 下一个要请求的 part 所在 segment 的序号和 part 索引
+   */
+  private partMsn: number
+  private partIndex: number
+  /**
+   * 当前请求的是所在 segment 剩下的全部数据（没有 part 的 segment 或者开放式 byterange 预加载提示）
+   */
+  private partWholeSegment: boolean
+  /**
+   * part 是否使用 byterange 指向同一个资源
+   */
+  private byterangeParts: boolean
+  /**
+   * 提前发出的预加载提示请求
+   */
+  private preload: {
+    key: string
+    loader: FetchIOLoader
+  }
+
   constructor(options: IOLoaderOptions, info: FetchInfo, mediaListUrl?: string, mediaPlayList?: MediaPlaylist) {
     this.options = options
     this.info = info
 
+    this.partMsn = -1
+    this.partIndex = 0
     this.segmentIndex = 0
     this.fetchedMap = new Map()
     this.fetchedHistoryList = []
@@ -249,6 +272,375 @@ class MediaLoader {
       this.segmentIndex = segIndex
       this.minBuffer = cache
     }
+
+    if (this.isLowLatency()) {
+      this.byterangeParts = this.hasByterangeParts()
+      this.abortPreload()
+      if (this.partMsn < 0) {
+        this.initPartPosition()
+      }
+      else if (this.partIndex > 0) {
+        // 切换码率之后从下一个 segment 开始，保证从关键帧开始解码
+        this.partMsn++
+        this.partIndex = 0
+      }
+    }
+  }
+
+  private isLowLatency() {
+    return this.options.isLive
+      && !!this.mediaPlayList.lowLatencyCompatibility
+      && this.mediaPlayList.partTargetDuration > 0
+  }
+
+  private hasByterangeParts() {
+    return this.mediaPlayList.segments.some((segment) => {
+      return segment.parts.some((part) => !part.hint && !!part.byterange)
+    })
+  }
+
+  /**
+   * 按 PART-HOLD-BACK 从直播边缘往前找一个可以独立解码的 part 作为起播位置
+   */
+  private initPartPosition() {
+    const segments = this.mediaPlayList.segments
+    const compatibility = this.mediaPlayList.lowLatencyCompatibility
+    const buffer = compatibility.partHoldBack
+      || compatibility.holdBack
+      || this.mediaPlayList.partTargetDuration * 3
+
+    this.partMsn = segments.length ? segments[0].mediaSequenceNumber : 0
+    this.partIndex = 0
+
+    let cache = 0
+    for (let i = segments.length - 1; i >= 0; i--) {
+      const segment = segments[i]
+      if (segment.parts.length && !segment.key) {
+        for (let j = segment.parts.length - 1; j >= 0; j--) {
+          const part = segment.parts[j]
+          if (part.hint || part.gap) {
+            continue
+          }
+          cache += part.duration
+          if (cache >= buffer && (part.independent || j === 0)) {
+            this.partMsn = segment.mediaSequenceNumber
+            this.partIndex = j
+            this.minBuffer = cache
+            return
+          }
+        }
+      }
+      else if (segment.uri) {
+        cache += segment.duration
+        if (cache >= buffer) {
+          this.partMsn = segment.mediaSequenceNumber
+          this.minBuffer = cache
+          return
+        }
+      }
+    }
+    this.minBuffer = cache
+  }
+
+  /**
+   * 预加载提示只给出起始位置时请求的是所在资源剩下的所有数据
+   */
+  private isOpenEndedHint(part: PartialSegment) {
+    return part.hint && this.byterangeParts && (!part.byterange || part.byterange.length == null)
+  }
+
+  private getPartRange(segment: Segment, index: number): Range {
+    const part = segment.parts[index]
+    const range = {
+      from: 0,
+      to: -1
+    }
+    if (part.byterange) {
+      let offset = part.byterange.offset
+      if (offset < 0) {
+        // 没有 offset 时接着上一个 part
+        const prev = segment.parts[index - 1]
+        offset = prev?.byterange && prev.uri === part.uri
+          ? this.getPartRange(segment, index - 1).to + 1
+          : 0
+      }
+      range.from = offset
+      if (part.byterange.length != null) {
+        range.to = offset + part.byterange.length - 1
+      }
+    }
+    return range
+  }
+
+  /**
+   * 合并 _HLS_skip 请求返回的增量播放列表，缓存的播放列表里没有被跳过的 segment 时返回 false
+   */
+  private mergeDeltaPlayList(playList: MediaPlaylist) {
+    const segments = this.mediaPlayList.segments
+    const index = segments.findIndex((segment) => segment.mediaSequenceNumber === playList.mediaSequenceBase)
+    if (index < 0 || segments.length - index < playList.skip) {
+      return false
+    }
+    const skipped = segments.slice(index, index + playList.skip)
+    if (skipped[skipped.length - 1].mediaSequenceNumber !== playList.mediaSequenceBase + playList.skip - 1) {
+      return false
+    }
+    // 增量列表里可能省略了被跳过部分中的 EXT-X-MAP
+    const map = skipped[skipped.length - 1].map
+    if (map) {
+      playList.segments.forEach((segment) => {
+        if (!segment.map) {
+          segment.map = map
+        }
+      })
+    }
+    playList.segments = skipped.concat(playList.segments)
+    playList.skip = 0
+    playList.duration = playList.segments.reduce((total, segment) => {
+      return is.number(segment.duration) ? total + segment.duration : total
+    }, 0)
+    this.mediaPlayList = playList
+    return true
+  }
+
+  /**
+   * 刷新直播播放列表
+   * 
+   * @param blocking 是否使用 _HLS_msn/_HLS_part 阻塞请求，等待下一个需要的 part 出现才返回
+   * @param skip 是否请求增量播放列表
+   */
+  private async reloadMediaPlayList(blocking: boolean, skip: boolean = true): Promise<void> {
+    const compatibility = this.mediaPlayList.lowLatencyCompatibility
+    const params: string[] = []
+
+    if (blocking) {
+      if (compatibility?.canBlockReload) {
+        params.push(`_HLS_msn=${this.partMsn}`, `_HLS_part=${this.partIndex}`)
+      }
+      else {
+        this.sleep = new Sleep(this.mediaPlayList.partTargetDuration || this.mediaPlayList.targetDuration / 2)
+        await this.sleep
+        this.sleep = null
+        if (this.aborted) {
+          return
+        }
+      }
+    }
+    // 只有缓存的列表足够新时才能请求增量列表
+    if (skip
+      && compatibility?.canSkipUntil > 0
+      && getTimestamp() - this.mediaPlayList.timestamp < compatibility.canSkipUntil * 500
+    ) {
+      params.push('_HLS_skip=YES')
+    }
+
+    let url = this.mediaListUrl
+    if (params.length) {
+      url += (url.indexOf('?') >= 0 ? '&' : '?') + params.join('&')
+    }
+
+    if (typeof AbortController === 'function') {
+      this.signal = new AbortController()
+    }
+    const playList = await fetchMediaPlayList(url, this.info, this.options, this.signal?.signal)
+    this.signal = null
+
+    if (!playList || this.aborted) {
+      return
+    }
+    if (playList.skip > 0) {
+      if (!this.mergeDeltaPlayList(playList)) {
+        logger.warn('can not merge hls delta playlist, reload the full playlist')
+        return this.reloadMediaPlayList(false, false)
+      }
+    }
+    else {
+      this.mediaPlayList = playList
+    }
+    this.byterangeParts = this.hasByterangeParts()
+  }
+
+  /**
+   * 对播放列表末尾的预加载提示提前发出请求，服务端在 part 可用时返回
+   */
+  private async startPreload(currentKey: string) {
+    if (this.preload) {
+      return
+    }
+    const last = this.mediaPlayList.segments[this.mediaPlayList.segments.length - 1]
+    const hint = last?.parts[last.parts.length - 1]
+    if (!hint?.hint || last.key || this.isOpenEndedHint(hint)) {
+      return
+    }
+    const url = urlUtil.buildAbsoluteURL(this.mediaListUrl, hint.uri)
+    const range = this.getPartRange(last, last.parts.length - 1)
+    const key = `${url}@${range.from}`
+    if (key === currentKey) {
+      return
+    }
+    const loader = new FetchIOLoader(object.extend({}, this.options, { disableSegment: true, loop: false }))
+    this.preload = {
+      key,
+      loader
+    }
+    await loader.open(
+      object.extend({}, this.info, {
+        url
+      }),
+      range
+    )
+    loader.connect().catch((error) => {
+      logger.warn(`preload hint request failed, ${error}`)
+    })
+  }
+
+  private abortPreload() {
+    if (this.preload) {
+      this.preload.loader.abort()
+      this.preload = null
+    }
+  }
+
+  private async openPart(
+    buffer: Uint8ArrayInterface,
+    segment: Segment,
+    uri: string,
+    range: Range,
+    isInit: boolean,
+    wholeSegment: boolean
+  ) {
+    this.isInitLoader = isInit
+    this.partWholeSegment = wholeSegment
+    this.currentUri = uri
+
+    await this.checkNeedDecrypt(isInit ? segment.map.key : segment.key, uri, segment.mediaSequenceNumber)
+
+    const url = urlUtil.buildAbsoluteURL(this.mediaListUrl, uri)
+    const key = `${url}@${range.from}`
+
+    if (this.preload?.key === key) {
+      this.loader = this.preload.loader
+      this.preload = null
+    }
+    else {
+      if (!isInit && segment.parts[this.partIndex]?.hint) {
+        // 已经到了直播边缘，之前的预加载请求已经过期
+        this.abortPreload()
+      }
+      this.loader = new FetchIOLoader(object.extend({}, this.options, { disableSegment: true, loop: false }))
+      await this.loader.open(
+        object.extend({}, this.info, {
+          url
+        }),
+        range
+      )
+    }
+
+    if (!isInit) {
+      this.startPreload(key)
+    }
+
+    const ret = await (this.aesDecryptPipe ? this.aesDecryptPipe.read(buffer) : this.loader.read(buffer))
+    if (ret > 10) {
+      return this.handleSlice(ret, buffer)
+    }
+    return ret
+  }
+
+  /**
+   * ll-hls 按 part 读取，part 还没出现时阻塞刷新播放列表
+   */
+  private async readPart(buffer: Uint8ArrayInterface): Promise<number> {
+    if (this.loader) {
+      const ret = this.aesDecryptPipe ? (await this.aesDecryptPipe.read(buffer)) : (await this.loader.read(buffer))
+      if (ret !== IOError.END || this.aborted) {
+        return ret
+      }
+      if (this.isInitLoader) {
+        this.initLoaded = true
+      }
+      else if (this.partWholeSegment) {
+        this.partMsn++
+        this.partIndex = 0
+      }
+      else {
+        this.partIndex++
+      }
+      this.loader = null
+    }
+
+    while (!this.aborted) {
+      const segments = this.mediaPlayList.segments
+      const first = segments.length ? segments[0].mediaSequenceNumber : 0
+
+      if (this.partMsn < first) {
+        logger.warn(`ll-hls fell behind the playlist, jump to segment ${first}`)
+        this.partMsn = first
+        this.partIndex = 0
+      }
+
+      const segment = segments[this.partMsn - first]
+
+      if (segment) {
+        if (segment.map?.uri && !segment.map.hint && !this.initLoaded) {
+          const range = {
+            from: 0,
+            to: -1
+          }
+          if (segment.map.byterange) {
+            range.from = Math.max(segment.map.byterange.offset, 0)
+            range.to = range.from + segment.map.byterange.length - 1
+          }
+          return this.openPart(buffer, segment, segment.map.uri, range, true, false)
+        }
+        if (segment.parts.length && !segment.key) {
+          const part = segment.parts[this.partIndex]
+          if (part?.gap) {
+            this.partIndex++
+            continue
+          }
+          if (part) {
+            return this.openPart(
+              buffer,
+              segment,
+              part.uri,
+              this.getPartRange(segment, this.partIndex),
+              false,
+              this.isOpenEndedHint(part)
+            )
+          }
+          if (segment.uri) {
+            this.partMsn++
+            this.partIndex = 0
+            continue
+          }
+        }
+        else if (segment.uri) {
+          if (this.partIndex > 0) {
+            // segment 已经移出 part 窗口，剩下的部分无法单独请求
+            logger.warn(`ll-hls part window passed, skip the rest of segment ${this.partMsn}`)
+            this.partMsn++
+            this.partIndex = 0
+            continue
+          }
+          const range = {
+            from: 0,
+            to: -1
+          }
+          if (segment.byterange) {
+            range.from = segment.byterange.offset
+            range.to = segment.byterange.offset + segment.byterange.length - 1
+          }
+          return this.openPart(buffer, segment, segment.uri, range, false, true)
+        }
+      }
+      else if (this.mediaPlayList.endlist) {
+        return IOError.END
+      }
+
+      await this.reloadMediaPlayList(true)
+    }
+    return IOError.END
   }
 
   public getMediaListUrl() {
@@ -338,6 +730,10 @@ class MediaLoader {
       return len
     }
 
+    if (this.isLowLatency()) {
+      return this.readPart(buffer)
+    }
+
     let ret = 0
 
     if (this.loader) {
@@ -388,11 +784,7 @@ class MediaLoader {
             return IOError.END
           }
         }
-        if (typeof AbortController === 'function') {
-          this.signal = new AbortController()
-        }
-        this.mediaPlayList = await fetchMediaPlayList(this.mediaListUrl, this.info, this.options, this.signal?.signal)
-        this.signal = null
+        await this.reloadMediaPlayList(false)
         if (this.aborted) {
           return IOError.END
         }
@@ -420,7 +812,7 @@ class MediaLoader {
       const byteRange = this.isInitLoader ? segments[0].map.byterange : segments[0].byterange
       if (byteRange) {
         range.from = byteRange.offset
-        range.to = byteRange.offset + byteRange.length
+        range.to = byteRange.offset + byteRange.length - 1
       }
 
       await this.loader.open(
@@ -460,7 +852,7 @@ class MediaLoader {
       const byteRange = this.isInitLoader ? segment.map.byterange : segment.byterange
       if (byteRange) {
         range.from = byteRange.offset
-        range.to = byteRange.offset + byteRange.length
+        range.to = byteRange.offset + byteRange.length - 1
       }
 
       await this.loader.open(
@@ -517,6 +909,7 @@ class MediaLoader {
 
   public async abort() {
     this.abortSleep()
+    this.abortPreload()
     if (this.signal) {
       this.signal.abort()
       this.signal = null
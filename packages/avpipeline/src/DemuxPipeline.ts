@@ -38,24 +38,31 @@ import {
   AVMediaType,
   AVPacketSideDataType,
   avRescaleQ2,
+  avRescaleQ3,
   NOPTS_VALUE,
+  NOPTS_VALUE_BIGINT,
   type AVStreamGroup,
   type AVStreamGroupInterface,
   AVDisposition,
   type AVStreamInterface,
   addAVPacketSideData,
-  getAVPacketData,
   getAVPacketSideData,
   refAVPacket,
   serializeAVPacket,
-  analyzeAVFormat
+  analyzeAVFormat,
+  avring,
+  type AVRing,
+  avbytering,
+  type AVByteRing,
+  type AVPacket,
+  createAVPacket,
+  destroyAVPacket,
+  unrefAVPacket,
+  copyCodecParameters
 } from '@libmedia/avutil'
 
 import {
-  AV_MILLI_TIME_BASE_Q,
-  h264,
-  hevc,
-  vvc
+  AV_MILLI_TIME_BASE_Q
 } from '@libmedia/avutil/internal'
 
 import {
@@ -67,6 +74,7 @@ import {
   mapUint8Array,
   memcpy,
   memcpyFromUint8Array,
+  atomics,
   config as cheapConfig
 } from '@libmedia/cheap'
 
@@ -76,13 +84,15 @@ import {
   logger,
   bigint,
   isWorker,
-  support
+  support,
+  object
 } from '@libmedia/common'
 
 import {
   IOError,
   IOReader,
-  IOWriter
+  IOWriter,
+  IOWriterSync
 } from '@libmedia/common/io'
 
 import {
@@ -97,27 +107,29 @@ import {
 
 import {
   demux,
+  mux,
+  bsfKernel,
   type AVFormatContextInterface,
   type AVIFormatContext,
   createAVIFormatContext,
-  type IFormat
+  type AVOFormatContext,
+  createAVOFormatContext,
+  type AVChapter
 } from '@libmedia/avformat'
 
-import type { IRtspFormatOptions } from '@libmedia/avformat/IRtspFormat'
-import type { IFlvFormatOptions } from '@libmedia/avformat/IFlvFormat'
-import type { IIsobmffFormatOptions } from '@libmedia/avformat/IIsobmffFormat'
-import type { IH264FormatOptions } from '@libmedia/avformat/IH264Format'
-import type { IHevcFormatOptions } from '@libmedia/avformat/IHevcFormat'
-import type { IVvcFormatOptions } from '@libmedia/avformat/IVvcFormat'
-import type { IAviFormatOptions } from '@libmedia/avformat/IAviFormat'
-
 import type { TaskOptions } from './Pipeline'
 import Pipeline from './Pipeline'
+import createOFormat from './mux/createOFormat'
+import createIFormat from './demux/createIFormat'
 
 import type { Data } from '@libmedia/common'
 
 export const STREAM_INDEX_ALL = -1
 const MAX_QUEUE_LENGTH_DEFAULT = 5000
+// 转封装每个 tick 最多处理的 avpacket 数量
+const REMUX_BATCH_SIZE = 100
+// 转封装交织等待的最大缓存 avpacket 数量，超过之后不再等待没有包的流
+const REMUX_MAX_INTERLEAVE_QUEUE = 500
 
 export interface DemuxTaskOptions extends TaskOptions {
   format?: AVFormat
@@ -129,6 +141,79 @@ export interface DemuxTaskOptions extends TaskOptions {
   avpacketList: pointer<List<pointer<AVPacketRef>>>
   avpacketListMutex: pointer<Mutex>
   flags?: int32
+  /**
+   * IO 线程的预读环形缓冲区，设置之后读数据直接从中拷贝，seek 和 size 仍然走消息
+   */
+  ioRing?: pointer<AVByteRing>
+}
+
+/**
+ * 流复制转封装配置
+ * 
+ * 输出协议和 MuxPipeline 相同，通过 rightPort 发送 write、seek、end 和 error
+ */
+export interface RemuxOptions {
+  format: AVFormat
+  formatOptions?: Data
+  rightPort: MessagePort
+  isLive?: boolean
+  nonnegative?: boolean
+  zeroStart?: boolean
+}
+
+interface RemuxContext extends RemuxOptions {
+  rightIPCPort: IPCPort
+  formatContext: AVOFormatContext
+  /**
+   * 写完之后可复用的 avpacket
+   */
+  avpacketCache: pointer<AVPacket>[]
+  /**
+   * 每个输出流等待交织写出的 avpacket
+   */
+  queues: pointer<AVPacket>[][]
+  queuedCount: number
+  /**
+   * 交织时需要等待的输出流（音视频）
+   */
+  interleaveStreams: int32[]
+  /**
+   * 输入流 index -> 输出流 index
+   */
+  streamIndexMap: Map<int32, int32>
+  loop: LoopTask
+  ended: boolean
+}
+
+interface KeyFrameIndexEntry {
+  /**
+   * 入队序号
+   */
+  seq: number
+  /**
+   * 毫秒
+   */
+  dts: int64
+  /**
+   * 参数集代数，每遇到一个携带参数集的关键帧加 1
+   */
+  paramSetGeneration: number
+  /**
+   * 当前代参数集所在关键帧的入队序号，没有为 -1
+   */
+  paramSetSeq: number
+}
+
+/**
+ * 缓存队列的关键帧索引
+ * 
+ * 队列只会从头部出队，所以队头的入队序号为 pushed - list.length
+ */
+interface AVPacketQueueIndex {
+  pushed: number
+  paramSetGeneration: number
+  paramSetSeq: number
+  keyFrames: KeyFrameIndexEntry[]
 }
 
 type SelfTask = DemuxTaskOptions & {
@@ -145,6 +230,8 @@ type SelfTask = DemuxTaskOptions & {
   pendingAVPackets: Map<number, pointer<AVPacketRef>[]>
   cacheRequests: Map<number, RpcMessage>
   streamIndexFlush: Map<number, boolean>
+  rings: Map<number, pointer<AVRing>>
+  queueIndexes: Map<number, AVPacketQueueIndex>
 
   realFormat: AVFormat
 
@@ -157,6 +244,8 @@ type SelfTask = DemuxTaskOptions & {
   lastVideoDts: int64
 
   avpacketPool: AVPacketPool
+
+  remux: RemuxContext
 }
 
 export default class DemuxPipeline extends Pipeline {
@@ -214,6 +303,29 @@ export default class DemuxPipeline extends Pipeline {
 
       assert(buffer.byteOffset >= iBuf && buffer.byteOffset < iBuf + bufferLength)
 
+      if (options.ioRing && !options.ioloaderOptions) {
+        const pointer = reinterpret_cast<pointer<uint8>>(buffer.byteOffset as uint32)
+        while (true) {
+          const task = this.tasks.get(options.taskId)
+          if (!task || !task.ioRing) {
+            return IOError.END
+          }
+          const len = avbytering.avbyteringRead(task.ioRing, pointer, buffer.length)
+          if (len > 0) {
+            return len
+          }
+          const ended = atomics.load(addressof(task.ioRing.ended))
+          if (ended) {
+            // 结束之前写入的数据要先读完
+            if (avbytering.avbyteringSize(task.ioRing) > 0) {
+              continue
+            }
+            return ended
+          }
+          await avbytering.avbyteringWaitData(task.ioRing, 100)
+        }
+      }
+
       const params: {
         pointer: pointer<void>
         length: size
@@ -317,6 +429,8 @@ export default class DemuxPipeline extends Pipeline {
       cacheAVPackets: new Map(),
       cacheRequests: new Map(),
       streamIndexFlush: new Map(),
+      rings: new Map(),
+      queueIndexes: new Map(),
       pendingAVPackets: new Map(),
 
       realFormat: AVFormat.UNKNOWN,
@@ -329,13 +443,15 @@ export default class DemuxPipeline extends Pipeline {
       lastAudioDts: 0n,
       lastVideoDts: 0n,
 
-      avpacketPool: new AVPacketPoolImpl(accessof(options.avpacketList), options.avpacketListMutex)
+      avpacketPool: new AVPacketPoolImpl(accessof(options.avpacketList), options.avpacketListMutex),
+
+      remux: null
     })
 
     return 0
   }
 
-  public async openStream(taskId: string, maxProbeDuration: int32 = 3000) {
+  public async openStream(taskId: string, maxProbeDuration: int32 = 3000, tieredProbe: boolean = false) {
     const task = this.tasks.get(taskId)
     if (task) {
       let ret = await task.leftIPCPort.request<int32>('open')
@@ -359,203 +475,19 @@ export default class DemuxPipeline extends Pipeline {
         return errorType.DATA_INVALID
       }
 
-      let iformat: IFormat
+      const iformat = await createIFormat(format, task.formatOptions)
 
-      switch (format) {
-        case AVFormat.FLV:
-          if (defined(ENABLE_DEMUXER_FLV)) {
-            iformat = new ((await import('@libmedia/avformat/IFlvFormat')).default)(task.formatOptions as IFlvFormatOptions)
-          }
-          else {
-            logger.error('flv format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.ISOBMFF:
-          if (defined(ENABLE_DEMUXER_ISOBMFF) || defined(ENABLE_PROTOCOL_DASH)) {
-            iformat = new ((await import('@libmedia/avformat/IIsobmffFormat')).default)(task.formatOptions as IIsobmffFormatOptions)
-          }
-          else {
-            logger.error('mp4 format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MPEGTS:
-          if (defined(ENABLE_DEMUXER_MPEGPS) || defined(ENABLE_PROTOCOL_HLS)) {
-            iformat = new ((await import('@libmedia/avformat/IMpegtsFormat')).default)
-          }
-          else {
-            logger.error('mpegts format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MPEGPS:
-          if (defined(ENABLE_DEMUXER_MPEGPS)) {
-            iformat = new ((await import('@libmedia/avformat/IMpegpsFormat')).default)
-          }
-          else {
-            logger.error('mpegps format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.IVF:
-          if (defined(ENABLE_DEMUXER_IVF)) {
-            iformat = new ((await import('@libmedia/avformat/IIvfFormat')).default)
-          }
-          else {
-            logger.error('ivf format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.OGG:
-          if (defined(ENABLE_DEMUXER_OGG)) {
-            iformat = new ((await import('@libmedia/avformat/IOggFormat')).default)
-          }
-          else {
-            logger.error('oggs format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MP3:
-          if (defined(ENABLE_DEMUXER_MP3)) {
-            iformat = new ((await import('@libmedia/avformat/IMp3Format')).default)
-          }
-          else {
-            logger.error('mp3 format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MATROSKA:
-        case AVFormat.WEBM:
-          if (defined(ENABLE_DEMUXER_MATROSKA)) {
-            iformat = new (((await import('@libmedia/avformat/IMatroskaFormat')).default))
-          }
-          else {
-            logger.error('matroska format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.AAC:
-          if (defined(ENABLE_DEMUXER_AAC)) {
-            iformat = new (((await import('@libmedia/avformat/IAacFormat')).default))
-          }
-          else {
-            logger.error('aac format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.FLAC:
-          if (defined(ENABLE_DEMUXER_FLAC)) {
-            iformat = new (((await import('@libmedia/avformat/IFlacFormat')).default))
-          }
-          else {
-            logger.error('flac format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.WAV:
-          if (defined(ENABLE_DEMUXER_WAV)) {
-            iformat = new (((await import('@libmedia/avformat/IWavFormat')).default))
-          }
-          else {
-            logger.error('wav format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.WEBVTT:
-          if (defined(ENABLE_DEMUXER_WEBVTT)) {
-            iformat = new (((await import('@libmedia/avformat/IWebVttFormat')).default))
-          }
-          else {
-            logger.error('webvtt format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.SUBRIP:
-          if (defined(ENABLE_DEMUXER_SUBRIP)) {
-            iformat = new (((await import('@libmedia/avformat/ISubRipFormat')).default))
-          }
-          else {
-            logger.error('subrip format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.ASS:
-          if (defined(ENABLE_DEMUXER_ASS)) {
-            iformat = new (((await import('@libmedia/avformat/IAssFormat')).default))
-          }
-          else {
-            logger.error('ass format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.TTML:
-          if (defined(ENABLE_DEMUXER_TTML)) {
-            iformat = new (((await import('@libmedia/avformat/ITtmlFormat')).default))
-          }
-          else {
-            logger.error('ttml format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.H264:
-          if (defined(ENABLE_DEMUXER_H264)) {
-            iformat = new (((await import('@libmedia/avformat/IH264Format')).default))(task.formatOptions as IH264FormatOptions)
-          }
-          else {
-            logger.error('h264 format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.HEVC:
-          if (defined(ENABLE_DEMUXER_HEVC)) {
-            iformat = new (((await import('@libmedia/avformat/IHevcFormat')).default))(task.formatOptions as IHevcFormatOptions)
-          }
-          else {
-            logger.error('hevc format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.VVC:
-          if (defined(ENABLE_DEMUXER_VVC)) {
-            iformat = new (((await import('@libmedia/avformat/IVvcFormat')).default))(task.formatOptions as IVvcFormatOptions)
-          }
-          else {
-            logger.error('vvc format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.RTSP:
-          if (defined(ENABLE_PROTOCOL_RTSP)) {
-            iformat = new (((await import('@libmedia/avformat/IRtspFormat')).default))(task.formatOptions as IRtspFormatOptions)
-          }
-          else {
-            logger.error('vvc format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.AVI:
-          if (defined(ENABLE_DEMUXER_AVI)) {
-            iformat = new (((await import('@libmedia/avformat/IAviFormat')).default))(task.formatOptions as IAviFormatOptions)
-          }
-          else {
-            logger.error('avi format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        default:
-          logger.error('format not support')
-          return errorType.FORMAT_NOT_SUPPORT
+      if (!iformat) {
+        return errorType.FORMAT_NOT_SUPPORT
       }
 
-      assert(iformat)
-
       task.realFormat = format
       task.formatContext.iformat = iformat
 
       return demux.open(task.formatContext, {
         maxAnalyzeDuration: maxProbeDuration,
-        fastOpen: task.isLive
+        fastOpen: task.isLive,
+        tieredAnalyze: tieredProbe && !task.isLive
       })
     }
     else {
@@ -646,52 +578,95 @@ export default class DemuxPipeline extends Pipeline {
     ipcPort.reply(request, avpacket)
   }
 
-  public async connectStreamTask(taskId: string, streamIndex: number, port: MessagePort) {
+  /**
+   * 连接一个流的消费者
+   * 
+   * @param taskId 
+   * @param streamIndex 
+   * @param port 
+   * @param ring 共享内存环形队列，传入之后 avpacket 直接写入 ring，消费者不再通过 pull 请求拉取
+   */
+  public async connectStreamTask(taskId: string, streamIndex: number, port: MessagePort, ring: pointer<AVRing> = nullptr) {
     const task = this.tasks.get(taskId)
     if (task) {
-      const ipcPort: IPCPort & { streamIndex?: number } = new IPCPort(port)
-
       task.cacheAVPackets.set(streamIndex, [])
 
-      ipcPort.streamIndex = streamIndex
-      ipcPort.on(REQUEST, async (request: RpcMessage) => {
-        switch (request.method) {
-          case 'pull': {
-            const cacheAVPackets = task.cacheAVPackets.get(ipcPort.streamIndex)
-            if (cacheAVPackets.length) {
-              const avpacket = cacheAVPackets.shift()
-              if (task.stats !== nullptr && avpacket > 0) {
-                if (task.formatContext.streams[avpacket.streamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
-                  task.stats.audioPacketQueueLength--
-                }
-                else if (task.formatContext.streams[avpacket.streamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
-                  task.stats.videoPacketQueueLength--
-                }
+      if (ring) {
+        avring.avringRestart(ring)
+        task.rings.set(streamIndex, ring)
+      }
+
+      task.rightIPCPorts.set(streamIndex, this.createStreamIPCPort(task, streamIndex, port))
+
+      logger.debug(`connect stream ${streamIndex}, taskId: ${task.taskId}`)
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  /**
+   * 替换流的消费端口，已缓存的 avpacket 和 ring 保留
+   * 
+   * 用于消费者（解码任务）迁移到其他线程
+   * 
+   * @param taskId 
+   * @param streamIndex 
+   * @param port 
+   */
+  public async reconnectStreamTask(taskId: string, streamIndex: number, port: MessagePort) {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      const old = task.rightIPCPorts.get(streamIndex)
+      if (old) {
+        old.destroy()
+      }
+      // 旧的消费者已经不存在了，挂起的请求直接丢弃
+      task.cacheRequests.delete(streamIndex)
+      task.rightIPCPorts.set(streamIndex, this.createStreamIPCPort(task, streamIndex, port))
+
+      logger.debug(`reconnect stream ${streamIndex}, taskId: ${task.taskId}`)
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  private createStreamIPCPort(task: SelfTask, streamIndex: number, port: MessagePort) {
+    const ipcPort: IPCPort & { streamIndex?: number } = new IPCPort(port)
+    ipcPort.streamIndex = streamIndex
+    ipcPort.on(REQUEST, async (request: RpcMessage) => {
+      switch (request.method) {
+        case 'pull': {
+          const cacheAVPackets = task.cacheAVPackets.get(ipcPort.streamIndex)
+          if (cacheAVPackets.length) {
+            const avpacket = cacheAVPackets.shift()
+            if (task.stats !== nullptr && avpacket > 0) {
+              if (task.formatContext.streams[avpacket.streamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
+                task.stats.audioPacketQueueLength--
+              }
+              else if (task.formatContext.streams[avpacket.streamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+                task.stats.videoPacketQueueLength--
               }
-              this.replyAVPacket(task, ipcPort, request, avpacket)
+            }
+            this.replyAVPacket(task, ipcPort, request, avpacket)
+          }
+          else {
+            if (task.demuxEnded) {
+              ipcPort.reply(request, IOError.END)
             }
             else {
-              if (task.demuxEnded) {
-                ipcPort.reply(request, IOError.END)
-              }
-              else {
-                task.cacheRequests.set(ipcPort.streamIndex, request)
-                if (task.loop && task.loop.isStarted()) {
-                  task.loop.resetInterval()
-                }
+              task.cacheRequests.set(ipcPort.streamIndex, request)
+              if (task.loop && task.loop.isStarted()) {
+                task.loop.resetInterval()
               }
             }
-            break
           }
+          break
         }
-      })
-      task.rightIPCPorts.set(streamIndex, ipcPort)
-
-      logger.debug(`connect stream ${streamIndex}, taskId: ${task.taskId}`)
-    }
-    else {
-      logger.fatal('task not found')
-    }
+      }
+    })
+    return ipcPort
   }
 
   public async addPendingStream(taskId: string, streamIndex: number) {
@@ -713,6 +688,7 @@ export default class DemuxPipeline extends Pipeline {
       }
 
       let cache = task.cacheAVPackets.get(oldStreamIndex)
+      const hasPending = task.pendingAVPackets.has(newStreamIndex)
       const ipcPort = task.rightIPCPorts.get(oldStreamIndex)
       const request = task.cacheRequests.get(oldStreamIndex)
 
@@ -734,11 +710,20 @@ export default class DemuxPipeline extends Pipeline {
         task.streamIndexFlush.set(newStreamIndex, true)
       }
 
-      if (task.pendingAVPackets.has(newStreamIndex)) {
+      if (hasPending) {
         task.pendingAVPackets.set(oldStreamIndex, cache)
         cache = task.pendingAVPackets.get(newStreamIndex)
         task.pendingAVPackets.delete(newStreamIndex)
       }
+      else {
+        // 关键帧索引跟随缓存队列转移，有 pending 队列时两个队列的 streamIndex 都没有变
+        const queueIndex = task.queueIndexes.get(oldStreamIndex)
+        task.queueIndexes.delete(newStreamIndex)
+        if (queueIndex) {
+          task.queueIndexes.set(newStreamIndex, queueIndex)
+          task.queueIndexes.delete(oldStreamIndex)
+        }
+      }
       if (task.formatContext.streams[newStreamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
         task.stats.audioPacketQueueLength = cache.length
       }
@@ -754,6 +739,15 @@ export default class DemuxPipeline extends Pipeline {
       task.cacheAVPackets.delete(oldStreamIndex)
       task.rightIPCPorts.delete(oldStreamIndex)
 
+      const ring = task.rings.get(oldStreamIndex)
+      if (ring) {
+        if (force) {
+          this.releaseRing(task, ring)
+        }
+        task.rings.set(newStreamIndex, ring)
+        task.rings.delete(oldStreamIndex)
+      }
+
       if (request) {
         task.cacheRequests.set(newStreamIndex, request)
         task.cacheRequests.delete(oldStreamIndex)
@@ -770,6 +764,119 @@ export default class DemuxPipeline extends Pipeline {
     }
   }
 
+  private hasParamSet(avpacket: pointer<AVPacketRef>) {
+    return !!(avpacket.flags & AVPacketFlags.AV_PKT_FLAG_H26X_PARAM_SET)
+      || getAVPacketSideData(avpacket, AVPacketSideDataType.AV_PKT_DATA_NEW_EXTRADATA) !== nullptr
+  }
+
+  private getQueueIndex(task: SelfTask, streamIndex: number, length: number) {
+    let queueIndex = task.queueIndexes.get(streamIndex)
+    if (!queueIndex) {
+      queueIndex = {
+        pushed: 0,
+        paramSetGeneration: 0,
+        paramSetSeq: -1,
+        keyFrames: []
+      }
+      task.queueIndexes.set(streamIndex, queueIndex)
+    }
+    // 去掉已经出队的关键帧
+    const head = queueIndex.pushed - length
+    while (queueIndex.keyFrames.length && queueIndex.keyFrames[0].seq < head) {
+      queueIndex.keyFrames.shift()
+    }
+    return queueIndex
+  }
+
+  /**
+   * avpacket 入缓存队列，视频关键帧同时记录到关键帧索引中
+   * 
+   * 参数集由解封装时打上的标记判断，裁剪队列时直接查索引
+   */
+  private enqueueAVPacket(task: SelfTask, list: pointer<AVPacketRef>[], streamIndex: number, avpacket: pointer<AVPacketRef>) {
+    const queueIndex = this.getQueueIndex(task, streamIndex, list.length)
+    const seq = queueIndex.pushed++
+    list.push(avpacket)
+
+    if (avpacket <= 0
+      || streamIndex === STREAM_INDEX_ALL
+      || !(avpacket.flags & AVPacketFlags.AV_PKT_FLAG_KEY)
+    ) {
+      return
+    }
+    const codecpar = task.formatContext.streams[avpacket.streamIndex].codecpar
+    if (codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO) {
+      return
+    }
+    // 只有直播会裁剪队列，点播不需要记录参数集
+    if (task.isLive
+      && (codecpar.codecId === AVCodecID.AV_CODEC_ID_H264
+        || codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC
+        || codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC
+      )
+      && this.hasParamSet(avpacket)
+    ) {
+      queueIndex.paramSetGeneration++
+      queueIndex.paramSetSeq = seq
+    }
+    queueIndex.keyFrames.push({
+      seq,
+      dts: avRescaleQ2(avpacket.dts, addressof(avpacket.timeBase), AV_MILLI_TIME_BASE_Q),
+      paramSetGeneration: queueIndex.paramSetGeneration,
+      paramSetSeq: queueIndex.paramSetSeq
+    })
+  }
+
+  private releaseRing(task: SelfTask, ring: pointer<AVRing>) {
+    let avpacket: pointer<AVPacketRef>
+    while (avpacket = reinterpret_cast<pointer<AVPacketRef>>(avring.avringPop(ring))) {
+      task.avpacketPool.release(avpacket)
+    }
+  }
+
+  /**
+   * 将缓存队列头部的 avpacket 转移到共享内存环形队列中
+   * 
+   * @returns 缓存队列是否已全部转移
+   */
+  private pumpRings(task: SelfTask) {
+    let drained = true
+    task.rings.forEach((ring, streamIndex) => {
+      const list = task.cacheAVPackets.get(streamIndex)
+      if (!list) {
+        return
+      }
+      while (list.length) {
+        const avpacket = list[0]
+        if (avpacket < 0) {
+          list.shift()
+          avring.avringEnd(ring)
+          break
+        }
+        if (!avring.avringPush(ring, avpacket)) {
+          break
+        }
+        list.shift()
+        if (task.stats !== nullptr) {
+          const codecType = task.formatContext.streams[avpacket.streamIndex].codecpar.codecType
+          if (codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
+            task.stats.audioPacketQueueLength--
+          }
+          else if (codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+            task.stats.videoPacketQueueLength--
+          }
+        }
+      }
+      if (list.length) {
+        drained = false
+      }
+      else if (task.demuxEnded) {
+        avring.avringEnd(ring)
+      }
+    })
+    return drained
+  }
+
   private async doDemux(task: SelfTask, minQueueLength: int32) {
     const avpacket = task.avpacketPool.alloc()
 
@@ -862,7 +969,7 @@ export default class DemuxPipeline extends Pipeline {
       }
       else {
         if (task.cacheAVPackets.has(streamIndex)) {
-          task.cacheAVPackets.get(streamIndex).push(avpacket)
+          this.enqueueAVPacket(task, task.cacheAVPackets.get(streamIndex), streamIndex, avpacket)
           if (task.stats !== nullptr) {
             if (task.formatContext.streams[streamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
               task.stats.audioPacketQueueLength++
@@ -879,7 +986,7 @@ export default class DemuxPipeline extends Pipeline {
         }
         else if (task.pendingAVPackets.has(streamIndex)) {
           const pending = task.pendingAVPackets.get(streamIndex)
-          pending.push(avpacket)
+          this.enqueueAVPacket(task, pending, streamIndex, avpacket)
           if (task.stats !== nullptr) {
             const type = task.formatContext.streams[streamIndex].codecpar.codecType
             while (pending.length) {
@@ -911,7 +1018,7 @@ export default class DemuxPipeline extends Pipeline {
               task.cacheRequests.delete(STREAM_INDEX_ALL)
             }
             else {
-              task.cacheAVPackets.get(STREAM_INDEX_ALL).push(avpacket)
+              this.enqueueAVPacket(task, task.cacheAVPackets.get(STREAM_INDEX_ALL), STREAM_INDEX_ALL, avpacket)
             }
           }
           else {
@@ -948,8 +1055,8 @@ export default class DemuxPipeline extends Pipeline {
       if ((stream.disposition & AVDisposition.ATTACHED_PIC) && stream.attachedPic) {
         const avpacket = task.avpacketPool.alloc()
         refAVPacket(avpacket, stream.attachedPic)
-        list.push(avpacket)
-        list.push(IOError.END as pointer<AVPacketRef>)
+        this.enqueueAVPacket(task, list, streamIndex, avpacket)
+        this.enqueueAVPacket(task, list, streamIndex, IOError.END as pointer<AVPacketRef>)
         if (task.stats !== nullptr) {
           task.stats.videoPacketQueueLength = 1
         }
@@ -967,6 +1074,19 @@ export default class DemuxPipeline extends Pipeline {
         task.loop.destroy()
       }
       task.loop = new LoopTask(async () => {
+        if (task.rings.size) {
+          const drained = this.pumpRings(task)
+          if (task.demuxEnded) {
+            // 解封装已结束，等待剩余的 avpacket 全部进入 ring
+            if (drained) {
+              task.loop.stop()
+            }
+            else {
+              task.loop.emptyTask()
+            }
+            return
+          }
+        }
         if (!isLive) {
           let canDo = false
           let isMaxQueue = false
@@ -996,7 +1116,12 @@ export default class DemuxPipeline extends Pipeline {
         if (ret) {
           task.demuxEnded = true
           logger.info(`demuxer ended, taskId: ${task.taskId}`)
-          task.loop.stop()
+          if (!task.rings.size) {
+            task.loop.stop()
+          }
+        }
+        if (task.rings.size) {
+          this.pumpRings(task)
         }
       }, 0, 0, true, false)
 
@@ -1023,6 +1148,10 @@ export default class DemuxPipeline extends Pipeline {
 
       this.doAttachedPicture(task)
 
+      if (task.rings.size) {
+        this.pumpRings(task)
+      }
+
       task.loop.start()
 
       logger.debug(`start demux loop, taskId: ${task.taskId}`)
@@ -1056,6 +1185,11 @@ export default class DemuxPipeline extends Pipeline {
           task.cacheAVPackets.forEach(resetList)
           task.pendingAVPackets.forEach(resetList)
 
+          task.rings.forEach((ring) => {
+            this.releaseRing(task, ring)
+            avring.avringRestart(ring)
+          })
+
           if (task.stats !== nullptr) {
             // 判断当前 task 处理的 stream 来重置
             task.cacheAVPackets.forEach((list, streamIndex) => {
@@ -1083,7 +1217,7 @@ export default class DemuxPipeline extends Pipeline {
           if (ret >= 0) {
             task.demuxEnded = false
             const streamIndex = avpacket.streamIndex
-            task.cacheAVPackets.get(streamIndex).push(avpacket)
+            this.enqueueAVPacket(task, task.cacheAVPackets.get(streamIndex), streamIndex, avpacket)
 
             if (task.stats !== nullptr) {
               if (task.formatContext.streams[avpacket.streamIndex].codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
@@ -1094,6 +1228,9 @@ export default class DemuxPipeline extends Pipeline {
               }
             }
             this.doAttachedPicture(task)
+            if (task.rings.size) {
+              this.pumpRings(task)
+            }
             task.loop.start()
             return avRescaleQ2(bigint.max(avpacket.pts, 0n), addressof(avpacket.timeBase), AV_MILLI_TIME_BASE_Q)
           }
@@ -1103,6 +1240,9 @@ export default class DemuxPipeline extends Pipeline {
 
             task.avpacketPool.release(avpacket)
             task.demuxEnded = true
+            task.rings.forEach((ring) => {
+              avring.avringEnd(ring)
+            })
             return timestamp
           }
         }
@@ -1138,25 +1278,6 @@ export default class DemuxPipeline extends Pipeline {
 
       const indexes: Map<number, number> = new Map()
 
-      function hasSps(avpacket: pointer<AVPacketRef>, codecId: AVCodecID) {
-        if (!(avpacket.flags & AVPacketFlags.AV_PKT_FLAG_KEY)) {
-          return false
-        }
-        let hasNewSps = getAVPacketSideData(avpacket, AVPacketSideDataType.AV_PKT_DATA_NEW_EXTRADATA) !== nullptr
-        if (!hasNewSps && (avpacket.flags & AVPacketFlags.AV_PKT_FLAG_H26X_ANNEXB)) {
-          if (codecId === AVCodecID.AV_CODEC_ID_H264) {
-            hasNewSps = !!h264.generateAnnexbExtradata(getAVPacketData(avpacket))
-          }
-          else if (codecId === AVCodecID.AV_CODEC_ID_HEVC) {
-            hasNewSps = !!hevc.generateAnnexbExtradata(getAVPacketData(avpacket))
-          }
-          else if (codecId === AVCodecID.AV_CODEC_ID_VVC) {
-            hasNewSps = !!vvc.generateAnnexbExtradata(getAVPacketData(avpacket))
-          }
-        }
-        return hasNewSps
-      }
-
       const cacheAVPackets: Map<number, pointer<AVPacketRef>[]> = new Map()
       task.cacheAVPackets.forEach((list, streamIndex) => {
         cacheAVPackets.set(streamIndex, list)
@@ -1169,33 +1290,45 @@ export default class DemuxPipeline extends Pipeline {
       cacheAVPackets.forEach((list, streamIndex) => {
         const codecType = task.formatContext.streams[streamIndex].codecpar.codecType
         const codecId = task.formatContext.streams[streamIndex].codecpar.codecId
-        if (codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
-          const lastDts = list[list.length - 1].dts
-          let i = list.length - 2
-          for (i = list.length - 2; i >= 0; i--) {
-            if ((list[i].flags & AVPacketFlags.AV_PKT_FLAG_KEY)) {
-              if (avRescaleQ2(lastDts - list[i].dts, addressof(list[i].timeBase), AV_MILLI_TIME_BASE_Q) >= max) {
-                croppingMax = bigint.max(croppingMax, avRescaleQ2(lastDts - list[i].dts, addressof(list[i].timeBase), AV_MILLI_TIME_BASE_Q))
-                break
-              }
+        if (codecType === AVMediaType.AVMEDIA_TYPE_VIDEO && list.length > 1) {
+          const queueIndex = this.getQueueIndex(task, streamIndex, list.length)
+          const keyFrames = queueIndex.keyFrames
+          const head = queueIndex.pushed - list.length
+          const lastDts = avRescaleQ2(list[list.length - 1].dts, addressof(list[list.length - 1].timeBase), AV_MILLI_TIME_BASE_Q)
+
+          // 二分查找最后一个距离队尾不小于 max 的关键帧（不包括队尾）
+          let low = 0
+          let high = keyFrames.length - 1
+          let found = -1
+          while (low <= high) {
+            const mid = (low + high) >>> 1
+            if (keyFrames[mid].seq - head <= list.length - 2 && lastDts - keyFrames[mid].dts >= max) {
+              found = mid
+              low = mid + 1
             }
+            else {
+              high = mid - 1
+            }
+          }
+          if (found < 0) {
+            return
           }
-          if (codecId === AVCodecID.AV_CODEC_ID_H264
-            || codecId === AVCodecID.AV_CODEC_ID_HEVC
-            || codecId === AVCodecID.AV_CODEC_ID_VVC
+          const entry = keyFrames[found]
+          let i = entry.seq - head
+          croppingMax = bigint.max(croppingMax, lastDts - entry.dts)
+
+          if ((codecId === AVCodecID.AV_CODEC_ID_H264
+              || codecId === AVCodecID.AV_CODEC_ID_HEVC
+              || codecId === AVCodecID.AV_CODEC_ID_VVC
+          )
+            && i > 0
+            && entry.paramSetSeq !== entry.seq
+            && entry.paramSetSeq - head > 0
           ) {
-            if (i > 0 && !hasSps(list[i], codecId)) {
-              for (let j = i - 1; j > 0; j--) {
-                if ((list[j].flags & AVPacketFlags.AV_PKT_FLAG_KEY)) {
-                  // 前面有新的 sps，裁剪到最新的 sps 处
-                  if (hasSps(list[j], codecId)) {
-                    croppingMax = bigint.max(croppingMax, avRescaleQ2(lastDts - list[j].dts, addressof(list[j].timeBase), AV_MILLI_TIME_BASE_Q))
-                    i = j
-                    break
-                  }
-                }
-              }
-            }
+            // 前面有新的参数集，裁剪到最新的参数集处
+            const paramSetEntry = keyFrames.find((keyFrame) => keyFrame.seq === entry.paramSetSeq)
+            croppingMax = bigint.max(croppingMax, lastDts - paramSetEntry.dts)
+            i = entry.paramSetSeq - head
           }
           if (i > 0) {
             indexes.set(streamIndex, i)
@@ -1206,12 +1339,12 @@ export default class DemuxPipeline extends Pipeline {
       // 再处理非视频，裁剪到视频处
       cacheAVPackets.forEach((list, streamIndex) => {
         const codecType = task.formatContext.streams[streamIndex].codecpar.codecType
-        if (codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO) {
-          const lastDts = list[list.length - 1].dts
+        if (codecType !== AVMediaType.AVMEDIA_TYPE_VIDEO && list.length) {
+          // 使用视频的裁剪时间，转换到流的时间基之后直接比较 dts
+          const threshold = list[list.length - 1].dts - avRescaleQ3(croppingMax, AV_MILLI_TIME_BASE_Q, addressof(list[0].timeBase))
           let i = list.length - 2
           for (i = list.length - 2; i >= 0; i--) {
-            // 使用视频的裁剪时间
-            if (avRescaleQ2(lastDts - list[i].dts, addressof(list[i].timeBase), AV_MILLI_TIME_BASE_Q) >= croppingMax) {
+            if (list[i].dts <= threshold) {
               break
             }
           }
@@ -1244,6 +1377,323 @@ export default class DemuxPipeline extends Pipeline {
     }
   }
 
+  /**
+   * 注册流复制转封装
+   * 
+   * 所有输出流都是 copy 时直接在 demux 线程中读包写包，不经过 avpacket 池和线程间通信，
+   * 写出之前和 MuxPipeline 一样按 dts 在流之间交织，
+   * 需要的 bitstream filter 由 OFormat 内部完成
+   * 
+   * @param taskId 
+   * @param options 
+   */
+  public async registerRemux(taskId: string, options: RemuxOptions) {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      if (task.remux) {
+        return errorType.INVALID_OPERATE
+      }
+
+      assert(options.rightPort)
+      const rightIPCPort = new IPCPort(options.rightPort)
+
+      const formatContext = createAVOFormatContext()
+      const ioWriter = new IOWriterSync(5 * 1024 * 1024)
+      ioWriter.onFlush = (data: Uint8Array, pos: int64) => {
+        const buffer = data.slice()
+        rightIPCPort.notify('write', {
+          data: buffer,
+          pos
+        }, [buffer.buffer])
+        return 0
+      }
+      ioWriter.onSeek = (pos) => {
+        rightIPCPort.notify('seek', {
+          pos
+        })
+        return 0
+      }
+      formatContext.ioWriter = ioWriter
+
+      task.remux = {
+        ...options,
+        rightIPCPort,
+        formatContext,
+        avpacketCache: [],
+        queues: [],
+        queuedCount: 0,
+        interleaveStreams: [],
+        streamIndexMap: new Map(),
+        loop: null,
+        ended: false
+      }
+      return 0
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  /**
+   * 添加转封装输出流，stream.index 为对应的输入流 index
+   * 
+   * @param taskId 
+   * @param stream 
+   */
+  public async addRemuxStream(taskId: string, stream: AVStreamInterface) {
+    const task = this.tasks.get(taskId)
+    if (task && task.remux) {
+      const ostream = task.remux.formatContext.createStream()
+      ostream.id = stream.id
+      copyCodecParameters(addressof(ostream.codecpar), stream.codecpar)
+      ostream.timeBase.num = stream.timeBase.num
+      ostream.timeBase.den = stream.timeBase.den
+      ostream.disposition = stream.disposition
+      ostream.metadata = stream.metadata
+      if (stream.attachedPic) {
+        ostream.attachedPic = createAVPacket()
+        refAVPacket(ostream.attachedPic, stream.attachedPic)
+      }
+      if (stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_ATTACHMENT
+        && stream.codecpar.codecType !== AVMediaType.AVMEDIA_TYPE_DATA
+        && !(stream.disposition & AVDisposition.ATTACHED_PIC)
+      ) {
+        task.remux.streamIndexMap.set(stream.index, ostream.index)
+      }
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  public async addRemuxMetadata(taskId: string, metadata: Data) {
+    const task = this.tasks.get(taskId)
+    if (task && task.remux) {
+      object.extend(task.remux.formatContext.metadata, metadata)
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  public async addRemuxChapters(taskId: string, chapters: AVChapter[]) {
+    const task = this.tasks.get(taskId)
+    if (task && task.remux) {
+      task.remux.formatContext.chapters.push(...chapters)
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  private endRemux(task: SelfTask, method: 'end' | 'error') {
+    const remux = task.remux
+    if (method === 'end') {
+      mux.writeTrailer(remux.formatContext)
+      mux.flush(remux.formatContext)
+    }
+    remux.loop.stop()
+    remux.ended = true
+    remux.rightIPCPort.notify(method)
+  }
+
+  /**
+   * 需要等待的流都有包时才能写出，和 MuxPipeline 一样保证输出按 dts 交织
+   */
+  private canWriteRemuxAVPacket(remux: RemuxContext) {
+    if (!remux.queuedCount) {
+      return false
+    }
+    if (remux.queuedCount >= REMUX_MAX_INTERLEAVE_QUEUE) {
+      return true
+    }
+    for (let i = 0; i < remux.interleaveStreams.length; i++) {
+      if (!remux.queues[remux.interleaveStreams[i]].length) {
+        return false
+      }
+    }
+    return true
+  }
+
+  /**
+   * 写出所有流队首中 dts 最小的 avpacket
+   */
+  private writeRemuxAVPacket(task: SelfTask) {
+    const remux = task.remux
+
+    let avpacket: pointer<AVPacket> = nullptr
+    let dts: int64 = NOPTS_VALUE_BIGINT
+    let index = 0
+
+    for (let i = 0; i < remux.queues.length; i++) {
+      if (remux.queues[i]?.length) {
+        const currentDts = avRescaleQ2(remux.queues[i][0].dts, addressof(remux.queues[i][0].timeBase), AV_MILLI_TIME_BASE_Q)
+        if (dts === NOPTS_VALUE_BIGINT || currentDts < dts) {
+          avpacket = remux.queues[i][0]
+          dts = currentDts
+          index = i
+        }
+      }
+    }
+
+    remux.queues[index].shift()
+    remux.queuedCount--
+
+    if (task.stats !== nullptr) {
+      const codecType = remux.formatContext.getStreamByIndex(index).codecpar.codecType
+      if (codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
+        if (!task.stats.audioPacketCount++) {
+          task.stats.firstAudioMuxDts = dts
+        }
+        task.stats.audioPacketBytes += static_cast<int64>(avpacket.size)
+        task.stats.lastAudioMuxDts = dts
+      }
+      else if (codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+        if (!task.stats.videoPacketCount++) {
+          task.stats.firstVideoMuxDts = dts
+        }
+        task.stats.videoPacketBytes += static_cast<int64>(avpacket.size)
+        task.stats.lastVideoMuxDts = dts
+      }
+    }
+
+    const now = remux.formatContext.ioWriter.getPos()
+    const ret = mux.writeAVPacket(remux.formatContext, avpacket)
+    if (task.stats !== nullptr) {
+      task.stats.bufferOutputBytes += remux.formatContext.ioWriter.getPos() - now
+    }
+    unrefAVPacket(avpacket)
+    remux.avpacketCache.push(avpacket)
+
+    if (ret < 0) {
+      logger.error(`remux write error, ret: ${ret}, taskId: ${task.taskId}`)
+    }
+    return ret
+  }
+
+  public async startRemux(taskId: string): Promise<number> {
+    const task = this.tasks.get(taskId)
+    if (task && task.remux) {
+      const remux = task.remux
+
+      if (remux.loop) {
+        logger.error('remux has started')
+        return errorType.INVALID_OPERATE
+      }
+      if (!remux.streamIndexMap.size) {
+        logger.error('remux streams not found')
+        return errorType.INVALID_OPERATE
+      }
+
+      const oformat = await createOFormat(remux.format, remux.formatOptions, remux.isLive)
+      if (!oformat) {
+        return errorType.FORMAT_NOT_SUPPORT
+      }
+      remux.formatContext.oformat = oformat
+
+      let ret = mux.open(remux.formatContext, {
+        nonnegative: remux.format !== AVFormat.ISOBMFF
+          && remux.format !== AVFormat.MATROSKA
+          || (remux.nonnegative ?? false),
+        zeroStart: remux.zeroStart ?? false
+      })
+      if (ret < 0) {
+        logger.error('remux open error')
+        return errorType.FORMAT_NOT_SUPPORT
+      }
+
+      mux.writeHeader(remux.formatContext)
+
+      remux.formatContext.streams.forEach((stream) => {
+        remux.queues[stream.index] = []
+        if ((stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO
+            || stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO
+        )
+          && !(stream.disposition & AVDisposition.ATTACHED_PIC)
+        ) {
+          remux.interleaveStreams.push(stream.index)
+        }
+      })
+
+      remux.loop = new LoopTask(async () => {
+        for (let i = 0; i < REMUX_BATCH_SIZE; i++) {
+          const avpacket = remux.avpacketCache.pop() || createAVPacket()
+          let ret = await demux.readAVPacket(task.formatContext, avpacket)
+          if (ret < 0) {
+            unrefAVPacket(avpacket)
+            remux.avpacketCache.push(avpacket)
+            if (ret === IOError.END) {
+              // 读完之后剩余的包全部按 dts 交织写出
+              while (remux.queuedCount) {
+                if (this.writeRemuxAVPacket(task) < 0) {
+                  this.endRemux(task, 'error')
+                  return
+                }
+              }
+              this.endRemux(task, 'end')
+            }
+            else if (ret !== IOError.ABORT) {
+              logger.error(`remux demux error, ret: ${ret}, taskId: ${task.taskId}`)
+              this.endRemux(task, 'error')
+            }
+            return
+          }
+
+          const streamIndex = remux.streamIndexMap.get(avpacket.streamIndex)
+          if (streamIndex == null) {
+            unrefAVPacket(avpacket)
+            remux.avpacketCache.push(avpacket)
+            continue
+          }
+
+          avpacket.streamIndex = streamIndex
+          remux.queues[streamIndex].push(avpacket)
+          remux.queuedCount++
+
+          while (this.canWriteRemuxAVPacket(remux)) {
+            if (this.writeRemuxAVPacket(task) < 0) {
+              this.endRemux(task, 'error')
+              return
+            }
+          }
+        }
+      }, 0, 0, false, false)
+      remux.loop.start()
+
+      logger.debug(`start remux loop, taskId: ${task.taskId}`)
+
+      return 0
+    }
+    else {
+      logger.error('task not found')
+      return errorType.INVALID_OPERATE
+    }
+  }
+
+  public async pauseRemux(taskId: string) {
+    const task = this.tasks.get(taskId)
+    if (task && task.remux) {
+      if (task.remux.loop) {
+        await task.remux.loop.stopBeforeNextTick()
+      }
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  public async unpauseRemux(taskId: string) {
+    const task = this.tasks.get(taskId)
+    if (task && task.remux) {
+      if (task.remux.loop && !task.remux.loop.isStarted() && !task.remux.ended) {
+        task.remux.loop.start()
+      }
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
   public async setAVStreamDiscard(taskId: string, streamIndex: int32, discard: int32) {
     const task = this.tasks.get(taskId)
     if (task) {
@@ -1261,6 +1711,15 @@ export default class DemuxPipeline extends Pipeline {
     }
   }
 
+  /**
+   * 加载 wasm 的 bitstream filter 实现，线程内所有任务共享，没有加载时使用 ts 实现
+   * 
+   * @param resource 
+   */
+  public async loadBSFKernel(resource: WebAssemblyResource | ArrayBuffer) {
+    return bsfKernel.load(await compileResource(resource))
+  }
+
   public async registerTask(options: DemuxTaskOptions): Promise<number> {
     if (this.tasks.has(options.taskId)) {
       return errorType.INVALID_OPERATE
@@ -1271,6 +1730,8 @@ export default class DemuxPipeline extends Pipeline {
   public async unregisterTask(taskId: string): Promise<void> {
     const task = this.tasks.get(taskId)
     if (task) {
+      // 预读缓冲区由调用方释放，这里之后不再访问
+      task.ioRing = nullptr
       if (task.ioReader && (task.ioReader.flags & IOFlags.NETWORK)) {
         task.ioReader.abort()
       }
@@ -1289,12 +1750,35 @@ export default class DemuxPipeline extends Pipeline {
           task.avpacketPool.release(avpacket)
         })
       })
+      task.rings.forEach((ring) => {
+        this.releaseRing(task, ring)
+        avring.avringEnd(ring)
+      })
+      task.rings.clear()
 
       task.cacheRequests.forEach((request, streamId) => {
         task.rightIPCPorts.get(streamId).reply(request, IOError.END)
       })
       task.cacheRequests.clear()
 
+      if (task.remux) {
+        if (task.remux.loop) {
+          await task.remux.loop.stopBeforeNextTick()
+          task.remux.loop.destroy()
+        }
+        await task.remux.formatContext.destroy()
+        task.remux.queues.forEach((queue) => {
+          queue.forEach((avpacket) => {
+            destroyAVPacket(avpacket)
+          })
+        })
+        task.remux.avpacketCache.forEach((avpacket) => {
+          destroyAVPacket(avpacket)
+        })
+        task.remux.rightIPCPort.destroy()
+        task.remux = null
+      }
+
       await task.formatContext.destroy()
 
       if (!task.mainTaskId) {
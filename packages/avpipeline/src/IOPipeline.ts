@@ -52,9 +52,15 @@ import type HlsIOLoader from '@libmedia/avnetwork/HlsIOLoader'
 import {
   errorType,
   IOType,
-  type AVMediaType
+  type AVMediaType,
+  type AVByteRing,
+  avbytering
 } from '@libmedia/avutil'
 
+import {
+  IOError
+} from '@libmedia/common/io'
+
 
 import type { TaskOptions } from './Pipeline'
 import Pipeline from './Pipeline'
@@ -65,13 +71,26 @@ export interface IOTaskOptions extends TaskOptions {
   options: IOLoaderOptions
   info: Data
   range: Range
+  /**
+   * 预读环形缓冲区，设置之后 open 成功后 IO 线程持续往里面写数据，解封装线程直接从中读取
+   * 
+   * 只支持不需要 ioloaderOptions 的 loader（Fetch、File）
+   */
+  ring?: pointer<AVByteRing>
 }
 
 type SelfTask = IOTaskOptions & {
   ioLoader: IOLoader
   ipcPort: IPCPort
+  fillLoop: Promise<void>
+  fillStopped: boolean
 }
 
+/**
+ * 单次预读的最大字节数
+ */
+const FILL_CHUNK_SIZE = 256 * 1024
+
 export default class IOPipeline extends Pipeline {
 
   declare tasks: Map<string, SelfTask>
@@ -133,10 +152,12 @@ export default class IOPipeline extends Pipeline {
 
     const ipcPort = new IPCPort(options.rightPort)
 
-    const task = {
+    const task: SelfTask = {
       ...options,
       ioLoader,
-      ipcPort
+      ipcPort,
+      fillLoop: null,
+      fillStopped: true
     }
 
     ipcPort.on(REQUEST, async (request: RpcMessage) => {
@@ -149,6 +170,7 @@ export default class IOPipeline extends Pipeline {
               ipcPort.reply(request, null, ret)
               break
             }
+            this.startFill(task)
             ipcPort.reply(request, ret)
           }
           catch (error) {
@@ -212,12 +234,18 @@ export default class IOPipeline extends Pipeline {
           assert(pos >= 0)
 
           try {
+            // 预读的数据在 seek 之后全部作废，先停止预读再 seek
+            await this.stopFill(task)
             const ret = await ioLoader.seek(pos, ioloaderOptions)
             if (ret < 0) {
               logger.error(`loader seek error, ${ret}, taskId: ${options.taskId}`)
               ipcPort.reply(request, null, ret)
               break
             }
+            if (task.ring) {
+              avbytering.avbyteringReset(task.ring)
+              this.startFill(task)
+            }
             ipcPort.reply(request, ret)
           }
           catch (error) {
@@ -239,10 +267,68 @@ export default class IOPipeline extends Pipeline {
     return 0
   }
 
+  /**
+   * 启动预读，IO 线程按环形缓冲区的剩余空间持续读取数据
+   * 
+   * 解封装线程消费数据之后通过 Atomics 唤醒，稳定状态下不需要任何消息往返
+   */
+  private startFill(task: SelfTask) {
+    if (!task.ring || task.fillLoop) {
+      return
+    }
+    task.fillStopped = false
+    task.fillLoop = (async () => {
+      while (!task.fillStopped) {
+        const writable = avbytering.avbyteringWritable(task.ring)
+        if (writable <= 0) {
+          await avbytering.avbyteringWaitSpace(task.ring, 100)
+          continue
+        }
+        const pointer = avbytering.avbyteringWritePointer(task.ring)
+        let len = 0
+        try {
+          len = await task.ioLoader.read(mapSafeUint8Array(pointer, Math.min(writable, FILL_CHUNK_SIZE)))
+        }
+        catch (error) {
+          if (!task.fillStopped) {
+            logger.error(`loader read error, ${error}, taskId: ${task.taskId}`)
+            avbytering.avbyteringEnd(task.ring, errorType.DATA_INVALID)
+          }
+          break
+        }
+        // seek 或者 stop 时正在读取的数据直接丢弃
+        if (task.fillStopped) {
+          break
+        }
+        if (len < 0) {
+          avbytering.avbyteringEnd(task.ring, len)
+          break
+        }
+        else if (len === 0) {
+          avbytering.avbyteringEnd(task.ring, IOError.END)
+          break
+        }
+        task.stats.bufferReceiveBytes += static_cast<int64>(len)
+        avbytering.avbyteringCommit(task.ring, len)
+      }
+    })()
+  }
+
+  private async stopFill(task: SelfTask) {
+    if (!task.fillLoop) {
+      return
+    }
+    task.fillStopped = true
+    avbytering.avbyteringWakeup(task.ring)
+    await task.fillLoop
+    task.fillLoop = null
+  }
+
   public async open(id: string) {
     const task = this.tasks.get(id)
     if (task) {
       await task.ioLoader.open(task.info, task.range)
+      this.startFill(task)
       return 0
     }
   }
@@ -450,9 +536,17 @@ export default class IOPipeline extends Pipeline {
   public async unregisterTask(id: string): Promise<void> {
     const task = this.tasks.get(id)
     if (task) {
+      if (task.fillLoop) {
+        task.fillStopped = true
+        avbytering.avbyteringWakeup(task.ring)
+      }
       await task.ioLoader.stop().catch((error) => {
         logger.warn(`stop ioloader error: ${error}, we will ignore it`)
       })
+      if (task.fillLoop) {
+        await task.fillLoop
+        task.fillLoop = null
+      }
       task.ipcPort.destroy()
       this.tasks.delete(id)
       logger.debug(`unregisterTask task, taskId: ${id}`)
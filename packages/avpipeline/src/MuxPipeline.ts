@@ -24,6 +24,7 @@
  */
 
 import {
+  compileResource,
   errorType,
   type AVPacketPool,
   type AVPacketRef,
@@ -45,7 +46,8 @@ import { AV_MILLI_TIME_BASE_Q } from '@libmedia/avutil/internal'
 
 import {
   type Mutex,
-  type List
+  type List,
+  type WebAssemblyResource
 } from '@libmedia/cheap'
 
 import {
@@ -69,15 +71,19 @@ import {
 
 import {
   mux,
+  bsfKernel,
   createAVOFormatContext,
   type AVChapter,
-  type AVOFormatContext,
-  type OFormat
+  type AVOFormatContext
 } from '@libmedia/avformat'
 
 import type { TaskOptions } from './Pipeline'
 import Pipeline from './Pipeline'
 import type { Data } from '@libmedia/common'
+import type { CmafSegmenterOptions } from './mux/CmafSegmenter'
+import type { OIsobmffFragmentInfo } from '@libmedia/avformat/OIsobmffFormat'
+import CmafSegmenter from './mux/CmafSegmenter'
+import createOFormat from './mux/createOFormat'
 
 const MIN_QUEUE_CACHE = 30
 
@@ -89,6 +95,12 @@ export interface MuxTaskOptions extends TaskOptions {
   avpacketListMutex: pointer<Mutex>
   nonnegative?: boolean
   zeroStart?: boolean
+  /**
+   * CMAF 分片输出（只支持 mp4）
+   * 
+   * 开启后不再输出 write，而是按 chunk 输出 cmafInit、cmafChunk、cmafSegment 和 cmafManifest
+   */
+  cmaf?: CmafSegmenterOptions
 }
 
 type SelfTask = MuxTaskOptions & {
@@ -97,6 +109,7 @@ type SelfTask = MuxTaskOptions & {
   avpacketPool: AVPacketPool
   loop: LoopTask
   ended: boolean
+  segmenter: CmafSegmenter | null
   streams: {
     stream: AVStream
     pullIPC: IPCPort
@@ -122,19 +135,36 @@ export default class MuxPipeline extends Pipeline {
     const formatContext = createAVOFormatContext()
     const ioWriter = new IOWriterSync(5 * 1024 * 1024)
 
-    ioWriter.onFlush = (data: Uint8Array, pos: int64) => {
-      const buffer = data.slice()
-      rightIPCPort.notify('write', {
-        data: buffer,
-        pos
-      }, [buffer.buffer])
-      return 0
-    }
-    ioWriter.onSeek = (pos) => {
-      rightIPCPort.notify('seek', {
-        pos
+    let segmenter: CmafSegmenter | null = null
+
+    if (options.cmaf) {
+      segmenter = new CmafSegmenter(options.cmaf, (method, params, transfer) => {
+        rightIPCPort.notify(method, params, transfer)
       })
-      return 0
+      ioWriter.onFlush = (data: Uint8Array) => {
+        segmenter.write(data.slice())
+        return 0
+      }
+      ioWriter.onSeek = (pos) => {
+        logger.warn(`cmaf output cannot seek to ${pos}, ignore it`)
+        return 0
+      }
+    }
+    else {
+      ioWriter.onFlush = (data: Uint8Array, pos: int64) => {
+        const buffer = data.slice()
+        rightIPCPort.notify('write', {
+          data: buffer,
+          pos
+        }, [buffer.buffer])
+        return 0
+      }
+      ioWriter.onSeek = (pos) => {
+        rightIPCPort.notify('seek', {
+          pos
+        })
+        return 0
+      }
     }
 
     formatContext.ioWriter = ioWriter
@@ -145,6 +175,7 @@ export default class MuxPipeline extends Pipeline {
       formatContext,
       loop: null,
       ended: false,
+      segmenter,
       streams: [],
       avpacketPool: new AVPacketPoolImpl(accessof(options.avpacketList), options.avpacketListMutex)
     })
@@ -156,121 +187,26 @@ export default class MuxPipeline extends Pipeline {
     const task = this.tasks.get(taskId)
     if (task) {
 
-      let oformat: OFormat
-
-      switch (task.format) {
-        case AVFormat.FLV:
-          if (defined(ENABLE_MUXER_FLV)) {
-            oformat = new ((await import('@libmedia/avformat/OFlvFormat')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('flv format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.ISOBMFF:
-          if (defined(ENABLE_MUXER_ISOBMFF) || defined(ENABLE_PROTOCOL_DASH)) {
-            oformat = new ((await import('@libmedia/avformat/OIsobmffFormat')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('mp4 format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MPEGTS:
-          if (defined(ENABLE_MUXER_ISOBMFF) || defined(ENABLE_PROTOCOL_HLS)) {
-            oformat = new ((await import('@libmedia/avformat/OMpegtsFormat')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('mpegts format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.IVF:
-          if (defined(ENABLE_MUXER_IVF)) {
-            oformat = new ((await import('@libmedia/avformat/OIvfFormat')).default)
-          }
-          else {
-            logger.error('ivf format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.OGG:
-          if (defined(ENABLE_MUXER_OGG)) {
-            oformat = new ((await import('@libmedia/avformat/OOggFormat')).default)
-          }
-          else {
-            logger.error('oggs format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MP3:
-          if (defined(ENABLE_MUXER_MP3)) {
-            oformat = new ((await import('@libmedia/avformat/OMp3Format')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('mp3 format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.WAV:
-          if (defined(ENABLE_MUXER_WAV)) {
-            oformat = new ((await import('@libmedia/avformat/OWavFormat')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('wav format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.FLAC:
-          if (defined(ENABLE_MUXER_FLAC)) {
-            oformat = new ((await import('@libmedia/avformat/OFlacFormat')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('flac format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.AAC:
-          if (defined(ENABLE_MUXER_AAC)) {
-            oformat = new ((await import('@libmedia/avformat/OAacFormat')).default)(task.formatOptions)
-          }
-          else {
-            logger.error('aac format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.MATROSKA:
-        case AVFormat.WEBM:
-          if (defined(ENABLE_MUXER_MATROSKA)) {
-            const options = {
-              isLive: task.isLive,
-              docType: task.format === AVFormat.WEBM ? 'webm' : 'matroska'
-            }
-            oformat = new (((await import('@libmedia/avformat/OMatroskaFormat')).default))(object.extend(task.formatOptions, options))
-          }
-          else {
-            logger.error('matroska format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        case AVFormat.H264:
-        case AVFormat.HEVC:
-        case AVFormat.VVC:
-          if (defined(ENABLE_MUXER_H26X)) {
-            oformat = new (((await import('@libmedia/avformat/OH26XFormat')).default))()
-          }
-          else {
-            logger.error('h26x format not support, maybe you can rebuild avmedia')
-            return errorType.FORMAT_NOT_SUPPORT
-          }
-          break
-        default:
-          logger.error('format not support')
+      if (task.segmenter) {
+        if (task.format !== AVFormat.ISOBMFF) {
+          logger.error('cmaf output only support mp4 format')
           return errorType.FORMAT_NOT_SUPPORT
+        }
+        task.formatOptions = object.extend({}, task.formatOptions, {
+          fragment: true,
+          defaultBaseIsMoof: true,
+          hasTfra: false,
+          chunkDuration: task.cmaf.chunkDuration,
+          onFragmentEnd: (info: OIsobmffFragmentInfo) => {
+            task.segmenter.addChunk(info)
+          }
+        })
       }
 
-      assert(oformat)
+      const oformat = await createOFormat(task.format, task.formatOptions, task.isLive)
+      if (!oformat) {
+        return errorType.FORMAT_NOT_SUPPORT
+      }
 
       task.formatContext.oformat = oformat
 
@@ -396,6 +332,11 @@ export default class MuxPipeline extends Pipeline {
 
       mux.writeHeader(task.formatContext)
 
+      if (task.segmenter) {
+        task.segmenter.setStreams(task.formatContext.streams)
+        task.segmenter.init()
+      }
+
       if (!task.streams.length) {
         logger.error('task streams not found')
         return errorType.INVALID_OPERATE
@@ -481,6 +422,9 @@ export default class MuxPipeline extends Pipeline {
         else if (!task.streams.some((s) => !s.ended)) {
           mux.writeTrailer(task.formatContext)
           mux.flush(task.formatContext)
+          if (task.segmenter) {
+            task.segmenter.end()
+          }
           task.rightIPCPort.notify('end')
           task.loop.stop()
           task.ended = true
@@ -520,6 +464,15 @@ export default class MuxPipeline extends Pipeline {
     }
   }
 
+  /**
+   * 加载 wasm 的 bitstream filter 实现，线程内所有任务共享，没有加载时使用 ts 实现
+   * 
+   * @param resource 
+   */
+  public async loadBSFKernel(resource: WebAssemblyResource | ArrayBuffer) {
+    return bsfKernel.load(await compileResource(resource))
+  }
+
   public async registerTask(options: MuxTaskOptions): Promise<number> {
     if (this.tasks.has(options.taskId)) {
       return errorType.INVALID_OPERATE
@@ -0,0 +1,678 @@
+/*
+ * libmedia ProbePipeline
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  errorType,
+  AVFormat,
+  IOFlags,
+  AVMediaType,
+  AVCodecID,
+  AVPacketFlags,
+  AVDisposition,
+  AVChannelOrder,
+  type AVStreamInterface,
+  NOPTS_VALUE,
+  NOPTS_VALUE_BIGINT,
+  avQ2D,
+  avReduce,
+  avRescaleQ,
+  analyzeAVFormat,
+  createAVPacket,
+  destroyAVPacket,
+  unrefAVPacket,
+  isHdr
+} from '@libmedia/avutil'
+
+import {
+  AV_MILLI_TIME_BASE_Q,
+  Ext2Format,
+  Format2AVFormat,
+  mediaType2AVMediaType,
+  disposition2AVDisposition,
+  PixfmtString2AVPixelFormat,
+  SampleFmtString2SampleFormat,
+  layoutName2AVChannelLayout,
+  colorRange2AVColorRange,
+  colorSpace2AVColorSpace,
+  colorPrimaries2AVColorPrimaries,
+  colorTrc2AVColorTransferCharacteristic
+} from '@libmedia/avutil/internal'
+
+import {
+  FetchIOLoader,
+  FileIOLoader,
+  type IOLoader
+} from '@libmedia/avnetwork'
+
+import {
+  is,
+  object,
+  logger,
+  getTimestamp,
+  url as urlUtils
+} from '@libmedia/common'
+
+import {
+  IOError,
+  IOReader
+} from '@libmedia/common/io'
+
+import {
+  demux,
+  dump,
+  dumpUtils,
+  type AVIFormatContext,
+  type AVFormatContextInterface,
+  createAVIFormatContext
+} from '@libmedia/avformat'
+
+import type { TaskOptions } from './Pipeline'
+import Pipeline from './Pipeline'
+import createIFormat from './demux/createIFormat'
+
+import type { Data, HttpOptions } from '@libmedia/common'
+
+export interface ProbeOptions {
+  /**
+   * 指定输入格式，不指定根据文件头和后缀名判断
+   */
+  format?: AVFormat
+  formatOptions?: Data
+  httpOptions?: HttpOptions
+  /**
+   * 最大流分析时长（毫秒），默认 3000
+   */
+  maxProbeDuration?: number
+  /**
+   * 最多读取的字节数（包括 seek 之后的读取），达到之后按文件结束处理，0 不限制
+   */
+  maxReadBytes?: number
+  /**
+   * 统计关键帧间隔需要的每个视频流关键帧数，0 不统计，默认 3
+   */
+  keyFrameCount?: number
+  /**
+   * 统计关键帧间隔最多读取的包数，默认 3000
+   */
+  maxPackets?: number
+  /**
+   * 结果中是否带上 dump 文本，默认 true
+   */
+  dump?: boolean
+  /**
+   * IO 缓冲区大小，默认 256k
+   */
+  bufferLength?: number
+}
+
+export interface ProbeTaskOptions extends TaskOptions, ProbeOptions {
+  /**
+   * 文件或者 http url
+   */
+  source: string | Blob
+}
+
+export interface ProbeStreamInfo {
+  index: number
+  id: number
+  codecType: AVMediaType
+  mediaType: string
+  codecId: AVCodecID
+  codecName: string
+  profile: string
+  disposition: string[]
+  metadata: Data
+  timeBase: {
+    num: number
+    den: number
+  }
+  /**
+   * 毫秒，未知为 -1
+   */
+  duration: number
+  /**
+   * 毫秒，未知为 -1
+   */
+  startTime: number
+  bitrate: number
+  nbFrames: number
+
+  width?: number
+  height?: number
+  /**
+   * 探测不解码，像素格式和颜色信息只有容器或者码流头中声明了才有
+   */
+  pixelFormat?: string
+  colorRange?: string
+  colorSpace?: string
+  colorPrimaries?: string
+  colorTrc?: string
+  hdr?: boolean
+  sampleAspectRatio?: string
+  displayAspectRatio?: string
+  framerate?: number
+  /**
+   * 平均关键帧间隔（毫秒），关键帧不足两个为 0
+   */
+  keyFrameInterval?: number
+  /**
+   * 平均每个 GOP 的帧数，关键帧不足两个为 0
+   */
+  gopSize?: number
+
+  sampleRate?: number
+  channels?: number
+  channelLayout?: string
+  sampleFormat?: string
+}
+
+export interface ProbeResult {
+  format: AVFormat
+  formatName: string
+  metadata: Data
+  /**
+   * 毫秒，未知为 -1
+   */
+  duration: number
+  /**
+   * 毫秒，未知为 -1
+   */
+  startTime: number
+  bitrate: number
+  /**
+   * 文件大小，未知为 0
+   */
+  size: number
+  chapters: {
+    start: number
+    end: number
+    metadata: Data
+  }[]
+  streams: ProbeStreamInfo[]
+  /**
+   * 探测过程实际读取的字节数
+   */
+  readBytes: number
+  /**
+   * 探测耗时（毫秒）
+   */
+  cost: number
+  dump?: string
+}
+
+interface KeyFrameStat {
+  pts: int64[]
+  frames: number[]
+  counter: number
+}
+
+type SelfTask = ProbeTaskOptions & {
+  ioLoader: IOLoader
+  ioReader: IOReader
+  formatContext: AVIFormatContext
+  readBytes: number
+  aborted: boolean
+  running: Promise<ProbeResult | int32>
+}
+
+const DefaultProbeOptions = {
+  maxProbeDuration: 3000,
+  maxReadBytes: 0,
+  keyFrameCount: 3,
+  maxPackets: 3000,
+  dump: true,
+  bufferLength: 256 * 1024
+}
+
+function pickMetadata(metadata: Data) {
+  const result: Data = {}
+  object.each(metadata, (value, key) => {
+    if (!is.object(value) && !is.array(value) && !is.arrayBuffer(value) && !ArrayBuffer.isView(value)) {
+      result[key] = value
+    }
+  })
+  return result
+}
+
+function toMilliseconds(time: int64, timeBase: { num: number, den: number }) {
+  if (time === NOPTS_VALUE_BIGINT) {
+    return -1
+  }
+  return static_cast<double>(avRescaleQ(time, timeBase, AV_MILLI_TIME_BASE_Q))
+}
+
+/**
+ * 无界面的文件探测，只读取文件头和分析流参数需要的最少的包
+ *
+ * 每个任务在当前线程内直接读取 IO，不经过 IO 线程，多个探测线程并行可以按核数线性扩展
+ */
+export default class ProbePipeline extends Pipeline {
+
+  declare tasks: Map<string, SelfTask>
+
+  constructor() {
+    super()
+  }
+
+  private createTask(options: ProbeTaskOptions): number {
+
+    const opts: ProbeTaskOptions = object.extend({}, DefaultProbeOptions, options)
+
+    let ioLoader: IOLoader
+    let ext = ''
+
+    // 探测只读文件头和少量的包，不需要按播放的大小预读
+    if (is.string(opts.source)) {
+      ioLoader = new FetchIOLoader({
+        isLive: false,
+        preload: 1024 * 1024
+      })
+      ext = urlUtils.parse(opts.source).file.split('.').pop()
+    }
+    else {
+      ioLoader = new FileIOLoader({
+        blockSize: opts.bufferLength,
+        concurrency: 1
+      })
+      if ((opts.source as File).name) {
+        ext = (opts.source as File).name.split('.').pop()
+      }
+    }
+
+    if (!is.number(opts.format) && ext) {
+      opts.format = Ext2Format[ext.toLowerCase()]
+    }
+
+    const ioReader = new IOReader(opts.bufferLength)
+    ioReader.flags |= IOFlags.SEEKABLE
+
+    ioReader.onFlush = async (buffer) => {
+      const task = this.tasks.get(opts.taskId)
+      if (!task || task.aborted) {
+        return IOError.END
+      }
+      let len = buffer.length
+      if (task.maxReadBytes > 0) {
+        if (task.readBytes >= task.maxReadBytes) {
+          return IOError.END
+        }
+        len = Math.min(len, task.maxReadBytes - task.readBytes)
+      }
+      const ret = await task.ioLoader.read(len < buffer.length ? buffer.subarray(0, len) : buffer)
+      if (ret > 0) {
+        task.readBytes += ret
+      }
+      return ret
+    }
+
+    ioReader.onSeek = async (pos) => {
+      const task = this.tasks.get(opts.taskId)
+      if (!task || task.aborted) {
+        return IOError.INVALID_OPERATION
+      }
+      return task.ioLoader.seek(pos)
+    }
+
+    ioReader.onSize = async () => {
+      const task = this.tasks.get(opts.taskId)
+      if (!task) {
+        return static_cast<int64>(IOError.INVALID_OPERATION)
+      }
+      return task.ioLoader.size()
+    }
+
+    const formatContext = createAVIFormatContext()
+    formatContext.ioReader = ioReader
+
+    this.tasks.set(opts.taskId, {
+      ...opts,
+      ioLoader,
+      ioReader,
+      formatContext,
+      readBytes: 0,
+      aborted: false,
+      running: null
+    })
+
+    return 0
+  }
+
+  /**
+   * 继续读包统计视频流的关键帧间隔
+   *
+   * 分级分析之后帧率和码率也在读包过程中继续统计
+   */
+  private async analyzeKeyFrames(task: SelfTask) {
+    const stats: Map<int32, KeyFrameStat> = new Map()
+
+    task.formatContext.streams.forEach((stream) => {
+      if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO
+        && !(stream.disposition & AVDisposition.ATTACHED_PIC)
+      ) {
+        stats.set(stream.index, {
+          pts: [],
+          frames: [],
+          counter: 0
+        })
+      }
+    })
+
+    if (!stats.size || task.keyFrameCount <= 0) {
+      return stats
+    }
+
+    const avpacket = createAVPacket()
+    let packets = 0
+
+    while (packets < task.maxPackets && !task.aborted) {
+      const ret = await demux.readAVPacket(task.formatContext, avpacket)
+      if (ret !== 0) {
+        break
+      }
+      packets++
+
+      const stat = stats.get(avpacket.streamIndex)
+      if (stat) {
+        if (avpacket.flags & AVPacketFlags.AV_PKT_FLAG_KEY) {
+          if (stat.pts.length) {
+            stat.frames.push(stat.counter)
+          }
+          stat.pts.push(avpacket.pts !== NOPTS_VALUE_BIGINT ? avpacket.pts : avpacket.dts)
+          stat.counter = 0
+        }
+        stat.counter++
+      }
+      unrefAVPacket(avpacket)
+
+      let done = true
+      stats.forEach((stat) => {
+        if (stat.pts.length < task.keyFrameCount) {
+          done = false
+        }
+      })
+      if (done) {
+        break
+      }
+    }
+
+    destroyAVPacket(avpacket)
+
+    return stats
+  }
+
+  private getStreamInfo(stream: AVStreamInterface, stat: KeyFrameStat) {
+    const codecpar = stream.codecpar
+
+    const disposition: string[] = []
+    object.each(disposition2AVDisposition, (flag, name) => {
+      if (stream.disposition & flag) {
+        disposition.push(name)
+      }
+    })
+
+    const info: ProbeStreamInfo = {
+      index: stream.index,
+      id: stream.id,
+      codecType: codecpar.codecType,
+      mediaType: dumpUtils.dumpKey(mediaType2AVMediaType, codecpar.codecType),
+      codecId: codecpar.codecId,
+      codecName: dumpUtils.dumpCodecName(codecpar.codecType, codecpar.codecId),
+      profile: dumpUtils.dumpProfileName(codecpar.codecId, codecpar.profile) || '',
+      disposition,
+      metadata: pickMetadata(stream.metadata),
+      timeBase: {
+        num: stream.timeBase.num,
+        den: stream.timeBase.den
+      },
+      duration: toMilliseconds(stream.duration, stream.timeBase),
+      startTime: toMilliseconds(stream.startTime, stream.timeBase),
+      bitrate: static_cast<double>(codecpar.bitrate),
+      nbFrames: static_cast<double>(stream.nbFrames)
+    }
+
+    if (codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+      info.width = codecpar.width
+      info.height = codecpar.height
+      if (codecpar.format !== NOPTS_VALUE) {
+        info.pixelFormat = dumpUtils.dumpKey(PixfmtString2AVPixelFormat, codecpar.format)
+        info.colorRange = dumpUtils.dumpKey(colorRange2AVColorRange, codecpar.colorRange, 'tv')
+        info.colorSpace = dumpUtils.dumpKey(colorSpace2AVColorSpace, codecpar.colorSpace)
+        info.colorPrimaries = dumpUtils.dumpKey(colorPrimaries2AVColorPrimaries, codecpar.colorPrimaries)
+        info.colorTrc = dumpUtils.dumpKey(colorTrc2AVColorTransferCharacteristic, codecpar.colorTrc)
+        info.hdr = isHdr(codecpar)
+      }
+      const dar = {
+        num: codecpar.width * codecpar.sampleAspectRatio.num,
+        den: codecpar.height * codecpar.sampleAspectRatio.den
+      }
+      if (dar.num && dar.den) {
+        avReduce(dar)
+        info.displayAspectRatio = `${dar.num}:${dar.den}`
+      }
+      info.sampleAspectRatio = `${codecpar.sampleAspectRatio.num}:${codecpar.sampleAspectRatio.den}`
+      info.framerate = avQ2D(codecpar.framerate) > 0 ? avQ2D(codecpar.framerate) : 0
+
+      info.keyFrameInterval = 0
+      info.gopSize = 0
+      if (stat && stat.pts.length > 1) {
+        const first = stat.pts[0]
+        const last = stat.pts[stat.pts.length - 1]
+        info.keyFrameInterval = toMilliseconds(last - first, stream.timeBase) / (stat.pts.length - 1)
+        info.gopSize = stat.frames.reduce((sum, frames) => sum + frames, 0) / stat.frames.length
+      }
+    }
+    else if (codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
+      info.sampleRate = codecpar.sampleRate
+      info.channels = codecpar.chLayout.nbChannels
+      if (codecpar.chLayout.order === AVChannelOrder.AV_CHANNEL_ORDER_NATIVE) {
+        info.channelLayout = dumpUtils.dumpKey(layoutName2AVChannelLayout, static_cast<double>(codecpar.chLayout.u.mask), '')
+      }
+      info.sampleFormat = dumpUtils.dumpKey(SampleFmtString2SampleFormat, codecpar.format)
+    }
+    return info
+  }
+
+  private async getResult(task: SelfTask, format: AVFormat, stats: Map<int32, KeyFrameStat>, cost: number) {
+    const formatContext = task.formatContext
+
+    const streams: AVStreamInterface[] = formatContext.streams.map((stream) => {
+      return {
+        index: stream.index,
+        id: stream.id,
+        codecpar: addressof(stream.codecpar),
+        nbFrames: stream.nbFrames,
+        metadata: stream.metadata,
+        duration: stream.duration,
+        startTime: stream.startTime,
+        disposition: stream.disposition,
+        timeBase: stream.timeBase,
+        attachedPic: stream.attachedPic
+      }
+    })
+
+    const size = await task.ioReader.fileSize()
+
+    const result: ProbeResult = {
+      format,
+      formatName: dumpUtils.dumpKey(Format2AVFormat, format),
+      metadata: pickMetadata(formatContext.metadata),
+      duration: -1,
+      startTime: -1,
+      bitrate: 0,
+      size: size > 0n ? static_cast<double>(size) : 0,
+      chapters: (formatContext.chapters || []).map((chapter) => {
+        return {
+          start: toMilliseconds(chapter.start, chapter.timeBase),
+          end: toMilliseconds(chapter.end, chapter.timeBase),
+          metadata: pickMetadata(chapter.metadata)
+        }
+      }),
+      streams: streams.map((stream) => this.getStreamInfo(stream, stats.get(stream.index))),
+      readBytes: task.readBytes,
+      cost
+    }
+
+    result.streams.forEach((stream) => {
+      if (stream.duration > result.duration) {
+        result.duration = stream.duration
+      }
+      if (stream.startTime >= 0 && (result.startTime < 0 || stream.startTime < result.startTime)) {
+        result.startTime = stream.startTime
+      }
+      result.bitrate += stream.bitrate
+    })
+    if (!result.bitrate && result.size && result.duration > 0) {
+      result.bitrate = Math.round(result.size * 8000 / result.duration)
+    }
+
+    if (task.dump) {
+      result.dump = dump([{
+        metadata: formatContext.metadata,
+        format,
+        chapters: formatContext.chapters,
+        streams,
+        streamGroups: []
+      } as AVFormatContextInterface], [{
+        from: is.string(task.source) ? task.source : ((task.source as File).name || 'blob'),
+        tag: 'Input'
+      }])
+    }
+
+    return result
+  }
+
+  private async run(task: SelfTask): Promise<ProbeResult | int32> {
+    const start = getTimestamp()
+
+    let ret = await task.ioLoader.open(is.string(task.source)
+      ? {
+        url: task.source,
+        httpOptions: task.httpOptions
+      }
+      : {
+        file: task.source
+      }
+    )
+    if (ret < 0) {
+      logger.error(`open ioloader failed, ret: ${ret}, taskId: ${task.taskId}`)
+      return ret
+    }
+
+    let format: AVFormat
+    try {
+      format = await analyzeAVFormat(task.ioReader, task.format)
+    }
+    catch (error) {
+      return errorType.DATA_INVALID
+    }
+
+    const iformat = await createIFormat(format, task.formatOptions)
+    if (!iformat) {
+      return errorType.FORMAT_NOT_SUPPORT
+    }
+    task.formatContext.iformat = iformat
+
+    ret = await demux.open(task.formatContext, {
+      maxAnalyzeDuration: task.maxProbeDuration,
+      tieredAnalyze: true
+    })
+    if (ret < 0) {
+      logger.error(`open format failed, ret: ${ret}, taskId: ${task.taskId}`)
+      return ret
+    }
+
+    ret = await demux.analyzeStreams(task.formatContext)
+    if (ret) {
+      logger.error(`analyze streams failed, ret: ${ret}, taskId: ${task.taskId}`)
+      return ret
+    }
+
+    const stats = await this.analyzeKeyFrames(task)
+
+    return this.getResult(task, format, stats, getTimestamp() - start)
+  }
+
+  /**
+   * 执行探测
+   *
+   * @param taskId
+   * @returns 成功返回 ProbeResult，失败返回错误码，被中止返回 INVALID_OPERATE
+   */
+  public async probe(taskId: string): Promise<ProbeResult | int32> {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      if (task.running) {
+        return errorType.INVALID_OPERATE
+      }
+      task.running = this.run(task)
+        .then((result) => {
+          return task.aborted ? errorType.INVALID_OPERATE : result
+        })
+        .catch((error) => {
+          logger.error(`probe failed, taskId: ${taskId}, error: ${error}`)
+          return errorType.DATA_INVALID
+        })
+      return task.running
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
+  /**
+   * 中止探测，正在进行的 probe 尽快返回 INVALID_OPERATE
+   *
+   * @param taskId
+   */
+  public async abort(taskId: string): Promise<void> {
+    const task = this.tasks.get(taskId)
+    if (task && !task.aborted) {
+      task.aborted = true
+      await task.ioLoader.stop()
+    }
+  }
+
+  public async registerTask(options: ProbeTaskOptions): Promise<number> {
+    if (this.tasks.has(options.taskId)) {
+      return errorType.INVALID_OPERATE
+    }
+    return this.createTask(options)
+  }
+
+  public async unregisterTask(taskId: string): Promise<void> {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      // 探测还在进行需要等待结束之后再销毁 formatContext
+      task.aborted = true
+      await task.ioLoader.stop()
+      if (task.running) {
+        await task.running
+      }
+      await task.formatContext.destroy()
+      this.tasks.delete(taskId)
+      logger.debug(`unregisterTask task, taskId: ${taskId}`)
+    }
+  }
+}
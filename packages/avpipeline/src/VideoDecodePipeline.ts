@@ -54,7 +54,9 @@ import {
   avRescaleQ2,
   AVCodecID,
   AVPacketSideDataType,
-  AVPacketFlags
+  AVPacketFlags,
+  avring,
+  type AVRing
 } from '@libmedia/avutil'
 
 import {
@@ -113,6 +115,10 @@ export interface VideoDecodeTaskOptions extends TaskOptions {
   preferWebCodecs?: boolean
   preferLatency?: boolean
   keepAlpha?: boolean
+  /**
+   * 与 DemuxPipeline 共享的 avpacket 环形队列，存在时不再通过 ipc 拉取 avpacket
+   */
+  avpacketRing?: pointer<AVRing>
 }
 
 type SelfTask = Omit<VideoDecodeTaskOptions, 'resource'> & {
@@ -145,6 +151,10 @@ type SelfTask = Omit<VideoDecodeTaskOptions, 'resource'> & {
 
   wasmDecoderOptions?: Data
   discard: AVDiscard
+  /**
+   * 低功耗模式的丢弃等级（播放器不可见或者很小时）
+   */
+  lowPowerDiscard: AVDiscard
   playRate: double
 }
 
@@ -237,16 +247,43 @@ export default class VideoDecodePipeline extends Pipeline {
     })
   }
 
+  private async pullAVPacketFromRing(task: SelfTask) {
+    while (true) {
+      const avpacket = reinterpret_cast<pointer<AVPacketRef>>(avring.avringPop(task.avpacketRing))
+      if (avpacket) {
+        return avpacket
+      }
+      if (avring.avringIsEnded(task.avpacketRing) || this.tasks.get(task.taskId) !== task) {
+        return IOError.END as pointer<AVPacketRef>
+      }
+      await avring.avringWait(task.avpacketRing, 100)
+    }
+  }
+
   private async pullAVPacketInternal(task: SelfTask, leftIPCPort: IPCPort) {
-    const result = await leftIPCPort.request<pointer<AVPacketRef> | AVPacketSerialize>('pull')
-    if (is.number(result) || isPointer(result)) {
-      return result as pointer<AVPacketRef>
+    const start = getTimestamp()
+    let avpacket: pointer<AVPacketRef>
+    if (task.avpacketRing) {
+      avpacket = await this.pullAVPacketFromRing(task)
     }
     else {
-      const avpacket = task.avpacketPool.alloc()
-      unserializeAVPacket(result, avpacket)
-      return avpacket
+      const result = await leftIPCPort.request<pointer<AVPacketRef> | AVPacketSerialize>('pull')
+      if (is.number(result) || isPointer(result)) {
+        avpacket = result as pointer<AVPacketRef>
+      }
+      else {
+        avpacket = task.avpacketPool.alloc()
+        unserializeAVPacket(result, avpacket)
+      }
+    }
+    if (task.stats !== nullptr && avpacket > 0) {
+      // 指数滑动平均
+      const cost = getTimestamp() - start
+      task.stats.videoPacketHandoffTime = task.stats.videoPacketHandoffTime
+        ? task.stats.videoPacketHandoffTime * 0.9 + cost * 0.1
+        : cost
     }
+    return avpacket
   }
 
   private async createTask(options: VideoDecodeTaskOptions): Promise<number> {
@@ -278,6 +315,7 @@ export default class VideoDecodePipeline extends Pipeline {
       decoderFallbackReady: null,
       softwareDecoderOpened: false,
       discard: AVDiscard.AVDISCARD_DEFAULT,
+      lowPowerDiscard: AVDiscard.AVDISCARD_DEFAULT,
       playRate: 1,
 
       avframePool,
@@ -380,6 +418,13 @@ export default class VideoDecodePipeline extends Pipeline {
                 }
               }
               else if (avpacket > 0) {
+                // 低功耗模式只解码关键帧
+                if (task.lowPowerDiscard >= AVDiscard.AVDISCARD_NONKEY
+                  && !(avpacket.flags & AVPacketFlags.AV_PKT_FLAG_KEY)
+                ) {
+                  task.avpacketPool.release(avpacket)
+                  continue
+                }
                 if (task.needKeyFrame) {
                   if ((avpacket.flags & AVPacketFlags.AV_PKT_FLAG_KEY)
                       // h264 强制判断 nalu type 某些码流封装层的关键帧标志是错误的 
@@ -810,7 +855,7 @@ export default class VideoDecodePipeline extends Pipeline {
           discard = AVDiscard.AVDISCARD_DEFAULT
         }
       }
-      task.softwareDecoder.setSkipFrameDiscard(discard)
+      task.softwareDecoder.setSkipFrameDiscard(Math.max(discard, task.lowPowerDiscard))
       if (task.playRate < rate) {
         task.discard = discard
       }
@@ -826,7 +871,7 @@ export default class VideoDecodePipeline extends Pipeline {
     if (task && task.softwareDecoder) {
       if (task.discard < AVDiscard.AVDISCARD_NONKEY) {
         task.discard += 8
-        task.softwareDecoder.setSkipFrameDiscard(task.discard)
+        task.softwareDecoder.setSkipFrameDiscard(Math.max(task.discard, task.lowPowerDiscard))
 
         logger.info(`set next discard, taskId: ${task.taskId}, discard: ${task.discard}`)
       }
@@ -838,13 +883,37 @@ export default class VideoDecodePipeline extends Pipeline {
     if (task && task.softwareDecoder) {
       if (task.discard > AVDiscard.AVDISCARD_DEFAULT) {
         task.discard -= 8
-        task.softwareDecoder.setSkipFrameDiscard(task.discard)
+        task.softwareDecoder.setSkipFrameDiscard(Math.max(task.discard, task.lowPowerDiscard))
 
         logger.info(`set prev discard, taskId: ${task.taskId}, discard: ${task.discard}`)
       }
     }
   }
 
+  /**
+   * 设置低功耗模式
+   * 
+   * AVDISCARD_NONKEY 只解码关键帧，退出之后从下一个关键帧开始完整解码
+   * AVDISCARD_NONREF 软解跳过非参考帧
+   * 
+   * @param taskId 
+   * @param discard 
+   */
+  public async setLowPowerDiscard(taskId: string, discard: int32) {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      if (task.lowPowerDiscard >= AVDiscard.AVDISCARD_NONKEY && discard < AVDiscard.AVDISCARD_NONKEY) {
+        // 只解码关键帧期间参考帧不完整，需要等下一个关键帧
+        task.needKeyFrame = true
+      }
+      task.lowPowerDiscard = discard
+      if (task.softwareDecoder) {
+        task.softwareDecoder.setSkipFrameDiscard(Math.max(task.discard, discard))
+      }
+      logger.info(`set low power discard, taskId: ${task.taskId}, discard: ${discard}`)
+    }
+  }
+
   public async resetTask(taskId: string) {
     const task = this.tasks.get(taskId)
     if (task) {
@@ -42,7 +42,14 @@ import {
   type AVRational,
   type AVFrame,
   type AVCodecParameters,
-  type AVCodecID
+  type AVCodecID,
+  type AVPacket,
+  AVPacketSideDataType,
+  getAVPacketSideData,
+  intread,
+  avRescaleQ2,
+  NOPTS_VALUE_BIGINT,
+  AV_MILLI_TIME_BASE_Q
 } from '@libmedia/avutil'
 
 import {
@@ -94,6 +101,30 @@ export interface VideoEncodeTaskOptions extends TaskOptions {
   gop: int32
   preferWebCodecs?: boolean
   copyTs?: boolean
+  /**
+   * 两遍编码的遍数，0 为单遍编码
+   * 
+   * 两遍编码只支持 wasm 编码器
+   */
+  pass?: int32
+  /**
+   * 第二遍编码使用的第一遍统计数据
+   */
+  passStats?: string
+  /**
+   * 场景切换检测阈值（0 - 100），大于 0 时在场景切换处插入关键帧
+   * 
+   * 只对 wasm 编码器生效
+   */
+  sceneCutThreshold?: double
+  /**
+   * 场景切换插入关键帧时距离上一个关键帧的最小帧数
+   */
+  sceneCutMinInterval?: int32
+  /**
+   * 分片时长（毫秒），大于 0 时在每个分片边界强制插入关键帧
+   */
+  segmentDuration?: double
 }
 
 type SelfTask = Omit<VideoEncodeTaskOptions, 'resource'> & {
@@ -122,6 +153,9 @@ type SelfTask = Omit<VideoEncodeTaskOptions, 'resource'> & {
 
   firstEncoded: boolean
   wasmEncoderOptions?: Data
+
+  // 下一个分片边界时间（毫秒）
+  nextSegmentTime: double
 }
 
 export interface VideoEncodeTaskInfo {
@@ -132,6 +166,23 @@ export interface VideoEncodeTaskInfo {
   hardware: boolean
 }
 
+const FF_QP2LAMBDA = 118
+
+function updateEncodeStats(task: SelfTask, avpacket: pointer<AVPacket>) {
+  task.stats.videoPacketEncodeCount++
+  task.stats.videoEncodeFrameSize = avpacket.size
+  task.stats.videoEncodeBytes += static_cast<int64>(avpacket.size)
+  // AV_PKT_DATA_QUALITY_STATS 开头 4 字节是 lambda 形式的质量值
+  const quality = getAVPacketSideData(avpacket, AVPacketSideDataType.AV_PKT_DATA_QUALITY_STATS)
+  if (quality && quality.size >= 4) {
+    const qp = intread.rl32(quality.data) / FF_QP2LAMBDA
+    task.stats.videoEncodeQp = qp
+    task.stats.videoEncodeQpCount++
+    task.stats.videoEncodeAvgQp += (qp - task.stats.videoEncodeAvgQp)
+      / static_cast<double>(task.stats.videoEncodeQpCount)
+  }
+}
+
 export default class VideoEncodePipeline extends Pipeline {
 
   declare tasks: Map<string, SelfTask>
@@ -156,7 +207,7 @@ export default class VideoEncodePipeline extends Pipeline {
       },
       onReceiveAVPacket(avpacket) {
         task.avpacketCaches.push(reinterpret_cast<pointer<AVPacketRef>>(avpacket))
-        task.stats.videoPacketEncodeCount++
+        updateEncodeStats(task, avpacket)
       },
       enableHardwareAcceleration,
       avpacketPool: task.avpacketPool,
@@ -166,15 +217,19 @@ export default class VideoEncodePipeline extends Pipeline {
   }
 
   private createWasmcodecEncoder(task: SelfTask, resource: WebAssemblyResource) {
-    return new WasmVideoEncoder({
+    const encoder = new WasmVideoEncoder({
       resource: task.resource,
       onReceiveAVPacket(avpacket) {
         task.avpacketCaches.push(reinterpret_cast<pointer<AVPacketRef>>(avpacket))
-        task.stats.videoPacketEncodeCount++
+        updateEncodeStats(task, avpacket)
       },
       avpacketPool: task.avpacketPool,
       copyTs: task.copyTs ?? false
     })
+    if (task.pass) {
+      encoder.setPass(task.pass, task.passStats)
+    }
+    return encoder
   }
 
   private async createTask(options: VideoEncodeTaskOptions): Promise<number> {
@@ -212,6 +267,7 @@ export default class VideoEncodePipeline extends Pipeline {
       softwareEncoderOpened: false,
       gopCounter: 0,
       firstEncoded: false,
+      nextSegmentTime: null,
 
       avframePool,
       avpacketPool
@@ -226,7 +282,12 @@ export default class VideoEncodePipeline extends Pipeline {
       return errorType.INVALID_OPERATE
     }
 
-    if (support.videoEncoder && options.enableHardware) {
+    if (options.pass && !(task.softwareEncoder instanceof WasmVideoEncoder)) {
+      logger.warn(`two-pass encoding need wasm encoder, encode with single pass, taskId: ${options.taskId}`)
+    }
+
+    // 两遍编码需要 wasm 编码器的统计数据，不使用硬件编码
+    if (support.videoEncoder && options.enableHardware && !options.pass) {
       task.hardwareEncoder = this.createWebcodecEncoder(task)
     }
 
@@ -306,15 +367,16 @@ export default class VideoEncodePipeline extends Pipeline {
               let avframe = await pullAVFrame()
               if (task.targetEncoder instanceof WasmVideoEncoder && avframe instanceof VideoFrame) {
                 const frame = task.avframePool.alloc()
-                await videoFrame2AVFrame(avframe, frame)
+                await videoFrame2AVFrame(avframe, frame, task.avframePool)
                 avframe.close()
                 avframe = frame
               }
 
               if (isPointer(avframe) || avframe instanceof VideoFrame) {
+                const key = this.isKeyFrame(task, avframe)
                 let ret = (!task.firstEncoded && task.targetEncoder instanceof WasmVideoEncoder)
-                  ? await task.targetEncoder.encodeAsync(avframe as pointer<AVFrame>, task.gopCounter === 0)
-                  : task.targetEncoder.encode(avframe as pointer<AVFrame>, task.gopCounter === 0)
+                  ? await task.targetEncoder.encodeAsync(avframe as pointer<AVFrame>, key)
+                  : task.targetEncoder.encode(avframe as pointer<AVFrame>, key)
                 if (ret < 0) {
                   task.stats.videoEncodeErrorFrameCount++
                   if (task.targetEncoder instanceof WebVideoEncoder && task.softwareEncoder) {
@@ -472,6 +534,57 @@ export default class VideoEncodePipeline extends Pipeline {
     return 0
   }
 
+  /**
+   * 判断当前帧是否编码为关键帧
+   * 
+   * 除了固定 gop 之外在分片边界和场景切换处强制插入关键帧，并从该帧开始重新计算 gop
+   */
+  private isKeyFrame(task: SelfTask, avframe: pointer<AVFrame> | VideoFrame) {
+    let key = task.gopCounter === 0
+
+    if (task.segmentDuration > 0) {
+      let time: double = null
+      if (avframe instanceof VideoFrame) {
+        time = avframe.timestamp / 1000
+      }
+      else if (avframe.pts !== NOPTS_VALUE_BIGINT && avframe.timeBase.den) {
+        time = static_cast<double>(avRescaleQ2(avframe.pts, addressof(avframe.timeBase), AV_MILLI_TIME_BASE_Q))
+      }
+      if (time !== null) {
+        if (task.nextSegmentTime === null) {
+          task.nextSegmentTime = time + task.segmentDuration
+          key = true
+        }
+        else if (time >= task.nextSegmentTime) {
+          while (task.nextSegmentTime <= time) {
+            task.nextSegmentTime += task.segmentDuration
+          }
+          key = true
+        }
+      }
+    }
+
+    // 每一帧都要计算分数，保证和相邻的上一帧比较
+    if (task.sceneCutThreshold > 0
+      && task.targetEncoder instanceof WasmVideoEncoder
+      && isPointer(avframe)
+    ) {
+      const score = task.targetEncoder.getSceneScore(avframe)
+      if (!key
+        && score >= task.sceneCutThreshold
+        && task.gopCounter >= (task.sceneCutMinInterval ?? 0)
+      ) {
+        key = true
+        task.stats.videoSceneCutCount++
+      }
+    }
+
+    if (key) {
+      task.gopCounter = 0
+    }
+    return key
+  }
+
   private async openSoftwareEncoder(task: SelfTask) {
     if (task.softwareEncoder && !task.softwareEncoderOpened) {
       const parameters = task.parameters
@@ -512,6 +625,7 @@ export default class VideoEncodePipeline extends Pipeline {
       task.wasmEncoderOptions = wasmEncoderOptions
 
       if (task.preferWebCodecs
+        && !task.pass
         && support.videoEncoder
         && WebVideoEncoder.isSupported(codecpar, false)
         && task.softwareEncoder instanceof WasmVideoEncoder
@@ -573,6 +687,10 @@ export default class VideoEncodePipeline extends Pipeline {
       task.avpacketCaches.length = 0
       task.inputEnd = false
       task.encodeEnd = false
+      task.nextSegmentTime = null
+      if (task.targetEncoder instanceof WasmVideoEncoder) {
+        task.targetEncoder.resetSceneDetect()
+      }
 
       logger.info(`reset video encode, taskId: ${task.taskId}`)
     }
@@ -586,6 +704,20 @@ export default class VideoEncodePipeline extends Pipeline {
     logger.fatal('task not found')
   }
 
+  /**
+   * 获取第一遍编码的统计数据，需要在编码结束之后 unregisterTask 之前调用
+   * 
+   * @param taskId 
+   * @returns 
+   */
+  public async getPassStats(taskId: string) {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      return task.targetEncoder instanceof WasmVideoEncoder ? task.targetEncoder.getPassStats() : ''
+    }
+    logger.fatal('task not found')
+  }
+
   public async getColorSpace(taskId: string) {
     const task = this.tasks.get(taskId)
     if (task) {
@@ -615,6 +747,7 @@ export default class VideoEncodePipeline extends Pipeline {
       array.each(task.avpacketCaches, (avpacket) => {
         task.avpacketPool.release(avpacket)
       })
+      task.avframePool.clearVideoBufferPool()
       this.tasks.delete(taskId)
     }
   }
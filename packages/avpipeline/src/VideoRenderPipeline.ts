@@ -36,7 +36,8 @@ import {
   type AVFrame,
   NOPTS_VALUE_BIGINT,
   avRescaleQ,
-  avRescaleQ2
+  avRescaleQ2,
+  compileResource
 } from '@libmedia/avutil'
 
 import { AV_MILLI_TIME_BASE_Q, AV_TIME_BASE_Q } from '@libmedia/avutil/internal'
@@ -44,7 +45,8 @@ import { AV_MILLI_TIME_BASE_Q, AV_TIME_BASE_Q } from '@libmedia/avutil/internal'
 import {
   isPointer,
   type Mutex,
-  type List
+  type List,
+  type WebAssemblyResource
 } from '@libmedia/cheap'
 
 import {
@@ -78,7 +80,8 @@ import {
   WebGLDefault16Render,
   WebGPUDefault8Render,
   WebGPUDefault16Render,
-  WritableStreamRender
+  WritableStreamRender,
+  yuv2rgbaKernel
 } from '@libmedia/avrender'
 
 import type { TaskOptions } from './Pipeline'
@@ -156,6 +159,8 @@ type SelfTask = VideoRenderTaskOptions & {
   render: ImageRender
   renderRedyed: boolean
   renderRecreateCount: number
+  // webgl 不可用时使用 wasm 转换 yuv 后 canvas 2d 渲染
+  softwareRender: boolean
 
   adjust: AdjustStatus
   adjustDiff: int64
@@ -224,6 +229,7 @@ export default class VideoRenderPipeline extends Pipeline {
       canvasUpdated: false,
       renderCreating: false,
       renderRecreateCount: 0,
+      softwareRender: false,
 
       skipRender: false,
 
@@ -424,6 +430,7 @@ export default class VideoRenderPipeline extends Pipeline {
           && task.enableWebGPU
           && support.webgpu
           && !disableWebGPU
+          && !task.softwareRender
         ) {
           array.each(WebGPURenderList, (RenderFactory) => {
             if (RenderFactory.isSupport(frame)) {
@@ -443,7 +450,7 @@ export default class VideoRenderPipeline extends Pipeline {
             }
           })
         }
-        if (!task.render) {
+        if (!task.render && !task.softwareRender) {
           array.each(WebGLRenderList, (RenderFactory) => {
             if (RenderFactory.isSupport(frame)) {
               task.render = new RenderFactory(task.canvas as OffscreenCanvas, {
@@ -462,6 +469,15 @@ export default class VideoRenderPipeline extends Pipeline {
             }
           })
         }
+        if (!task.render && CanvasImageRender.isSupport(frame)) {
+          task.render = new CanvasImageRender(task.canvas as OffscreenCanvas, {
+            sar: task.sar,
+            devicePixelRatio: task.devicePixelRatio,
+            renderMode: task.renderMode
+          })
+          task.isSupport = CanvasImageRender.isSupport
+          task.softwareRender = true
+        }
       }
     }
     if (!task.render) {
@@ -480,6 +496,16 @@ export default class VideoRenderPipeline extends Pipeline {
       task.render.clear()
     }
     catch (error) {
+      if (isPointer(frame)
+        && !task.softwareRender
+        && !(defined(ENABLE_WEBGPU) && task.render instanceof WebGPURender && !fallback)
+        && CanvasImageRender.isSupport(frame)
+      ) {
+        task.softwareRender = true
+        task.renderCreating = false
+        logger.warn('not support webgl render, try to fallback to canvas render')
+        return this.createRender(task, frame, true)
+      }
       if (defined(ENABLE_WEBGPU)) {
         if (task.render instanceof WebGPURender && !fallback) {
           disableWebGPU = true
@@ -836,6 +862,24 @@ export default class VideoRenderPipeline extends Pipeline {
     }
   }
 
+  /**
+   * 替换上游（解码任务）端口，需要在 beforeSeek 之后调用，保证没有正在进行的 pull
+   *
+   * @param taskId
+   * @param port
+   */
+  public async updateLeftPort(taskId: string, port: MessagePort) {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      task.leftIPCPort.destroy()
+      task.leftPort = port
+      task.leftIPCPort = new IPCPort(port)
+    }
+    else {
+      logger.fatal('task not found')
+    }
+  }
+
   public async setPlayRate(taskId: string, rate: double) {
     const task = this.tasks.get(taskId)
     if (task) {
@@ -1177,6 +1221,17 @@ export default class VideoRenderPipeline extends Pipeline {
     }
   }
 
+  /**
+   * 加载 wasm 的 yuv 转 rgba 实现，线程内所有任务共享
+   * 
+   * 加载之后 webgl 和 webgpu 都不可用时使用 canvas 2d 渲染 AVFrame
+   * 
+   * @param resource 
+   */
+  public async loadYUVKernel(resource: WebAssemblyResource | ArrayBuffer) {
+    return yuv2rgbaKernel.load(await compileResource(resource))
+  }
+
   public async registerTask(options: VideoRenderTaskOptions): Promise<number> {
     if (this.tasks.has(options.taskId)) {
       return errorType.INVALID_OPERATE
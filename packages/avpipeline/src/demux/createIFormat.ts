@@ -0,0 +1,218 @@
+/*
+ * libmedia createIFormat
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  AVFormat
+} from '@libmedia/avutil'
+
+import {
+  logger
+} from '@libmedia/common'
+
+import type { Data } from '@libmedia/common'
+import type { IFormat } from '@libmedia/avformat'
+
+import type { IRtspFormatOptions } from '@libmedia/avformat/IRtspFormat'
+import type { IFlvFormatOptions } from '@libmedia/avformat/IFlvFormat'
+import type { IIsobmffFormatOptions } from '@libmedia/avformat/IIsobmffFormat'
+import type { IH264FormatOptions } from '@libmedia/avformat/IH264Format'
+import type { IHevcFormatOptions } from '@libmedia/avformat/IHevcFormat'
+import type { IVvcFormatOptions } from '@libmedia/avformat/IVvcFormat'
+import type { IAviFormatOptions } from '@libmedia/avformat/IAviFormat'
+
+/**
+ * 根据输入格式创建 IFormat，格式不支持返回 null
+ * 
+ * @param format 
+ * @param formatOptions 
+ */
+export default async function createIFormat(format: AVFormat, formatOptions: Data): Promise<IFormat> {
+  switch (format) {
+    case AVFormat.FLV:
+      if (defined(ENABLE_DEMUXER_FLV)) {
+        return new ((await import('@libmedia/avformat/IFlvFormat')).default)(formatOptions as IFlvFormatOptions)
+      }
+      else {
+        logger.error('flv format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.ISOBMFF:
+      if (defined(ENABLE_DEMUXER_ISOBMFF) || defined(ENABLE_PROTOCOL_DASH)) {
+        return new ((await import('@libmedia/avformat/IIsobmffFormat')).default)(formatOptions as IIsobmffFormatOptions)
+      }
+      else {
+        logger.error('mp4 format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MPEGTS:
+      if (defined(ENABLE_DEMUXER_MPEGPS) || defined(ENABLE_PROTOCOL_HLS)) {
+        return new ((await import('@libmedia/avformat/IMpegtsFormat')).default)
+      }
+      else {
+        logger.error('mpegts format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MPEGPS:
+      if (defined(ENABLE_DEMUXER_MPEGPS)) {
+        return new ((await import('@libmedia/avformat/IMpegpsFormat')).default)
+      }
+      else {
+        logger.error('mpegps format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.IVF:
+      if (defined(ENABLE_DEMUXER_IVF)) {
+        return new ((await import('@libmedia/avformat/IIvfFormat')).default)
+      }
+      else {
+        logger.error('ivf format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.OGG:
+      if (defined(ENABLE_DEMUXER_OGG)) {
+        return new ((await import('@libmedia/avformat/IOggFormat')).default)
+      }
+      else {
+        logger.error('oggs format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MP3:
+      if (defined(ENABLE_DEMUXER_MP3)) {
+        return new ((await import('@libmedia/avformat/IMp3Format')).default)
+      }
+      else {
+        logger.error('mp3 format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MATROSKA:
+    case AVFormat.WEBM:
+      if (defined(ENABLE_DEMUXER_MATROSKA)) {
+        return new (((await import('@libmedia/avformat/IMatroskaFormat')).default))
+      }
+      else {
+        logger.error('matroska format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.AAC:
+      if (defined(ENABLE_DEMUXER_AAC)) {
+        return new (((await import('@libmedia/avformat/IAacFormat')).default))
+      }
+      else {
+        logger.error('aac format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.FLAC:
+      if (defined(ENABLE_DEMUXER_FLAC)) {
+        return new (((await import('@libmedia/avformat/IFlacFormat')).default))
+      }
+      else {
+        logger.error('flac format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.WAV:
+      if (defined(ENABLE_DEMUXER_WAV)) {
+        return new (((await import('@libmedia/avformat/IWavFormat')).default))
+      }
+      else {
+        logger.error('wav format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.WEBVTT:
+      if (defined(ENABLE_DEMUXER_WEBVTT)) {
+        return new (((await import('@libmedia/avformat/IWebVttFormat')).default))
+      }
+      else {
+        logger.error('webvtt format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.SUBRIP:
+      if (defined(ENABLE_DEMUXER_SUBRIP)) {
+        return new (((await import('@libmedia/avformat/ISubRipFormat')).default))
+      }
+      else {
+        logger.error('subrip format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.ASS:
+      if (defined(ENABLE_DEMUXER_ASS)) {
+        return new (((await import('@libmedia/avformat/IAssFormat')).default))
+      }
+      else {
+        logger.error('ass format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.TTML:
+      if (defined(ENABLE_DEMUXER_TTML)) {
+        return new (((await import('@libmedia/avformat/ITtmlFormat')).default))
+      }
+      else {
+        logger.error('ttml format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.H264:
+      if (defined(ENABLE_DEMUXER_H264)) {
+        return new (((await import('@libmedia/avformat/IH264Format')).default))(formatOptions as IH264FormatOptions)
+      }
+      else {
+        logger.error('h264 format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.HEVC:
+      if (defined(ENABLE_DEMUXER_HEVC)) {
+        return new (((await import('@libmedia/avformat/IHevcFormat')).default))(formatOptions as IHevcFormatOptions)
+      }
+      else {
+        logger.error('hevc format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.VVC:
+      if (defined(ENABLE_DEMUXER_VVC)) {
+        return new (((await import('@libmedia/avformat/IVvcFormat')).default))(formatOptions as IVvcFormatOptions)
+      }
+      else {
+        logger.error('vvc format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.RTSP:
+      if (defined(ENABLE_PROTOCOL_RTSP)) {
+        return new (((await import('@libmedia/avformat/IRtspFormat')).default))(formatOptions as IRtspFormatOptions)
+      }
+      else {
+        logger.error('vvc format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.AVI:
+      if (defined(ENABLE_DEMUXER_AVI)) {
+        return new (((await import('@libmedia/avformat/IAviFormat')).default))(formatOptions as IAviFormatOptions)
+      }
+      else {
+        logger.error('avi format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    default:
+      logger.error('format not support')
+      return null
+  }
+}
@@ -28,11 +28,26 @@ export {
   default as MuxPipeline
 } from './MuxPipeline'
 
+export {
+  type CmafSegmenterOptions,
+  type CmafChunk,
+  type CmafManifest,
+  default as CmafSegmenter
+} from './mux/CmafSegmenter'
+
 export {
   type TaskOptions,
   default as Pipeline
 } from './Pipeline'
 
+export {
+  type ProbeOptions,
+  type ProbeTaskOptions,
+  type ProbeStreamInfo,
+  type ProbeResult,
+  default as ProbePipeline
+} from './ProbePipeline'
+
 export {
   type VideoDecodeTaskInfo,
   type VideoDecodeTaskOptions,
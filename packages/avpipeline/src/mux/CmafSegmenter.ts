@@ -0,0 +1,497 @@
+/*
+ * libmedia CMAF segmenter
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  type AVStream,
+  AVMediaType,
+  getAudioCodec,
+  getVideoCodec
+} from '@libmedia/avutil'
+
+import {
+  concatTypeArray,
+  getTimestamp
+} from '@libmedia/common'
+
+import {
+  MediaPlaylist,
+  MediaInitializationSection,
+  Segment,
+  PartialSegment
+} from '@libmedia/avprotocol/m3u8/types'
+
+import { stringifyMediaPlaylist } from '@libmedia/avprotocol/m3u8/writer'
+import { stringifyMPD, toDuration } from '@libmedia/avprotocol/dash/writer'
+import type { MPD } from '@libmedia/avprotocol/dash/type'
+
+import type { OIsobmffFragmentInfo } from '@libmedia/avformat/OIsobmffFormat'
+
+// 只保留最近几个分片的 part 信息
+const PART_SEGMENT_COUNT = 3
+
+export interface CmafSegmenterOptions {
+  /**
+   * 分片目标时长（毫秒），在关键帧处切分
+   */
+  segmentDuration: number
+  /**
+   * chunk 时长（毫秒），每个 chunk 完成后立即输出
+   */
+  chunkDuration: number
+  /**
+   * 是否是直播，直播输出 dynamic 的 MPD 和不带 ENDLIST 的 m3u8
+   */
+  live?: boolean
+  /**
+   * 播放列表保留的分片数量，0 为全部保留
+   */
+  listSize?: number
+  /**
+   * init 分片名
+   */
+  initName?: string
+  /**
+   * 分片名，$Number$ 替换为分片序号
+   */
+  segmentName?: string
+  /**
+   * chunk 名，$Number$ 替换为分片序号，$Part$ 替换为 chunk 序号
+   */
+  partName?: string
+  /**
+   * 是否生成 m3u8
+   */
+  hls?: boolean
+  /**
+   * 是否生成 MPD
+   */
+  dash?: boolean
+}
+
+export interface CmafManifest {
+  m3u8?: string
+  mpd?: string
+}
+
+export interface CmafChunk {
+  data: Uint8Array<ArrayBuffer>
+  /**
+   * 所属分片序号
+   */
+  segment: number
+  /**
+   * 在分片中的序号
+   */
+  part: number
+  /**
+   * 开始时间（毫秒）
+   */
+  startTime: number
+  /**
+   * 时长（毫秒）
+   */
+  duration: number
+  /**
+   * 是否从关键帧开始
+   */
+  independent: boolean
+  /**
+   * 播放列表有变化时才有值
+   * 
+   * 直播每个 chunk 更新 m3u8（LL-HLS 的 part），MPD 和点播的 m3u8 只在分片完成时更新
+   */
+  manifest?: CmafManifest
+}
+
+interface SegmentInfo {
+  number: number
+  startTime: number
+  duration: number
+  size: number
+  hls: Segment
+}
+
+const defaultOptions: Partial<CmafSegmenterOptions> = {
+  live: false,
+  listSize: 0,
+  initName: 'init.mp4',
+  segmentName: 'segment-$Number$.m4s',
+  partName: 'segment-$Number$.$Part$.m4s',
+  hls: true,
+  dash: true
+}
+
+/**
+ * 把 fragment mp4 的输出切成 CMAF 分片和 chunk，并增量更新 m3u8 和 MPD
+ * 
+ * 每个 fragment（chunk）写完立即通过 notify 输出，不需要等整个分片完成
+ */
+export default class CmafSegmenter {
+
+  private options: CmafSegmenterOptions
+
+  private notify: (method: string, params: any, transfer?: Transferable[]) => void
+
+  private buffers: Uint8Array[]
+
+  private segments: SegmentInfo[]
+
+  private current: SegmentInfo | null
+
+  private nextNumber: number
+
+  private playlist: MediaPlaylist
+
+  private map: MediaInitializationSection
+
+  private ended: boolean
+
+  private availabilityStartTime: number
+
+  private totalSize: number
+  private totalDuration: number
+  private maxSegmentDuration: number
+
+  /**
+   * 最近一次生成的播放列表
+   */
+  private manifest: CmafManifest
+
+  private contentType: 'video' | 'audio'
+  private codecs: string
+  private bitrate: number
+  private width: number
+  private height: number
+  private sampleRate: number
+
+  constructor(options: CmafSegmenterOptions, notify: (method: string, params: any, transfer?: Transferable[]) => void) {
+    this.options = {
+      ...defaultOptions,
+      ...options
+    }
+    this.notify = notify
+
+    this.buffers = []
+    this.segments = []
+    this.current = null
+    this.nextNumber = 1
+    this.ended = false
+    this.totalSize = 0
+    this.totalDuration = 0
+    this.maxSegmentDuration = 0
+    this.manifest = {}
+
+    this.map = new MediaInitializationSection({
+      uri: this.options.initName
+    })
+
+    this.playlist = new MediaPlaylist({
+      version: 9,
+      targetDuration: this.options.segmentDuration / 1000,
+      mediaSequenceBase: this.nextNumber,
+      independentSegments: true,
+      partTargetDuration: this.options.live ? this.options.chunkDuration / 1000 : undefined,
+      lowLatencyCompatibility: this.options.live
+        ? {
+          canBlockReload: true,
+          canSkipUntil: 0,
+          holdBack: 0,
+          partHoldBack: this.options.chunkDuration * 3 / 1000
+        }
+        : undefined,
+      playlistType: this.options.live ? undefined : 'EVENT'
+    })
+  }
+
+  private getName(template: string, number: number, part?: number) {
+    return template.replace(/\$Number\$/g, `${number}`).replace(/\$Part\$/g, `${part}`)
+  }
+
+  private takeBuffer() {
+    const data = concatTypeArray(Uint8Array, this.buffers) as Uint8Array<ArrayBuffer>
+    this.buffers = []
+    return data
+  }
+
+  /**
+   * 写入封装器输出的数据
+   */
+  public write(data: Uint8Array) {
+    this.buffers.push(data)
+  }
+
+  public setStreams(streams: AVStream[]) {
+    const codecs: string[] = []
+    this.contentType = 'audio'
+    this.bitrate = 0
+    streams.forEach((stream) => {
+      if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+        this.contentType = 'video'
+        this.width = stream.codecpar.width
+        this.height = stream.codecpar.height
+        codecs.push(getVideoCodec(addressof(stream.codecpar)))
+      }
+      else if (stream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
+        this.sampleRate = stream.codecpar.sampleRate
+        codecs.push(getAudioCodec(addressof(stream.codecpar)))
+      }
+      this.bitrate += static_cast<double>(stream.codecpar.bitrate)
+    })
+    this.codecs = codecs.join(',')
+  }
+
+  /**
+   * 输出 init 分片（ftyp + moov）
+   */
+  public init() {
+    const data = this.takeBuffer()
+    this.availabilityStartTime = getTimestamp()
+    this.notify('cmafInit', {
+      data
+    }, [data.buffer])
+  }
+
+  /**
+   * 一个 fragment 写完，作为 chunk 输出
+   */
+  public addChunk(info: OIsobmffFragmentInfo) {
+    const data = this.takeBuffer()
+
+    let segmentChanged = false
+
+    if (!this.current
+      || info.independent
+        && this.current.duration >= this.options.segmentDuration - this.options.chunkDuration / 2
+    ) {
+      if (this.current) {
+        this.finishSegment()
+        segmentChanged = true
+      }
+      this.startSegment(info.startTime)
+    }
+
+    const current = this.current
+    this.removeHint(current)
+    const part = current.hls.parts.length
+
+    current.hls.parts.push(new PartialSegment({
+      hint: false,
+      uri: this.getName(this.options.partName, current.number, part),
+      duration: info.duration / 1000,
+      independent: info.independent
+    }))
+    current.duration += info.duration
+    current.size += data.length
+
+    if (this.options.live) {
+      // 预告下一个 part，播放器可以提前发起阻塞请求
+      current.hls.parts.push(new PartialSegment({
+        hint: true,
+        uri: this.getName(this.options.partName, current.number, part + 1)
+      }))
+    }
+
+    const chunk: CmafChunk = {
+      data,
+      segment: current.number,
+      part,
+      startTime: info.startTime,
+      duration: info.duration,
+      independent: info.independent
+    }
+    // 直播每个 part 都要更新 m3u8，其他情况只在分片边界更新
+    if (this.options.live && this.options.hls || segmentChanged) {
+      chunk.manifest = this.updateManifest(segmentChanged)
+    }
+    this.notify('cmafChunk', chunk, [data.buffer])
+  }
+
+  private removeHint(segment: SegmentInfo) {
+    const parts = segment.hls.parts
+    if (parts.length && parts[parts.length - 1].hint) {
+      parts.pop()
+    }
+  }
+
+  private startSegment(startTime: number) {
+    const number = this.nextNumber++
+    this.current = {
+      number,
+      startTime,
+      duration: 0,
+      size: 0,
+      hls: new Segment({
+        uri: '',
+        duration: 0,
+        mediaSequenceNumber: number,
+        map: this.map,
+        parts: []
+      })
+    }
+    this.playlist.segments.push(this.current.hls)
+  }
+
+  private finishSegment() {
+    const current = this.current
+    this.removeHint(current)
+    current.hls.uri = this.getName(this.options.segmentName, current.number)
+    current.hls.duration = current.duration / 1000
+
+    this.segments.push(current)
+    this.totalSize += current.size
+    this.totalDuration += current.duration
+    this.maxSegmentDuration = Math.max(this.maxSegmentDuration, current.duration)
+    this.current = null
+
+    if (this.options.listSize && this.segments.length > this.options.listSize) {
+      const removed = this.segments.shift()
+      this.playlist.segments.shift()
+      this.playlist.mediaSequenceBase = removed.number + 1
+    }
+    // 较早的分片不再需要 part
+    const index = this.playlist.segments.length - PART_SEGMENT_COUNT - 1
+    if (index >= 0) {
+      this.playlist.segments[index].parts = []
+    }
+
+    this.playlist.targetDuration = Math.max(this.playlist.targetDuration, current.duration / 1000)
+
+    this.notify('cmafSegment', {
+      segment: current.number,
+      startTime: current.startTime,
+      duration: current.duration,
+      size: current.size
+    })
+  }
+
+  private getBandwidth() {
+    if (this.bitrate > 0) {
+      return this.bitrate
+    }
+    return this.totalDuration ? Math.ceil(this.totalSize * 8 / (this.totalDuration / 1000)) : 0
+  }
+
+  private getMPD() {
+    const dynamic = this.options.live && !this.ended
+    const mpd: Partial<MPD> = {
+      type: dynamic ? 'dynamic' : 'static',
+      availabilityStartTime: dynamic ? new Date(this.availabilityStartTime).toISOString() : undefined,
+      publishTime: new Date().toISOString(),
+      minimumUpdatePeriod: dynamic ? toDuration(this.options.chunkDuration / 1000) : undefined,
+      timeShiftBufferDepth: dynamic && this.options.listSize
+        ? toDuration(this.options.listSize * this.options.segmentDuration / 1000)
+        : undefined,
+      mediaPresentationDuration: dynamic ? undefined : toDuration(this.totalDuration / 1000),
+      maxSegmentDuration: toDuration(Math.max(this.maxSegmentDuration, this.options.segmentDuration) / 1000),
+      minBufferTime: toDuration(this.options.segmentDuration / 1000),
+      Period: {
+        id: '0',
+        start: 'PT0S',
+        AdaptationSet: {
+          id: '0',
+          contentType: this.contentType,
+          segmentAlignment: 'true',
+          startWithSAP: '1',
+          bitstreamSwitching: 'false',
+          Representation: {
+            id: '0',
+            mimeType: `${this.contentType}/mp4`,
+            codecs: this.codecs,
+            bandwidth: `${this.getBandwidth()}`,
+            width: this.width ? `${this.width}` : undefined,
+            height: this.height ? `${this.height}` : undefined,
+            audioSamplingRate: this.sampleRate ? `${this.sampleRate}` : undefined,
+            SegmentTemplate: {
+              timescale: '1000',
+              initialization: this.options.initName,
+              media: this.options.segmentName,
+              startNumber: `${this.segments.length ? this.segments[0].number : this.nextNumber}`,
+              // 低延迟：分片还在生成时就可以按 chunk 请求
+              availabilityTimeOffset: dynamic
+                ? `${(this.options.segmentDuration - this.options.chunkDuration) / 1000}`
+                : undefined,
+              availabilityTimeComplete: dynamic ? 'false' : undefined,
+              SegmentTimeline: {
+                S: this.segments.map((segment) => {
+                  return {
+                    t: `${Math.round(segment.startTime)}`,
+                    d: `${Math.round(segment.duration)}`
+                  }
+                })
+              }
+            }
+          }
+        }
+      }
+    }
+    return stringifyMPD(mpd)
+  }
+
+  /**
+   * 重新生成播放列表
+   * 
+   * @param segmentChanged MPD 只描述完整的分片，只在分片完成时重新生成
+   */
+  private updateManifest(segmentChanged: boolean) {
+    const manifest: CmafManifest = {}
+    if (this.options.hls) {
+      manifest.m3u8 = stringifyMediaPlaylist(this.playlist)
+    }
+    if (this.options.dash) {
+      if (segmentChanged || !this.manifest.mpd) {
+        manifest.mpd = this.getMPD()
+      }
+      else {
+        manifest.mpd = this.manifest.mpd
+      }
+    }
+    this.manifest = manifest
+    return manifest
+  }
+
+  /**
+   * 获取最近一次生成的播放列表
+   */
+  public getManifest(): CmafManifest {
+    return this.manifest
+  }
+
+  /**
+   * 封装结束，输出最后一个分片和最终的播放列表
+   */
+  public end() {
+    if (this.current) {
+      this.finishSegment()
+    }
+    // 丢弃 trailer 写出的数据（空 mfra）
+    this.buffers = []
+    this.ended = true
+    this.playlist.endlist = true
+    if (!this.options.live) {
+      this.playlist.playlistType = 'VOD'
+    }
+    this.notify('cmafManifest', this.updateManifest(true))
+  }
+}
@@ -0,0 +1,146 @@
+/*
+ * libmedia createOFormat
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  AVFormat
+} from '@libmedia/avutil'
+
+import {
+  logger,
+  object
+} from '@libmedia/common'
+
+import type { Data } from '@libmedia/common'
+import type { OFormat } from '@libmedia/avformat'
+
+/**
+ * 根据输出格式创建 OFormat，格式不支持返回 null
+ * 
+ * @param format 
+ * @param formatOptions 
+ * @param isLive 
+ */
+export default async function createOFormat(format: AVFormat, formatOptions: Data, isLive?: boolean): Promise<OFormat> {
+  switch (format) {
+    case AVFormat.FLV:
+      if (defined(ENABLE_MUXER_FLV)) {
+        return new ((await import('@libmedia/avformat/OFlvFormat')).default)(formatOptions)
+      }
+      else {
+        logger.error('flv format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.ISOBMFF:
+      if (defined(ENABLE_MUXER_ISOBMFF) || defined(ENABLE_PROTOCOL_DASH)) {
+        return new ((await import('@libmedia/avformat/OIsobmffFormat')).default)(formatOptions)
+      }
+      else {
+        logger.error('mp4 format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MPEGTS:
+      if (defined(ENABLE_MUXER_ISOBMFF) || defined(ENABLE_PROTOCOL_HLS)) {
+        return new ((await import('@libmedia/avformat/OMpegtsFormat')).default)(formatOptions)
+      }
+      else {
+        logger.error('mpegts format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.IVF:
+      if (defined(ENABLE_MUXER_IVF)) {
+        return new ((await import('@libmedia/avformat/OIvfFormat')).default)
+      }
+      else {
+        logger.error('ivf format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.OGG:
+      if (defined(ENABLE_MUXER_OGG)) {
+        return new ((await import('@libmedia/avformat/OOggFormat')).default)
+      }
+      else {
+        logger.error('oggs format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MP3:
+      if (defined(ENABLE_MUXER_MP3)) {
+        return new ((await import('@libmedia/avformat/OMp3Format')).default)(formatOptions)
+      }
+      else {
+        logger.error('mp3 format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.WAV:
+      if (defined(ENABLE_MUXER_WAV)) {
+        return new ((await import('@libmedia/avformat/OWavFormat')).default)(formatOptions)
+      }
+      else {
+        logger.error('wav format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.FLAC:
+      if (defined(ENABLE_MUXER_FLAC)) {
+        return new ((await import('@libmedia/avformat/OFlacFormat')).default)(formatOptions)
+      }
+      else {
+        logger.error('flac format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.AAC:
+      if (defined(ENABLE_MUXER_AAC)) {
+        return new ((await import('@libmedia/avformat/OAacFormat')).default)(formatOptions)
+      }
+      else {
+        logger.error('aac format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.MATROSKA:
+    case AVFormat.WEBM:
+      if (defined(ENABLE_MUXER_MATROSKA)) {
+        const options = {
+          isLive,
+          docType: format === AVFormat.WEBM ? 'webm' : 'matroska'
+        }
+        return new (((await import('@libmedia/avformat/OMatroskaFormat')).default))(object.extend(formatOptions, options))
+      }
+      else {
+        logger.error('matroska format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    case AVFormat.H264:
+    case AVFormat.HEVC:
+    case AVFormat.VVC:
+      if (defined(ENABLE_MUXER_H26X)) {
+        return new (((await import('@libmedia/avformat/OH26XFormat')).default))()
+      }
+      else {
+        logger.error('h26x format not support, maybe you can rebuild avmedia')
+        return null
+      }
+    default:
+      logger.error('format not support')
+      return null
+  }
+}
@@ -210,6 +210,34 @@ export default class Stats {
    * 视频最大渲染帧间隔（毫秒）
    */
   videoFrameRenderIntervalMax: int32
+  /**
+   * 视频解码线程获取 avpacket 的平均耗时（毫秒）
+   */
+  videoPacketHandoffTime: double
+  /**
+   * 最近一个视频编码帧的 QP（编码器没有给出质量信息时为 0）
+   */
+  videoEncodeQp: double
+  /**
+   * 视频编码帧的平均 QP
+   */
+  videoEncodeAvgQp: double
+  /**
+   * 带有质量信息的视频编码帧数
+   */
+  videoEncodeQpCount: int32
+  /**
+   * 最近一个视频编码帧的大小（字节）
+   */
+  videoEncodeFrameSize: int32
+  /**
+   * 视频编码输出总字节数
+   */
+  videoEncodeBytes: int64
+  /**
+   * 场景切换插入的关键帧数
+   */
+  videoSceneCutCount: int32
   /**
    * 接收带宽
    */
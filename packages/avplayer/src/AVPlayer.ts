@@ -27,7 +27,7 @@ import {
   IOPipeline,
   DemuxPipeline,
   AudioDecodePipeline,
-  VideoDecodePipeline,
+  type VideoDecodePipeline,
   AudioRenderPipeline,
   VideoRenderPipeline,
   Stats
@@ -90,6 +90,7 @@ import {
   addSideData,
   getSideData,
   AVSeekFlags,
+  AVDiscard,
   IOType,
   IOFlags,
   AVFormat,
@@ -114,7 +115,13 @@ import {
   avMalloc,
   AVCodecParameterFlags,
   getVideoMimeType,
-  getAudioMimeType
+  getAudioMimeType,
+  avring,
+  type AVRing,
+  avbytering,
+  type AVByteRing,
+  type AVPacketRef,
+  AVPacketPoolImpl
 } from '@libmedia/avutil'
 
 import {
@@ -160,6 +167,7 @@ import type MSEPipeline from './mse/MSEPipeline'
 import StatsController from './StatsController'
 import getMediaSource from './function/getMediaSource'
 import JitterBufferController from './JitterBufferController'
+import VideoDecoderThreadPool from './VideoDecoderThreadPool'
 import type SubtitleRender from './subtitle/SubtitleRender'
 import type { playerEventChanged, playerEventChanging, playerEventError, playerEventNoParam,
   playerEventProgress, playerEventSubtitleDelayChange, playerEventTime, playerEventVolumeChange
@@ -264,7 +272,7 @@ export interface AVPlayerOptions {
    * @param mediaType 
    * @returns 
    */
-  getWasm?: (type: 'decoder' | 'resampler' | 'stretchpitcher', codecId?: AVCodecID, mediaType?: AVMediaType) => string | ArrayBuffer | WebAssemblyResource
+  getWasm?: (type: 'decoder' | 'resampler' | 'stretchpitcher' | 'yuv2rgba', codecId?: AVCodecID, mediaType?: AVMediaType) => string | ArrayBuffer | WebAssemblyResource
   /**
    * 是否是直播（已弃用，请在 load 方法中传递参数）
    * @deprecated
@@ -282,6 +290,12 @@ export interface AVPlayerOptions {
    * 是否启用 WebGPU 渲染
    */
   enableWebGPU?: boolean
+  /**
+   * 是否启用 wasm 软件渲染
+   * 
+   * 启用之后 WebGL 和 WebGPU 都不可用时在 wasm 中将 yuv 转换为 rgba 使用 canvas 2d 渲染
+   */
+  enableWasmCanvasRender?: boolean
   /**
    * 是否启用 WebCodecs 编解码
    */
@@ -320,6 +334,10 @@ export interface AVPlayerOptions {
    * 预加载 buffer 时长，点播使用（秒）
    */
   preLoadTime?: float
+  /**
+   * 多线程下 IO 线程预读缓冲区大小（字节），点播的 url 和文件使用，0 表示不预读
+   */
+  readAheadSize?: int32
   /**
    * 自定义查找播放流回调
    */
@@ -335,6 +353,18 @@ export interface AVPlayerOptions {
    * DRM 配置
    */
   drmSystemOptions?: DRMSystemOptions
+  /**
+   * 是否开启低功耗模式（非 mse 模式）
+   * 
+   * 页面隐藏或者播放器不在视口内时只解封装和解码视频关键帧，恢复可见后从下一个关键帧开始完整解码
+   * 
+   * 默认 true
+   */
+  enableLowPowerMode?: boolean
+  /**
+   * 播放器显示面积（css 像素）小于该值时软解跳过非参考帧，默认 0 不开启
+   */
+  lowPowerAreaThreshold?: number
 }
 
 export interface AVPlayerLoadOptions {
@@ -393,6 +423,12 @@ export interface AVPlayerLoadOptions {
    * 最大分析时长（秒）用于分析流参数的最大时长，默认 3 秒
    */
   maxProbeDuration?: number
+  /**
+   * 分级快速分析流参数，解码器需要的参数拿到之后立即结束分析，帧率和码率在播放过程中继续统计
+   * 
+   * 可以缩短远程 flv、ts 等格式的打开时间
+   */
+  fastProbe?: boolean
 }
 
 export interface AVPlayerPlayOptions {
@@ -498,7 +534,10 @@ const defaultAVPlayerOptions: Partial<AVPlayerOptions> = {
   jitterBufferMax: 4,
   jitterBufferMin: 1,
   lowLatency: false,
-  preLoadTime: 4
+  preLoadTime: 4,
+  readAheadSize: 4 * 1024 * 1024,
+  enableLowPowerMode: true,
+  lowPowerAreaThreshold: 0
 }
 
 export const enum AVPlayerStatus {
@@ -600,6 +639,15 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
    * @hidden
    */
   static MSEThread: Thread<MSEPipeline>
+  /**
+   * @hidden
+   * 非 VideoPipelineProxy 模式下所有 AVPlayer 实例共享的视频解码线程池
+   */
+  static VideoDecoderThreadPool: VideoDecoderThreadPool
+  /**
+   * 视频解码线程池最大线程数，需要在第一个 AVPlayer 加载之前设置
+   */
+  static VideoDecoderThreadPoolSize: number = Math.max(Math.min((navigator.hardwareConcurrency || 4) >> 1, 8), 1)
 
   static audioContext: AudioContext
   /**
@@ -607,9 +655,8 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
    */
   static Resource: Map<string, WebAssemblyResource | ArrayBuffer> = new Map()
 
-  // 解码线程每个 player 独占一个
-  // TODO 若需要同时播放大量视频，可以考虑实现一个 VideoDecoderThreadPool
-  // 来根据各个视频规格做线程解码任务调度，降低系统线程切换开销，这里就不实现了
+  // 解码线程从 VideoDecoderThreadPool 中分配，多个 player 共享
+  // VideoPipelineProxy 模式下解码和渲染在同一个 worker 中，每个 player 独占
   private VideoDecoderThread: Thread<VideoDecodePipeline>
   private VideoRenderThread: Thread<VideoRenderPipeline>
   private VideoPipelineProxy: VideoPipelineProxy
@@ -664,6 +711,16 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
   private statsController: StatsController
   private jitterBufferController: JitterBufferController
 
+  private videoPacketRing: pointer<AVRing>
+  private ioByteRing: pointer<AVByteRing>
+
+  // 低功耗模式
+  private lowPowerDiscard: AVDiscard
+  private documentHidden: boolean
+  private containerVisible: boolean
+  private containerArea: number
+  private intersectionObserver: IntersectionObserver
+
   private selectedVideoStream: AVStreamInterface
   private selectedAudioStream: AVStreamInterface
   private selectedSubtitleStream: AVStreamInterface
@@ -695,6 +752,11 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     this.seekedTimestamp = NOPTS_VALUE_BIGINT
     this.isLive_ = !!options.isLive
 
+    this.lowPowerDiscard = AVDiscard.AVDISCARD_DEFAULT
+    this.documentHidden = false
+    this.containerVisible = true
+    this.containerArea = 0
+
     this.GlobalData = make<AVPlayerGlobalData>()
 
     this.statsController = new StatsController(
@@ -1149,12 +1211,6 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
       seekedTimestamp = await AVPlayer.DemuxerThread.seek(this.taskId, timestamp, AVSeekFlags.FRAME)
     }
 
-    if (this.subtitleRender) {
-      for (let i = 0; i < this.externalSubtitleTasks.length; i++) {
-        await AVPlayer.DemuxerThread.seek(this.externalSubtitleTasks[0].taskId, timestamp, AVSeekFlags.FRAME)
-      }
-    }
-
     this.fire(eventType.TIME, [timestamp])
 
     if (defined(ENABLE_MSE) && this.useMSE) {
@@ -1296,7 +1352,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     return minPTS
   }
 
-  private async getResource(type: 'decoder' | 'resampler' | 'stretchpitcher', codecId?: AVCodecID, mediaType?: AVMediaType) {
+  private async getResource(type: 'decoder' | 'resampler' | 'stretchpitcher' | 'yuv2rgba', codecId?: AVCodecID, mediaType?: AVMediaType) {
     const key = codecId != null ? `${type}-${codecId}` : type
 
     if (AVPlayer.Resource.has(key)) {
@@ -1345,7 +1401,21 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     }
   }
 
-  private async createSubtitleRender(subtitleStream: AVStreamInterface, taskId: string) {
+  /**
+   * 创建 IO 线程预读缓冲区，只有多线程下才能使用共享内存
+   */
+  private createIOByteRing() {
+    if (cheapConfig.USE_THREADS
+      && !AVPlayer.IODemuxProxy
+      && this.options.readAheadSize > 0
+      && !avbytering.avbyteringInit(addressof(this.GlobalData.ioByteRing), this.options.readAheadSize)
+    ) {
+      return addressof(this.GlobalData.ioByteRing)
+    }
+    return nullptr
+  }
+
+  private async createSubtitleRender(subtitleStream: AVStreamInterface, taskId: string, external: boolean = false) {
 
     if (this.isMediaStreamMode()) {
       return
@@ -1365,7 +1435,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
         videoHeight: this.selectedVideoStream?.codecpar.height ?? 0
       })
 
-      this.subtitleRender.setDemuxTask(taskId)
+      this.subtitleRender.setDemuxTask(taskId, external)
 
       this.selectedSubtitleStream = subtitleStream
 
@@ -1505,13 +1575,10 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
       || this.status === AVPlayerStatus.SEEKING
       || this.status === AVPlayerStatus.CHANGING
 
-    if (handleStatus) {
-      await AVPlayer.DemuxerThread.seek(taskId, this.currentTime, AVSeekFlags.FRAME)
-    }
-
+    // 外挂字幕从头读取整个文件存入 SubtitleRender 的事件存储，不需要 seek 到当前时间
     if (defined(ENABLE_SUBTITLE_RENDER)) {
       if (handleStatus && !this.subtitleRender) {
-        await this.createSubtitleRender(stream, taskId)
+        await this.createSubtitleRender(stream, taskId, true)
         this.subtitleRender.start()
       }
       else if (this.subtitleRender) {
@@ -1577,11 +1644,17 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     let flags = 0
     let ret = 0
 
+    this.ioByteRing = nullptr
+
     if (is.string(source)) {
       flags |= IOFlags.NETWORK
       let { info, type, ext } = await analyzeUrlIOLoader(source, options.ext, options.http)
       this.ext = ext
 
+      if (type === IOType.Fetch && !this.isLive_) {
+        this.ioByteRing = this.createIOByteRing()
+      }
+
       // 注册一个 url io 任务
       ret = await AVPlayer.IOThread.registerTask
         .transfer(this.ioloader2DemuxerChannel.port1)
@@ -1603,12 +1676,14 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
             isLive: this.isLive_
           }),
           rightPort: this.ioloader2DemuxerChannel.port1,
-          stats: addressof(this.GlobalData.stats)
+          stats: addressof(this.GlobalData.stats),
+          ring: this.ioByteRing
         })
     }
     else if (source instanceof File) {
       this.isLive_ = false
       this.ext = source.name.split('.').pop()
+      this.ioByteRing = this.createIOByteRing()
       // 注册一个文件 io 任务
       ret = await AVPlayer.IOThread.registerTask
         .transfer(this.ioloader2DemuxerChannel.port1)
@@ -1626,7 +1701,8 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
             isLive: false
           }),
           rightPort: this.ioloader2DemuxerChannel.port1,
-          stats: addressof(this.GlobalData.stats)
+          stats: addressof(this.GlobalData.stats),
+          ring: this.ioByteRing
         })
     }
     else if (source instanceof CustomIOLoader) {
@@ -1821,7 +1897,8 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
           isLive: this.isLive_,
           flags,
           avpacketList: addressof(this.GlobalData.avpacketList),
-          avpacketListMutex: addressof(this.GlobalData.avpacketListMutex)
+          avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
+          ioRing: this.ioByteRing
         })
     }
 
@@ -1853,7 +1930,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
       maxProbeDuration = Math.floor(options.maxProbeDuration * 1000)
     }
 
-    ret = await AVPlayer.DemuxerThread.openStream(this.taskId, maxProbeDuration)
+    ret = await AVPlayer.DemuxerThread.openStream(this.taskId, maxProbeDuration, !!options.fastProbe)
     if (ret < 0) {
       logger.fatal(`open stream failed, ret: ${ret}, taskId: ${this.taskId}`)
     }
@@ -1870,7 +1947,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     }
 
     if ((defined(ENABLE_PROTOCOL_DASH) || defined(ENABLE_PROTOCOL_HLS)) && this.subTaskId) {
-      ret = await AVPlayer.DemuxerThread.openStream(this.subTaskId, maxProbeDuration)
+      ret = await AVPlayer.DemuxerThread.openStream(this.subTaskId, maxProbeDuration, !!options.fastProbe)
       if (ret < 0) {
         logger.fatal(`open stream failed, ret: ${ret}, taskId: ${this.subTaskId}`)
       }
@@ -1886,7 +1963,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     }
 
     if ((defined(ENABLE_PROTOCOL_DASH) || defined(ENABLE_PROTOCOL_HLS)) && this.subtitleTaskId) {
-      ret = await AVPlayer.DemuxerThread.openStream(this.subtitleTaskId, maxProbeDuration)
+      ret = await AVPlayer.DemuxerThread.openStream(this.subtitleTaskId, maxProbeDuration, !!options.fastProbe)
       if (ret < 0) {
         logger.fatal(`open subtitle stream failed, ret: ${ret}, taskId: ${this.subtitleTaskId}`)
       }
@@ -2243,13 +2320,24 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
       this.selectedVideoStream = videoStream
 
       await AVPlayer.startVideoRenderPipeline(this.options.enableWorker)
-      await this.createVideoDecoderThread(this.options.enableWorker)
+      await this.createVideoDecoderThread(this.options.enableWorker, videoStream)
 
       videoStartTime = avRescaleQ(videoStream.startTime, videoStream.timeBase, AV_MILLI_TIME_BASE_Q)
 
       this.demuxer2VideoDecoderChannel = createMessageChannel(this.options.enableWorker)
       this.videoDecoder2VideoRenderChannel = createMessageChannel(this.options.enableWorker)
 
+      // 多线程下解封装线程和解码线程通过共享内存环形队列交接 avpacket
+      let avpacketRing: pointer<AVRing> = nullptr
+      if (cheapConfig.USE_THREADS) {
+        // 上一次 load 的 ring 没有经过 stop 释放时先销毁，避免泄漏共享内存
+        this.destroyVideoPacketRing()
+        if (!avring.avringInit(addressof(this.GlobalData.videoPacketRing), this.isLive() ? 4 : 32)) {
+          avpacketRing = addressof(this.GlobalData.videoPacketRing)
+        }
+      }
+      this.videoPacketRing = avpacketRing
+
       let resource = await this.getResource('decoder', videoStream.codecpar.codecId, videoStream.codecpar.codecType)
       if (!resource) {
         if (support.videoDecoder) {
@@ -2265,42 +2353,11 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
         }
       }
 
-      // 注册一个视频解码任务
-      await this.VideoDecoderThread.registerTask
-        .transfer(this.demuxer2VideoDecoderChannel.port2, this.videoDecoder2VideoRenderChannel.port1)
-        .invoke({
-          taskId: this.taskId,
-          resource,
-          leftPort: this.demuxer2VideoDecoderChannel.port2,
-          rightPort: this.videoDecoder2VideoRenderChannel.port1,
-          stats: addressof(this.GlobalData.stats),
-          enableHardware: this.options.enableHardware
-            && this.options.enableWebCodecs
-            && !(videoStream.disposition & AVDisposition.ATTACHED_PIC),
-          avpacketList: addressof(this.GlobalData.avpacketList),
-          avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
-          avframeList: addressof(this.GlobalData.avframeList),
-          avframeListMutex: addressof(this.GlobalData.avframeListMutex),
-          preferWebCodecs: !isHdr(videoStream.codecpar)
-            && (!hasAlphaChannel(videoStream.codecpar)
-              || videoStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP8
-              || videoStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9
-              || videoStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_AV1
-            )
-            && !!this.options.enableWebCodecs
-            && !(videoStream.disposition & AVDisposition.ATTACHED_PIC),
-          preferLatency: this.isLive(),
-          keepAlpha: true
-        })
-
-      let ret = await this.VideoDecoderThread.open(this.taskId, serializeAVCodecParameters(videoStream.codecpar))
-      if (ret < 0) {
-        logger.fatal(`cannot open video ${dumpUtils.dumpCodecName(videoStream.codecpar.codecType, videoStream.codecpar.codecId)} decoder`)
-      }
+      await this.registerVideoDecoderTask(videoStream, resource)
 
       await AVPlayer.DemuxerThread.connectStreamTask
         .transfer(this.demuxer2VideoDecoderChannel.port1)
-        .invoke(this.subTaskId || this.taskId, videoStream.index, this.demuxer2VideoDecoderChannel.port1)
+        .invoke(this.subTaskId || this.taskId, videoStream.index, this.demuxer2VideoDecoderChannel.port1, avpacketRing)
 
       this.VideoDecoderThread.setPlayRate(this.taskId, this.playRate)
     }
@@ -2439,6 +2496,13 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
         this.renderRotate = -(Math.atan2(videoStream.metadata[AVStreamMetadataKey.MATRIX][3], videoStream.metadata[AVStreamMetadataKey.MATRIX][0]) * (180 / Math.PI))
       }
 
+      if (this.options.enableWasmCanvasRender) {
+        const yuvResource = await this.getResource('yuv2rgba')
+        if (yuvResource) {
+          await this.VideoRenderThread.loadYUVKernel(yuvResource)
+        }
+      }
+
       // 注册一个视频渲染任务
       await this.VideoRenderThread.registerTask
         .transfer(
@@ -2472,6 +2536,20 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
 
       this.videoEnded = false
       this.VideoRenderThread.setPlayRate(this.taskId, this.playRate)
+
+      if (this.options.enableLowPowerMode
+        && !this.isMediaStreamMode()
+        && typeof IntersectionObserver === 'function'
+      ) {
+        this.intersectionObserver = new IntersectionObserver((entries) => {
+          const entry = entries[entries.length - 1]
+          this.containerVisible = entry.isIntersecting
+          this.containerArea = entry.boundingClientRect.width * entry.boundingClientRect.height
+          this.updateLowPowerMode()
+        })
+        this.intersectionObserver.observe(this.options.container as HTMLDivElement)
+      }
+      this.updateLowPowerMode()
     }
     if (this.audioDecoder2AudioRenderChannel) {
 
@@ -2665,6 +2743,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
           promises.push(AVPlayer.AudioRenderThread.unpause(this.taskId))
         }
         if (this.videoDecoder2VideoRenderChannel) {
+          AVPlayer.VideoDecoderThreadPool?.setActive(this.taskId, this.lowPowerDiscard < AVDiscard.AVDISCARD_NONKEY)
           promises.push(this.VideoRenderThread.unpause(this.taskId))
         }
       }
@@ -2701,7 +2780,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
         const externalTask = this.externalSubtitleTasks.find((task) => {
           return task.streamId === subtitleStream.id
         })
-        await this.createSubtitleRender(subtitleStream, externalTask ? externalTask.taskId : (this.subtitleTaskId || this.taskId))
+        await this.createSubtitleRender(subtitleStream, externalTask ? externalTask.taskId : (this.subtitleTaskId || this.taskId), !!externalTask)
       }
 
       if (this.subtitleRender && this.externalSubtitleTasks.length) {
@@ -2865,6 +2944,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
         }
         if (this.videoDecoder2VideoRenderChannel) {
           promises.push(this.VideoRenderThread.pause(this.taskId))
+          AVPlayer.VideoDecoderThreadPool?.setActive(this.taskId, false)
         }
       }
       return Promise.all(promises).then(() => {
@@ -2881,6 +2961,9 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
         if (defined(ENABLE_SUBTITLE_RENDER) && this.subtitleRender) {
           this.subtitleRender.pause()
         }
+        if (this.videoDecoder2VideoRenderChannel) {
+          return this.migrateVideoDecoder()
+        }
       })
     }
     else {
@@ -3000,11 +3083,6 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     ) {
       this.seekedTimestamp = seekedTimestamp > timestamp ? seekedTimestamp : timestamp
     }
-    if (this.subtitleRender) {
-      for (let i = 0; i < this.externalSubtitleTasks.length; i++) {
-        await AVPlayer.DemuxerThread.seek(this.externalSubtitleTasks[i].taskId, this.currentTime, AVSeekFlags.FRAME)
-      }
-    }
     if (defined(ENABLE_SUBTITLE_RENDER) && this.subtitleRender) {
       this.subtitleRender.reset()
       this.subtitleRender.start()
@@ -3206,6 +3284,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     }
     if (this.VideoDecoderThread) {
       await this.VideoDecoderThread.unregisterTask(this.taskId)
+      AVPlayer.VideoDecoderThreadPool?.setActive(this.taskId, false)
     }
     if (AVPlayer.AudioDecoderThread) {
       await AVPlayer.AudioDecoderThread.unregisterTask(this.taskId)
@@ -3225,6 +3304,12 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     if (AVPlayer.IOThread) {
       await AVPlayer.IOThread.unregisterTask(this.taskId)
     }
+    this.destroyVideoPacketRing()
+    if (this.GlobalData.ioByteRing.buffer) {
+      // IO 任务和解封装任务都已经注销，不会再访问预读缓冲区
+      avbytering.avbyteringDestroy(addressof(this.GlobalData.ioByteRing))
+    }
+    this.ioByteRing = nullptr
     if (this.ioIPCPort) {
       await (this.source as CustomIOLoader).stop().catch((error) => {
         logger.error(`stop custom ioloader error, ${error}`)
@@ -3250,6 +3335,12 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     if (this.controller) {
       this.controller.destroy()
     }
+    if (this.intersectionObserver) {
+      this.intersectionObserver.disconnect()
+      this.intersectionObserver = null
+    }
+    this.lowPowerDiscard = AVDiscard.AVDISCARD_DEFAULT
+    this.containerVisible = true
     if (this.drmSession) {
       await this.drmSession.close()
       this.drmSession = null
@@ -3571,12 +3662,6 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
   public setSubtitleEnable(enable: boolean) {
     if (defined(ENABLE_SUBTITLE_RENDER) && this.subtitleRender && this.selectedSubtitleStream) {
       if (enable) {
-        const externalTask = this.externalSubtitleTasks.find((task) => {
-          return task.streamId === this.selectedSubtitleStream.id
-        })
-        if (externalTask) {
-          AVPlayer.DemuxerThread.seek(externalTask.taskId, this.currentTime, AVSeekFlags.FRAME)
-        }
         this.subtitleRender.reset()
         this.subtitleRender.start()
       }
@@ -3596,6 +3681,8 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     if (!this.useMSE) {
       this.VideoRenderThread?.resize(this.taskId, width, height)
     }
+    this.containerArea = width * height
+    this.updateLowPowerMode()
     logger.info(`player call resize, width: ${width}, height: ${height}, taskId: ${this.taskId}`)
   }
 
@@ -4088,9 +4175,8 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
             return task.streamId === stream.id
           })
           if (externalTask) {
-            this.subtitleRender.setDemuxTask(externalTask.taskId)
+            this.subtitleRender.setDemuxTask(externalTask.taskId, true)
             this.subtitleRender.reset()
-            await AVPlayer.DemuxerThread.seek(externalTask.taskId, this.currentTime, AVSeekFlags.FRAME, stream.index)
           }
           else {
             this.subtitleRender.setDemuxTask(this.taskId)
@@ -4230,8 +4316,7 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     }
 
     if (this.VideoDecoderThread) {
-      await this.VideoDecoderThread.clear()
-      closeThread(this.VideoDecoderThread)
+      await AVPlayer.VideoDecoderThreadPool.release(this.taskId)
       this.VideoDecoderThread = null
     }
 
@@ -4412,9 +4497,124 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     this.fire(eventType.ERROR, [error])
   }
 
-  private async createVideoDecoderThread(enableWorker: boolean = true) {
+  /**
+   * @hidden
+   */
+  public onVisibilityChange(hidden: boolean) {
+    this.documentHidden = hidden
+    this.updateLowPowerMode()
+  }
+
+  /**
+   * 根据可见性和显示大小切换视频低功耗模式
+   */
+  private async updateLowPowerMode() {
+    if (!this.options.enableLowPowerMode
+      || this.useMSE
+      || !this.videoDecoder2VideoRenderChannel
+      || !this.VideoDecoderThread
+      || !this.selectedVideoStream
+      || this.isAttachmentPicture(this.selectedVideoStream)
+    ) {
+      return
+    }
+
+    let discard = AVDiscard.AVDISCARD_DEFAULT
+    if (this.documentHidden || !this.containerVisible) {
+      discard = AVDiscard.AVDISCARD_NONKEY
+    }
+    else if (this.options.lowPowerAreaThreshold > 0
+      && this.containerArea > 0
+      && this.containerArea < this.options.lowPowerAreaThreshold
+    ) {
+      discard = AVDiscard.AVDISCARD_NONREF
+    }
+
+    if (discard === this.lowPowerDiscard) {
+      return
+    }
+    this.lowPowerDiscard = discard
+
+    AVPlayer.VideoDecoderThreadPool?.setActive(
+      this.taskId,
+      discard < AVDiscard.AVDISCARD_NONKEY && this.status !== AVPlayerStatus.PAUSED
+    )
+
+    // 关键帧之外的 avpacket 在解封装时就丢弃
+    await AVPlayer.DemuxerThread.setAVStreamDiscard(
+      this.subTaskId || this.taskId,
+      this.selectedVideoStream.index,
+      discard === AVDiscard.AVDISCARD_NONKEY ? AVDiscard.AVDISCARD_NONKEY : AVDiscard.AVDISCARD_DEFAULT
+    )
+    await this.VideoDecoderThread.setLowPowerDiscard(this.taskId, discard)
+
+    logger.info(`low power mode changed, discard: ${discard}, taskId: ${this.taskId}`)
+
+    if (discard === AVDiscard.AVDISCARD_NONKEY) {
+      await this.migrateVideoDecoder()
+    }
+  }
+
+  /**
+   * 销毁视频 avpacket 环形队列，还没有被消费的 avpacket 回收到 avpacket 池
+   */
+  private destroyVideoPacketRing() {
+    if (this.GlobalData.videoPacketRing.buffer) {
+      const avpacketPool = new AVPacketPoolImpl(this.GlobalData.avpacketList, addressof(this.GlobalData.avpacketListMutex))
+      avring.avringDestroy(addressof(this.GlobalData.videoPacketRing), (avpacket) => {
+        avpacketPool.release(reinterpret_cast<pointer<AVPacketRef>>(avpacket))
+      })
+    }
+  }
+
+  private async registerVideoDecoderTask(videoStream: AVStreamInterface, resource: WebAssemblyResource | ArrayBuffer) {
+    // 注册一个视频解码任务
+    await this.VideoDecoderThread.registerTask
+      .transfer(this.demuxer2VideoDecoderChannel.port2, this.videoDecoder2VideoRenderChannel.port1)
+      .invoke({
+        taskId: this.taskId,
+        resource,
+        leftPort: this.demuxer2VideoDecoderChannel.port2,
+        rightPort: this.videoDecoder2VideoRenderChannel.port1,
+        stats: addressof(this.GlobalData.stats),
+        enableHardware: this.options.enableHardware
+          && this.options.enableWebCodecs
+          && !(videoStream.disposition & AVDisposition.ATTACHED_PIC),
+        avpacketList: addressof(this.GlobalData.avpacketList),
+        avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
+        avframeList: addressof(this.GlobalData.avframeList),
+        avframeListMutex: addressof(this.GlobalData.avframeListMutex),
+        preferWebCodecs: !isHdr(videoStream.codecpar)
+          && (!hasAlphaChannel(videoStream.codecpar)
+            || videoStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP8
+            || videoStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9
+            || videoStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_AV1
+          )
+          && !!this.options.enableWebCodecs
+          && !(videoStream.disposition & AVDisposition.ATTACHED_PIC),
+        preferLatency: this.isLive(),
+        keepAlpha: true,
+        avpacketRing: this.videoPacketRing
+      })
+
+    const ret = await this.VideoDecoderThread.open(this.taskId, serializeAVCodecParameters(videoStream.codecpar))
+    if (ret < 0) {
+      logger.fatal(`cannot open video ${dumpUtils.dumpCodecName(videoStream.codecpar.codecType, videoStream.codecpar.codecId)} decoder`)
+    }
+  }
+
+  private getVideoDecodeWeight(videoStream: AVStreamInterface) {
+    const framerate = avQ2D(videoStream.codecpar.framerate)
+    return Math.max(videoStream.codecpar.width * videoStream.codecpar.height, 1)
+      * (framerate > 0 && framerate < 240 ? framerate : 25)
+  }
+
+  private async createVideoDecoderThread(enableWorker: boolean, videoStream: AVStreamInterface) {
 
     if (this.VideoDecoderThread) {
+      if (!this.VideoPipelineProxy) {
+        await AVPlayer.VideoDecoderThreadPool.acquire(this.taskId, this.getVideoDecodeWeight(videoStream))
+      }
       return
     }
 
@@ -4424,10 +4624,10 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
       || !supportOffscreenCanvas()
       || !defined(ENABLE_WORKER_PROXY)
     ) {
-      this.VideoDecoderThread = await createThreadFromClass(VideoDecodePipeline, {
-        name: 'VideoDecoderThread'
-      }).run()
-      this.VideoDecoderThread.setLogLevel(AVPlayer.level)
+      if (!AVPlayer.VideoDecoderThreadPool) {
+        AVPlayer.VideoDecoderThreadPool = new VideoDecoderThreadPool(AVPlayer.VideoDecoderThreadPoolSize, AVPlayer.level)
+      }
+      this.VideoDecoderThread = await AVPlayer.VideoDecoderThreadPool.acquire(this.taskId, this.getVideoDecodeWeight(videoStream))
       this.VideoRenderThread = AVPlayer.VideoRenderThread
     }
     else {
@@ -4439,6 +4639,75 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     }
   }
 
+  /**
+   * 暂停或不可见时把视频解码任务迁移到线程池中负载更低的线程
+   * 
+   * 解码器状态无法迁移，新线程上的解码任务从当前时间重新 seek 开始解码，
+   * 直播无法 seek，不做迁移
+   */
+  private async migrateVideoDecoder() {
+    if (this.isLive_
+      || this.status === AVPlayerStatus.SEEKING
+      || this.status !== AVPlayerStatus.PAUSED && this.lowPowerDiscard < AVDiscard.AVDISCARD_NONKEY
+      || this.VideoPipelineProxy
+      || !AVPlayer.VideoDecoderThreadPool
+      || !this.videoDecoder2VideoRenderChannel
+      || !this.selectedVideoStream
+      || this.isAttachmentPicture(this.selectedVideoStream)
+    ) {
+      return
+    }
+
+    const thread = await AVPlayer.VideoDecoderThreadPool.getMigrationTarget(this.taskId)
+    if (!thread) {
+      return
+    }
+
+    const resource = await this.getResource('decoder', this.selectedVideoStream.codecpar.codecId, AVMediaType.AVMEDIA_TYPE_VIDEO)
+    if (!resource) {
+      await AVPlayer.VideoDecoderThreadPool.closeIdle(thread)
+      return
+    }
+
+    this.lastStatus = this.status
+    this.status = AVPlayerStatus.SEEKING
+
+    try {
+      await this.doSeek(this.currentTime, this.selectedVideoStream.index, {
+        onBeforeSeek: async () => {
+          await this.VideoDecoderThread.unregisterTask(this.taskId)
+          await AVPlayer.VideoDecoderThreadPool.move(this.taskId, thread)
+          this.VideoDecoderThread = thread
+
+          this.demuxer2VideoDecoderChannel = createMessageChannel(this.options.enableWorker)
+          this.videoDecoder2VideoRenderChannel = createMessageChannel(this.options.enableWorker)
+
+          await this.registerVideoDecoderTask(this.selectedVideoStream, resource)
+
+          await this.VideoRenderThread.updateLeftPort
+            .transfer(this.videoDecoder2VideoRenderChannel.port2)
+            .invoke(this.taskId, this.videoDecoder2VideoRenderChannel.port2)
+          await AVPlayer.DemuxerThread.reconnectStreamTask
+            .transfer(this.demuxer2VideoDecoderChannel.port1)
+            .invoke(this.subTaskId || this.taskId, this.selectedVideoStream.index, this.demuxer2VideoDecoderChannel.port1)
+
+          this.VideoDecoderThread.setPlayRate(this.taskId, this.playRate)
+          if (this.lowPowerDiscard !== AVDiscard.AVDISCARD_DEFAULT) {
+            await this.VideoDecoderThread.setLowPowerDiscard(this.taskId, this.lowPowerDiscard)
+          }
+        }
+      })
+    }
+    catch (error) {
+      logger.error(`migrate video decoder failed, taskId: ${this.taskId}, error: ${error}`)
+    }
+    finally {
+      // 任务没有迁移过去时目标线程是空的，关闭掉
+      await AVPlayer.VideoDecoderThreadPool.closeIdle(thread)
+      this.status = this.lastStatus
+    }
+  }
+
   /**
    * @hidden
    */
@@ -4602,6 +4871,10 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
    * 停止所有管线
    */
   static async stopPipelines() {
+    if (AVPlayer.VideoDecoderThreadPool) {
+      await AVPlayer.VideoDecoderThreadPool.destroy()
+      AVPlayer.VideoDecoderThreadPool = null
+    }
     if (AVPlayer.VideoRenderThread) {
       await AVPlayer.VideoRenderThread.clear()
       closeThread(AVPlayer.VideoRenderThread)
@@ -4696,6 +4969,9 @@ export default class AVPlayer extends Emitter implements ControllerObserver {
     if (AVPlayer.MSEThread) {
       AVPlayer.MSEThread.setLogLevel(level)
     }
+    if (AVPlayer.VideoDecoderThreadPool) {
+      AVPlayer.VideoDecoderThreadPool.setLogLevel(level)
+    }
 
     logger.info(`set log level: ${level}`)
   }
@@ -53,6 +53,7 @@ export interface ControllerObserver {
   isPictureInPicture: () => boolean
   isMediaStreamMode: () => boolean
   onError: (error: Error) => void
+  onVisibilityChange: (hidden: boolean) => void
 }
 
 export default class Controller {
@@ -161,12 +162,14 @@ export default class Controller {
       this.muxerControlIPCPort.notify('visibilitychange', {
         visibilityHidden: this.visibilityHidden
       })
+      this.observer.onVisibilityChange(this.visibilityHidden)
     }
     this.visibilityHidden = document.visibilityState === 'hidden' && !this.observer.isPictureInPicture()
     document.addEventListener('visibilitychange', this.onVisibilityChange)
     this.muxerControlIPCPort.notify('visibilitychange', {
       visibilityHidden: this.visibilityHidden
     })
+    this.observer.onVisibilityChange(this.visibilityHidden)
   }
 
   public getVideoRenderControlPort() {
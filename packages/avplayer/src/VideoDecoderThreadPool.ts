@@ -0,0 +1,286 @@
+/*
+ * libmedia VideoDecoderThreadPool
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import { VideoDecodePipeline } from '@libmedia/avpipeline'
+
+import {
+  type Thread,
+  closeThread,
+  createThreadFromClass
+} from '@libmedia/cheap'
+
+import {
+  logger
+} from '@libmedia/common'
+
+interface PoolTask {
+  taskId: string
+  /**
+   * 解码负载权重（每秒像素数）
+   */
+  weight: number
+  /**
+   * 暂停或不可见的任务不计入负载
+   */
+  active: boolean
+}
+
+interface PoolThread {
+  thread: Thread<VideoDecodePipeline>
+  ready: Promise<Thread<VideoDecodePipeline>>
+  tasks: Map<string, PoolTask>
+}
+
+/**
+ * 视频解码线程池
+ *
+ * 所有 AVPlayer 实例共享固定上限数量的解码线程，每个线程上可以运行多个解码任务
+ * 新任务放到当前负载最低的线程上，暂停的任务在恢复播放前可以迁移到负载更低的线程
+ */
+export default class VideoDecoderThreadPool {
+
+  private threads: PoolThread[]
+
+  private maxThreads: number
+
+  private level: number
+
+  constructor(maxThreads: number, level: number) {
+    this.threads = []
+    this.maxThreads = Math.max(maxThreads, 1)
+    this.level = level
+  }
+
+  private getLoad(poolThread: PoolThread, exclude?: string) {
+    let load = 0
+    poolThread.tasks.forEach((task) => {
+      if (task.active && task.taskId !== exclude) {
+        load += task.weight
+      }
+    })
+    return load
+  }
+
+  private getPoolThread(taskId: string) {
+    return this.threads.find((poolThread) => poolThread.tasks.has(taskId))
+  }
+
+  private createPoolThread() {
+    const poolThread: PoolThread = {
+      thread: null,
+      ready: null,
+      tasks: new Map()
+    }
+    poolThread.ready = createThreadFromClass(VideoDecodePipeline, {
+      name: `VideoDecoderThread${this.threads.length}`
+    }).run().then((thread) => {
+      thread.setLogLevel(this.level)
+      poolThread.thread = thread
+      return thread
+    })
+    this.threads.push(poolThread)
+    return poolThread
+  }
+
+  /**
+   * 选择负载最低的线程，若最低的线程也有负载且线程数没有达到上限则新建一个线程
+   */
+  private selectPoolThread() {
+    let target: PoolThread = null
+    let min = Infinity
+    for (let i = 0; i < this.threads.length; i++) {
+      const load = this.getLoad(this.threads[i])
+      if (load < min) {
+        min = load
+        target = this.threads[i]
+      }
+    }
+    if (!target || min > 0 && this.threads.length < this.maxThreads) {
+      target = this.createPoolThread()
+    }
+    return target
+  }
+
+  /**
+   * 为任务分配一个解码线程
+   *
+   * @param taskId
+   * @param weight
+   */
+  public async acquire(taskId: string, weight: number) {
+    let poolThread = this.getPoolThread(taskId)
+    if (poolThread) {
+      const task = poolThread.tasks.get(taskId)
+      task.weight = weight
+      task.active = true
+    }
+    else {
+      poolThread = this.selectPoolThread()
+      poolThread.tasks.set(taskId, {
+        taskId,
+        weight,
+        active: true
+      })
+      logger.debug(`acquire video decoder thread ${this.threads.indexOf(poolThread)}, taskId: ${taskId}`)
+    }
+    return poolThread.ready
+  }
+
+  /**
+   * 释放任务占用的线程，空闲线程会被关闭（至少保留一个）
+   *
+   * 调用之前任务需要已经从线程上 unregister
+   *
+   * @param taskId
+   */
+  public async release(taskId: string) {
+    const poolThread = this.getPoolThread(taskId)
+    if (poolThread) {
+      poolThread.tasks.delete(taskId)
+      if (!poolThread.tasks.size && this.threads.length > 1) {
+        this.threads.splice(this.threads.indexOf(poolThread), 1)
+        const thread = await poolThread.ready
+        await thread.clear()
+        closeThread(thread)
+      }
+    }
+  }
+
+  /**
+   * 关闭没有任务的线程（至少保留一个），迁移失败时用来回收 getMigrationTarget 新建的线程
+   *
+   * @param thread
+   */
+  public async closeIdle(thread: Thread<VideoDecodePipeline>) {
+    const poolThread = this.threads.find((poolThread) => poolThread.thread === thread)
+    if (poolThread && !poolThread.tasks.size && this.threads.length > 1) {
+      this.threads.splice(this.threads.indexOf(poolThread), 1)
+      await thread.clear()
+      closeThread(thread)
+    }
+  }
+
+  /**
+   * 设置任务是否计入负载，播放器暂停或不可见时设置为 false
+   *
+   * @param taskId
+   * @param active
+   */
+  public setActive(taskId: string, active: boolean) {
+    const poolThread = this.getPoolThread(taskId)
+    if (poolThread) {
+      poolThread.tasks.get(taskId).active = active
+    }
+  }
+
+  /**
+   * 获取任务应该迁移过去的线程，不需要迁移返回 null
+   *
+   * 当前线程上还有其他活跃任务时才考虑迁移
+   *
+   * @param taskId
+   */
+  public async getMigrationTarget(taskId: string) {
+    const current = this.getPoolThread(taskId)
+    if (!current) {
+      return null
+    }
+    const task = current.tasks.get(taskId)
+    const currentLoad = this.getLoad(current, taskId)
+
+    if (currentLoad === 0) {
+      return null
+    }
+
+    let target: PoolThread = null
+    let min = Infinity
+    for (let i = 0; i < this.threads.length; i++) {
+      if (this.threads[i] === current) {
+        continue
+      }
+      const load = this.getLoad(this.threads[i])
+      if (load < min) {
+        min = load
+        target = this.threads[i]
+      }
+    }
+
+    // 有空闲线程直接迁移过去
+    if (target && min === 0) {
+      return target.ready
+    }
+    if (this.threads.length < this.maxThreads) {
+      return this.createPoolThread().ready
+    }
+    // 线程数已满，迁移后目标线程不比当前线程重才迁移
+    if (target && min + task.weight <= currentLoad) {
+      return target.ready
+    }
+    return null
+  }
+
+  /**
+   * 将任务记录迁移到目标线程，调用之前需要在旧线程上 unregister，之后在新线程上重新 register
+   *
+   * @param taskId
+   * @param thread
+   */
+  public async move(taskId: string, thread: Thread<VideoDecodePipeline>) {
+    const current = this.getPoolThread(taskId)
+    const target = this.threads.find((poolThread) => poolThread.thread === thread)
+    if (!current || !target || current === target) {
+      return
+    }
+    target.tasks.set(taskId, current.tasks.get(taskId))
+    current.tasks.delete(taskId)
+
+    logger.info(`move video decode task to thread ${this.threads.indexOf(target)}, taskId: ${taskId}`)
+
+    if (!current.tasks.size && this.threads.length > 1) {
+      this.threads.splice(this.threads.indexOf(current), 1)
+      const thread = await current.ready
+      await thread.clear()
+      closeThread(thread)
+    }
+  }
+
+  public setLogLevel(level: number) {
+    this.level = level
+    this.threads.forEach((poolThread) => {
+      if (poolThread.thread) {
+        poolThread.thread.setLogLevel(level)
+      }
+    })
+  }
+
+  public async destroy() {
+    for (let i = 0; i < this.threads.length; i++) {
+      const thread = await this.threads[i].ready
+      await thread.clear()
+      closeThread(thread)
+    }
+    this.threads = []
+  }
+}
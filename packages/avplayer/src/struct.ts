@@ -35,7 +35,9 @@ import type {
 
 import type {
   AVFrameRef,
-  AVPacketRef
+  AVPacketRef,
+  AVRing,
+  AVByteRing
 } from '@libmedia/avutil'
 
 @struct
@@ -44,5 +46,7 @@ export class AVPlayerGlobalData {
   avframeList: List<pointer<AVFrameRef>>
   avpacketListMutex: Mutex
   avframeListMutex: Mutex
+  videoPacketRing: AVRing
+  ioByteRing: AVByteRing
   stats: Stats
 }
@@ -0,0 +1,155 @@
+/*
+ * libmedia subtitle event store
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type { AssEvent } from '@libmedia/avformat/internal'
+
+import {
+  array
+} from '@libmedia/common'
+
+/**
+ * 字幕事件存储
+ *
+ * 事件按 Start 排序，在排序后的数组上建立一棵隐式区间树（每个节点保存子树中最大的 End），
+ * 查询某一时刻正在显示的事件只需要 O(log n + k)
+ *
+ * 外挂字幕文件整个读取一次存入，seek 和切换轨道不需要重新解封装和解析
+ */
+export default class SubtitleEventStore {
+
+  private events: AssEvent[]
+
+  private tree: int64[]
+
+  private size: int32
+
+  private dirty: boolean
+
+  /**
+   * 是否已经读取完所有事件
+   */
+  public ended: boolean
+
+  constructor() {
+    this.events = []
+    this.tree = []
+    this.size = 0
+    this.dirty = false
+    this.ended = false
+  }
+
+  public add(event: AssEvent) {
+    const events = this.events
+    // 解封装出来的事件基本是按时间排序的，大多数情况直接追加
+    if (!events.length || events[events.length - 1].Start <= event.Start) {
+      events.push(event)
+    }
+    else {
+      const index = array.binarySearch(events, (item) => {
+        if (item.Start > event.Start) {
+          return -1
+        }
+        return 1
+      })
+      events.splice(index > -1 ? index : events.length, 0, event)
+    }
+    this.dirty = true
+  }
+
+  private build() {
+    const n = this.events.length
+    let size = 1
+    while (size < n) {
+      size <<= 1
+    }
+    this.size = size
+    this.tree = new Array(size << 1).fill(-1n)
+    for (let i = 0; i < n; i++) {
+      this.tree[size + i] = this.events[i].End
+    }
+    for (let i = size - 1; i > 0; i--) {
+      const left = this.tree[i << 1]
+      const right = this.tree[(i << 1) + 1]
+      this.tree[i] = left > right ? left : right
+    }
+    this.dirty = false
+  }
+
+  /**
+   * 查找 Start <= time < End 的事件
+   *
+   * @param time 毫秒
+   * @param callback
+   */
+  public query(time: int64, callback: (event: AssEvent) => void) {
+    if (!this.events.length) {
+      return
+    }
+    if (this.dirty) {
+      this.build()
+    }
+
+    // 第一个 Start > time 的事件，之后的事件都还没有开始
+    let count = array.binarySearch(this.events, (item) => {
+      if (item.Start > time) {
+        return -1
+      }
+      return 1
+    })
+    if (count < 0) {
+      count = this.events.length
+    }
+    if (count === 0) {
+      return
+    }
+
+    const stack: int32[] = [1]
+    while (stack.length) {
+      const node = stack.pop()
+      if (this.tree[node] <= time) {
+        continue
+      }
+      if (node >= this.size) {
+        callback(this.events[node - this.size])
+        continue
+      }
+      // 计算右子树覆盖的起始下标，超出 count 的部分不用遍历
+      let depth = 31 - Math.clz32(node)
+      const rightStart = (((node << 1) + 1) << (Math.log2(this.size) - depth - 1)) - this.size
+      if (rightStart < count) {
+        stack.push((node << 1) + 1)
+      }
+      stack.push(node << 1)
+    }
+  }
+
+  public clear() {
+    this.events.length = 0
+    this.tree.length = 0
+    this.size = 0
+    this.dirty = false
+    this.ended = false
+  }
+}
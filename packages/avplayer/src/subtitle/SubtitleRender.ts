@@ -24,6 +24,7 @@
  */
 
 import AssRender from './AssRender'
+import SubtitleEventStore from './SubtitleEventStore'
 import { type AssEvent, AssEventType, ass } from '@libmedia/avformat/internal'
 import { parseEffect } from 'ass-compiler/src/parser/effect'
 import { parseText } from 'ass-compiler/src/parser/text'
@@ -72,6 +73,8 @@ import {
   IPCPort
 } from '@libmedia/common/network'
 
+const STORE_PULL_BATCH = 50
+
 export interface SubtitleRenderOptions {
   delay?: int64
   getCurrentTime: () => int64
@@ -222,6 +225,16 @@ export default class SubtitleRender {
 
   private queue: AssEvent[]
 
+  /**
+   * 外挂字幕每个 task 的事件存储，整个文件读取完之后 seek 和切换轨道都直接从这里查找
+   */
+  private stores: Map<string, SubtitleEventStore>
+
+  /**
+   * 当前已经渲染出来的事件（store 模式）
+   */
+  private rendered: Set<AssEvent>
+
   private ended: boolean
 
   private options: SubtitleRenderOptions
@@ -241,6 +254,8 @@ export default class SubtitleRender {
     this.ended = false
     this.pulling = false
     this.queue = []
+    this.stores = new Map()
+    this.rendered = new Set()
     this.delay = 0n
     this.demuxer2SubtitleRenderChannels = new Map()
     this.leftPorts = new Map()
@@ -260,6 +275,18 @@ export default class SubtitleRender {
 
     this.loop = new LoopTask(() => {
 
+      const store = this.stores.get(this.currentPort)
+
+      if (store) {
+        if (!store.ended) {
+          this.pull()
+        }
+        const currentTime = this.options.getCurrentTime() - this.delay
+        this.render.clear(currentTime)
+        this.renderStore(store, currentTime)
+        return
+      }
+
       if (!this.queue.length && this.ended) {
         this.loop.stop()
       }
@@ -285,6 +312,31 @@ export default class SubtitleRender {
     }, 0, 50, false)
   }
 
+  private renderStore(store: SubtitleEventStore, currentTime: int64) {
+    this.rendered.forEach((event) => {
+      if (event.End <= currentTime || event.Start > currentTime) {
+        this.rendered.delete(event)
+      }
+    })
+    store.query(currentTime, (event) => {
+      if (!this.rendered.has(event)) {
+        this.rendered.add(event)
+        // AssRender 会修改传入事件的时间，store 中的事件需要保留
+        this.render.render(object.extend({}, event))
+      }
+    })
+  }
+
+  private pushEvent(event: AssEvent) {
+    const store = this.stores.get(this.currentPort)
+    if (store) {
+      store.add(event)
+    }
+    else {
+      this.queue.push(event)
+    }
+  }
+
   private getAssHeader(codecpar: pointer<AVCodecParameters>) {
     let header = ''
     if (codecpar.codecId === AVCodecID.AV_CODEC_ID_ASS && codecpar.extradataSize) {
@@ -320,13 +372,13 @@ export default class SubtitleRender {
             if (event.End == null) {
               event.End = subtitle.pts + subtitle.duration
             }
-            this.queue.push(event)
+            this.pushEvent(event)
           }
           else if (rect.type === AVSubtitleType.SUBTITLE_WEBVTT) {
-            this.queue.push(this.webvtt2AssEvent(rect.text, subtitle.pts, subtitle.pts + subtitle.duration))
+            this.pushEvent(this.webvtt2AssEvent(rect.text, subtitle.pts, subtitle.pts + subtitle.duration))
           }
           else {
-            this.queue.push(this.text2AssEvent(rect.text, subtitle.pts, subtitle.pts + subtitle.duration))
+            this.pushEvent(this.text2AssEvent(rect.text, subtitle.pts, subtitle.pts + subtitle.duration))
           }
         }
       }
@@ -373,37 +425,63 @@ export default class SubtitleRender {
     }
     this.pulling = true
     const currentPort = this.currentPort
-    const avpacket = await this.leftPorts.get(this.currentPort).request<pointer<AVPacketRef>>('pull')
-    if (avpacket === IOError.END) {
-      logger.debug('SubtitleRender end')
-      this.decoder?.flush()
-      this.ended = true
-    }
-    else if (avpacket < 0) {
-      logger.debug(`SubtitleRender pull avpacket error, ret: ${avpacket}`)
-      this.ended = true
-    }
-    else if (this.loop && currentPort === this.currentPort) {
-      avpacket.pts = avRescaleQ2(avpacket.pts, addressof(avpacket.timeBase), AV_MILLI_TIME_BASE_Q)
-      avpacket.duration = avRescaleQ2(avpacket.duration, addressof(avpacket.timeBase), AV_MILLI_TIME_BASE_Q)
-      const ret = this.decoder.decode(avpacket)
-      if (this.avpacketPool) {
-        this.avpacketPool.release(avpacket)
-      }
-      else {
-        destroyAVPacket(avpacket)
+    const store = this.stores.get(currentPort)
+
+    // store 模式下不受播放进度限制，一次拉取多个 packet 尽快把整个文件读完
+    let count = store ? STORE_PULL_BATCH : 1
+
+    while (count-- > 0) {
+      const avpacket = await this.leftPorts.get(currentPort).request<pointer<AVPacketRef>>('pull')
+      if (avpacket === IOError.END) {
+        logger.debug('SubtitleRender end')
+        this.decoder?.flush()
+        if (store) {
+          store.ended = true
+        }
+        else {
+          this.ended = true
+        }
+        break
       }
-      if (ret < 0) {
-        logger.debug(`SubtitleRender decode avpacket error, ret: ${avpacket}`)
-        this.ended = true
+      else if (avpacket < 0) {
+        logger.debug(`SubtitleRender pull avpacket error, ret: ${avpacket}`)
+        if (store) {
+          store.ended = true
+        }
+        else {
+          this.ended = true
+        }
+        break
       }
-    }
-    else {
-      if (this.avpacketPool) {
-        this.avpacketPool.release(avpacket)
+      else if (this.loop && currentPort === this.currentPort) {
+        avpacket.pts = avRescaleQ2(avpacket.pts, addressof(avpacket.timeBase), AV_MILLI_TIME_BASE_Q)
+        avpacket.duration = avRescaleQ2(avpacket.duration, addressof(avpacket.timeBase), AV_MILLI_TIME_BASE_Q)
+        const ret = this.decoder.decode(avpacket)
+        if (this.avpacketPool) {
+          this.avpacketPool.release(avpacket)
+        }
+        else {
+          destroyAVPacket(avpacket)
+        }
+        if (ret < 0) {
+          logger.debug(`SubtitleRender decode avpacket error, ret: ${avpacket}`)
+          if (store) {
+            store.ended = true
+          }
+          else {
+            this.ended = true
+          }
+          break
+        }
       }
       else {
-        destroyAVPacket(avpacket)
+        if (this.avpacketPool) {
+          this.avpacketPool.release(avpacket)
+        }
+        else {
+          destroyAVPacket(avpacket)
+        }
+        break
       }
     }
     this.pulling = false
@@ -438,6 +516,7 @@ export default class SubtitleRender {
 
   public reset() {
     this.queue.length = 0
+    this.rendered.clear()
     this.render.clearAll()
   }
 
@@ -455,9 +534,20 @@ export default class SubtitleRender {
     }
   }
 
-  public setDemuxTask(taskId: string) {
+  /**
+   * 设置当前拉取的 demux task
+   *
+   * @param taskId
+   * @param external 是否是外挂字幕，外挂字幕从头读取整个文件存入 SubtitleEventStore，
+   *                 之后 seek 和切换轨道不需要再 seek demuxer 重新读取
+   */
+  public setDemuxTask(taskId: string, external: boolean = false) {
     if (this.currentPort !== taskId) {
       this.pulling = false
+      this.rendered.clear()
+    }
+    if (external && !this.stores.has(taskId)) {
+      this.stores.set(taskId, new SubtitleEventStore())
     }
     this.currentPort = taskId
   }
@@ -468,6 +558,11 @@ export default class SubtitleRender {
     this.leftPorts.clear()
     this.demuxer2SubtitleRenderChannels.clear()
     this.queue.length = 0
+    this.stores.forEach((store) => {
+      store.clear()
+    })
+    this.stores.clear()
+    this.rendered.clear()
     this.render.destroy()
     this.render = null
     this.decoder.close()
@@ -106,6 +106,7 @@ export default class VideoPipeline {
           stats: {
             videoFrameDecodeCount: stats.videoFrameDecodeCount,
             videoFrameDecodeIntervalMax: stats.videoFrameDecodeIntervalMax,
+            videoPacketHandoffTime: stats.videoPacketHandoffTime,
             videoDecodeErrorPacketCount: stats.videoDecodeErrorPacketCount,
             videoCurrentTime: stats.videoCurrentTime,
             videoFrameRenderCount: stats.videoFrameRenderCount,
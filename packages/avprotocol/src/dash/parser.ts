@@ -3,7 +3,7 @@
  * MIT license 
  */
 
-import type { MPD, MPDMediaList, Period, Protection, SegmentTemplate } from './type'
+import type { Media, MPD, MPDMediaList, Period, Protection, Segment, SegmentTemplate } from './type'
 
 import {
   xml2Json,
@@ -93,6 +93,166 @@ function parseProtection(protection: Data[]) {
   return result
 }
 
+/**
+ * SegmentTemplate 生成的分片，url 在第一次访问时才生成
+ */
+class TemplateSegment implements Segment {
+  idx: number
+  start: number
+  end: number
+  segmentDuration: number
+  pending: boolean
+  /**
+   * SegmentTimeline 中的开始时间和时长（timescale 单位），按 $Number$ 生成的分片没有
+   */
+  time: number
+  duration: number
+
+  private template: string
+  private url_: string
+
+  constructor(
+    template: string,
+    idx: number,
+    start: number,
+    end: number,
+    segmentDuration: number,
+    pending: boolean,
+    time?: number,
+    duration?: number
+  ) {
+    this.template = template
+    this.idx = idx
+    this.start = start
+    this.end = end
+    this.segmentDuration = segmentDuration
+    this.pending = pending
+    this.time = time
+    this.duration = duration
+  }
+
+  get url() {
+    if (!this.url_) {
+      let url = this.template.replace(/\$Number(%(\d+)d)?\$/g, (s0, s1, s2) => {
+        if (s2) {
+          return preFixInteger(this.idx, +s2)
+        }
+        return toString(this.idx)
+      })
+      if (is.number(this.time)) {
+        url = url.replace(/\$Time\$/g, toString(this.time))
+      }
+      this.url_ = url
+    }
+    return this.url_
+  }
+}
+
+/**
+ * 查找上一次解析结果中同一个 Representation 的 SegmentTimeline 分片列表
+ */
+function findTimelineMedia(previous: MPDMediaList, id: string, baseURL: string, timescale: number) {
+  if (!previous) {
+    return null
+  }
+  const media: Media = previous.mediaList.video.find((m) => m.id === id)
+    || previous.mediaList.audio.find((m) => m.id === id)
+    || previous.mediaList.subtitle.find((m) => m.id === id)
+  const last = media?.mediaSegments?.[media.mediaSegments.length - 1]
+  if (media
+    && media.baseURL === baseURL
+    && media.timescale === timescale
+    && last instanceof TemplateSegment
+    && is.number(last.time)
+  ) {
+    return media
+  }
+  return null
+}
+
+/**
+ * 删除时移窗口之外的分片，没有 timeShiftBufferDepth 时按服务端当前列表的开始时间
+ */
+function trimTimeline(segments: Segment[], timeShiftBufferDepth: number, windowStart: number) {
+  if (!segments.length) {
+    return
+  }
+  const cutoff = timeShiftBufferDepth
+    ? segments[segments.length - 1].end - timeShiftBufferDepth
+    : windowStart
+  let count = 0
+  while (count < segments.length - 1 && segments[count].end <= cutoff) {
+    count++
+  }
+  if (count) {
+    segments.splice(0, count)
+  }
+}
+
+/**
+ * 展开 SegmentTimeline，只追加结束时间在 lastEnd 之后的分片
+ * 
+ * 返回时间线的结束时间和开始时间
+ */
+function expandTimeline(
+  S: { t?: string, d: string, r?: string }[],
+  start: number,
+  timescale: number,
+  duration: number,
+  template: string,
+  segments: Segment[],
+  lastEnd: number
+) {
+  let startTime = 0
+  let windowStart = 0
+  let index = start
+  for (let i = 0; i < S.length; i++) {
+    let d = parseFloat(S[i].d)
+    if (S[i].t) {
+      startTime = parseFloat(S[i].t)
+    }
+    if (i === 0) {
+      windowStart = startTime / timescale
+    }
+
+    let r = 1
+    if (S[i].r) {
+      r = parseInt(S[i].r)
+      if (r === -1 && duration) {
+        r = Math.ceil(duration * timescale / d)
+      }
+      else {
+        r += 1
+      }
+    }
+    if (startTime + d * r <= lastEnd) {
+      startTime += d * r
+      index += r
+      continue
+    }
+    for (let j = 0; j < r; j++) {
+      if (startTime + d > lastEnd) {
+        segments.push(new TemplateSegment(
+          template,
+          index,
+          startTime / timescale,
+          (startTime + d) / timescale,
+          d / timescale,
+          false,
+          startTime,
+          d
+        ))
+      }
+      index++
+      startTime += d
+    }
+  }
+  return {
+    end: startTime,
+    windowStart
+  }
+}
+
 function joinPath(base: string, path: string) {
   if (/^https?:\/\//.test(path)) {
     return path
@@ -100,7 +260,7 @@ function joinPath(base: string, path: string) {
   return base + path
 }
 
-function parsePeriod(result: MPD, period: Period, url: string) {
+function parsePeriod(result: MPD, period: Period, url: string, previous?: MPDMediaList) {
   const list: MPDMediaList = {
     mediaList: {
       audio: [],
@@ -227,7 +387,7 @@ function parsePeriod(result: MPD, period: Period, url: string) {
       }
       repID.push(rItem.id)
       let initSegment = ''
-      const mediaSegments = []
+      let mediaSegments: Segment[] = []
       let timescale = 0
       let duration = list.duration
       let baseURL = joinPath(url.slice(0, url.lastIndexOf('/') + 1), adaptationSetBaseUrl)
@@ -342,6 +502,7 @@ function parsePeriod(result: MPD, period: Period, url: string) {
           let start = ST.startNumber ? parseInt(ST.startNumber) : 1
           initSegment = ST.initialization
           timescale = parseFloat(ST.timescale || '1')
+          const template = baseURL + ST.media.replace(/\$RepresentationID\$/g, rItem.id)
 
           if (ST.duration && !ST.SegmentTimeline) {
             duration = parseFloat(ST.duration)
@@ -369,60 +530,26 @@ function parsePeriod(result: MPD, period: Period, url: string) {
                 segmentDuration = list.duration - segmentDuration * (end - start)
                 endTime = list.duration
               }
-              mediaSegments.push({
-                idx: i,
-                start: startTime,
-                end: endTime,
-                url: baseURL + ST.media.replace(/\$RepresentationID\$/g, rItem.id).replace(/\$Number(%(\d+)d)?\$/g, (s0, s1, s2) => {
-                  if (s2) {
-                    return preFixInteger(i, +s2)
-                  }
-                  return toString(i)
-                }),
-                segmentDuration,
-                pending: i > generateIndex
-              })
+              mediaSegments.push(new TemplateSegment(template, i, startTime, endTime, segmentDuration, i > generateIndex))
             }
           }
           else if (ST.SegmentTimeline && ST.SegmentTimeline.S) {
             const S = is.array(ST.SegmentTimeline.S) ? ST.SegmentTimeline.S : [ST.SegmentTimeline.S]
-            let startTime = 0
-            let index = start
-            for (let i = 0; i < S.length; i++) {
-              let d = parseFloat(S[i].d)
-              if (S[i].t) {
-                startTime = parseFloat(S[i].t)
-              }
-
-              let r = 1
-              if (S[i].r) {
-                r = parseInt(S[i].r)
-                if (r === -1 && duration) {
-                  r = Math.ceil(duration * timescale / d)
-                }
-                else {
-                  r += 1
-                }
-              }
-              for (let j = 0; j < r; j++) {
-                mediaSegments.push({
-                  idx: index,
-                  start: startTime / timescale,
-                  end: (startTime + d) / timescale,
-                  url: baseURL + ST.media.replace(/\$RepresentationID\$/g, rItem.id)
-                    .replace(/\$Number(%(\d+)d)?\$/g, (s0, s1, s2) => {
-                      if (s2) {
-                        return preFixInteger(index, +s2)
-                      }
-                      return toString(index)
-                    })
-                    .replace(/\$Time\$/g, toString(startTime)),
-                  segmentDuration: d / timescale
-                })
-                index++
-                startTime += d
+            // 直播刷新时沿用上一次的分片列表，只追加比已有分片更新的 S
+            const timelineMedia = list.type === 'live' ? findTimelineMedia(previous, rItem.id, baseURL, timescale) : null
+            if (timelineMedia) {
+              const last = timelineMedia.mediaSegments[timelineMedia.mediaSegments.length - 1] as TemplateSegment
+              const lastEnd = last.time + last.duration
+              const { end, windowStart } = expandTimeline(S, start, timescale, duration, template, timelineMedia.mediaSegments, lastEnd)
+              // 新的时间线比已有的短说明时间线重置了，重新生成
+              if (end >= lastEnd) {
+                mediaSegments = timelineMedia.mediaSegments
+                trimTimeline(mediaSegments, list.timeShiftBufferDepth, windowStart)
               }
             }
+            if (!timelineMedia || mediaSegments !== timelineMedia.mediaSegments) {
+              expandTimeline(S, start, timescale, duration, template, mediaSegments, -Infinity)
+            }
           }
         }
         else if (rItem.SegmentList) {
@@ -507,11 +634,18 @@ function parsePeriod(result: MPD, period: Period, url: string) {
   return list
 }
 
-export default function parser(xml: string, url: string) {
+/**
+ * 解析 MPD
+ * 
+ * @param xml 
+ * @param url 
+ * @param previous 直播刷新时传入上一次的解析结果，SegmentTimeline 增量合并到上一次的分片列表中
+ */
+export default function parser(xml: string, url: string, previous?: MPDMediaList) {
   const result = parseMPD(xml).MPD
   if (result.type === 'dynamic') {
     const period = is.array(result.Period) ? result.Period[result.Period.length - 1] : result.Period
-    return parsePeriod(result, period, url)
+    return parsePeriod(result, period, url, previous)
   }
   else {
     const periods = is.array(result.Period) ? result.Period : [result.Period]
@@ -97,6 +97,7 @@ export interface SegmentTemplate {
   timescale?: string
   duration?: string
   presentationTimeOffset?: string
+  availabilityTimeOffset?: string
   availabilityTimeComplete?: string
   SegmentTimeline: SegmentTimeline
 }
@@ -0,0 +1,97 @@
+/*
+ * libmedia dash mpd writer
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type { MPD } from './type'
+
+function escapeXml(value: string) {
+  return value
+    .replace(/&/g, '&amp;')
+    .replace(/</g, '&lt;')
+    .replace(/>/g, '&gt;')
+    .replace(/"/g, '&quot;')
+}
+
+/**
+ * 和 parser 的 xml2Json 结构对应：
+ * 首字母大写的 key 为子元素，其余为属性，value 为文本内容
+ */
+function toXml(name: string, node: Record<string, any>, indent: string) {
+  const attributes: string[] = []
+  const children: string[] = []
+  let text: string
+
+  for (const key in node) {
+    const value = node[key]
+    if (value == null) {
+      continue
+    }
+    if (key === 'value') {
+      text = escapeXml(String(value))
+    }
+    else if (/^[A-Z]/.test(key)) {
+      const list = Array.isArray(value) ? value : [value]
+      list.forEach((item) => {
+        if (typeof item === 'object') {
+          children.push(toXml(key, item, indent + '  '))
+        }
+        else {
+          children.push(`${indent}  <${key}>${escapeXml(String(item))}</${key}>`)
+        }
+      })
+    }
+    else {
+      attributes.push(` ${key}="${escapeXml(String(value))}"`)
+    }
+  }
+
+  const open = `${indent}<${name}${attributes.join('')}`
+  if (children.length) {
+    return `${open}>\n${children.join('\n')}\n${indent}</${name}>`
+  }
+  if (text != null) {
+    return `${open}>${text}</${name}>`
+  }
+  return `${open}/>`
+}
+
+/**
+ * 将 MPD 序列化为 xml 文本
+ */
+export function stringifyMPD(mpd: Partial<MPD>, profiles: string = 'urn:mpeg:dash:profile:isoff-live:2011') {
+  return '<?xml version="1.0" encoding="utf-8"?>\n'
+    + toXml('MPD', {
+      xmlns: 'urn:mpeg:dash:schema:mpd:2011',
+      profiles,
+      ...mpd
+    }, '')
+    + '\n'
+}
+
+/**
+ * 秒转 xs:duration
+ */
+export function toDuration(seconds: number) {
+  return `PT${Number(seconds.toFixed(3))}S`
+}
@@ -0,0 +1,161 @@
+/*
+ * libmedia m3u8 writer
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type {
+  MediaPlaylist,
+  MediaInitializationSection,
+  PartialSegment,
+  Byterange
+} from './types'
+
+function formatDuration(duration: number) {
+  return Number(duration.toFixed(5)).toString()
+}
+
+function formatByterange(byterange: Byterange) {
+  return `${byterange.length}@${byterange.offset}`
+}
+
+function stringifyMap(map: MediaInitializationSection) {
+  let attributes = `URI="${map.uri}"`
+  if (map.byterange) {
+    attributes += `,BYTERANGE="${formatByterange(map.byterange)}"`
+  }
+  return `#EXT-X-MAP:${attributes}`
+}
+
+function stringifyPart(part: PartialSegment) {
+  if (part.hint) {
+    let attributes = `TYPE=PART,URI="${part.uri}"`
+    if (part.byterange) {
+      attributes += `,BYTERANGE-START=${part.byterange.offset}`
+      if (part.byterange.length) {
+        attributes += `,BYTERANGE-LENGTH=${part.byterange.length}`
+      }
+    }
+    return `#EXT-X-PRELOAD-HINT:${attributes}`
+  }
+  let attributes = `DURATION=${formatDuration(part.duration)},URI="${part.uri}"`
+  if (part.independent) {
+    attributes += ',INDEPENDENT=YES'
+  }
+  if (part.byterange) {
+    attributes += `,BYTERANGE="${formatByterange(part.byterange)}"`
+  }
+  if (part.gap) {
+    attributes += ',GAP=YES'
+  }
+  return `#EXT-X-PART:${attributes}`
+}
+
+/**
+ * 将 MediaPlaylist 序列化为 m3u8 文本
+ * 
+ * 支持 LL-HLS 的 EXT-X-PART、EXT-X-PART-INF、EXT-X-SERVER-CONTROL 和 EXT-X-PRELOAD-HINT，
+ * 最后一个 segment 的 uri 为空时表示该 segment 还未完成，只输出其已完成的 part
+ */
+export function stringifyMediaPlaylist(playlist: MediaPlaylist) {
+  const lines: string[] = ['#EXTM3U']
+
+  if (playlist.version) {
+    lines.push(`#EXT-X-VERSION:${playlist.version}`)
+  }
+  lines.push(`#EXT-X-TARGETDURATION:${Math.ceil(playlist.targetDuration)}`)
+
+  if (playlist.lowLatencyCompatibility) {
+    const { canBlockReload, canSkipUntil, holdBack, partHoldBack } = playlist.lowLatencyCompatibility
+    const attributes: string[] = []
+    if (canBlockReload) {
+      attributes.push('CAN-BLOCK-RELOAD=YES')
+    }
+    if (canSkipUntil) {
+      attributes.push(`CAN-SKIP-UNTIL=${formatDuration(canSkipUntil)}`)
+    }
+    if (holdBack) {
+      attributes.push(`HOLD-BACK=${formatDuration(holdBack)}`)
+    }
+    if (partHoldBack) {
+      attributes.push(`PART-HOLD-BACK=${formatDuration(partHoldBack)}`)
+    }
+    if (attributes.length) {
+      lines.push(`#EXT-X-SERVER-CONTROL:${attributes.join(',')}`)
+    }
+  }
+  if (playlist.partTargetDuration) {
+    lines.push(`#EXT-X-PART-INF:PART-TARGET=${formatDuration(playlist.partTargetDuration)}`)
+  }
+  if (playlist.mediaSequenceBase) {
+    lines.push(`#EXT-X-MEDIA-SEQUENCE:${playlist.mediaSequenceBase}`)
+  }
+  if (playlist.discontinuitySequenceBase) {
+    lines.push(`#EXT-X-DISCONTINUITY-SEQUENCE:${playlist.discontinuitySequenceBase}`)
+  }
+  if (playlist.playlistType) {
+    lines.push(`#EXT-X-PLAYLIST-TYPE:${playlist.playlistType}`)
+  }
+  if (playlist.independentSegments) {
+    lines.push('#EXT-X-INDEPENDENT-SEGMENTS')
+  }
+  if (playlist.start) {
+    lines.push(`#EXT-X-START:TIME-OFFSET=${playlist.start.offset}${playlist.start.precise ? ',PRECISE=YES' : ''}`)
+  }
+
+  let lastMap: MediaInitializationSection
+  playlist.segments.forEach((segment) => {
+    if (segment.discontinuity) {
+      lines.push('#EXT-X-DISCONTINUITY')
+    }
+    if (segment.map && segment.map !== lastMap) {
+      lines.push(stringifyMap(segment.map))
+      lastMap = segment.map
+    }
+    if (segment.programDateTime) {
+      lines.push(`#EXT-X-PROGRAM-DATE-TIME:${segment.programDateTime.toISOString()}`)
+    }
+    segment.parts.forEach((part) => {
+      lines.push(stringifyPart(part))
+    })
+    if (segment.uri) {
+      lines.push(`#EXTINF:${formatDuration(segment.duration)},${segment.title ?? ''}`)
+      if (segment.byterange) {
+        lines.push(`#EXT-X-BYTERANGE:${formatByterange(segment.byterange)}`)
+      }
+      lines.push(segment.uri)
+    }
+  })
+
+  playlist.prefetchSegments.forEach((segment) => {
+    if (segment.discontinuity) {
+      lines.push('#EXT-X-PREFETCH-DISCONTINUITY')
+    }
+    lines.push(`#EXT-X-PREFETCH:${segment.uri}`)
+  })
+
+  if (playlist.endlist) {
+    lines.push('#EXT-X-ENDLIST')
+  }
+
+  return lines.join('\n') + '\n'
+}
@@ -0,0 +1,424 @@
+/*
+ * libmedia yuv to rgba
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+
+#include "wasmenv.h"
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+#define FORMAT_YUV420P 0
+#define FORMAT_NV12 1
+#define FORMAT_YUV420P10LE 2
+#define FORMAT_P010LE 3
+
+#define MATRIX_BT601 0
+#define MATRIX_BT709 1
+#define MATRIX_BT2020 2
+
+#define FILTER_NEAREST 0
+#define FILTER_BILINEAR 1
+
+/**
+ * 采样读取方式，统一转换到 10 bit 计算
+ * 0 8 bit，左移 2 位
+ * 1 16 bit 低 10 位有效
+ * 2 16 bit 高 10 位有效（P010）
+ */
+#define DEPTH_8 0
+#define DEPTH_10 1
+#define DEPTH_10_MSB 2
+
+/**
+ * 系数定点精度，输出从 10 bit 到 8 bit 再右移 2 位
+ */
+#define COEF_BITS 12
+#define OUT_SHIFT (COEF_BITS + 2)
+
+typedef struct Coef {
+  int32_t yoff;
+  int32_t ycoef;
+  int32_t rv;
+  int32_t gu;
+  int32_t gv;
+  int32_t bu;
+} Coef;
+
+typedef struct Source {
+  const uint8_t *y;
+  const uint8_t *u;
+  const uint8_t *v;
+  int32_t y_stride;
+  int32_t uv_stride;
+  int32_t width;
+  int32_t height;
+  int32_t depth;
+  int32_t interleaved;
+} Source;
+
+static int32_t fixed(double v) {
+  return (int32_t)(v * (1 << COEF_BITS) + (v < 0 ? -0.5 : 0.5));
+}
+
+static void init_coef(Coef *coef, int32_t matrix, int32_t full_range) {
+  double kr = 0.299;
+  double kb = 0.114;
+  if (matrix == MATRIX_BT709) {
+    kr = 0.2126;
+    kb = 0.0722;
+  }
+  else if (matrix == MATRIX_BT2020) {
+    kr = 0.2627;
+    kb = 0.0593;
+  }
+  double kg = 1.0 - kr - kb;
+
+  double ys = 1.0;
+  double cs = 1.0;
+  coef->yoff = 0;
+  if (!full_range) {
+    // 10 bit 的 limited range 亮度 64 - 940，色度 64 - 960
+    ys = 1023.0 / 876.0;
+    cs = 1023.0 / 896.0;
+    coef->yoff = 64;
+  }
+  coef->ycoef = fixed(ys);
+  coef->rv = fixed(cs * 2.0 * (1.0 - kr));
+  coef->gu = fixed(cs * 2.0 * (1.0 - kb) * kb / kg);
+  coef->gv = fixed(cs * 2.0 * (1.0 - kr) * kr / kg);
+  coef->bu = fixed(cs * 2.0 * (1.0 - kb));
+}
+
+static inline int32_t load_sample(const uint8_t *row, int32_t index, int32_t depth) {
+  if (depth == DEPTH_8) {
+    return row[index] << 2;
+  }
+  uint16_t v = ((const uint16_t *)row)[index];
+  return depth == DEPTH_10 ? (v & 0x3ff) : (v >> 6);
+}
+
+static inline void load_chroma(const Source *src, int32_t cy, int32_t cx, int32_t *u, int32_t *v) {
+  const uint8_t *row = src->u + cy * src->uv_stride;
+  if (src->interleaved) {
+    *u = load_sample(row, cx << 1, src->depth);
+    *v = load_sample(row, (cx << 1) + 1, src->depth);
+  }
+  else {
+    *u = load_sample(row, cx, src->depth);
+    *v = load_sample(src->v + cy * src->uv_stride, cx, src->depth);
+  }
+}
+
+static inline uint8_t clip(int32_t v) {
+  return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+/**
+ * 一行 10 bit 的 yuv 转 rgba
+ */
+static void convert_row(const int16_t *ys, const int16_t *us, const int16_t *vs, uint8_t *dst, int32_t width, const Coef *coef) {
+  int32_t x = 0;
+
+#ifdef __wasm_simd128__
+  const v128_t yoff = wasm_i32x4_splat(coef->yoff);
+  const v128_t center = wasm_i32x4_splat(512);
+  const v128_t round = wasm_i32x4_splat(1 << (OUT_SHIFT - 1));
+  const v128_t ycoef = wasm_i32x4_splat(coef->ycoef);
+  const v128_t rv = wasm_i32x4_splat(coef->rv);
+  const v128_t gu = wasm_i32x4_splat(coef->gu);
+  const v128_t gv = wasm_i32x4_splat(coef->gv);
+  const v128_t bu = wasm_i32x4_splat(coef->bu);
+  const v128_t alpha = wasm_i16x8_splat(255);
+
+  for (; x + 8 <= width; x += 8) {
+    v128_t y16 = wasm_v128_load(ys + x);
+    v128_t u16 = wasm_v128_load(us + x);
+    v128_t v16 = wasm_v128_load(vs + x);
+
+    v128_t yl = wasm_i32x4_add(wasm_i32x4_mul(wasm_i32x4_sub(wasm_i32x4_extend_low_i16x8(y16), yoff), ycoef), round);
+    v128_t yh = wasm_i32x4_add(wasm_i32x4_mul(wasm_i32x4_sub(wasm_i32x4_extend_high_i16x8(y16), yoff), ycoef), round);
+    v128_t ul = wasm_i32x4_sub(wasm_i32x4_extend_low_i16x8(u16), center);
+    v128_t uh = wasm_i32x4_sub(wasm_i32x4_extend_high_i16x8(u16), center);
+    v128_t vl = wasm_i32x4_sub(wasm_i32x4_extend_low_i16x8(v16), center);
+    v128_t vh = wasm_i32x4_sub(wasm_i32x4_extend_high_i16x8(v16), center);
+
+    v128_t r16 = wasm_i16x8_narrow_i32x4(
+      wasm_i32x4_shr(wasm_i32x4_add(yl, wasm_i32x4_mul(vl, rv)), OUT_SHIFT),
+      wasm_i32x4_shr(wasm_i32x4_add(yh, wasm_i32x4_mul(vh, rv)), OUT_SHIFT)
+    );
+    v128_t g16 = wasm_i16x8_narrow_i32x4(
+      wasm_i32x4_shr(wasm_i32x4_sub(wasm_i32x4_sub(yl, wasm_i32x4_mul(ul, gu)), wasm_i32x4_mul(vl, gv)), OUT_SHIFT),
+      wasm_i32x4_shr(wasm_i32x4_sub(wasm_i32x4_sub(yh, wasm_i32x4_mul(uh, gu)), wasm_i32x4_mul(vh, gv)), OUT_SHIFT)
+    );
+    v128_t b16 = wasm_i16x8_narrow_i32x4(
+      wasm_i32x4_shr(wasm_i32x4_add(yl, wasm_i32x4_mul(ul, bu)), OUT_SHIFT),
+      wasm_i32x4_shr(wasm_i32x4_add(yh, wasm_i32x4_mul(uh, bu)), OUT_SHIFT)
+    );
+
+    // rg: r0..r7 g0..g7，ba: b0..b7 a0..a7
+    v128_t rg = wasm_u8x16_narrow_i16x8(r16, g16);
+    v128_t ba = wasm_u8x16_narrow_i16x8(b16, alpha);
+
+    wasm_v128_store(dst + (x << 2), wasm_i8x16_shuffle(rg, ba, 0, 8, 16, 24, 1, 9, 17, 25, 2, 10, 18, 26, 3, 11, 19, 27));
+    wasm_v128_store(dst + (x << 2) + 16, wasm_i8x16_shuffle(rg, ba, 4, 12, 20, 28, 5, 13, 21, 29, 6, 14, 22, 30, 7, 15, 23, 31));
+  }
+#endif
+
+  for (; x < width; x++) {
+    int32_t y = (ys[x] - coef->yoff) * coef->ycoef + (1 << (OUT_SHIFT - 1));
+    int32_t u = us[x] - 512;
+    int32_t v = vs[x] - 512;
+    uint8_t *p = dst + (x << 2);
+    p[0] = clip((y + v * coef->rv) >> OUT_SHIFT);
+    p[1] = clip((y - u * coef->gu - v * coef->gv) >> OUT_SHIFT);
+    p[2] = clip((y + u * coef->bu) >> OUT_SHIFT);
+    p[3] = 255;
+  }
+}
+
+/**
+ * 原尺寸输出时展开一行，色度水平复制一份
+ */
+static void unpack_row(const Source *src, int32_t y, int16_t *ys, int16_t *us, int16_t *vs) {
+  const uint8_t *yrow = src->y + y * src->y_stride;
+  const uint8_t *urow = src->u + (y >> 1) * src->uv_stride;
+  const uint8_t *vrow = src->interleaved ? urow : src->v + (y >> 1) * src->uv_stride;
+  int32_t x = 0;
+
+#ifdef __wasm_simd128__
+  if (src->depth == DEPTH_8) {
+    for (; x + 16 <= src->width; x += 16) {
+      v128_t v = wasm_v128_load(yrow + x);
+      wasm_v128_store(ys + x, wasm_i16x8_shl(wasm_u16x8_extend_low_u8x16(v), 2));
+      wasm_v128_store(ys + x + 8, wasm_i16x8_shl(wasm_u16x8_extend_high_u8x16(v), 2));
+
+      v128_t cu;
+      v128_t cv;
+      if (src->interleaved) {
+        v128_t c = wasm_v128_load(urow + x);
+        cu = wasm_i8x16_shuffle(c, c, 0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+        cv = wasm_i8x16_shuffle(c, c, 1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+      }
+      else {
+        v128_t c = wasm_v128_load64_zero(urow + (x >> 1));
+        cu = wasm_i8x16_shuffle(c, c, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+        c = wasm_v128_load64_zero(vrow + (x >> 1));
+        cv = wasm_i8x16_shuffle(c, c, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+      }
+      wasm_v128_store(us + x, wasm_i16x8_shl(wasm_u16x8_extend_low_u8x16(cu), 2));
+      wasm_v128_store(us + x + 8, wasm_i16x8_shl(wasm_u16x8_extend_high_u8x16(cu), 2));
+      wasm_v128_store(vs + x, wasm_i16x8_shl(wasm_u16x8_extend_low_u8x16(cv), 2));
+      wasm_v128_store(vs + x + 8, wasm_i16x8_shl(wasm_u16x8_extend_high_u8x16(cv), 2));
+    }
+  }
+#endif
+
+  for (; x < src->width; x++) {
+    int32_t u;
+    int32_t v;
+    ys[x] = (int16_t)load_sample(yrow, x, src->depth);
+    if (src->interleaved) {
+      u = load_sample(urow, (x >> 1) << 1, src->depth);
+      v = load_sample(urow, ((x >> 1) << 1) + 1, src->depth);
+    }
+    else {
+      u = load_sample(urow, x >> 1, src->depth);
+      v = load_sample(vrow, x >> 1, src->depth);
+    }
+    us[x] = (int16_t)u;
+    vs[x] = (int16_t)v;
+  }
+}
+
+/**
+ * 计算采样位置，最近邻取像素中心对应的源像素，双线性返回 8 bit 小数部分
+ */
+static inline int32_t map_position(int32_t d, int32_t dst_size, int32_t src_size, int32_t filter, int32_t *weight) {
+  if (filter == FILTER_BILINEAR) {
+    int32_t f = (int32_t)(((int64_t)(2 * d + 1) * src_size << 8) / (2 * dst_size)) - 128;
+    if (f < 0) {
+      f = 0;
+    }
+    *weight = f & 0xff;
+    return f >> 8;
+  }
+  int32_t p = (int32_t)((int64_t)(2 * d + 1) * src_size / (2 * dst_size));
+  *weight = 0;
+  return p < src_size ? p : src_size - 1;
+}
+
+static inline int32_t lerp(int32_t a, int32_t b, int32_t w) {
+  return a + (((b - a) * w + 128) >> 8);
+}
+
+/**
+ * 缩放输出时采样一行，缩放和颜色转换在同一次遍历中完成，不产生中间帧
+ */
+static void sample_row(
+  const Source *src, int32_t dy, int32_t dst_width, int32_t dst_height, int32_t filter,
+  const int32_t *map, int16_t *ys, int16_t *us, int16_t *vs
+) {
+  int32_t chroma_width = (src->width + 1) >> 1;
+  int32_t chroma_height = (src->height + 1) >> 1;
+
+  int32_t wy;
+  int32_t wcy;
+  int32_t y0 = map_position(dy, dst_height, src->height, filter, &wy);
+  int32_t cy0 = map_position(dy, dst_height, chroma_height, filter, &wcy);
+
+  if (filter == FILTER_BILINEAR) {
+    int32_t y1 = y0 + 1 < src->height ? y0 + 1 : src->height - 1;
+    int32_t cy1 = cy0 + 1 < chroma_height ? cy0 + 1 : chroma_height - 1;
+    const uint8_t *yrow0 = src->y + y0 * src->y_stride;
+    const uint8_t *yrow1 = src->y + y1 * src->y_stride;
+    for (int32_t x = 0; x < dst_width; x++) {
+      const int32_t *m = map + (x << 2);
+      int32_t x1 = m[0] + 1 < src->width ? m[0] + 1 : src->width - 1;
+      int32_t cx1 = m[2] + 1 < chroma_width ? m[2] + 1 : chroma_width - 1;
+
+      int32_t top = lerp(load_sample(yrow0, m[0], src->depth), load_sample(yrow0, x1, src->depth), m[1]);
+      int32_t bottom = lerp(load_sample(yrow1, m[0], src->depth), load_sample(yrow1, x1, src->depth), m[1]);
+      ys[x] = (int16_t)lerp(top, bottom, wy);
+
+      int32_t u00, v00, u01, v01, u10, v10, u11, v11;
+      load_chroma(src, cy0, m[2], &u00, &v00);
+      load_chroma(src, cy0, cx1, &u01, &v01);
+      load_chroma(src, cy1, m[2], &u10, &v10);
+      load_chroma(src, cy1, cx1, &u11, &v11);
+      us[x] = (int16_t)lerp(lerp(u00, u01, m[3]), lerp(u10, u11, m[3]), wcy);
+      vs[x] = (int16_t)lerp(lerp(v00, v01, m[3]), lerp(v10, v11, m[3]), wcy);
+    }
+  }
+  else {
+    const uint8_t *yrow = src->y + y0 * src->y_stride;
+    int32_t cy = y0 >> 1;
+    for (int32_t x = 0; x < dst_width; x++) {
+      const int32_t *m = map + (x << 2);
+      int32_t u;
+      int32_t v;
+      ys[x] = (int16_t)load_sample(yrow, m[0], src->depth);
+      load_chroma(src, cy, m[0] >> 1, &u, &v);
+      us[x] = (int16_t)u;
+      vs[x] = (int16_t)v;
+    }
+  }
+}
+
+static inline int32_t align8(int32_t v) {
+  return (v + 7) & ~7;
+}
+
+/**
+ * 转换需要的临时内存大小
+ */
+EM_PORT_API(int32_t) yuv2rgba_scratch_size(int32_t dst_width) {
+  return align8(dst_width) * 3 * (int32_t)sizeof(int16_t) + dst_width * 4 * (int32_t)sizeof(int32_t);
+}
+
+/**
+ * yuv420p/nv12/yuv420p10le/p010le 转 rgba
+ *
+ * 输出尺寸和源尺寸不同时在同一次遍历中缩放
+ *
+ * @param y u v 平面数据，nv12 和 p010 的 uv 交错存放在 u 中
+ * @param scratch 临时内存，大小为 yuv2rgba_scratch_size(dst_width)
+ * @return 成功返回 0，参数错误返回 -1
+ */
+EM_PORT_API(int32_t) yuv2rgba(
+  const uint8_t *y, const uint8_t *u, const uint8_t *v, int32_t y_stride, int32_t uv_stride,
+  int32_t width, int32_t height, int32_t format, int32_t matrix, int32_t full_range,
+  uint8_t *dst, int32_t dst_stride, int32_t dst_width, int32_t dst_height, int32_t filter,
+  uint8_t *scratch
+) {
+  if (!y || !u || !dst || !scratch || width <= 0 || height <= 0 || dst_width <= 0 || dst_height <= 0) {
+    return -1;
+  }
+
+  Source src;
+  src.y = y;
+  src.u = u;
+  src.v = v;
+  src.y_stride = y_stride;
+  src.uv_stride = uv_stride;
+  src.width = width;
+  src.height = height;
+
+  switch (format) {
+    case FORMAT_YUV420P:
+      src.depth = DEPTH_8;
+      src.interleaved = 0;
+      break;
+    case FORMAT_NV12:
+      src.depth = DEPTH_8;
+      src.interleaved = 1;
+      break;
+    case FORMAT_YUV420P10LE:
+      src.depth = DEPTH_10;
+      src.interleaved = 0;
+      break;
+    case FORMAT_P010LE:
+      src.depth = DEPTH_10_MSB;
+      src.interleaved = 1;
+      break;
+    default:
+      return -1;
+  }
+  if (!src.interleaved && !v) {
+    return -1;
+  }
+
+  Coef coef;
+  init_coef(&coef, matrix, full_range);
+
+  int32_t row_size = align8(dst_width);
+  int16_t *ys = (int16_t *)scratch;
+  int16_t *us = ys + row_size;
+  int16_t *vs = us + row_size;
+  int32_t *map = (int32_t *)(vs + row_size);
+
+  if (dst_width == width && dst_height == height) {
+    for (int32_t i = 0; i < height; i++) {
+      unpack_row(&src, i, ys, us, vs);
+      convert_row(ys, us, vs, dst + i * dst_stride, width, &coef);
+    }
+    return 0;
+  }
+
+  int32_t chroma_width = (width + 1) >> 1;
+  for (int32_t i = 0; i < dst_width; i++) {
+    int32_t *m = map + (i << 2);
+    m[0] = map_position(i, dst_width, width, filter, m + 1);
+    m[2] = map_position(i, dst_width, chroma_width, filter, m + 3);
+  }
+
+  for (int32_t i = 0; i < dst_height; i++) {
+    sample_row(&src, i, dst_width, dst_height, filter, map, ys, us, vs);
+    convert_row(ys, us, vs, dst + i * dst_stride, dst_width, &coef);
+  }
+
+  return 0;
+}
@@ -27,6 +27,7 @@ import { RenderMode } from './ImageRender'
 import type { ImageRenderOptions } from './ImageRender'
 import ImageRender from './ImageRender'
 import AlphaMask from './webgl/postprocess/AlphaMask'
+import * as yuv2rgbaKernel from './yuv2rgbaKernel'
 
 import {
   logger,
@@ -37,6 +38,10 @@ import {
   type AVFrame
 } from '@libmedia/avutil'
 
+import {
+  isPointer
+} from '@libmedia/cheap'
+
 export interface CanvasImageRenderOptions extends ImageRenderOptions {
   colorSpace?: 'rec2100-pq' | 'rec2100-hlg'
 }
@@ -57,6 +62,18 @@ export default class CanvasImageRender extends ImageRender {
   private hasAlpha: boolean
   private alphaMask: AlphaMask
 
+  /**
+   * 布局变化后需要清除整个画布，否则每帧只覆盖视频区域
+   */
+  private dirty: boolean
+
+  private converter: yuv2rgbaKernel.Yuv2RgbaConverter
+  /**
+   * 有旋转或翻转时 putImageData 不受变换影响，先写到这里再 drawImage
+   */
+  private backCanvas: OffscreenCanvas
+  private backContext: OffscreenCanvasRenderingContext2D
+
   constructor(canvas: HTMLCanvasElement | OffscreenCanvas, options: CanvasImageRenderOptions) {
     super(canvas, options)
 
@@ -64,6 +81,7 @@ export default class CanvasImageRender extends ImageRender {
     this.paddingTop = 0
     this.flipX = 1
     this.flipY = 1
+    this.dirty = true
   }
 
   public async init() {
@@ -116,7 +134,6 @@ export default class CanvasImageRender extends ImageRender {
       this.videoHeight = frame.codedHeight
       this.textureWidth = frame.codedWidth
       this.layout()
-      this.clear()
 
       if (this.hasAlpha && support.offscreenCanvas && support.webgl) {
         this.alphaMask = new AlphaMask(frame.codedWidth, frame.codedHeight)
@@ -124,15 +141,83 @@ export default class CanvasImageRender extends ImageRender {
     }
   }
 
-  public render(frame: VideoFrame, alpha?: VideoFrame): void {
+  private checkAVFrame(frame: pointer<AVFrame>) {
+    if (frame.width !== this.textureWidth
+      || frame.height !== this.videoHeight
+      || frame.width !== this.videoWidth
+      || this.hasAlpha
+    ) {
+      if (this.alphaMask) {
+        this.alphaMask.destroy()
+        this.alphaMask = null
+      }
+      this.hasAlpha = false
+      this.videoWidth = frame.width
+      this.videoHeight = frame.height
+      this.textureWidth = frame.width
+      this.layout()
+    }
+  }
+
+  private renderAVFrame(frame: pointer<AVFrame>) {
+    this.checkAVFrame(frame)
+
+    // 直接转换到画布上视频区域的尺寸，缩放和颜色转换一次完成
+    const width = Math.round(this.canvasWidth * this.options.devicePixelRatio - 2 * this.paddingLeft)
+    const height = Math.round(this.canvasHeight * this.options.devicePixelRatio - 2 * this.paddingTop)
+
+    if (width <= 0 || height <= 0) {
+      return
+    }
+
+    if (!this.converter) {
+      this.converter = new yuv2rgbaKernel.Yuv2RgbaConverter()
+    }
+    if (!this.converter.convert(frame, width, height)) {
+      return
+    }
+    const imageData = this.converter.getImageData(width, height)
+
+    if (this.dirty) {
+      this.clear()
+      this.dirty = false
+    }
+
+    if (!this.rotate && this.flipX === 1 && this.flipY === 1) {
+      this.context.putImageData(imageData, this.paddingLeft, this.paddingTop)
+    }
+    else {
+      if (!this.backCanvas) {
+        this.backCanvas = new OffscreenCanvas(width, height)
+        this.backContext = this.backCanvas.getContext('2d')
+      }
+      else if (this.backCanvas.width !== width || this.backCanvas.height !== height) {
+        this.backCanvas.width = width
+        this.backCanvas.height = height
+      }
+      this.backContext.putImageData(imageData, 0, 0)
+      this.context.drawImage(this.backCanvas, this.paddingLeft, this.paddingTop, width, height)
+    }
+  }
+
+  public render(frame: VideoFrame | pointer<AVFrame>, alpha?: VideoFrame): void {
 
     if (this.lost) {
       return
     }
 
+    if (isPointer(frame)) {
+      this.renderAVFrame(frame)
+      return
+    }
+
     this.checkFrame(frame, alpha)
 
-    this.clear()
+    // 不透明的帧每次都覆盖同一块区域，只有布局变化后才需要清除整个画布
+    if (this.dirty || this.hasAlpha) {
+      this.clear()
+      this.dirty = false
+    }
     this.context.drawImage(
       frame,
       this.paddingLeft,
@@ -156,6 +241,8 @@ export default class CanvasImageRender extends ImageRender {
   }
 
   protected layout(): void {
+    this.dirty = true
+
     let videoWidth = this.videoWidth
     let videoHeight = this.videoHeight
     let canvasWidth = this.canvasWidth
@@ -278,11 +365,20 @@ export default class CanvasImageRender extends ImageRender {
       this.alphaMask.destroy()
       this.alphaMask = null
     }
+    if (this.converter) {
+      this.converter.destroy()
+      this.converter = null
+    }
+    this.backCanvas = null
+    this.backContext = null
     super.destroy()
   }
 
   static isSupport(frame: pointer<AVFrame> | VideoFrame | ImageBitmap): boolean {
-    // VideoFrame
+    if (isPointer(frame)) {
+      // 需要当前线程已经加载 yuv2rgba wasm
+      return yuv2rgbaKernel.isSupport(frame)
+    }
     return frame instanceof VideoFrame || frame instanceof ImageBitmap
   }
 }
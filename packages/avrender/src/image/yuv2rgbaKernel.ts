@@ -0,0 +1,256 @@
+/*
+ * libmedia wasm yuv to rgba kernel
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  WebAssemblyRunner,
+  type WebAssemblyResource,
+  isPointer
+} from '@libmedia/cheap'
+
+import { getHeap } from '@libmedia/cheap/internal'
+
+import {
+  logger
+} from '@libmedia/common'
+
+import {
+  type AVFrame,
+  AVPixelFormat,
+  AVColorSpace,
+  AVColorRange,
+  avMalloc,
+  avFree
+} from '@libmedia/avutil'
+
+export const enum Yuv2RgbaFilter {
+  NEAREST,
+  BILINEAR
+}
+
+const enum KernelFormat {
+  YUV420P,
+  NV12,
+  YUV420P10LE,
+  P010LE
+}
+
+const enum KernelMatrix {
+  BT601,
+  BT709,
+  BT2020
+}
+
+let runner: WebAssemblyRunner = null
+
+/**
+ * 加载 wasm 的 yuv 转 rgba 实现，加载之后 CanvasImageRender 可以渲染 AVFrame
+ * 
+ * 每个线程加载一次
+ * 
+ * @param resource 
+ */
+export async function load(resource: WebAssemblyResource) {
+  if (runner) {
+    return 0
+  }
+  try {
+    const instance = new WebAssemblyRunner(resource)
+    await instance.run()
+    runner = instance
+    logger.debug('wasm yuv2rgba kernel loaded')
+    return 0
+  }
+  catch (error) {
+    logger.warn(`load wasm yuv2rgba kernel failed, ${error}`)
+    return -1
+  }
+}
+
+export function unload() {
+  if (runner) {
+    runner.destroy()
+    runner = null
+  }
+}
+
+export function isLoaded() {
+  return !!runner
+}
+
+function getFormat(format: AVPixelFormat) {
+  switch (format) {
+    case AVPixelFormat.AV_PIX_FMT_YUV420P:
+    case AVPixelFormat.AV_PIX_FMT_YUVJ420P:
+      return KernelFormat.YUV420P
+    case AVPixelFormat.AV_PIX_FMT_NV12:
+      return KernelFormat.NV12
+    case AVPixelFormat.AV_PIX_FMT_YUV420P10LE:
+      return KernelFormat.YUV420P10LE
+    case AVPixelFormat.AV_PIX_FMT_P010LE:
+      return KernelFormat.P010LE
+    default:
+      return -1
+  }
+}
+
+function getMatrix(frame: pointer<AVFrame>) {
+  switch (frame.colorSpace) {
+    case AVColorSpace.AVCOL_SPC_BT709:
+      return KernelMatrix.BT709
+    case AVColorSpace.AVCOL_SPC_BT2020_NCL:
+    case AVColorSpace.AVCOL_SPC_BT2020_CL:
+      return KernelMatrix.BT2020
+    case AVColorSpace.AVCOL_SPC_UNSPECIFIED:
+      // 没有标记的高清视频按 BT709 处理
+      return frame.height > 576 ? KernelMatrix.BT709 : KernelMatrix.BT601
+    default:
+      return KernelMatrix.BT601
+  }
+}
+
+/**
+ * 当前线程是否可以转换此帧
+ */
+export function isSupport(frame: pointer<AVFrame> | VideoFrame | ImageBitmap) {
+  return !!runner && isPointer(frame) && getFormat(frame.format as AVPixelFormat) >= 0
+}
+
+/**
+ * yuv 转 rgba 转换器
+ * 
+ * 输出缓冲区和临时缓冲区在尺寸变大时才重新分配，缩放和颜色转换在一次遍历中完成
+ */
+export class Yuv2RgbaConverter {
+
+  private rgba: pointer<uint8>
+
+  private rgbaSize: int32
+
+  private scratch: pointer<uint8>
+
+  private scratchSize: int32
+
+  private imageData: ImageData
+
+  constructor() {
+    this.rgba = nullptr
+    this.rgbaSize = 0
+    this.scratch = nullptr
+    this.scratchSize = 0
+    this.imageData = null
+  }
+
+  /**
+   * 将 frame 转换到 width x height 的 rgba，返回输出缓冲区，失败返回 nullptr
+   * 
+   * 输出每行 width * 4 字节
+   */
+  public convert(frame: pointer<AVFrame>, width: int32, height: int32, filter: Yuv2RgbaFilter = Yuv2RgbaFilter.BILINEAR): pointer<uint8> {
+    const format = getFormat(frame.format as AVPixelFormat)
+    if (!runner || format < 0 || width <= 0 || height <= 0) {
+      return nullptr
+    }
+
+    const size = width * height * 4
+    if (size > this.rgbaSize) {
+      if (this.rgba) {
+        avFree(this.rgba)
+      }
+      this.rgba = reinterpret_cast<pointer<uint8>>(avMalloc(size))
+      this.rgbaSize = size
+    }
+    const scratchSize = runner.invoke<int32>('yuv2rgba_scratch_size', width)
+    if (scratchSize > this.scratchSize) {
+      if (this.scratch) {
+        avFree(this.scratch)
+      }
+      this.scratch = reinterpret_cast<pointer<uint8>>(avMalloc(scratchSize))
+      this.scratchSize = scratchSize
+    }
+
+    const interleaved = format === KernelFormat.NV12 || format === KernelFormat.P010LE
+    const fullRange = frame.colorRange === AVColorRange.AVCOL_RANGE_JPEG
+      || frame.format === AVPixelFormat.AV_PIX_FMT_YUVJ420P
+
+    const ret = runner.invoke<int32>(
+      'yuv2rgba',
+      frame.data[0],
+      frame.data[1],
+      interleaved ? nullptr : frame.data[2],
+      frame.linesize[0],
+      frame.linesize[1],
+      frame.width,
+      frame.height,
+      format,
+      getMatrix(frame),
+      fullRange ? 1 : 0,
+      this.rgba,
+      width * 4,
+      width,
+      height,
+      filter,
+      this.scratch
+    )
+
+    if (ret < 0) {
+      logger.error(`yuv2rgba failed, format: ${frame.format}, size: ${frame.width}x${frame.height} -> ${width}x${height}`)
+      return nullptr
+    }
+
+    return this.rgba
+  }
+
+  /**
+   * 获取上一次 convert 输出的 ImageData
+   * 
+   * 非共享内存直接引用堆上的数据，共享内存时 ImageData 不能引用 SharedArrayBuffer，拷贝到复用的 ImageData 中
+   */
+  public getImageData(width: int32, height: int32) {
+    const heap = getHeap()
+    const size = width * height * 4
+    if (heap instanceof ArrayBuffer) {
+      return new ImageData(new Uint8ClampedArray(heap, static_cast<double>(reinterpret_cast<size>(this.rgba)), size), width, height)
+    }
+    if (!this.imageData || this.imageData.width !== width || this.imageData.height !== height) {
+      this.imageData = new ImageData(width, height)
+    }
+    this.imageData.data.set(new Uint8ClampedArray(heap, static_cast<double>(reinterpret_cast<size>(this.rgba)), size))
+    return this.imageData
+  }
+
+  public destroy() {
+    if (this.rgba) {
+      avFree(this.rgba)
+      this.rgba = nullptr
+    }
+    if (this.scratch) {
+      avFree(this.scratch)
+      this.scratch = nullptr
+    }
+    this.rgbaSize = 0
+    this.scratchSize = 0
+    this.imageData = null
+  }
+}
@@ -16,3 +16,5 @@ export { default as Track } from './track/Track'
 export { default as WebGPURender, type WebGPURenderOptions } from './image/WebGPURender'
 
 export { default as WebGLRender, type WebGLRenderOptions } from './image/WebGLRender'
+
+export * as yuv2rgbaKernel from './image/yuv2rgbaKernel'
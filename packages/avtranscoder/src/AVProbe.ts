@@ -0,0 +1,276 @@
+/*
+ * libmedia AVProbe
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import {
+  ProbePipeline,
+  type ProbeOptions,
+  type ProbeResult
+} from '@libmedia/avpipeline'
+
+import {
+  type Thread,
+  closeThread,
+  createThreadFromClass
+} from '@libmedia/cheap'
+
+import {
+  logger,
+  generateUUID
+} from '@libmedia/common'
+
+import {
+  errorType
+} from '@libmedia/avutil'
+
+export {
+  type ProbeOptions,
+  type ProbeResult,
+  type ProbeStreamInfo
+} from '@libmedia/avpipeline'
+
+export interface AVProbeOptions {
+  /**
+   * 探测线程数，默认 CPU 核数
+   */
+  threads?: number
+  /**
+   * 每个线程同时进行的探测数，网络文件 IO 等待较多时可以调大，默认 2
+   */
+  concurrency?: number
+}
+
+interface ProbeJob {
+  source: string | Blob
+  options: ProbeOptions
+  resolve: (result: ProbeResult | int32) => void
+}
+
+interface ProbeThread {
+  thread: Thread<ProbePipeline>
+  ready: Promise<Thread<ProbePipeline>>
+  running: number
+  /**
+   * 正在探测的任务 id
+   */
+  taskIds: Set<string>
+}
+
+/**
+ * 多文件并行探测
+ *
+ * 探测任务排队分发到固定上限数量的探测线程上，每个线程在自己内部读取文件，只读取文件头和分析流参数需要的最少的包
+ *
+ * ```
+ * const probe = new AVProbe()
+ * const results = await probe.probeAll(files, { maxReadBytes: 16 * 1024 * 1024 })
+ * ```
+ */
+export default class AVProbe {
+
+  private threads: ProbeThread[]
+
+  private queue: ProbeJob[]
+
+  private maxThreads: number
+
+  private concurrency: number
+
+  private level: number
+
+  private jobs: Set<Promise<void>>
+
+  private destroyed: boolean
+
+  constructor(options: AVProbeOptions = {}) {
+    this.threads = []
+    this.queue = []
+    this.jobs = new Set()
+    this.destroyed = false
+    this.maxThreads = Math.max(options.threads || navigator.hardwareConcurrency || 4, 1)
+    this.concurrency = Math.max(options.concurrency || 2, 1)
+    this.level = logger.INFO
+  }
+
+  private createProbeThread() {
+    const probeThread: ProbeThread = {
+      thread: null,
+      ready: null,
+      running: 0,
+      taskIds: new Set()
+    }
+    probeThread.ready = createThreadFromClass(ProbePipeline, {
+      name: `ProbeThread${this.threads.length}`
+    }).run().then((thread) => {
+      thread.setLogLevel(this.level)
+      probeThread.thread = thread
+      return thread
+    })
+    this.threads.push(probeThread)
+    return probeThread
+  }
+
+  /**
+   * 选择正在运行任务最少的线程，都已经满了且线程数没有达到上限则新建一个线程
+   */
+  private selectProbeThread() {
+    let target: ProbeThread = null
+    for (let i = 0; i < this.threads.length; i++) {
+      if (!target || this.threads[i].running < target.running) {
+        target = this.threads[i]
+      }
+    }
+    if ((!target || target.running > 0) && this.threads.length < this.maxThreads) {
+      return this.createProbeThread()
+    }
+    if (target && target.running < this.concurrency) {
+      return target
+    }
+    return null
+  }
+
+  private schedule() {
+    while (this.queue.length) {
+      const probeThread = this.selectProbeThread()
+      if (!probeThread) {
+        break
+      }
+      probeThread.running++
+      const job = this.run(probeThread, this.queue.shift())
+      this.jobs.add(job)
+      job.then(() => {
+        this.jobs.delete(job)
+      })
+    }
+  }
+
+  private async run(probeThread: ProbeThread, job: ProbeJob) {
+    const taskId = generateUUID()
+    let result: ProbeResult | int32
+    let thread: Thread<ProbePipeline>
+    probeThread.taskIds.add(taskId)
+    try {
+      thread = await probeThread.ready
+      result = await thread.registerTask({
+        ...job.options,
+        taskId,
+        source: job.source,
+        stats: nullptr
+      })
+      if (result === 0) {
+        result = this.destroyed ? errorType.INVALID_OPERATE : await thread.probe(taskId)
+      }
+    }
+    catch (error) {
+      logger.error(`probe failed, taskId: ${taskId}, error: ${error}`)
+      result = errorType.DATA_INVALID
+    }
+    job.resolve(result)
+    if (thread) {
+      await thread.unregisterTask(taskId)
+    }
+    probeThread.taskIds.delete(taskId)
+    probeThread.running--
+    this.schedule()
+  }
+
+  /**
+   * 探测一个文件
+   *
+   * @param source 文件或者 http url
+   * @param options
+   * @returns 成功返回 ProbeResult，失败返回错误码
+   */
+  public probe(source: string | Blob, options: ProbeOptions = {}) {
+    return new Promise<ProbeResult | int32>((resolve) => {
+      if (this.destroyed) {
+        resolve(errorType.INVALID_OPERATE)
+        return
+      }
+      this.queue.push({
+        source,
+        options,
+        resolve
+      })
+      this.schedule()
+    })
+  }
+
+  /**
+   * 并行探测多个文件，结果按输入顺序返回
+   *
+   * @param sources
+   * @param options
+   * @param onprogress 每个文件探测完成之后回调
+   */
+  public probeAll(
+    sources: (string | Blob)[],
+    options: ProbeOptions = {},
+    onprogress?: (index: number, result: ProbeResult | int32) => void
+  ) {
+    return Promise.all(sources.map((source, index) => {
+      return this.probe(source, options).then((result) => {
+        if (onprogress) {
+          onprogress(index, result)
+        }
+        return result
+      })
+    }))
+  }
+
+  public setLogLevel(level: number) {
+    this.level = level
+    this.threads.forEach((probeThread) => {
+      if (probeThread.thread) {
+        probeThread.thread.setLogLevel(level)
+      }
+    })
+  }
+
+  /**
+   * 销毁所有线程，排队中和正在探测的任务返回 INVALID_OPERATE
+   */
+  public async destroy() {
+    this.destroyed = true
+    this.queue.forEach((job) => {
+      job.resolve(errorType.INVALID_OPERATE)
+    })
+    this.queue = []
+    // 中止正在进行的探测，等待任务都结束之后再关闭线程
+    for (let i = 0; i < this.threads.length; i++) {
+      const probeThread = this.threads[i]
+      const thread = await probeThread.ready
+      for (const taskId of probeThread.taskIds) {
+        await thread.abort(taskId)
+      }
+    }
+    await Promise.all(Array.from(this.jobs))
+    for (let i = 0; i < this.threads.length; i++) {
+      const thread = await this.threads[i].ready
+      await thread.clear()
+      closeThread(thread)
+    }
+    this.threads = []
+  }
+}
@@ -31,7 +31,10 @@ import {
   VideoDecodePipeline,
   AudioEncodePipeline,
   VideoEncodePipeline,
-  type Stats
+  type Stats,
+  type CmafSegmenterOptions,
+  type CmafChunk,
+  type CmafManifest
 } from '@libmedia/avpipeline'
 
 import {
@@ -170,6 +173,14 @@ import Controller from './Controller'
 
 export const Events = eventType
 
+export {
+  type AVProbeOptions,
+  type ProbeOptions,
+  type ProbeResult,
+  type ProbeStreamInfo,
+  default as AVProbe
+} from './AVProbe'
+
 export interface AVTranscoderOptions {
   /**
    * 自定义 wasm 请求 base url
@@ -177,8 +188,12 @@ export interface AVTranscoderOptions {
    *  `${wasmBaseUrl}/decode/aac.wasm`
    */
   wasmBaseUrl?: string
-  getWasm?: (type: 'decoder' | 'resampler' | 'scaler' | 'encoder', codec?: AVCodecID, mediaType?: AVMediaType) => string | ArrayBuffer | WebAssemblyResource
+  getWasm?: (type: 'decoder' | 'resampler' | 'scaler' | 'encoder' | 'bsf', codec?: AVCodecID, mediaType?: AVMediaType) => string | ArrayBuffer | WebAssemblyResource
   onprogress?: (taskId: string, progress: number) => void
+  /**
+   * 使用 wasm 实现的 bitstream filter（annexb 转 avcc、adts 转 raw），加载失败时使用 ts 实现
+   */
+  enableWasmBSF?: boolean
 }
 
 export interface TaskOptions {
@@ -258,6 +273,29 @@ export interface TaskOptions {
     formatOptions?: Data
     metadata?: Data
     chapters?: AVChapter[]
+    /**
+     * CMAF 低延迟分片输出，只支持 mp4 格式
+     * 
+     * 每个 chunk 写完立即回调，同时生成 m3u8 和 MPD，file 中依然写入完整的 fragment mp4
+     */
+    cmaf?: CmafSegmenterOptions & {
+      /**
+       * init 分片（ftyp + moov）
+       */
+      onInit?: (data: Uint8Array<ArrayBuffer>) => void
+      /**
+       * 每个 chunk（moof + mdat）完成
+       */
+      onChunk?: (chunk: CmafChunk) => void
+      /**
+       * 一个完整分片完成
+       */
+      onSegment?: (segment: { segment: number, startTime: number, duration: number }) => void
+      /**
+       * 播放列表更新
+       */
+      onManifest?: (manifest: CmafManifest) => void
+    }
     video?: {
       /**
        * 输出编码类型
@@ -328,6 +366,44 @@ export interface TaskOptions {
        * 详情参考 ffmpeg 的编码器 options 配置
        */
       encoderOptions?: Data
+      /**
+       * 两遍编码，addTask 时先跑一遍只编码视频的第一遍（输出丢弃），统计数据保存在内存中，再用它配置第二遍编码
+       * 
+       * 只支持 wasm 的 vp8/vp9/av1/mpeg4 编码器，x264/x265 的统计数据需要文件系统，wasm 编码器不支持
+       * 输入不能是 CustomIOLoader（需要读两遍）
+       */
+      twoPass?: boolean
+      /**
+       * 手动指定两遍编码的遍数，需要自己保存第一遍的统计数据（比如写入 OPFS），第二遍通过 passStats 传入
+       */
+      pass?: 1 | 2
+      /**
+       * 第二遍编码使用的统计数据
+       */
+      passStats?: string
+      /**
+       * 第一遍编码结束时回调统计数据
+       */
+      onPassStats?: (stats: string) => void
+      /**
+       * 场景切换检测，开启后在场景切换处插入关键帧，只对 wasm 编码器生效
+       */
+      sceneCut?: boolean | {
+        /**
+         * 检测阈值（0 - 100），默认 10
+         */
+        threshold?: number
+        /**
+         * 距离上一个关键帧的最小间隔（毫秒），默认 500
+         */
+        minInterval?: number
+      }
+      /**
+       * 分片时长（毫秒），在每个分片边界强制插入关键帧
+       * 
+       * 配置了 cmaf 时默认使用 cmaf.segmentDuration，多码率输出的每一档关键帧对齐
+       */
+      segmentDuration?: number
     }
     audio?: {
       /**
@@ -360,23 +436,72 @@ export interface TaskOptions {
       profile?: number
     }
   }
+  /**
+   * 多码率输出（ABR ladder）
+   * 
+   * 每一档只输出视频，和 output 共用一次解封装和解码，解码后的帧通过引用计数分发给各档的 framerate/scale 分支，
+   * 每一档有自己的编码器和封装器；output.video 不能是 copy 或 disable
+   */
+  renditions?: {
+    file: TaskOptions['output']['file']
+    format?: TaskOptions['output']['format']
+    formatOptions?: Data
+    video: TaskOptions['output']['video']
+  }[]
+}
+
+interface OutputTarget {
+  taskId: string
+  muxer2OutputChannel: MessageChannel
+  outputIPCPort?: IPCPort
+  safeFileIO?: SafeFileWriter
+  oformat: AVFormat
+  /**
+   * 多码率时该输出在滤镜任务中的输出端口，提前结束时分离，其他档不再等待它
+   */
+  filterOutput?: {
+    taskId: string
+    id: number
+  }
 }
 
-interface SelfTask {
+interface SelfRendition extends OutputTarget {
+  options: TaskOptions['renditions'][number]
+  stream?: {
+    taskId: string
+    input: AVStreamInterface
+    output: AVStreamInterface
+    filter2EncoderChannel: MessageChannel
+    encoder2MuxerChannel: MessageChannel
+  }
+}
+
+interface VideoOutputBranch {
+  // 编码任务 id
   taskId: string
+  // 封装任务 id
+  muxTaskId: string
+  config: TaskOptions['output']['video']
+  stream: AVStreamInterface
+  filter2EncoderChannel: MessageChannel
+  encoder2MuxerChannel: MessageChannel
+}
+
+interface SelfTask extends OutputTarget {
   startTime: number
   subTaskId?: string
   ext?: string
   options: TaskOptions
   ioloader2DemuxerChannel: MessageChannel
-  muxer2OutputChannel: MessageChannel
   stats: Stats
   inputIPCPort?: IPCPort
-  outputIPCPort?: IPCPort
-  safeFileIO?: SafeFileWriter
   iformat: AVFormat
-  oformat: AVFormat
   formatContext: AVFormatContextInterface
+  renditions: SelfRendition[]
+  // 还未结束的输出数量
+  pendingOutputs: number
+  // 所有输出流都是 copy，在 demux 线程中直接转封装，不经过 mux 线程
+  remux: boolean
   streams: {
     taskId?: string
     input: AVStreamInterface
@@ -399,6 +524,18 @@ class AVTranscoderGlobalData {
   avframeListMutex: Mutex
 }
 
+/**
+ * wasm 编码器中可以在内存中传递两遍编码统计数据的编码器
+ * 
+ * x264/x265 的统计数据通过文件读写，wasm 编码器没有文件系统
+ */
+function isTwoPassSupported(codecId: AVCodecID) {
+  return codecId === AVCodecID.AV_CODEC_ID_VP8
+    || codecId === AVCodecID.AV_CODEC_ID_VP9
+    || codecId === AVCodecID.AV_CODEC_ID_AV1
+    || codecId === AVCodecID.AV_CODEC_ID_MPEG4
+}
+
 const defaultAVTranscoderOptions: Partial<AVTranscoderOptions> = {
 }
 
@@ -470,7 +607,7 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   /**
    * @hidden
    */
-  private async getResource(type: 'decoder' | 'resampler' | 'scaler' | 'encoder', codecId?: AVCodecID, mediaType?: AVMediaType) {
+  private async getResource(type: 'decoder' | 'resampler' | 'scaler' | 'encoder' | 'bsf', codecId?: AVCodecID, mediaType?: AVMediaType) {
     const key = codecId != null ? `${type}-${codecId}` : type
 
     if (AVTranscoder.Resource.has(key)) {
@@ -695,14 +832,77 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
     return task.options.input.ext === 'mpd'
   }
 
+  /**
+   * 音视频输出都是 copy 或 disable 并且不需要裁剪时可以在 demux 线程中直接转封装
+   * 
+   * @hidden
+   */
+  private canRemux(task: SelfTask) {
+    const options = task.options
+    const copyOrDisable = (config: { codec?: string, disable?: boolean }) => {
+      return !!config && (config.disable || config.codec === 'copy')
+    }
+    return copyOrDisable(options.output.audio)
+      && copyOrDisable(options.output.video)
+      && !options.renditions?.length
+      && !options.output.cmaf
+      && !options.start
+      && !options.duration
+      // dash 音视频是两个解封装任务
+      && !(defined(ENABLE_PROTOCOL_DASH) && this.isDash(task))
+  }
+
+  /**
+   * @hidden
+   */
+  private async pauseMux(task: SelfTask, taskId: string) {
+    if (task.remux && taskId === task.taskId) {
+      await this.DemuxerThread.pauseRemux(taskId)
+    }
+    else {
+      await this.MuxThread.pause(taskId)
+    }
+  }
+
+  /**
+   * @hidden
+   */
+  private async unpauseMux(task: SelfTask, taskId: string) {
+    if (task.remux && taskId === task.taskId) {
+      await this.DemuxerThread.unpauseRemux(taskId)
+    }
+    else {
+      await this.MuxThread.unpause(taskId)
+    }
+  }
+
   public async ready() {
     await this.startDemuxPipeline()
     await this.startAudioPipeline()
     await this.startVideoPipeline()
     await this.startMuxPipeline()
+    if (this.options.enableWasmBSF) {
+      await this.loadBSFKernel()
+    }
     logger.info('AVTranscoder pipelines started')
   }
 
+  /**
+   * @hidden
+   */
+  private async loadBSFKernel() {
+    try {
+      const resource = await this.getResource('bsf')
+      if (resource) {
+        await this.DemuxerThread.loadBSFKernel(resource)
+        await this.MuxThread.loadBSFKernel(resource)
+      }
+    }
+    catch (error) {
+      logger.warn(`load wasm bsf failed, use ts implementation, ${error}`)
+    }
+  }
+
   /**
    * @hidden
    */
@@ -727,7 +927,7 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   /**
    * @hidden
    */
-  private copyAVStreamInterface(task: SelfTask, stream: AVStreamInterface, copy: boolean = false) {
+  private copyAVStreamInterface(task: SelfTask, stream: AVStreamInterface, copy: boolean = false, oformat: AVFormat = task.oformat) {
     const newStream = object.extend({}, stream)
     newStream.codecpar = reinterpret_cast<pointer<AVCodecParameters>>(avMallocz(sizeof(AVCodecParameters)))
     copyCodecParameters(newStream.codecpar, stream.codecpar)
@@ -747,7 +947,7 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
         this.changeAVStreamTimebase(newStream, { num: 1, den: 90000 })
       }
     }
-    if (task.oformat === AVFormat.ISOBMFF
+    if (oformat === AVFormat.ISOBMFF
       && newStream.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO
     ) {
       // 如果是整数帧率，调整时间基为 framerate 的倍数，节省 stts box 的大小
@@ -957,17 +1157,20 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   /**
    * @hidden
    */
-  private async setTaskOutput(task: SelfTask) {
-    const muxer2OutputChannel = task.muxer2OutputChannel = createMessageChannel()
-    const ipcPort = task.outputIPCPort = new IPCPort(muxer2OutputChannel.port2)
+  private async setTaskOutput(task: SelfTask, rendition?: SelfRendition) {
+    const target: OutputTarget = rendition ?? task
+    const output = rendition ? rendition.options : task.options.output
+
+    const muxer2OutputChannel = target.muxer2OutputChannel = createMessageChannel()
+    const ipcPort = target.outputIPCPort = new IPCPort(muxer2OutputChannel.port2)
 
     let format: AVFormat
 
-    if (task.options.output.format) {
-      format = Format2AVFormat[task.options.output.format]
+    if (output.format) {
+      format = Format2AVFormat[output.format]
     }
-    else if (task.options.output.file instanceof FileSystemFileHandle) {
-      let ext = task.options.output.file.name.split('.').pop()
+    else if (output.file instanceof FileSystemFileHandle) {
+      let ext = output.file.name.split('.').pop()
       format = Ext2Format[ext]
     }
 
@@ -975,23 +1178,40 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
       logger.fatal('invalid output format')
     }
 
-    task.oformat = format
+    target.oformat = format
 
-    let ret = await this.MuxThread.registerTask.transfer(muxer2OutputChannel.port1)
-      .invoke({
-        taskId: task.taskId,
-        format,
-        avpacketList: addressof(this.GlobalData.avpacketList),
-        avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
-        stats: addressof(task.stats),
-        rightPort: muxer2OutputChannel.port1,
-        formatOptions: task.options.output.formatOptions,
-        zeroStart: task.options.startAtZero ?? false,
-        nonnegative: task.options.nonnegative ?? false
+    const cmaf = rendition ? null : task.options.output.cmaf
+
+    let cmafOptions: CmafSegmenterOptions
+    if (cmaf) {
+      // 回调留在主线程，只把配置传给 mux 线程
+      cmafOptions = {} as CmafSegmenterOptions
+      object.each(cmaf, (value, key) => {
+        if (!is.func(value)) {
+          cmafOptions[key] = value
+        }
       })
+    }
 
-    if (ret < 0) {
-      logger.fatal(`register mux task failed, ret: ${ret}, taskId: ${task.taskId}`)
+    // 转封装需要等解封装任务注册之后在 demux 线程注册
+    if (rendition || !task.remux) {
+      let ret = await this.MuxThread.registerTask.transfer(muxer2OutputChannel.port1)
+        .invoke({
+          taskId: target.taskId,
+          format,
+          avpacketList: addressof(this.GlobalData.avpacketList),
+          avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
+          stats: addressof(task.stats),
+          rightPort: muxer2OutputChannel.port1,
+          formatOptions: output.formatOptions,
+          zeroStart: task.options.startAtZero ?? false,
+          nonnegative: task.options.nonnegative ?? false,
+          cmaf: cmafOptions
+        })
+
+      if (ret < 0) {
+        logger.fatal(`register mux task failed, ret: ${ret}, taskId: ${target.taskId}`)
+      }
     }
 
     let ioWriter: {
@@ -1001,12 +1221,12 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
       close: () => void | Promise<void>
     }
 
-    if (task.options.output.file instanceof FileSystemFileHandle) {
-      ioWriter = task.safeFileIO = new SafeFileWriter(task.options.output.file)
-      await task.safeFileIO.ready()
+    if (output.file instanceof FileSystemFileHandle) {
+      ioWriter = target.safeFileIO = new SafeFileWriter(output.file)
+      await target.safeFileIO.ready()
     }
     else {
-      ioWriter = task.options.output.file
+      ioWriter = output.file
     }
 
     ipcPort.on(NOTIFY, async (request: RpcMessage) => {
@@ -1019,21 +1239,21 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
             else {
               ioWriter.write(request.params.data)
             }
-            if (task.options.output.file instanceof FileSystemFileHandle) {
-              if (task.safeFileIO.writeQueueSize > 5) {
+            if (output.file instanceof FileSystemFileHandle) {
+              if (target.safeFileIO.writeQueueSize > 5) {
                 try {
-                  await this.MuxThread.pause(task.taskId)
-                  while (task.safeFileIO.writeQueueSize > 5) {
+                  await this.pauseMux(task, target.taskId)
+                  while (target.safeFileIO.writeQueueSize > 5) {
                     await new Sleep(0)
                   }
-                  await this.MuxThread.unpause(task.taskId)
+                  await this.unpauseMux(task, target.taskId)
                 }
                 catch (e) {}
               }
             }
           }
           catch (error) {
-            logger.error(`ioWriter write error, ${error}, taskId: ${task.taskId}`)
+            logger.error(`ioWriter write error, ${error}, taskId: ${target.taskId}`)
           }
           break
         }
@@ -1046,23 +1266,75 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
             ioWriter.seek(Number(pos))
           }
           catch (error) {
-            logger.error(`ioWriter seek error, ${error}, taskId: ${task.taskId}`)
+            logger.error(`ioWriter seek error, ${error}, taskId: ${target.taskId}`)
+          }
+          break
+        }
+        case 'cmafInit': {
+          try {
+            ioWriter.write(request.params.data)
+          }
+          catch (error) {
+            logger.error(`ioWriter write error, ${error}, taskId: ${target.taskId}`)
+          }
+          if (cmaf?.onInit) {
+            cmaf.onInit(request.params.data)
+          }
+          break
+        }
+        case 'cmafChunk': {
+          const chunk: CmafChunk = request.params
+          try {
+            ioWriter.write(chunk.data)
+          }
+          catch (error) {
+            logger.error(`ioWriter write error, ${error}, taskId: ${target.taskId}`)
+          }
+          if (cmaf?.onChunk) {
+            cmaf.onChunk(chunk)
+          }
+          if (cmaf?.onManifest && chunk.manifest) {
+            cmaf.onManifest(chunk.manifest)
+          }
+          break
+        }
+        case 'cmafSegment': {
+          if (cmaf?.onSegment) {
+            cmaf.onSegment(request.params)
+          }
+          break
+        }
+        case 'cmafManifest': {
+          if (cmaf?.onManifest) {
+            cmaf.onManifest(request.params)
           }
           break
         }
         case 'end': {
           await ioWriter.close()
-          await this.clearTask(task)
-          this.fire(eventType.TASK_ENDED, [task.taskId])
-          logger.info(`transcode ended, taskId: ${task.taskId}, cost: ${dumpUtils.dumpTime(static_cast<int64>(getTimestamp() - task.startTime))}`)
+          // 所有输出（包括多码率的每一档）都结束了任务才结束
+          if (--task.pendingOutputs > 0) {
+            if (target.filterOutput) {
+              await this.VideoFilterThread.detachOutput(target.filterOutput.taskId, target.filterOutput.id)
+            }
+          }
+          else if (task.pendingOutputs === 0) {
+            await this.reportPassStats(task)
+            await this.clearTask(task)
+            this.fire(eventType.TASK_ENDED, [task.taskId])
+            logger.info(`transcode ended, taskId: ${task.taskId}, cost: ${dumpUtils.dumpTime(static_cast<int64>(getTimestamp() - task.startTime))}`)
+          }
           break
         }
 
         case 'error': {
           await ioWriter.close()
-          await this.clearTask(task)
-          this.fire(eventType.TASK_ERROR, [task.taskId])
-          logger.info(`transcode error, taskId: ${task.taskId}`)
+          if (task.pendingOutputs > 0) {
+            task.pendingOutputs = 0
+            await this.clearTask(task)
+            this.fire(eventType.TASK_ERROR, [task.taskId])
+            logger.info(`transcode error, taskId: ${task.taskId}`)
+          }
           break
         }
       }
@@ -1220,6 +1492,15 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
     else if (audioConfig?.codec === 'copy' && !(task.options.start || task.options.duration)) {
       let newStream = this.copyAVStreamInterface(task, stream, true)
       try {
+        if (task.remux) {
+          await this.DemuxerThread.addRemuxStream(task.taskId, newStream)
+          this.freeAVStreamInterface(newStream)
+          task.streams.push({
+            input: stream
+          })
+          return 0
+        }
+
         const demuxer2MuxerChannel = createMessageChannel()
         await this.DemuxerThread.connectStreamTask
           .transfer(demuxer2MuxerChannel.port1)
@@ -1607,6 +1888,15 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
     else if (videoConfig?.codec === 'copy' && !(task.options.start || task.options.duration)) {
       let newStream = this.copyAVStreamInterface(task, stream, true)
       try {
+        if (task.remux) {
+          await this.DemuxerThread.addRemuxStream(task.taskId, newStream)
+          this.freeAVStreamInterface(newStream)
+          task.streams.push({
+            input: stream
+          })
+          return 0
+        }
+
         const demuxer2MuxerChannel = createMessageChannel()
         await this.DemuxerThread.connectStreamTask
           .transfer(demuxer2MuxerChannel.port1)
@@ -1630,146 +1920,44 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
     }
     else {
       const demuxer2DecoderChannel = createMessageChannel()
-      const encoder2MuxerChannel = createMessageChannel()
-
       const decoder2FilterChannel = createMessageChannel()
-      const filter2EncoderChannel = createMessageChannel()
-
-      const newStream = this.copyAVStreamInterface(task, stream)
-      newStream.codecpar.flags &= ~AVCodecParameterFlags.AV_CODECPAR_FLAG_NO_PTS
-      newStream.codecpar.flags &= ~AVCodecParameterFlags.AV_CODECPAR_FLAG_NO_DTS
 
       const taskId = generateUUID()
 
-      let ret = 0
-
-      if (videoConfig) {
-        if (videoConfig.codec && videoConfig.codec !== 'copy') {
-          const codecId = VideoCodecString2CodecId[videoConfig.codec]
-          if (!is.number(codecId)) {
-            this.freeAVStreamInterface(newStream)
-            logger.fatal(`invalid codec name(${videoConfig.codec})`)
-          }
-          newStream.codecpar.codecId = codecId
-
-          if (newStream.codecpar.codecId !== stream.codecpar.codecId) {
-            newStream.codecpar.profile = NOPTS_VALUE
-            newStream.codecpar.level = NOPTS_VALUE
-          }
-        }
-        if (videoConfig.width) {
-          newStream.codecpar.width = videoConfig.width
-        }
-        if (videoConfig.height) {
-          newStream.codecpar.height = videoConfig.height
-        }
-        if (videoConfig.bitrate) {
-          newStream.codecpar.bitrate = static_cast<int64>(videoConfig.bitrate)
-        }
-        if (videoConfig.pixfmt) {
-          const pixfmt = PixfmtString2AVPixelFormat[videoConfig.pixfmt]
-          if (!is.number(pixfmt)) {
-            logger.fatal(`invalid pixfmt name(${videoConfig.pixfmt})`)
-          }
-          newStream.codecpar.format = pixfmt
-        }
-        if (videoConfig.framerate) {
-          newStream.codecpar.framerate.num = videoConfig.framerate >>> 0
-          newStream.codecpar.framerate.den = 1
-        }
-        if (videoConfig.aspect) {
-          newStream.codecpar.sampleAspectRatio.den = videoConfig.aspect.den
-          newStream.codecpar.sampleAspectRatio.num = videoConfig.aspect.num
-        }
-        if (videoConfig.profile) {
-          newStream.codecpar.profile = videoConfig.profile
-        }
-        if (videoConfig.level) {
-          newStream.codecpar.level = videoConfig.level
-        }
-        if (videoConfig.delay) {
-          newStream.codecpar.videoDelay = videoConfig.delay
-        }
-      }
-
-      if (newStream.codecpar.profile === NOPTS_VALUE) {
-        if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264) {
-          const descriptor = getAVPixelFormatDescriptor(newStream.codecpar.format as AVPixelFormat)
-          newStream.codecpar.profile = descriptor?.comp[0]?.depth === 10 ? h264.H264Profile.kHigh10 : h264.H264Profile.kHigh
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC) {
-          const descriptor = getAVPixelFormatDescriptor(newStream.codecpar.format as AVPixelFormat)
-          newStream.codecpar.profile = descriptor?.comp[0]?.depth === 10 ? hevc.HEVCProfile.Main10 : hevc.HEVCProfile.Main
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC) {
-
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_AV1) {
-          newStream.codecpar.profile = av1.AV1Profile.Main
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9) {
-          newStream.codecpar.profile = vp9.VP9Profile.Profile0
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP8) {
-          newStream.codecpar.profile = 0
-        }
-      }
-      if (newStream.codecpar.level === NOPTS_VALUE) {
-        if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264) {
-          newStream.codecpar.level = h264.getLevelByResolution(newStream.codecpar.width, newStream.codecpar.height, avQ2D(newStream.codecpar.framerate))
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC) {
-          newStream.codecpar.level = hevc.getLevelByResolution(
-            newStream.codecpar.profile,
-            newStream.codecpar.width,
-            newStream.codecpar.height,
-            avQ2D(newStream.codecpar.framerate),
-            static_cast<double>(newStream.codecpar.bitrate)
-          )
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC) {
-          // TODO 现在还没有 vvc 编码器，将来如果加入了 vvc 编码器再来实现
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_AV1) {
-          newStream.codecpar.level = av1.getLevelByResolution(newStream.codecpar.width, newStream.codecpar.height, avQ2D(newStream.codecpar.framerate))
-        }
-        else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9) {
-          newStream.codecpar.level = vp9.getLevelByResolution(newStream.codecpar.width, newStream.codecpar.height, avQ2D(newStream.codecpar.framerate))
-        }
-      }
-
-      if ((!videoConfig || videoConfig.delay == null)
-        && newStream.codecpar.videoDelay === 0
-      ) {
-        // 这个用来设置 max_b_frame_count，只针对 wasm 编码器，webcodecs 目前无法编码出 B 帧
-        newStream.codecpar.videoDelay = 4
-      }
+      // 多码率只作用于第一个视频流
+      const renditions = task.renditions.length && !task.renditions[0].stream ? task.renditions : []
 
-      if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264
-        || newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_MPEG4
-        || newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC
-        || newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC
-      ) {
-        if (task.oformat === AVFormat.MPEGTS
-          || task.oformat === AVFormat.H264
-          || task.oformat === AVFormat.HEVC
-          || task.oformat === AVFormat.VVC
-        ) {
-          newStream.codecpar.flags |= AVCodecParameterFlags.AV_CODECPAR_FLAG_H26X_ANNEXB
-        }
-        else {
-          newStream.codecpar.flags &= ~AVCodecParameterFlags.AV_CODECPAR_FLAG_H26X_ANNEXB
-        }
-      }
+      const branches: VideoOutputBranch[] = [{
+        taskId,
+        muxTaskId: task.taskId,
+        config: videoConfig,
+        stream: this.createVideoOutputStream(task, stream, videoConfig, task.oformat),
+        filter2EncoderChannel: createMessageChannel(),
+        encoder2MuxerChannel: createMessageChannel()
+      }]
+      renditions.forEach((rendition) => {
+        branches.push({
+          taskId: generateUUID(),
+          muxTaskId: rendition.taskId,
+          config: rendition.options.video,
+          stream: this.createVideoOutputStream(task, stream, rendition.options.video, rendition.oformat),
+          filter2EncoderChannel: createMessageChannel(),
+          encoder2MuxerChannel: createMessageChannel()
+        })
+      })
 
-      if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_MPEG4 && newStream.timeBase.den > 65535) {
-        this.changeAVStreamTimebase(newStream, { num: 1, den: 65535 })
+      const freeBranches = () => {
+        branches.forEach((branch) => {
+          this.freeAVStreamInterface(branch.stream)
+        })
       }
 
       await this.DemuxerThread.connectStreamTask
         .transfer(demuxer2DecoderChannel.port1)
         .invoke(task.subTaskId || task.taskId, stream.index, demuxer2DecoderChannel.port1)
 
+      let ret = 0
+
       let decoderResource = await this.getResource('decoder', stream.codecpar.codecId, stream.codecpar.codecType)
       if (!decoderResource) {
         if (support.videoDecoder) {
@@ -1778,13 +1966,13 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
           })
           if (!isSupport.supported) {
             logger.error(`VideoDecoder codecId ${stream.codecpar.codecId} not support`)
-            this.freeAVStreamInterface(newStream)
+            freeBranches()
             return errorType.OPERATE_NOT_SUPPORT
           }
         }
         else {
           logger.error(`video decoder codecId ${stream.codecpar.codecId} not support`)
-          this.freeAVStreamInterface(newStream)
+          freeBranches()
           return errorType.OPERATE_NOT_SUPPORT
         }
       }
@@ -1817,7 +2005,7 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
 
       if (ret < 0) {
         logger.error(`cannot open video ${dumpUtils.dumpCodecName(stream.codecpar.codecType, stream.codecpar.codecId)} decoder`)
-        this.freeAVStreamInterface(newStream)
+        freeBranches()
         return ret
       }
 
@@ -1828,84 +2016,71 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
 
       const vertices: AVFilterGraphDesVertex<GraphNodeType>[] = []
       const edges: { parent: number, child: number }[] = []
+      const outputs: FilterGraphPortDes[] = []
       let input: FilterGraphPortDes
-      let output: FilterGraphPortDes
 
-      let rangeNodeId: number
-
-      const scaleNode = createGraphDesVertex('scaler', {
-        resource: scalerResource,
-        output: {
-          width: newStream.codecpar.width,
-          height: newStream.codecpar.height,
-          format: newStream.codecpar.format as AVPixelFormat
+      const append = (vertex: AVFilterGraphDesVertex<GraphNodeType>, parent?: AVFilterGraphDesVertex<GraphNodeType>) => {
+        vertices.push(vertex)
+        if (parent) {
+          edges.push({
+            parent: parent.id,
+            child: vertex.id
+          })
         }
-      })
-
-      vertices.push(scaleNode)
-      input = {
-        id: scaleNode.id,
-        port: decoder2FilterChannel.port2
-      }
-      output = {
-        id: scaleNode.id,
-        port: filter2EncoderChannel.port1
+        else {
+          input = {
+            id: vertex.id,
+            port: decoder2FilterChannel.port2
+          }
+        }
+        return vertex
       }
 
+      let head: AVFilterGraphDesVertex<GraphNodeType>
+
       if (task.options.start || task.options.duration) {
         const start = avRescaleQ(static_cast<int64>(task.options.start || 0), AV_MILLI_TIME_BASE_Q, AV_TIME_BASE_Q)
-        const rangeNode = createGraphDesVertex('range', {
+        head = append(createGraphDesVertex('range', {
           start: start,
           end: task.options.duration
             ? (avRescaleQ(static_cast<int64>(task.options.duration), AV_MILLI_TIME_BASE_Q, AV_TIME_BASE_Q) + start)
             : -1n
-        })
-        vertices.push(rangeNode)
-        input = {
-          id: rangeNode.id,
-          port: decoder2FilterChannel.port2
-        }
-        edges.push({
-          parent: rangeNode.id,
-          child: scaleNode.id
-        })
-        rangeNodeId = rangeNode.id
+        }))
       }
 
-      if (avQ2D(stream.codecpar.framerate) > avQ2D(newStream.codecpar.framerate)) {
-        const framerateNode = createGraphDesVertex('framerate', {
-          framerate: {
-            num: newStream.codecpar.framerate.num,
-            den: newStream.codecpar.framerate.den
-          }
-        })
-        vertices.push(framerateNode)
+      if (branches.length > 1) {
+        // 解码后的帧引用计数分发给每一档，不拷贝
+        head = append(createGraphDesVertex('split', {
+          count: branches.length
+        }), head)
+      }
 
-        edges.length = 0
-        if (rangeNodeId) {
-          edges.push({
-            parent: rangeNodeId,
-            child: framerateNode.id
-          })
-          edges.push({
-            parent: framerateNode.id,
-            child: scaleNode.id
-          })
-        }
-        else {
-          input = {
-            id: framerateNode.id,
-            port: decoder2FilterChannel.port2
+      branches.forEach((branch) => {
+        let parent = head
+        if (avQ2D(stream.codecpar.framerate) > avQ2D(branch.stream.codecpar.framerate)) {
+          parent = append(createGraphDesVertex('framerate', {
+            framerate: {
+              num: branch.stream.codecpar.framerate.num,
+              den: branch.stream.codecpar.framerate.den
+            }
+          }), parent)
+        }
+        const scaleNode = append(createGraphDesVertex('scaler', {
+          resource: scalerResource,
+          output: {
+            width: branch.stream.codecpar.width,
+            height: branch.stream.codecpar.height,
+            format: branch.stream.codecpar.format as AVPixelFormat
           }
-          edges.push({
-            parent: framerateNode.id,
-            child: scaleNode.id
-          })
-        }
-      }
+        }), parent)
+        outputs.push({
+          id: scaleNode.id,
+          port: branch.filter2EncoderChannel.port1
+        })
+      })
 
       await this.VideoFilterThread.registerTask
-        .transfer(decoder2FilterChannel.port2, filter2EncoderChannel.port1)
+        .transfer(decoder2FilterChannel.port2, ...outputs.map((output) => output.port))
         .invoke({
           taskId: taskId,
           graph: {
@@ -1913,95 +2088,279 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
             edges
           },
           inputPorts: [input],
-          outputPorts: [output],
+          outputPorts: outputs,
           stats: addressof(task.stats),
           avframeList: addressof(this.GlobalData.avframeList),
           avframeListMutex: addressof(this.GlobalData.avframeListMutex)
         })
 
-      let encoderResource = await this.getResource('encoder', newStream.codecpar.codecId, newStream.codecpar.codecType)
-      if (!encoderResource) {
-        if (support.videoEncoder) {
-          const isSupport = await VideoEncoder.isConfigSupported({
-            codec: getVideoCodec(newStream.codecpar),
-            width: newStream.codecpar.width,
-            height: newStream.codecpar.height
-          })
-          if (!isSupport.supported) {
-            logger.error(`VideoEncoder ${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} codecId ${newStream.codecpar.codecId} not support`)
-            this.freeAVStreamInterface(newStream)
-            return errorType.OPERATE_NOT_SUPPORT
-          }
+      task.streams.push({
+        taskId,
+        input: stream,
+        output: branches[0].stream,
+        demuxer2DecoderChannel,
+        decoder2FilterChannel,
+        filter2EncoderChannel: branches[0].filter2EncoderChannel,
+        encoder2MuxerChannel: branches[0].encoder2MuxerChannel
+      })
+      if (renditions.length) {
+        task.filterOutput = {
+          taskId,
+          id: outputs[0].id
         }
-        else {
-          logger.error(`${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} encoder codecId ${newStream.codecpar.codecId} not support`)
+      }
+      renditions.forEach((rendition, index) => {
+        const branch = branches[index + 1]
+        rendition.stream = {
+          taskId: branch.taskId,
+          input: stream,
+          output: branch.stream,
+          filter2EncoderChannel: branch.filter2EncoderChannel,
+          encoder2MuxerChannel: branch.encoder2MuxerChannel
+        }
+        rendition.filterOutput = {
+          taskId,
+          id: outputs[index + 1].id
+        }
+      })
+
+      for (let i = 0; i < branches.length; i++) {
+        ret = await this.openVideoEncoder(task, branches[i])
+        if (ret < 0) {
+          return ret
+        }
+      }
+
+      return 0
+    }
+  }
+
+  /**
+   * @hidden
+   */
+  private createVideoOutputStream(task: SelfTask, stream: AVStreamInterface, videoConfig: TaskOptions['output']['video'], oformat: AVFormat) {
+    const newStream = this.copyAVStreamInterface(task, stream, false, oformat)
+    newStream.codecpar.flags &= ~AVCodecParameterFlags.AV_CODECPAR_FLAG_NO_PTS
+    newStream.codecpar.flags &= ~AVCodecParameterFlags.AV_CODECPAR_FLAG_NO_DTS
+
+    if (videoConfig) {
+      if (videoConfig.codec && videoConfig.codec !== 'copy') {
+        const codecId = VideoCodecString2CodecId[videoConfig.codec]
+        if (!is.number(codecId)) {
           this.freeAVStreamInterface(newStream)
-          return errorType.OPERATE_NOT_SUPPORT
+          logger.fatal(`invalid codec name(${videoConfig.codec})`)
         }
+        newStream.codecpar.codecId = codecId
+
+        if (newStream.codecpar.codecId !== stream.codecpar.codecId) {
+          newStream.codecpar.profile = NOPTS_VALUE
+          newStream.codecpar.level = NOPTS_VALUE
+        }
+      }
+      if (videoConfig.width) {
+        newStream.codecpar.width = videoConfig.width
+      }
+      if (videoConfig.height) {
+        newStream.codecpar.height = videoConfig.height
+      }
+      if (videoConfig.bitrate) {
+        newStream.codecpar.bitrate = static_cast<int64>(videoConfig.bitrate)
+      }
+      if (videoConfig.pixfmt) {
+        const pixfmt = PixfmtString2AVPixelFormat[videoConfig.pixfmt]
+        if (!is.number(pixfmt)) {
+          logger.fatal(`invalid pixfmt name(${videoConfig.pixfmt})`)
+        }
+        newStream.codecpar.format = pixfmt
+      }
+      if (videoConfig.framerate) {
+        newStream.codecpar.framerate.num = videoConfig.framerate >>> 0
+        newStream.codecpar.framerate.den = 1
       }
+      if (videoConfig.aspect) {
+        newStream.codecpar.sampleAspectRatio.den = videoConfig.aspect.den
+        newStream.codecpar.sampleAspectRatio.num = videoConfig.aspect.num
+      }
+      if (videoConfig.profile) {
+        newStream.codecpar.profile = videoConfig.profile
+      }
+      if (videoConfig.level) {
+        newStream.codecpar.level = videoConfig.level
+      }
+      if (videoConfig.delay) {
+        newStream.codecpar.videoDelay = videoConfig.delay
+      }
+    }
 
-      const wasmEncoderOptions: Data = {}
-      const resourceExtraData: Data = {}
+    if (newStream.codecpar.profile === NOPTS_VALUE) {
+      if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264) {
+        const descriptor = getAVPixelFormatDescriptor(newStream.codecpar.format as AVPixelFormat)
+        newStream.codecpar.profile = descriptor?.comp[0]?.depth === 10 ? h264.H264Profile.kHigh10 : h264.H264Profile.kHigh
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC) {
+        const descriptor = getAVPixelFormatDescriptor(newStream.codecpar.format as AVPixelFormat)
+        newStream.codecpar.profile = descriptor?.comp[0]?.depth === 10 ? hevc.HEVCProfile.Main10 : hevc.HEVCProfile.Main
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC) {
 
-      // x265 需要提前创建线程
-      if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC) {
-        resourceExtraData.enableThreadPool = true
-        resourceExtraData.enableThreadCountRate = 2
       }
-      // libvpx 需要提前创建线程
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_AV1) {
+        newStream.codecpar.profile = av1.AV1Profile.Main
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9) {
+        newStream.codecpar.profile = vp9.VP9Profile.Profile0
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP8) {
+        newStream.codecpar.profile = 0
+      }
+    }
+    if (newStream.codecpar.level === NOPTS_VALUE) {
+      if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264) {
+        newStream.codecpar.level = h264.getLevelByResolution(newStream.codecpar.width, newStream.codecpar.height, avQ2D(newStream.codecpar.framerate))
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC) {
+        newStream.codecpar.level = hevc.getLevelByResolution(
+          newStream.codecpar.profile,
+          newStream.codecpar.width,
+          newStream.codecpar.height,
+          avQ2D(newStream.codecpar.framerate),
+          static_cast<double>(newStream.codecpar.bitrate)
+        )
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC) {
+        // TODO 现在还没有 vvc 编码器，将来如果加入了 vvc 编码器再来实现
+      }
+      else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_AV1) {
+        newStream.codecpar.level = av1.getLevelByResolution(newStream.codecpar.width, newStream.codecpar.height, avQ2D(newStream.codecpar.framerate))
+      }
       else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9) {
-        resourceExtraData.enableThreadPool = true
+        newStream.codecpar.level = vp9.getLevelByResolution(newStream.codecpar.width, newStream.codecpar.height, avQ2D(newStream.codecpar.framerate))
       }
+    }
 
-      if (task.options?.output?.video?.encoderOptions) {
-        object.each(task.options.output.video.encoderOptions, (value, key) => {
-          wasmEncoderOptions[key] = value
-        })
+    if ((!videoConfig || videoConfig.delay == null)
+      && newStream.codecpar.videoDelay === 0
+    ) {
+      // 这个用来设置 max_b_frame_count，只针对 wasm 编码器，webcodecs 目前无法编码出 B 帧
+      newStream.codecpar.videoDelay = 4
+    }
+
+    if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_H264
+      || newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_MPEG4
+      || newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC
+      || newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VVC
+    ) {
+      if (oformat === AVFormat.MPEGTS
+        || oformat === AVFormat.H264
+        || oformat === AVFormat.HEVC
+        || oformat === AVFormat.VVC
+      ) {
+        newStream.codecpar.flags |= AVCodecParameterFlags.AV_CODECPAR_FLAG_H26X_ANNEXB
       }
+      else {
+        newStream.codecpar.flags &= ~AVCodecParameterFlags.AV_CODECPAR_FLAG_H26X_ANNEXB
+      }
+    }
 
-      // 注册一个视频编码任务
-      await this.VideoEncoderThread.registerTask
-        .transfer(filter2EncoderChannel.port2, encoder2MuxerChannel.port1)
-        .invoke({
-          taskId: taskId,
-          resource: encoderResource,
-          resourceExtraData,
-          leftPort: filter2EncoderChannel.port2,
-          rightPort: encoder2MuxerChannel.port1,
-          stats: addressof(task.stats),
-          enableHardware: !!videoConfig.enableHardware && !!videoConfig.enableWebCodecs,
-          avpacketList: addressof(this.GlobalData.avpacketList),
-          avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
-          avframeList: addressof(this.GlobalData.avframeList),
-          avframeListMutex: addressof(this.GlobalData.avframeListMutex),
-          gop: static_cast<int32>(avQ2D(newStream.codecpar.framerate) * (videoConfig.keyFrameInterval ?? 5000) / 1000),
-          preferWebCodecs: !isHdr(newStream.codecpar) && !hasAlphaChannel(newStream.codecpar) && !!videoConfig.enableWebCodecs,
-          copyTs: task.options.copyTs ?? false
-        })
+    if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_MPEG4 && newStream.timeBase.den > 65535) {
+      this.changeAVStreamTimebase(newStream, { num: 1, den: 65535 })
+    }
 
-      ret = await this.VideoEncoderThread.open(taskId, newStream.codecpar, { num: newStream.timeBase.num, den: newStream.timeBase.den }, wasmEncoderOptions)
+    return newStream
+  }
 
-      if (ret < 0) {
-        logger.error(`cannot open video ${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} encoder`)
-        this.freeAVStreamInterface(newStream)
-        return ret
+  /**
+   * @hidden
+   */
+  private async openVideoEncoder(task: SelfTask, branch: VideoOutputBranch): Promise<number> {
+    const newStream = branch.stream
+    const videoConfig = branch.config
+
+    let encoderResource = await this.getResource('encoder', newStream.codecpar.codecId, newStream.codecpar.codecType)
+    if (!encoderResource) {
+      if (support.videoEncoder) {
+        const isSupport = await VideoEncoder.isConfigSupported({
+          codec: getVideoCodec(newStream.codecpar),
+          width: newStream.codecpar.width,
+          height: newStream.codecpar.height
+        })
+        if (!isSupport.supported) {
+          logger.error(`VideoEncoder ${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} codecId ${newStream.codecpar.codecId} not support`)
+          return errorType.OPERATE_NOT_SUPPORT
+        }
+      }
+      else {
+        logger.error(`${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} encoder codecId ${newStream.codecpar.codecId} not support`)
+        return errorType.OPERATE_NOT_SUPPORT
       }
+    }
 
-      await this.MuxThread.addStream.transfer(encoder2MuxerChannel.port2)
-        .invoke(task.taskId, newStream, encoder2MuxerChannel.port2)
+    const wasmEncoderOptions: Data = {}
+    const resourceExtraData: Data = {}
 
-      task.streams.push({
-        taskId,
-        input: stream,
-        output: newStream,
-        demuxer2DecoderChannel,
-        decoder2FilterChannel,
-        filter2EncoderChannel,
-        encoder2MuxerChannel
+    // x265 需要提前创建线程
+    if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_HEVC) {
+      resourceExtraData.enableThreadPool = true
+      resourceExtraData.enableThreadCountRate = 2
+    }
+    // libvpx 需要提前创建线程
+    else if (newStream.codecpar.codecId === AVCodecID.AV_CODEC_ID_VP9) {
+      resourceExtraData.enableThreadPool = true
+    }
+
+    if (videoConfig?.encoderOptions) {
+      object.each(videoConfig.encoderOptions, (value, key) => {
+        wasmEncoderOptions[key] = value
       })
+    }
 
-      return 0
+    let pass = videoConfig?.pass ?? 0
+    if (pass && !isTwoPassSupported(newStream.codecpar.codecId)) {
+      logger.warn(`two-pass encoding not support for ${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} encoder, encode with single pass`)
+      pass = 0
+    }
+
+    const framerate = avQ2D(newStream.codecpar.framerate)
+    const sceneCut: { threshold?: number, minInterval?: number } = videoConfig?.sceneCut
+      ? (is.boolean(videoConfig.sceneCut) ? {} : videoConfig.sceneCut)
+      : null
+
+    // 注册一个视频编码任务
+    await this.VideoEncoderThread.registerTask
+      .transfer(branch.filter2EncoderChannel.port2, branch.encoder2MuxerChannel.port1)
+      .invoke({
+        taskId: branch.taskId,
+        resource: encoderResource,
+        resourceExtraData,
+        leftPort: branch.filter2EncoderChannel.port2,
+        rightPort: branch.encoder2MuxerChannel.port1,
+        stats: addressof(task.stats),
+        enableHardware: !pass && !!videoConfig?.enableHardware && !!videoConfig?.enableWebCodecs,
+        avpacketList: addressof(this.GlobalData.avpacketList),
+        avpacketListMutex: addressof(this.GlobalData.avpacketListMutex),
+        avframeList: addressof(this.GlobalData.avframeList),
+        avframeListMutex: addressof(this.GlobalData.avframeListMutex),
+        gop: static_cast<int32>(framerate * (videoConfig?.keyFrameInterval ?? 5000) / 1000),
+        preferWebCodecs: !pass && !isHdr(newStream.codecpar) && !hasAlphaChannel(newStream.codecpar) && !!videoConfig?.enableWebCodecs,
+        copyTs: task.options.copyTs ?? false,
+        pass,
+        passStats: pass === 2 ? (videoConfig.passStats ?? '') : '',
+        sceneCutThreshold: sceneCut ? (sceneCut.threshold ?? 10) : 0,
+        sceneCutMinInterval: sceneCut ? static_cast<int32>(framerate * (sceneCut.minInterval ?? 500) / 1000) : 0,
+        segmentDuration: videoConfig?.segmentDuration ?? task.options.output.cmaf?.segmentDuration ?? 0
+      })
+
+    const ret = await this.VideoEncoderThread.open(branch.taskId, newStream.codecpar, { num: newStream.timeBase.num, den: newStream.timeBase.den }, wasmEncoderOptions)
+
+    if (ret < 0) {
+      logger.error(`cannot open video ${dumpUtils.dumpCodecName(newStream.codecpar.codecType, newStream.codecpar.codecId)} encoder`)
+      return ret
     }
+
+    await this.MuxThread.addStream.transfer(branch.encoder2MuxerChannel.port2)
+      .invoke(branch.muxTaskId, newStream, branch.encoder2MuxerChannel.port2)
+
+    return 0
   }
 
   /**
@@ -2010,6 +2369,15 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   private async handleCopyStream(stream: AVStreamInterface, task: SelfTask): Promise<number> {
     let newStream = this.copyAVStreamInterface(task, stream, true)
     try {
+      if (task.remux) {
+        await this.DemuxerThread.addRemuxStream(task.taskId, newStream)
+        this.freeAVStreamInterface(newStream)
+        task.streams.push({
+          input: stream
+        })
+        return 0
+      }
+
       const demuxer2MuxerChannel = createMessageChannel()
 
       if (!(stream.disposition & AVDisposition.ATTACHED_PIC)) {
@@ -2035,11 +2403,100 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
     }
   }
 
+  /**
+   * 第一遍编码结束后取出统计数据，需要在 clearTask 注销编码任务之前调用
+   * 
+   * @hidden
+   */
+  private async reportPassStats(task: SelfTask) {
+    const videoConfig = task.options.output.video
+    if (videoConfig?.pass !== 1 || !videoConfig.onPassStats) {
+      return
+    }
+    for (let i = 0; i < task.streams.length; i++) {
+      if (task.streams[i].taskId
+        && task.streams[i].input.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO
+      ) {
+        videoConfig.onPassStats(await this.VideoEncoderThread.getPassStats(task.streams[i].taskId))
+        break
+      }
+    }
+  }
+
+  /**
+   * 运行两遍编码的第一遍，只编码视频并丢弃输出，返回统计数据
+   * 
+   * @hidden
+   */
+  private async runFirstPass(taskOptions: TaskOptions) {
+    let passStats = ''
+    const taskId = await this.addTask({
+      ...taskOptions,
+      output: {
+        file: {
+          write: () => {},
+          appendBufferByPosition: () => {},
+          seek: () => {},
+          close: () => {}
+        },
+        format: 'mkv',
+        video: {
+          ...taskOptions.output.video,
+          twoPass: false,
+          pass: 1,
+          passStats: '',
+          onPassStats: (stats) => {
+            passStats = stats
+          }
+        },
+        audio: {
+          disable: true
+        }
+      },
+      renditions: undefined
+    })
+
+    await new Promise<void>((resolve) => {
+      const done = (id: string) => {
+        if (id === taskId) {
+          this.off(eventType.TASK_ENDED, done)
+          this.off(eventType.TASK_ERROR, done)
+          resolve()
+        }
+      }
+      this.on(eventType.TASK_ENDED, done)
+      this.on(eventType.TASK_ERROR, done)
+      this.startTask(taskId).catch(() => {
+        done(taskId)
+      })
+    })
+
+    logger.info(`two-pass first pass ended, stats size: ${passStats.length}`)
+
+    return passStats
+  }
+
   /**
    * @hidden
    */
   private async clearTask(task: SelfTask) {
-    this.MuxThread.unregisterTask(task.taskId)
+    if (!task.remux) {
+      this.MuxThread.unregisterTask(task.taskId)
+    }
+    for (let i = 0; i < task.renditions.length; i++) {
+      const rendition = task.renditions[i]
+      this.MuxThread.unregisterTask(rendition.taskId)
+      if (rendition.stream) {
+        await this.VideoEncoderThread.unregisterTask(rendition.stream.taskId)
+        this.freeAVStreamInterface(rendition.stream.output)
+      }
+      if (rendition.outputIPCPort) {
+        rendition.outputIPCPort.destroy()
+      }
+      if (rendition.safeFileIO) {
+        rendition.safeFileIO.destroy()
+      }
+    }
     for (let i = 0; i < task.streams.length; i++) {
       if (task.streams[i].taskId) {
         if (task.streams[i].input.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
@@ -2084,11 +2541,88 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
     }
   }
 
+  /**
+   * @hidden
+   */
+  private async updateOutputCodecParameters(muxTaskId: string, encoderTaskId: string, output: AVStreamInterface) {
+    let buffer: Uint8Array
+    let updated = false
+    if (output.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
+      buffer = await this.AudioEncoderThread.getExtraData(encoderTaskId)
+    }
+    else if (output.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
+      buffer = await this.VideoEncoderThread.getExtraData(encoderTaskId)
+      const colorSpace = await this.VideoEncoderThread.getColorSpace(encoderTaskId)
+      if (colorSpace) {
+        output.codecpar.colorSpace = colorSpace.colorSpace
+        output.codecpar.colorPrimaries = colorSpace.colorPrimaries
+        output.codecpar.colorTrc = colorSpace.colorTrc
+        updated = true
+      }
+    }
+    if (!buffer) {
+      const codecId = output.codecpar.codecId
+      if (codecId === AVCodecID.AV_CODEC_ID_AAC) {
+        buffer = aac.avCodecParameters2Extradata(accessof(output.codecpar))
+      }
+      else if (codecId === AVCodecID.AV_CODEC_ID_OPUS) {
+        buffer = opus.avCodecParameters2Extradata(accessof(output.codecpar))
+      }
+    }
+    if (buffer) {
+      const extradata: pointer<uint8> = avMalloc(buffer.length)
+      memcpyFromUint8Array(extradata, buffer.length, buffer)
+      if (output.codecpar.extradata) {
+        avFree(output.codecpar.extradata)
+      }
+      output.codecpar.extradata = extradata
+      output.codecpar.extradataSize = buffer.length
+      updated = true
+    }
+    if (updated) {
+      await this.MuxThread.updateAVCodecParameters(muxTaskId, output.id, output.codecpar)
+    }
+  }
+
   public async addTask(taskOptions: TaskOptions) {
     if (taskOptions.output.audio?.disable && taskOptions.output.video?.disable) {
       logger.fatal('audio and video are all disable')
     }
 
+    const videoConfig = taskOptions.output.video
+    if (videoConfig?.twoPass && !videoConfig.pass && !videoConfig.disable && videoConfig.codec !== 'copy') {
+      if (taskOptions.input.file instanceof CustomIOLoader) {
+        logger.warn('two-pass encoding need to read input twice, CustomIOLoader not support, encode with single pass')
+      }
+      else if (videoConfig.codec && !isTwoPassSupported(VideoCodecString2CodecId[videoConfig.codec])) {
+        logger.warn(`two-pass encoding not support for ${videoConfig.codec} encoder, encode with single pass`)
+      }
+      else {
+        const passStats = await this.runFirstPass(taskOptions)
+        if (passStats) {
+          taskOptions = {
+            ...taskOptions,
+            output: {
+              ...taskOptions.output,
+              video: {
+                ...videoConfig,
+                pass: 2,
+                passStats
+              }
+            }
+          }
+        }
+        else {
+          logger.warn('two-pass first pass got no stats, encode with single pass')
+        }
+      }
+    }
+    if (taskOptions.renditions?.length
+      && (taskOptions.output.video?.disable || taskOptions.output.video?.codec === 'copy')
+    ) {
+      logger.fatal('renditions need output video to be transcoded')
+    }
+
     const taskId = generateUUID()
     const stats = make<Stats>()
     const task: SelfTask = {
@@ -2102,21 +2636,54 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
       oformat: AVFormat.UNKNOWN,
       streams: [],
       formatContext: null,
-      controller: new Controller(this)
+      controller: new Controller(this),
+      renditions: (taskOptions.renditions ?? []).map((options) => {
+        return {
+          taskId: generateUUID(),
+          options,
+          muxer2OutputChannel: null,
+          oformat: AVFormat.UNKNOWN
+        }
+      }),
+      pendingOutputs: 1 + (taskOptions.renditions?.length ?? 0),
+      remux: false
     }
     try {
 
       let ret = 0
 
       await this.setTaskInput(task)
+      task.remux = this.canRemux(task)
       await this.setTaskOutput(task)
+      for (let i = 0; i < task.renditions.length; i++) {
+        await this.setTaskOutput(task, task.renditions[i])
+      }
 
       const formatContext = task.formatContext = await this.analyzeInputStreams(task)
 
-      await this.MuxThread.addFormatContextMetadata(
-        task.taskId,
-        object.extend({}, task.options.output.metadata ?? {}, formatContext.metadata)
-      )
+      if (task.remux) {
+        ret = await this.DemuxerThread.registerRemux
+          .transfer(task.muxer2OutputChannel.port1)
+          .invoke(task.taskId, {
+            format: task.oformat,
+            formatOptions: task.options.output.formatOptions,
+            rightPort: task.muxer2OutputChannel.port1,
+            zeroStart: task.options.startAtZero ?? false,
+            nonnegative: task.options.nonnegative ?? false
+          })
+        if (ret < 0) {
+          logger.fatal(`register remux task failed, ret: ${ret}, taskId: ${task.taskId}`)
+        }
+        logger.info(`all output streams are copy, remux in demuxer thread, taskId: ${task.taskId}`)
+      }
+
+      const metadata = object.extend({}, task.options.output.metadata ?? {}, formatContext.metadata)
+      if (task.remux) {
+        await this.DemuxerThread.addRemuxMetadata(task.taskId, metadata)
+      }
+      else {
+        await this.MuxThread.addFormatContextMetadata(task.taskId, metadata)
+      }
       if (formatContext.chapters.length || task.options.output.chapters?.length) {
         const chapters: AVChapter[] = []
         if (formatContext.chapters.length) {
@@ -2125,7 +2692,12 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
         if (task.options.output.chapters?.length) {
           chapters.push(...task.options.output.chapters)
         }
-        await this.MuxThread.addFormatContextChapters(task.taskId, chapters)
+        if (task.remux) {
+          await this.DemuxerThread.addRemuxChapters(task.taskId, chapters)
+        }
+        else {
+          await this.MuxThread.addFormatContextChapters(task.taskId, chapters)
+        }
       }
 
       task.iformat = formatContext.format
@@ -2171,6 +2743,14 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
             dumpUtils.dumpCodecName(stream.input.codecpar.codecType, stream.input.codecpar.codecId)} -> copy)\n`
         }
       })
+      task.renditions.forEach((rendition, index) => {
+        if (rendition.stream) {
+          mappingDump += `  Stream #0:${rendition.stream.input.index} -> #${index + 1}:0 (${
+            dumpUtils.dumpCodecName(rendition.stream.input.codecpar.codecType, rendition.stream.input.codecpar.codecId)
+          } -> ${dumpUtils.dumpCodecName(rendition.stream.output.codecpar.codecType, rendition.stream.output.codecpar.codecId)} ${
+            rendition.stream.output.codecpar.width}x${rendition.stream.output.codecpar.height})\n`
+        }
+      })
       logger.info(`\nAVTranscoder version ${defined(VERSION)} Copyright (c) 2024-present the libmedia developers\n`
         + dump([formatContext], [{
           from: is.string(task.options.input.file) ? task.options.input.file : (task.options.input.file instanceof File ? task.options.input.file.name : 'ioReader'),
@@ -2200,6 +2780,20 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
         await this.DemuxerThread.seek(task.taskId, static_cast<int64>(task.options.start), AVSeekFlags.TIMESTAMP)
       }
       let ret = 0
+
+      if (task.remux) {
+        ret = await this.DemuxerThread.startRemux(taskId)
+        if (ret < 0) {
+          await this.clearTask(task)
+          logger.fatal(`start remux error, ret ${ret}`)
+        }
+        task.startTime = getTimestamp()
+        if (!this.reportTimer.isStarted()) {
+          this.reportTimer.start()
+        }
+        return
+      }
+
       await this.DemuxerThread.startDemux(taskId, false, 10)
       ret = await this.MuxThread.open(taskId)
 
@@ -2211,46 +2805,25 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
       const streams = task.streams
 
       for (let i = 0; i < streams.length; i++) {
-        if (!streams[i].output) {
-          continue
-        }
-
-        let buffer: Uint8Array
-        let updated = false
-        if (streams[i].output.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_AUDIO) {
-          buffer = await this.AudioEncoderThread.getExtraData(streams[i].taskId)
-        }
-        else if (streams[i].output.codecpar.codecType === AVMediaType.AVMEDIA_TYPE_VIDEO) {
-          buffer = await this.VideoEncoderThread.getExtraData(streams[i].taskId)
-          const colorSpace = await this.VideoEncoderThread.getColorSpace(streams[i].taskId)
-          if (colorSpace) {
-            streams[i].output.codecpar.colorSpace = colorSpace.colorSpace
-            streams[i].output.codecpar.colorPrimaries = colorSpace.colorPrimaries
-            streams[i].output.codecpar.colorTrc = colorSpace.colorTrc
-            updated = true
-          }
+        if (streams[i].output) {
+          await this.updateOutputCodecParameters(task.taskId, streams[i].taskId, streams[i].output)
         }
-        if (!buffer) {
-          const codecId = streams[i].output.codecpar.codecId
-          if (codecId === AVCodecID.AV_CODEC_ID_AAC) {
-            buffer = aac.avCodecParameters2Extradata(accessof(streams[i].output.codecpar))
-          }
-          else if (codecId === AVCodecID.AV_CODEC_ID_OPUS) {
-            buffer = opus.avCodecParameters2Extradata(accessof(streams[i].output.codecpar))
-          }
+      }
+
+      for (let i = 0; i < task.renditions.length; i++) {
+        const rendition = task.renditions[i]
+        ret = await this.MuxThread.open(rendition.taskId)
+        if (ret < 0) {
+          await this.clearTask(task)
+          logger.fatal(`start transcode error, ret ${ret}`)
         }
-        if (buffer) {
-          const extradata: pointer<uint8> = avMalloc(buffer.length)
-          memcpyFromUint8Array(extradata, buffer.length, buffer)
-          if (streams[i].output.codecpar.extradata) {
-            avFree(streams[i].output.codecpar.extradata)
-          }
-          streams[i].output.codecpar.extradata = extradata
-          streams[i].output.codecpar.extradataSize = buffer.length
-          updated = true
+        if (rendition.stream) {
+          await this.updateOutputCodecParameters(rendition.taskId, rendition.stream.taskId, rendition.stream.output)
         }
-        if (updated) {
-          await this.MuxThread.updateAVCodecParameters(task.taskId, streams[i].output.id, streams[i].output.codecpar)
+        ret = await this.MuxThread.start(rendition.taskId)
+        if (ret < 0) {
+          await this.clearTask(task)
+          logger.fatal(`start transcode error, ret ${ret}`)
         }
       }
 
@@ -2274,7 +2847,10 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   public async pauseTask(taskId: string) {
     const task = this.tasks.get(taskId)
     if (task) {
-      await this.MuxThread.pause(taskId)
+      await this.pauseMux(task, taskId)
+      for (let i = 0; i < task.renditions.length; i++) {
+        await this.MuxThread.pause(task.renditions[i].taskId)
+      }
     }
     else {
       logger.fatal(`task ${taskId} not found`)
@@ -2284,7 +2860,10 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   public async unpauseTask(taskId: string) {
     const task = this.tasks.get(taskId)
     if (task) {
-      await this.MuxThread.unpause(taskId)
+      await this.unpauseMux(task, taskId)
+      for (let i = 0; i < task.renditions.length; i++) {
+        await this.MuxThread.unpause(task.renditions[i].taskId)
+      }
     }
     else {
       logger.fatal(`task ${taskId} not found`)
@@ -2294,7 +2873,10 @@ export default class AVTranscoder extends Emitter implements ControllerObserver
   public async cancelTask(taskId: string) {
     const task = this.tasks.get(taskId)
     if (task) {
-      await this.MuxThread.unpause(taskId)
+      await this.unpauseMux(task, taskId)
+      for (let i = 0; i < task.renditions.length; i++) {
+        await this.MuxThread.unpause(task.renditions[i].taskId)
+      }
       await this.clearTask(task)
     }
     else {
@@ -117,6 +117,23 @@ export default class AVFilterPipeline extends Pipeline {
     return 0
   }
 
+  /**
+   * 分离一个不再拉取的输出（比如多码率中提前结束的一档），其他输出不再等待它
+   * 
+   * @param taskId 
+   * @param id 输出端口对应的顶点 id
+   */
+  public async detachOutput(taskId: string, id: number) {
+    const task = this.tasks.get(taskId)
+    if (task) {
+      const index = task.outputPorts.findIndex((port) => port.id === id)
+      const vertex = task.filterGraph.outputs.find((vertex) => vertex.id === id)
+      if (index > -1 && vertex) {
+        vertex.filter.detachOutputNode(task.outputNodes[index])
+      }
+    }
+  }
+
   public async registerTask(options: AVFilterTaskOptions): Promise<number> {
     if (this.tasks.has(options.taskId)) {
       return errorType.INVALID_OPERATE
@@ -131,6 +148,7 @@ export default class AVFilterPipeline extends Pipeline {
         task.filterGraph.vertices[i].filter.disconnect()
         await task.filterGraph.vertices[i].filter.destroy()
       }
+      task.avframePool.clearVideoBufferPool()
       this.tasks.delete(taskId)
     }
   }
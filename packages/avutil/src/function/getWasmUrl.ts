@@ -4,7 +4,7 @@ import { AVCodecID } from '../codec'
 let supportAtomic = WebAssembly.validate(base64.base64ToUint8Array('AGFzbQEAAAABBgFgAX8BfwISAQNlbnYGbWVtb3J5AgMBgIACAwIBAAcJAQVsb2FkOAAACgoBCAAgAP4SAAAL'))
 let supportSimd = WebAssembly.validate(base64.base64ToUint8Array('AGFzbQEAAAABBQFgAAF7AhIBA2VudgZtZW1vcnkCAwGAgAIDAgEACgoBCABBAP0ABAAL'))
 
-export default function getWasmUrl(baseUrl: string, type: 'decoder' | 'encoder' | 'resampler' | 'scaler' | 'stretchpitcher', codecId?: AVCodecID): string {
+export default function getWasmUrl(baseUrl: string, type: 'decoder' | 'encoder' | 'resampler' | 'scaler' | 'stretchpitcher' | 'bsf' | 'yuv2rgba', codecId?: AVCodecID): string {
 
   let tag = defined(WASM_64) ? '-64' : (supportSimd ? '-simd' : (supportAtomic ? '-atomic' : ''))
 
@@ -186,5 +186,9 @@ export default function getWasmUrl(baseUrl: string, type: 'decoder' | 'encoder'
       return `${baseUrl}/scale/scale${tag}.wasm`
     case 'stretchpitcher':
       return `${baseUrl}/stretchpitch/stretchpitch${tag}.wasm`
+    case 'bsf':
+      return `${baseUrl}/bsf/bsf${tag}.wasm`
+    case 'yuv2rgba':
+      return `${baseUrl}/yuv2rgba/yuv2rgba${tag}.wasm`
   }
 }
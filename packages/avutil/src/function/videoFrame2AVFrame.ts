@@ -24,6 +24,7 @@
 
 import { createAVFrame, getVideoBuffer, unrefAVFrame } from '../util/avframe'
 import type AVFrame from '../struct/avframe'
+import type { AVFramePool } from '../struct/avframe'
 import { AVColorPrimaries, AVColorRange, AVColorSpace, AVColorTransferCharacteristic, AVPixelFormat } from '../pixfmt'
 import { getAVPixelFormatDescriptor } from '../pixelFormatDescriptor'
 import { getHeap } from '@libmedia/cheap/internal'
@@ -46,7 +47,18 @@ export function mapColorTrc(colorTrc: VideoTransferCharacteristics) {
   return colorTrcMap[colorTrc] ?? AVColorTransferCharacteristic.AVCOL_TRC_BT709
 }
 
-export async function videoFrame2AVFrame<T extends pointer<AVFrame> = pointer<AVFrame>>(videoFrame: VideoFrame, avframe: T = nullptr) {
+/**
+ * VideoFrame 拷贝到 AVFrame
+ * 
+ * @param videoFrame 
+ * @param avframe 
+ * @param avframePool 传入的 pool 实现了 getVideoBuffer 时从池子中复用帧 buffer
+ */
+export async function videoFrame2AVFrame<T extends pointer<AVFrame> = pointer<AVFrame>>(
+  videoFrame: VideoFrame,
+  avframe: T = nullptr,
+  avframePool?: AVFramePool
+) {
   if (avframe === nullptr) {
     avframe = createAVFrame() as T
   }
@@ -75,7 +87,12 @@ export async function videoFrame2AVFrame<T extends pointer<AVFrame> = pointer<AV
     avframe.cropBottom = reinterpret_cast<size>(videoFrame.codedHeight - videoFrame.visibleRect.bottom)
   }
 
-  getVideoBuffer(avframe)
+  if (avframePool?.getVideoBuffer) {
+    avframePool.getVideoBuffer(avframe)
+  }
+  else {
+    getVideoBuffer(avframe)
+  }
 
   const des = getAVPixelFormatDescriptor(avframe.format as AVPixelFormat)
   const layout: PlaneLayout[] = []
@@ -24,26 +24,47 @@
  */
 
 import type { AVFramePool } from '../struct/avframe'
+import type AVFrame from '../struct/avframe'
 import { AVFrameRef } from '../struct/avframe'
+import { AVBufferRef } from '../struct/avbuffer'
 import { avMallocz } from '../util/mem'
-import { getAVFrameDefault, unrefAVFrame } from '../util/avframe'
+import { getAVFrameDefault, getVideoBuffer, unrefAVFrame } from '../util/avframe'
+import { avbufferRef, avbufferUnref } from '../util/avbuffer'
 
 import {
   type List,
   type Mutex,
   atomics,
-  mutex
+  mutex,
+  stack
 } from '@libmedia/cheap'
 
+interface VideoBufferPool {
+  linesize: int32[]
+  // 每个 plane 相对 buffer 起始的偏移
+  offset: size[]
+  plane: boolean[]
+  // 池子自己持有的引用，引用计数为 1 时表示没有帧在使用
+  buffers: pointer<AVBufferRef>[]
+}
+
+// 每种格式尺寸最多缓存的 buffer 数
+const VIDEO_BUFFER_POOL_MAX = 8
+// 最多缓存的格式尺寸种类
+const VIDEO_BUFFER_POOL_KEY_MAX = 4
+
 export default class AVFramePoolImpl implements AVFramePool {
 
   private list: List<pointer<AVFrameRef>>
 
   private mutex: pointer<Mutex>
 
+  private videoBufferPools: Map<string, VideoBufferPool>
+
   constructor(list: List<pointer<AVFrameRef>>, mutex?: pointer<Mutex>) {
     this.list = list
     this.mutex = mutex
+    this.videoBufferPools = new Map()
   }
 
   public alloc(): pointer<AVFrameRef> {
@@ -80,4 +101,92 @@ export default class AVFramePoolImpl implements AVFramePool {
       atomics.store(addressof(avframe.refCount), -1)
     }
   }
+
+  /**
+   * 按 format/width/height 从池子中给视频帧分配 buffer，同 getVideoBuffer
+   * 
+   * 池子始终持有每个 buffer 的一个引用，帧（包括在其他线程或 wasm 中）释放之后引用计数回到 1，
+   * buffer 不会被释放，下次分配直接复用，不需要每帧 malloc 大块内存
+   * 
+   * @param avframe 
+   * @returns 
+   */
+  public getVideoBuffer(avframe: pointer<AVFrame>): int32 {
+    const key = `${avframe.format}_${avframe.width}_${avframe.height}`
+    let pool = this.videoBufferPools.get(key)
+
+    if (pool) {
+      for (let i = 0; i < pool.buffers.length; i++) {
+        const buffer = pool.buffers[i]
+        if (atomics.compareExchange(addressof(buffer.buffer.refcount), 1, 2) === 1) {
+          const ref = reinterpret_cast<pointer<AVBufferRef>>(avMallocz(sizeof(AVBufferRef)))
+          ref.buffer = buffer.buffer
+          ref.data = buffer.data
+          ref.size = buffer.size
+          avframe.buf[0] = ref
+          for (let j = 0; j < 4; j++) {
+            avframe.linesize[j] = pool.linesize[j]
+            avframe.data[j] = pool.plane[j]
+              ? reinterpret_cast<pointer<uint8>>(buffer.data + pool.offset[j])
+              : nullptr
+          }
+          avframe.extendedData = addressof(avframe.data)
+          return 0
+        }
+      }
+    }
+
+    const ret = getVideoBuffer(avframe)
+    if (ret < 0) {
+      return ret
+    }
+
+    if (!pool) {
+      if (this.videoBufferPools.size >= VIDEO_BUFFER_POOL_KEY_MAX) {
+        // 尺寸变化之后旧的尺寸一般不会再用到
+        const oldest = this.videoBufferPools.keys().next().value
+        this.freeVideoBufferPool(this.videoBufferPools.get(oldest))
+        this.videoBufferPools.delete(oldest)
+      }
+      pool = {
+        linesize: [],
+        offset: [],
+        plane: [],
+        buffers: []
+      }
+      for (let i = 0; i < 4; i++) {
+        pool.linesize[i] = avframe.linesize[i]
+        pool.plane[i] = !!avframe.data[i]
+        pool.offset[i] = avframe.data[i]
+          ? reinterpret_cast<size>(avframe.data[i]) - reinterpret_cast<size>(avframe.buf[0].data)
+          : 0
+      }
+      this.videoBufferPools.set(key, pool)
+    }
+    if (pool.buffers.length < VIDEO_BUFFER_POOL_MAX) {
+      pool.buffers.push(avbufferRef(avframe.buf[0]))
+    }
+    return 0
+  }
+
+  private freeVideoBufferPool(pool: VideoBufferPool) {
+    const p = reinterpret_cast<pointer<pointer<AVBufferRef>>>(stack.malloc(sizeof(pointer)))
+    for (let i = 0; i < pool.buffers.length; i++) {
+      // 还在使用中的 buffer 由最后一个使用者释放
+      accessof(p) <- pool.buffers[i]
+      avbufferUnref(p)
+    }
+    stack.free(sizeof(pointer))
+    pool.buffers.length = 0
+  }
+
+  /**
+   * 释放池子持有的视频 buffer
+   */
+  public clearVideoBufferPool() {
+    this.videoBufferPools.forEach((pool) => {
+      this.freeVideoBufferPool(pool)
+    })
+    this.videoBufferPools.clear()
+  }
 }
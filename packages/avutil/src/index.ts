@@ -86,6 +86,14 @@ export {
   BufferPoolEntry
 } from './struct/avbuffer'
 
+export {
+  AVRing
+} from './struct/avring'
+
+export {
+  AVByteRing
+} from './struct/avbytering'
+
 export {
   AVChannelCustom,
   AVChannelLayout
@@ -232,6 +240,8 @@ export {
 } from './util/codecparameters'
 
 export * as avbuffer from './util/avbuffer'
+export * as avring from './util/avring'
+export * as avbytering from './util/avbytering'
 export * as avdict from './util/avdict'
 export * as intread from './util/intread'
 export * as intwrite from './util/intwrite'
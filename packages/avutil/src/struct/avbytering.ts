@@ -0,0 +1,57 @@
+/*
+ * libmedia AVByteRing defined
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+/**
+ * 单生产者单消费者字节环形缓冲区
+ * 
+ * 存放在共享内存中，IO 线程提前把数据读进来，解封装线程直接从中拷贝，不需要每次都发消息请求
+ */
+@struct
+export class AVByteRing {
+  /**
+   * 数据缓冲区，长度为 capacity
+   */
+  buffer: pointer<uint8> = nullptr
+
+  /**
+   * 缓冲区大小，必须是 2 的幂
+   */
+  capacity: int32 = 0
+
+  /**
+   * 已写入的字节数，只有生产者修改
+   */
+  head: atomic_int32 = 0
+
+  /**
+   * 已读取的字节数，只有消费者修改
+   */
+  tail: atomic_int32 = 0
+
+  /**
+   * 生产者结束时的返回码（IOError.END 或者错误码），0 表示还在写入
+   */
+  ended: atomic_int32 = 0
+}
@@ -660,4 +660,8 @@ export class AVFrameRef extends AVFrame {
 export interface AVFramePool {
   alloc: () => pointer<AVFrameRef>
   release: (avframe: pointer<AVFrameRef>) => void
+  /**
+   * 从池子中分配视频帧 buffer，没有实现时使用 getVideoBuffer 每次新分配
+   */
+  getVideoBuffer?: (avframe: pointer<AVFrame>) => int32
 }
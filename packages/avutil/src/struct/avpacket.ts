@@ -69,7 +69,12 @@ export const enum AVPacketFlags {
   /**
    * 对于 h264/h265/h266 标记是否是 annexb 码流格式，未置此标志则为 avcc 格式
    */
-  AV_PKT_FLAG_H26X_ANNEXB = 64
+  AV_PKT_FLAG_H26X_ANNEXB = 64,
+
+  /**
+   * 对于 annexb 格式的 h264/h265/h266 关键帧标记其中带有参数集，由解封装时设置
+   */
+  AV_PKT_FLAG_H26X_PARAM_SET = 128
 }
 
 @struct
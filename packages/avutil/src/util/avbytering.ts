@@ -0,0 +1,190 @@
+/*
+ * libmedia AVByteRing util
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type { AVByteRing } from '../struct/avbytering'
+import { avFree, avMalloc } from './mem'
+import * as errorType from '../error'
+
+import { atomics, memcpy } from '@libmedia/cheap'
+
+/**
+ * 初始化字节环形缓冲区
+ * 
+ * @param ring 
+ * @param capacity 字节数，向上取整到 2 的幂
+ */
+export function avbyteringInit(ring: pointer<AVByteRing>, capacity: int32) {
+  let count = 1
+  while (count < capacity) {
+    count <<= 1
+  }
+  ring.buffer = reinterpret_cast<pointer<uint8>>(avMalloc(static_cast<size>(count)))
+  if (!ring.buffer) {
+    return errorType.NO_MEMORY
+  }
+  ring.capacity = count
+  atomics.store(addressof(ring.head), 0)
+  atomics.store(addressof(ring.tail), 0)
+  atomics.store(addressof(ring.ended), 0)
+  return 0
+}
+
+/**
+ * 销毁字节环形缓冲区，需要生产者和消费者都已经停止
+ * 
+ * @param ring 
+ */
+export function avbyteringDestroy(ring: pointer<AVByteRing>) {
+  if (!ring.buffer) {
+    return
+  }
+  avFree(ring.buffer)
+  ring.buffer = nullptr
+  ring.capacity = 0
+}
+
+/**
+ * 当前可读的字节数
+ * 
+ * @param ring 
+ */
+export function avbyteringSize(ring: pointer<AVByteRing>) {
+  return (atomics.load(addressof(ring.head)) - atomics.load(addressof(ring.tail))) | 0
+}
+
+/**
+ * 生产者当前可以连续写入的字节数（到缓冲区末尾为止）
+ * 
+ * @param ring 
+ */
+export function avbyteringWritable(ring: pointer<AVByteRing>) {
+  const head = atomics.load(addressof(ring.head))
+  const space = ring.capacity - avbyteringSize(ring)
+  return Math.min(space, ring.capacity - (head & (ring.capacity - 1)))
+}
+
+/**
+ * 生产者写入位置
+ * 
+ * @param ring 
+ */
+export function avbyteringWritePointer(ring: pointer<AVByteRing>) {
+  return reinterpret_cast<pointer<uint8>>(ring.buffer + (atomics.load(addressof(ring.head)) & (ring.capacity - 1)))
+}
+
+/**
+ * 生产者提交写入位置开始的 length 个字节，唤醒等待中的消费者
+ * 
+ * @param ring 
+ * @param length 
+ */
+export function avbyteringCommit(ring: pointer<AVByteRing>, length: int32) {
+  atomics.store(addressof(ring.head), (atomics.load(addressof(ring.head)) + length) | 0)
+  atomics.notify(addressof(ring.head), 1)
+}
+
+/**
+ * 消费者读取最多 length 个字节到 dst，返回读取的字节数
+ * 
+ * @param ring 
+ * @param dst 
+ * @param length 
+ */
+export function avbyteringRead(ring: pointer<AVByteRing>, dst: pointer<uint8>, length: int32) {
+  const tail = atomics.load(addressof(ring.tail))
+  const len = Math.min(length, avbyteringSize(ring))
+  if (len <= 0) {
+    return 0
+  }
+  const offset = tail & (ring.capacity - 1)
+  const first = Math.min(len, ring.capacity - offset)
+  memcpy(dst, reinterpret_cast<pointer<uint8>>(ring.buffer + offset), first)
+  if (len > first) {
+    memcpy(reinterpret_cast<pointer<uint8>>(dst + first), ring.buffer, len - first)
+  }
+  atomics.store(addressof(ring.tail), (tail + len) | 0)
+  atomics.notify(addressof(ring.tail), 1)
+  return len
+}
+
+/**
+ * 生产者结束写入
+ * 
+ * @param ring 
+ * @param code IOError.END 或者错误码
+ */
+export function avbyteringEnd(ring: pointer<AVByteRing>, code: int32) {
+  atomics.store(addressof(ring.ended), code)
+  atomics.notify(addressof(ring.head), 1)
+}
+
+/**
+ * 清空缓冲区（seek 之后），需要生产者已经停止并且消费者没有在读
+ * 
+ * @param ring 
+ */
+export function avbyteringReset(ring: pointer<AVByteRing>) {
+  atomics.store(addressof(ring.head), 0)
+  atomics.store(addressof(ring.tail), 0)
+  atomics.store(addressof(ring.ended), 0)
+}
+
+/**
+ * 唤醒所有在等待的生产者和消费者
+ * 
+ * @param ring 
+ */
+export function avbyteringWakeup(ring: pointer<AVByteRing>) {
+  atomics.notify(addressof(ring.head), 1)
+  atomics.notify(addressof(ring.tail), 1)
+}
+
+/**
+ * 消费者等待新数据写入或者生产者结束
+ * 
+ * @param ring 
+ * @param timeout 毫秒
+ */
+export async function avbyteringWaitData(ring: pointer<AVByteRing>, timeout: int32) {
+  const head = atomics.load(addressof(ring.head))
+  if (head !== atomics.load(addressof(ring.tail)) || atomics.load(addressof(ring.ended))) {
+    return
+  }
+  await atomics.waitTimeoutAsync(addressof(ring.head), head, timeout)
+}
+
+/**
+ * 生产者等待消费者读出空间
+ * 
+ * @param ring 
+ * @param timeout 毫秒
+ */
+export async function avbyteringWaitSpace(ring: pointer<AVByteRing>, timeout: int32) {
+  const tail = atomics.load(addressof(ring.tail))
+  if (avbyteringSize(ring) < ring.capacity) {
+    return
+  }
+  await atomics.waitTimeoutAsync(addressof(ring.tail), tail, timeout)
+}
@@ -0,0 +1,164 @@
+/*
+ * libmedia AVRing util
+ *
+ * 版权所有 (C) 2024 赵高兴
+ * Copyright (C) 2024 Gaoxing Zhao
+ *
+ * 此文件是 libmedia 的一部分
+ * This file is part of libmedia.
+ * 
+ * libmedia 是自由软件；您可以根据 GNU Lesser General Public License（GNU LGPL）3.1
+ * 或任何其更新的版本条款重新分发或修改它
+ * libmedia is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.1 of the License, or (at your option) any later version.
+ * 
+ * libmedia 希望能够为您提供帮助，但不提供任何明示或暗示的担保，包括但不限于适销性或特定用途的保证
+ * 您应自行承担使用 libmedia 的风险，并且需要遵守 GNU Lesser General Public License 中的条款和条件。
+ * libmedia is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ */
+
+import type { AVRing } from '../struct/avring'
+import { avFree, avMallocz } from './mem'
+import * as errorType from '../error'
+
+import { atomics } from '@libmedia/cheap'
+
+/**
+ * 初始化环形队列
+ * 
+ * @param ring 
+ * @param capacity 槽位数量，向上取整到 2 的幂
+ */
+export function avringInit(ring: pointer<AVRing>, capacity: int32) {
+  let count = 1
+  while (count < capacity) {
+    count <<= 1
+  }
+  ring.buffer = reinterpret_cast<pointer<pointer<void>>>(avMallocz(sizeof(pointer) * static_cast<size>(count)))
+  if (!ring.buffer) {
+    return errorType.NO_MEMORY
+  }
+  ring.capacity = count
+  atomics.store(addressof(ring.head), 0)
+  atomics.store(addressof(ring.tail), 0)
+  atomics.store(addressof(ring.ended), 0)
+  return 0
+}
+
+/**
+ * 销毁环形队列，release 用于回收队列中还未被消费的数据
+ * 
+ * @param ring 
+ * @param release 
+ */
+export function avringDestroy(ring: pointer<AVRing>, release?: (data: pointer<void>) => void) {
+  if (!ring.buffer) {
+    return
+  }
+  let data: pointer<void>
+  while (data = avringPop(ring)) {
+    if (release) {
+      release(data)
+    }
+  }
+  avFree(ring.buffer)
+  ring.buffer = nullptr
+  ring.capacity = 0
+}
+
+/**
+ * 当前队列中的数据个数
+ * 
+ * @param ring 
+ */
+export function avringSize(ring: pointer<AVRing>) {
+  return (atomics.load(addressof(ring.head)) - atomics.load(addressof(ring.tail))) | 0
+}
+
+/**
+ * 生产者写入数据，队列已满返回 false
+ * 
+ * @param ring 
+ * @param data 
+ */
+export function avringPush(ring: pointer<AVRing>, data: pointer<void>) {
+  const head = atomics.load(addressof(ring.head))
+  if (((head - atomics.load(addressof(ring.tail))) | 0) >= ring.capacity) {
+    return false
+  }
+  ring.buffer[head & (ring.capacity - 1)] = data
+  // store 之后消费者才能看到这个槽位
+  atomics.store(addressof(ring.head), (head + 1) | 0)
+  atomics.notify(addressof(ring.head), 1)
+  return true
+}
+
+/**
+ * 取出一个数据，队列为空返回 nullptr
+ * 
+ * 使用 CAS 推进读计数，生产者在消费者暂停时（seek、切流）也可以安全地清空队列
+ * 
+ * @param ring 
+ */
+export function avringPop(ring: pointer<AVRing>): pointer<void> {
+  while (true) {
+    const tail = atomics.load(addressof(ring.tail))
+    if (tail === atomics.load(addressof(ring.head))) {
+      return nullptr
+    }
+    const data = ring.buffer[tail & (ring.capacity - 1)]
+    if (atomics.compareExchange(addressof(ring.tail), tail, (tail + 1) | 0) === tail) {
+      return data
+    }
+  }
+}
+
+/**
+ * 标记生产者结束，唤醒等待中的消费者
+ * 
+ * @param ring 
+ */
+export function avringEnd(ring: pointer<AVRing>) {
+  atomics.store(addressof(ring.ended), 1)
+  atomics.notify(addressof(ring.head), 1)
+}
+
+/**
+ * 生产者重新开始写入（seek 之后）
+ * 
+ * @param ring 
+ */
+export function avringRestart(ring: pointer<AVRing>) {
+  atomics.store(addressof(ring.ended), 0)
+}
+
+/**
+ * 队列是否已经结束并且被消费完
+ * 
+ * @param ring 
+ */
+export function avringIsEnded(ring: pointer<AVRing>) {
+  return atomics.load(addressof(ring.ended)) === 1 && avringSize(ring) === 0
+}
+
+/**
+ * 消费者等待新数据写入或者生产者结束
+ * 
+ * 使用 waitAsync 不会阻塞线程的事件循环，timeout 之后返回由调用者重新检查
+ * 
+ * @param ring 
+ * @param timeout 毫秒
+ */
+export async function avringWait(ring: pointer<AVRing>, timeout: int32) {
+  const head = atomics.load(addressof(ring.head))
+  if (head !== atomics.load(addressof(ring.tail)) || atomics.load(addressof(ring.ended))) {
+    return
+  }
+  await atomics.waitTimeoutAsync(addressof(ring.head), head, timeout)
+}
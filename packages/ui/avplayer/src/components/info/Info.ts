@@ -28,7 +28,8 @@ const videoStatsKeys = [
   'videoRenderFramerate',
   'keyFrameInterval',
   'videoFrameDecodeIntervalMax',
-  'videoFrameRenderIntervalMax'
+  'videoFrameRenderIntervalMax',
+  'videoPacketHandoffTime'
 ]
 
 const Info: ComponentOptions = {
@@ -75,6 +76,9 @@ const Info: ComponentOptions = {
         if (key === 'audioBitrate' || key === 'videoBitrate' || key === 'bandwidth') {
           value = (value * 8 / 1000) + ' kbps'
         }
+        else if (key === 'videoPacketHandoffTime') {
+          value = value.toFixed(3) + ' ms'
+        }
         this.append('list', {
           key: key.replace(/([A-Z])/g, ' $1').replace(/^[a-z]/, (s) => s.toUpperCase()),
           value